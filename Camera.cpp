@@ -0,0 +1,68 @@
+// October 18, 2026
+
+#include "Camera.hpp"
+
+#include <cmath>
+
+// ***** Public methods *****
+
+void Camera::update(float time, float aspect, float pathLength) {
+    // Down the street along the x axis, looking a little from side to side
+    const float speed = 10.f;
+    position[0] = std::fmod(time * speed, pathLength) - pathLength / 2.f;
+    position[1] = 4.f + 2.f * std::sin(time * 0.2f);
+    position[2] = 0.f;
+    float yaw = 0.4f * std::sin(time * 0.3f);
+    float forward[3] = { std::cos(yaw), -0.05f, std::sin(yaw) };
+    float forwardLength = std::sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+    for (float& component : forward) {
+        component /= forwardLength;
+    }
+
+    // The view looks down -z, with x right and y up. right = forward x up,
+    // with up being +y
+    float right[3] = { -forward[2], 0.f, forward[0] };
+    float rightLength = std::sqrt(right[0] * right[0] + right[2] * right[2]);
+    right[0] /= rightLength;
+    right[2] /= rightLength;
+    float up[3] = {
+        right[1] * forward[2] - right[2] * forward[1],
+        right[2] * forward[0] - right[0] * forward[2],
+        right[0] * forward[1] - right[1] * forward[0],
+    };
+
+    float view[16] = {
+        right[0], up[0], -forward[0], 0.f,
+        right[1], up[1], -forward[1], 0.f,
+        right[2], up[2], -forward[2], 0.f,
+        0.f, 0.f, 0.f, 1.f,
+    };
+    for (int row = 0; row < 3; row++) {
+        view[12 + row] = -(view[row] * position[0] + view[4 + row] * position[1] + view[8 + row] * position[2]);
+    }
+
+    // y is flipped for Vulkan, and depth maps to [0, 1]
+    float focal = 1.f / std::tan(FIELD_OF_VIEW / 2.f);
+    float projection[16] = {
+        focal / aspect, 0.f, 0.f, 0.f,
+        0.f, -focal, 0.f, 0.f,
+        0.f, 0.f, FAR_PLANE / (NEAR_PLANE - FAR_PLANE), -1.f,
+        0.f, 0.f, NEAR_PLANE * FAR_PLANE / (NEAR_PLANE - FAR_PLANE), 0.f,
+    };
+
+    multiply(projection, view, viewProjection);
+}
+
+// ***** Private methods *****
+
+void Camera::multiply(const float* a, const float* b, float* result) {
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.f;
+            for (int i = 0; i < 4; i++) {
+                sum += a[i * 4 + row] * b[column * 4 + i];
+            }
+            result[column * 4 + row] = sum;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+// October 18, 2026
+
+#pragma once
+
+/**
+ * A camera flying at street level down the middle of the scene, on a fixed
+ * path so frames are repeatable for benchmarking.
+ *
+ * Matrices are column-major, as GLSL expects them, and project to Vulkan's
+ * clip space: y points down and depth goes from 0 at the near plane to 1 at
+ * the far plane.
+ */
+class Camera {
+public:
+    /** The distances to the near and far planes */
+    inline static const float NEAR_PLANE = 0.1f;
+    inline static const float FAR_PLANE = 1000.f;
+    /** The vertical field of view, in radians */
+    inline static const float FIELD_OF_VIEW = 1.0f;
+
+    /**
+     * Moves the camera to where it is at a point in time, and updates the
+     * matrices
+     *
+     * @param time The time in seconds
+     * @param aspect The width of the view divided by its height
+     * @param pathLength The length of the path along the x axis, centered on
+     *                   the origin, after which the camera starts over
+     */
+    void update(float time, float aspect, float pathLength);
+
+    /**
+     * @return The projection matrix times the view matrix, as 16 floats
+     */
+    const float* getViewProjection() const { return viewProjection; }
+
+    /**
+     * @return The position of the camera, as 3 floats
+     */
+    const float* getPosition() const { return position; }
+
+private:
+    float position[3] = { 0.f, 0.f, 0.f };
+    float viewProjection[16] = {};
+
+    /**
+     * Multiplies two column-major 4x4 matrices
+     *
+     * @param result Set to a times b. Must not be a or b
+     */
+    static void multiply(const float* a, const float* b, float* result);
+};
@@ -0,0 +1,300 @@
+// October 18, 2026
+
+#include "CompletionService.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+// ***** Public methods *****
+
+void CompletionService::initialize(vk::Device device, bool timelineSupported) {
+    this->device = device;
+    this->timelineSupported = timelineSupported;
+
+    if (timelineSupported) {
+        // Load the timeline functions. They are not loaded by default because
+        // they are from an extension
+        getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR) device.getProcAddr("vkGetSemaphoreCounterValueKHR");
+        waitSemaphores = (PFN_vkWaitSemaphoresKHR) device.getProcAddr("vkWaitSemaphoresKHR");
+        signalSemaphore = (PFN_vkSignalSemaphoreKHR) device.getProcAddr("vkSignalSemaphoreKHR");
+
+        if (getSemaphoreCounterValue == nullptr || waitSemaphores == nullptr || signalSemaphore == nullptr) {
+            throw std::runtime_error("ERROR: Could not load timeline semaphore functions.");
+        }
+
+        wakeSemaphore = createTimelineSemaphore();
+        wakeValue = 0;
+    }
+
+    running = true;
+    worker = std::thread(&CompletionService::workerLoop, this);
+}
+
+void CompletionService::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        wakeWorkerLocked();
+    }
+    workAvailable.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    // Everything has finished on the GPU, so every remaining callback can run
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& pending : pendingFences) {
+            completed.push_back(std::move(pending.callback));
+        }
+        for (auto& pending : pendingTimelines) {
+            completed.push_back(std::move(pending.callback));
+        }
+        pendingFences.clear();
+        pendingTimelines.clear();
+    }
+    dispatchCompleted();
+
+    for (vk::Fence fence : allFences) {
+        device.destroyFence(fence);
+    }
+    allFences.clear();
+    freeFences.clear();
+
+    for (const QueueTimeline& timeline : queueTimelines) {
+        device.destroySemaphore(timeline.semaphore);
+    }
+    queueTimelines.clear();
+    device.destroySemaphore(wakeSemaphore);
+    wakeSemaphore = nullptr;
+}
+
+vk::Fence CompletionService::acquireFence() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (freeFences.empty()) {
+        // Fences in the pool start unsignaled, unlike the frame fences
+        vk::Fence fence = device.createFence(vk::FenceCreateInfo{});
+        allFences.push_back(fence);
+        return fence;
+    }
+
+    vk::Fence fence = freeFences.back();
+    freeFences.pop_back();
+    return fence;
+}
+
+void CompletionService::onFence(vk::Fence fence, Callback callback) {
+    bool pooled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // A fence from the pool is recycled by the worker once signaled
+        for (vk::Fence pooledFence : allFences) {
+            if (pooledFence == fence) {
+                pooled = true;
+                break;
+            }
+        }
+        pendingFences.push_back({ fence, std::move(callback), pooled });
+        wakeWorkerLocked();
+    }
+    workAvailable.notify_one();
+}
+
+void CompletionService::onTimeline(vk::Semaphore semaphore, uint64_t value, Callback callback) {
+    if (!timelineSupported) {
+        throw std::runtime_error("ERROR: CompletionService::onTimeline() requires timeline semaphores.");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingTimelines.push_back({ semaphore, value, std::move(callback) });
+        wakeWorkerLocked();
+    }
+    workAvailable.notify_one();
+}
+
+void CompletionService::onQueueComplete(vk::Queue queue, Callback callback) {
+    if (timelineSupported) {
+        // Each queue gets its own timeline, since values must be signaled in
+        // increasing order
+        auto timeline = std::find_if(queueTimelines.begin(), queueTimelines.end(),
+                                     [queue](const QueueTimeline& t) { return t.queue == queue; });
+        if (timeline == queueTimelines.end()) {
+            queueTimelines.push_back({ queue, createTimelineSemaphore(), 0 });
+            timeline = queueTimelines.end() - 1;
+        }
+        uint64_t value = ++timeline->value;
+
+        vk::TimelineSemaphoreSubmitInfoKHR timelineInfo{};
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &value;
+        vk::SubmitInfo submitInfo{};
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timeline->semaphore;
+        queue.submit(submitInfo, nullptr);
+
+        onTimeline(timeline->semaphore, value, std::move(callback));
+        return;
+    }
+
+    vk::Fence fence = acquireFence();
+
+    // A submission with no command buffers only signals its fence once all of
+    // the previously submitted work on the queue has completed
+    queue.submit(nullptr, fence);
+
+    onFence(fence, std::move(callback));
+}
+
+void CompletionService::dispatchCompleted() {
+    // Take the callbacks out first, so a callback can register more work
+    // without deadlocking
+    std::deque<Callback> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(completed);
+    }
+
+    for (auto& callback : ready) {
+        callback();
+    }
+}
+
+vk::Semaphore CompletionService::createTimelineSemaphore(uint64_t initialValue) {
+    if (!timelineSupported) {
+        throw std::runtime_error("ERROR: CompletionService::createTimelineSemaphore() requires timeline semaphores.");
+    }
+
+    vk::SemaphoreTypeCreateInfoKHR typeInfo{};
+    typeInfo.semaphoreType = vk::SemaphoreTypeKHR::eTimeline;
+    typeInfo.initialValue = initialValue;
+
+    vk::SemaphoreCreateInfo createInfo{};
+    createInfo.pNext = &typeInfo;
+
+    return device.createSemaphore(createInfo);
+}
+
+size_t CompletionService::pendingCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pendingFences.size() + pendingTimelines.size() + completed.size();
+}
+
+// ***** Private methods *****
+
+void CompletionService::workerLoop() {
+    std::vector<vk::Fence> fences;
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this]() {
+                return !running || !pendingFences.empty() || !pendingTimelines.empty();
+            });
+
+            if (!running) {
+                return;
+            }
+
+            // Copy the handles so the GPU can be waited on without the lock.
+            // Only this thread removes pending work, so the handles stay
+            // valid. Any work registered from now on signals the next wake
+            fences.clear();
+            for (const auto& pending : pendingFences) {
+                fences.push_back(pending.fence);
+            }
+            semaphores.clear();
+            values.clear();
+            for (const auto& pending : pendingTimelines) {
+                semaphores.push_back(static_cast<VkSemaphore>(pending.semaphore));
+                values.push_back(pending.value);
+            }
+            if (!semaphores.empty()) {
+                semaphores.push_back(static_cast<VkSemaphore>(wakeSemaphore));
+                values.push_back(wakeValue + 1);
+            }
+        }
+
+        // Wait until any of the work completes, or with timelines until new
+        // work is registered. Once the device is lost nothing will complete,
+        // so the worker stops and leaves the callbacks to destroy(), which
+        // the app calls before recreating the device
+        try {
+            if (!fences.empty()) {
+                device.waitForFences(fences, VK_FALSE, UINT64_MAX);
+            } else if (!semaphores.empty()) {
+                VkSemaphoreWaitInfoKHR waitInfo{};
+                waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+                waitInfo.flags = VK_SEMAPHORE_WAIT_ANY_BIT_KHR;
+                waitInfo.semaphoreCount = (uint32_t)semaphores.size();
+                waitInfo.pSemaphores = semaphores.data();
+                waitInfo.pValues = values.data();
+                if (waitSemaphores(static_cast<VkDevice>(device), &waitInfo, UINT64_MAX) ==
+                    VK_ERROR_DEVICE_LOST) {
+                    return;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            collectCompleted();
+        } catch (const vk::DeviceLostError&) {
+            return;
+        }
+    }
+}
+
+void CompletionService::collectCompleted() {
+    // Fences are swapped out of the vector as they complete, so iterate by
+    // index instead of with an iterator
+    for (size_t i = 0; i < pendingFences.size();) {
+        PendingFence& pending = pendingFences[i];
+
+        if (device.getFenceStatus(pending.fence) != vk::Result::eSuccess) {
+            i++;
+            continue;
+        }
+
+        if (pending.pooled) {
+            // Only this thread touches a pooled fence while it is pending, so
+            // it can be reset without further synchronization
+            device.resetFences(pending.fence);
+            freeFences.push_back(pending.fence);
+        }
+        completed.push_back(std::move(pending.callback));
+
+        pendingFences[i] = std::move(pendingFences.back());
+        pendingFences.pop_back();
+    }
+
+    for (size_t i = 0; i < pendingTimelines.size();) {
+        PendingTimeline& pending = pendingTimelines[i];
+
+        uint64_t value = 0;
+        getSemaphoreCounterValue(static_cast<VkDevice>(device), static_cast<VkSemaphore>(pending.semaphore), &value);
+        if (value < pending.value) {
+            i++;
+            continue;
+        }
+
+        completed.push_back(std::move(pending.callback));
+
+        pendingTimelines[i] = std::move(pendingTimelines.back());
+        pendingTimelines.pop_back();
+    }
+}
+
+void CompletionService::wakeWorkerLocked() {
+    if (!wakeSemaphore) {
+        return;
+    }
+
+    VkSemaphoreSignalInfoKHR signalInfo{};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO_KHR;
+    signalInfo.semaphore = static_cast<VkSemaphore>(wakeSemaphore);
+    signalInfo.value = ++wakeValue;
+    signalSemaphore(static_cast<VkDevice>(device), &signalInfo);
+}
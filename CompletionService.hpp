@@ -0,0 +1,216 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * A background service that watches submitted GPU work and fires callbacks
+ * once that work has completed. Work can be tracked either by a fence or by a
+ * value on a timeline semaphore.
+ *
+ * The waiting is done on a worker thread, but the callbacks themselves are
+ * run on the main thread from dispatchCompleted(), so they are free to touch
+ * externally synchronized objects (command pools, memory, etc.) without any
+ * extra locking. dispatchCompleted() never blocks, so the main thread never
+ * has to wait on a fence just to reclaim a resource.
+ *
+ * The worker waits on the GPU without a timeout. With timeline semaphores,
+ * onQueueComplete() signals a timeline of the queue instead of a fence, and
+ * the worker also waits on a wake semaphore that is signaled from the host
+ * whenever work is registered, so new work is picked up right away. Without
+ * them, or while fences are pending, new work is picked up once any of the
+ * fences being waited on is signaled. Work on one queue completes in order,
+ * so work registered later on the same queue is not delayed by that.
+ */
+class CompletionService {
+public:
+    /** The type of function run once tracked work is complete */
+    using Callback = std::function<void()>;
+
+    /**
+     * Starts the worker thread for the given device
+     *
+     * @param device The logical device that the fences and semaphores belong
+     *               to
+     * @param timelineSupported Whether VK_KHR_timeline_semaphore is enabled on
+     *                          the device, which allows onTimeline() and
+     *                          createTimelineSemaphore() to be used
+     */
+    void initialize(vk::Device device, bool timelineSupported);
+
+    /**
+     * Stops the worker thread, runs every callback that is still registered,
+     * and destroys the pooled fences and the service's semaphores. Should be
+     * called before this object leaves scope.
+     *
+     * Requires: All work tracked by this service has completed (typically by
+     *           calling device.waitIdle() first) or the device is lost, and
+     *           the device has not been destroyed
+     */
+    void destroy();
+
+    /**
+     * Gets an unsignaled fence from the pool of the service. The fence should
+     * be given to a queue submission and then passed to onFence(), at which
+     * point the service resets it and returns it to the pool once signaled.
+     *
+     * @return An unsignaled fence owned by the service
+     */
+    vk::Fence acquireFence();
+
+    /**
+     * Registers a callback to run once the fence is signaled. If the fence
+     * came from acquireFence(), it is recycled after it is signaled. Other
+     * fences are left as they are, and are never reset by the service.
+     *
+     * @param fence The fence, which must already have been submitted
+     * @param callback The function to run on the main thread after the fence
+     *                 is signaled
+     */
+    void onFence(vk::Fence fence, Callback callback);
+
+    /**
+     * Registers a callback to run once a timeline semaphore reaches a value
+     *
+     * Requires: Timeline semaphores are supported
+     *
+     * @param semaphore The timeline semaphore
+     * @param value The value that the semaphore must reach
+     * @param callback The function to run on the main thread after the
+     *                 semaphore reaches the value
+     */
+    void onTimeline(vk::Semaphore semaphore, uint64_t value, Callback callback);
+
+    /**
+     * Registers a callback to run once every command submitted to the queue so
+     * far has completed. This is done with an empty submission that signals
+     * the queue's timeline, or a pooled fence without timeline semaphores,
+     * which is much cheaper than waiting for the queue to idle.
+     *
+     * Requires: The queue is not being used by another thread
+     *
+     * @param queue The queue whose work must complete
+     * @param callback The function to run on the main thread after the work
+     *                 has completed
+     */
+    void onQueueComplete(vk::Queue queue, Callback callback);
+
+    /**
+     * Runs the callbacks of all work that the worker has seen complete. This
+     * never waits on the GPU, so it is safe to call once per frame.
+     */
+    void dispatchCompleted();
+
+    /**
+     * Creates a timeline semaphore owned by the caller
+     *
+     * Requires: Timeline semaphores are supported
+     *
+     * @param initialValue The starting value of the semaphore
+     *
+     * @return The new timeline semaphore
+     */
+    vk::Semaphore createTimelineSemaphore(uint64_t initialValue = 0);
+
+    /**
+     * @return Whether timeline semaphores can be tracked by this service
+     */
+    bool supportsTimelines() const { return timelineSupported; }
+
+    /**
+     * @return The number of callbacks that have not yet been run
+     */
+    size_t pendingCount();
+
+private:
+    /** Work tracked by a fence */
+    struct PendingFence {
+        vk::Fence fence;
+        Callback callback;
+        /** Whether the fence came from the pool and must be recycled */
+        bool pooled;
+    };
+
+    /** Work tracked by a timeline semaphore value */
+    struct PendingTimeline {
+        vk::Semaphore semaphore;
+        uint64_t value;
+        Callback callback;
+    };
+
+    /** The timeline signaled by onQueueComplete() for a queue */
+    struct QueueTimeline {
+        vk::Queue queue;
+        vk::Semaphore semaphore;
+        /** The last value submitted */
+        uint64_t value;
+    };
+
+    vk::Device device;
+    bool timelineSupported = false;
+
+    // Loaded from the device because they come from an extension
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+    PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+    PFN_vkSignalSemaphoreKHR signalSemaphore = nullptr;
+
+    /** The worker thread that waits on the GPU */
+    std::thread worker;
+    /** Whether the worker should keep running */
+    bool running = false;
+
+    /** Guards every container below, as well as running */
+    std::mutex mutex;
+    /** Wakes the worker when there is new work or it should stop */
+    std::condition_variable workAvailable;
+
+    /** Unsignaled fences that are ready to be handed out */
+    std::vector<vk::Fence> freeFences;
+    /** Every fence created by the pool, so they can be destroyed */
+    std::vector<vk::Fence> allFences;
+
+    std::vector<PendingFence> pendingFences;
+    std::vector<PendingTimeline> pendingTimelines;
+    /** Only touched by onQueueComplete() and destroy(), which are never
+     *  called from the worker */
+    std::vector<QueueTimeline> queueTimelines;
+    /** Signaled from the host to wake the worker from its wait on the
+     *  timelines, with wakeValue counting the wakes */
+    vk::Semaphore wakeSemaphore;
+    uint64_t wakeValue = 0;
+    /** Callbacks whose work is complete, waiting for dispatchCompleted() */
+    std::deque<Callback> completed;
+
+    /**
+     * The main loop of the worker thread. Waits on the pending fences and
+     * semaphores, and moves the callbacks of complete work to the completed
+     * queue.
+     */
+    void workerLoop();
+
+    /**
+     * Moves the callbacks of any complete work to the completed queue, and
+     * recycles signaled pooled fences.
+     *
+     * Requires: The mutex is held
+     */
+    void collectCompleted();
+
+    /**
+     * Signals the wake semaphore, so a worker waiting on the timelines looks
+     * for new work. Does nothing without timeline semaphores. The worker
+     * must also be notified through workAvailable, in case it isn't waiting
+     * on the GPU
+     *
+     * Requires: The mutex is held
+     */
+    void wakeWorkerLocked();
+};
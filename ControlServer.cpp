@@ -0,0 +1,303 @@
+// October 18, 2026
+
+#include "ControlServer.hpp"
+
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+
+// The values of VkPresentModeKHR, so this doesn't depend on Vulkan
+static const uint32_t PRESENT_MODE_IMMEDIATE = 0;
+static const uint32_t PRESENT_MODE_MAILBOX = 1;
+static const uint32_t PRESENT_MODE_FIFO = 2;
+static const uint32_t PRESENT_MODE_FIFO_RELAXED = 3;
+
+/**
+ * Appends a metric in the Prometheus text format
+ */
+static void appendMetric(std::string* text, const char* name, const char* type, const char* help,
+                         double value) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.9g\n", name, help, name, type, name, value);
+    text->append(line);
+}
+
+// ***** Public methods *****
+
+bool ControlServer::start(const std::string& path, const MetricsFile* metrics, uint32_t maxFramesInFlight) {
+#if defined(__linux__) || defined(__APPLE__)
+    this->path = path;
+    this->metrics = metrics;
+    this->maxFramesInFlight = maxFramesInFlight;
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0) {
+        return false;
+    }
+    // A socket left behind by a run that crashed would stop the bind
+    unlink(path.c_str());
+    if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenSocket, 4) != 0) {
+        close(listenSocket);
+        listenSocket = -1;
+        return false;
+    }
+
+    running = true;
+    worker = std::thread(&ControlServer::serve, this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ControlServer::stop() {
+#if defined(__linux__) || defined(__APPLE__)
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (listenSocket >= 0) {
+        close(listenSocket);
+        listenSocket = -1;
+        unlink(path.c_str());
+    }
+#endif
+}
+
+// ***** Private methods *****
+
+void ControlServer::serve() {
+#if defined(__linux__) || defined(__APPLE__)
+    lowerThreadPriority();
+
+    while (running) {
+        // Wake up now and then to check whether to stop
+        pollfd listener{ listenSocket, POLLIN, 0 };
+        if (poll(&listener, 1, POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+        int client = accept(listenSocket, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+#ifdef __APPLE__
+        // A client that disconnects mid answer shouldn't kill the app
+        int noSignal = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+        serveClient(client);
+        close(client);
+    }
+#endif
+}
+
+void ControlServer::serveClient(int client) {
+#if defined(__linux__) || defined(__APPLE__)
+#ifdef __linux__
+    const int sendFlags = MSG_NOSIGNAL;
+#else
+    const int sendFlags = 0;
+#endif
+
+    std::string pending;
+    int idleMs = 0;
+    char buffer[256];
+    while (running && idleMs < CLIENT_TIMEOUT_MS) {
+        pollfd reader{ client, POLLIN, 0 };
+        int ready = poll(&reader, 1, POLL_INTERVAL_MS);
+        if (ready < 0) {
+            return;
+        }
+        if (ready == 0) {
+            idleMs += POLL_INTERVAL_MS;
+            continue;
+        }
+        idleMs = 0;
+
+        ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return;
+        }
+        pending.append(buffer, (size_t)received);
+
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            std::string answer = runCommand(line);
+            size_t sent = 0;
+            while (sent < answer.size()) {
+                ssize_t count = send(client, answer.data() + sent, answer.size() - sent, sendFlags);
+                if (count <= 0) {
+                    return;
+                }
+                sent += (size_t)count;
+            }
+        }
+        if (pending.size() > MAX_LINE_LENGTH) {
+            return;
+        }
+    }
+#endif
+}
+
+std::string ControlServer::runCommand(const std::string& line) {
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+
+    if (command == "metrics") {
+        return formatMetrics();
+    }
+
+    if (command == "present_mode") {
+        std::string name;
+        words >> name;
+        uint32_t mode;
+        if (name == "immediate") {
+            mode = PRESENT_MODE_IMMEDIATE;
+        } else if (name == "mailbox") {
+            mode = PRESENT_MODE_MAILBOX;
+        } else if (name == "fifo") {
+            mode = PRESENT_MODE_FIFO;
+        } else if (name == "fifo_relaxed") {
+            mode = PRESENT_MODE_FIFO_RELAXED;
+        } else {
+            return "ERROR: The present mode must be fifo, fifo_relaxed, mailbox or immediate\n";
+        }
+        return presentMode.post(mode) ? "OK\n" : "ERROR: The last present mode hasn't been applied yet\n";
+    }
+
+    if (command == "frames_in_flight") {
+        uint32_t count = 0;
+        if (!(words >> count) || count < 1 || count > maxFramesInFlight) {
+            return "ERROR: The frames in flight must be from 1 to " + std::to_string(maxFramesInFlight) + "\n";
+        }
+        return framesInFlight.post(count) ? "OK\n" : "ERROR: The last frames in flight haven't been applied yet\n";
+    }
+
+    if (command == "resolution_scale") {
+        float scale = 0.f;
+        if (!(words >> scale) || !(scale >= MIN_RESOLUTION_SCALE && scale <= MAX_RESOLUTION_SCALE)) {
+            char error[96];
+            std::snprintf(error, sizeof(error), "ERROR: The resolution scale must be from %g to %g\n",
+                          MIN_RESOLUTION_SCALE, MAX_RESOLUTION_SCALE);
+            return error;
+        }
+        return resolutionScale.post(scale) ? "OK\n" : "ERROR: The last resolution scale hasn't been applied yet\n";
+    }
+
+    if (command == "dump_pipeline_cache") {
+        return dumpPipelineCache.post(true) ? "OK\n" : "ERROR: The pipeline cache is already being saved\n";
+    }
+
+    if (command == "capture") {
+        CaptureRequest request{};
+        std::string capturePath = DEFAULT_CAPTURE_PATH;
+        if (!(words >> request.frameCount) || request.frameCount == 0) {
+            return "ERROR: Usage: capture <frames> [file]\n";
+        }
+        words >> capturePath;
+        if (capturePath.size() >= sizeof(request.path)) {
+            return "ERROR: The capture path is too long\n";
+        }
+        std::strncpy(request.path, capturePath.c_str(), sizeof(request.path) - 1);
+        return capture.post(request) ? "OK\n" : "ERROR: The last capture hasn't started yet\n";
+    }
+
+    if (command == "vertex_pulling") {
+        std::string state;
+        words >> state;
+        if (state != "on" && state != "off") {
+            return "ERROR: Usage: vertex_pulling <on|off>\n";
+        }
+        return vertexPulling.post(state == "on") ? "OK\n" : "ERROR: The last vertex pulling hasn't been applied yet\n";
+    }
+
+    return "ERROR: Unknown command \"" + command + "\"\n";
+}
+
+std::string ControlServer::formatMetrics() const {
+    MetricsFile::Snapshot snapshot;
+    if (metrics == nullptr || !metrics->read(&snapshot)) {
+        return "ERROR: No metrics have been published\n";
+    }
+
+    // Prometheus expects seconds
+    const double SECONDS_PER_MS = 0.001;
+    std::string text;
+    appendMetric(&text, "vulkan_app_frames_total", "counter", "Frames presented", (double)snapshot.frameCount);
+    appendMetric(&text, "vulkan_app_swapchain_recreations_total", "counter", "Times the swapchain was recreated",
+                 (double)snapshot.swapchainRecreateCount);
+    appendMetric(&text, "vulkan_app_swapchain_recreation_seconds_total", "counter",
+                 "Time spent recreating the swapchain", snapshot.totalSwapchainRecreateTime * SECONDS_PER_MS);
+    appendMetric(&text, "vulkan_app_last_swapchain_recreation_seconds", "gauge",
+                 "How long the last swapchain recreation took", snapshot.lastSwapchainRecreateTime * SECONDS_PER_MS);
+    appendMetric(&text, "vulkan_app_uptime_seconds", "gauge", "Time since the app started", snapshot.uptime);
+    appendMetric(&text, "vulkan_app_device_memory_allocated_bytes", "gauge", "Device memory allocated",
+                 (double)snapshot.allocatedBytes);
+    appendMetric(&text, "vulkan_app_device_memory_used_bytes", "gauge", "Device memory in use",
+                 (double)snapshot.usedBytes);
+    appendMetric(&text, "vulkan_app_last_frame_time_seconds", "gauge", "The time of the last frame",
+                 snapshot.lastFrameTime * SECONDS_PER_MS);
+    appendMetric(&text, "vulkan_app_max_frame_time_seconds", "gauge", "The longest recent frame",
+                 snapshot.maxFrameTime * SECONDS_PER_MS);
+    appendMetric(&text, "vulkan_app_gpu_frame_time_seconds", "gauge", "The GPU time of the last timed frame",
+                 snapshot.gpuFrameTime * SECONDS_PER_MS);
+
+    // The percentiles are over recent frames, so they are a summary without
+    // a sum or count
+    char line[256];
+    text.append("# HELP vulkan_app_frame_time_seconds Recent frame times\n"
+                "# TYPE vulkan_app_frame_time_seconds summary\n");
+    const double quantiles[][2] = {
+        { 0.5, snapshot.medianFrameTime },
+        { 0.95, snapshot.p95FrameTime },
+        { 0.99, snapshot.p99FrameTime },
+    };
+    for (const auto& quantile : quantiles) {
+        std::snprintf(line, sizeof(line), "vulkan_app_frame_time_seconds{quantile=\"%g\"} %.9g\n",
+                      quantile[0], quantile[1] * SECONDS_PER_MS);
+        text.append(line);
+    }
+    appendMetric(&text, "vulkan_app_average_frame_time_seconds", "gauge", "The average of recent frame times",
+                 snapshot.averageFrameTime * SECONDS_PER_MS);
+    return text;
+}
+
+// ***** Static methods *****
+
+void ControlServer::lowerThreadPriority() {
+#if defined(__linux__)
+    // Only runs when nothing else wants the core
+    sched_param param{};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#endif
+}
@@ -0,0 +1,173 @@
+// October 18, 2026
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "MetricsFile.hpp"
+
+/**
+ * A slot that one thread posts a value to and another takes it from, without
+ * either waiting. A value posted while the last one hasn't been taken is
+ * refused, so the poster can report that it is busy.
+ */
+template <typename T>
+class Mailbox {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "Mailbox values must be trivially copyable");
+
+    /**
+     * Posts a value. Only one thread may post
+     *
+     * @return false if the last value hasn't been taken yet
+     */
+    bool post(const T& value) {
+        if (full.load(std::memory_order_acquire)) {
+            return false;
+        }
+        this->value = value;
+        full.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Takes the posted value, if there is one. Only one thread may take
+     *
+     * @return Whether there was a value
+     */
+    bool take(T* value) {
+        if (!full.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *value = this->value;
+        full.store(false, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T value{};
+    std::atomic<bool> full{false};
+};
+
+/**
+ * Serves a local Unix domain socket for monitoring and controlling the app
+ * while it runs, on a background thread at the lowest priority. Each line a
+ * client sends is a command, answered with "OK" or "ERROR: <reason>":
+ *
+ *     metrics                       The metrics, in the Prometheus text format
+ *     present_mode <mode>           fifo, fifo_relaxed, mailbox or immediate
+ *     frames_in_flight <count>      1 up to the most the app allows
+ *     resolution_scale <scale>      The scene's resolution, relative to the
+ *                                   window's
+ *     dump_pipeline_cache           Saves the pipeline cache
+ *     capture <frames> [file]       Captures frames for the replay tool
+ *     vertex_pulling <on|off>       Whether the scene's vertex shader fetches
+ *                                   its own vertices
+ *
+ * For example "echo metrics | socat - UNIX-CONNECT:/tmp/vulkan_app.sock".
+ *
+ * The render thread never touches the socket. Commands reach it through
+ * mailboxes, which it takes from between frames, and the metrics are read
+ * from the seqlocked MetricsFile the app already publishes to. So a slow or
+ * misbehaving client can't stall a frame.
+ *
+ * Only POSIX systems have Unix domain sockets. Elsewhere start() returns
+ * false.
+ */
+class ControlServer {
+public:
+    /** Where the app listens */
+    inline static const std::string DEFAULT_PATH = "/tmp/vulkan_app.sock";
+
+    /** The range of resolution scales accepted */
+    inline static const float MIN_RESOLUTION_SCALE = 0.25f;
+    inline static const float MAX_RESOLUTION_SCALE = 2.f;
+
+    /** A request to capture frames */
+    struct CaptureRequest {
+        uint32_t frameCount;
+        char path[256];
+    };
+
+    // The commands for the render thread
+
+    /** A VkPresentModeKHR, which the render thread checks is supported */
+    Mailbox<uint32_t> presentMode;
+    Mailbox<uint32_t> framesInFlight;
+    Mailbox<float> resolutionScale;
+    Mailbox<bool> dumpPipelineCache;
+    Mailbox<CaptureRequest> capture;
+    Mailbox<bool> vertexPulling;
+
+    /**
+     * Starts listening on a background thread, replacing any socket left
+     * behind at the path
+     *
+     * @param path The socket to listen on
+     * @param metrics The file the metrics are read from, or null if they
+     *                aren't exported
+     * @param maxFramesInFlight The most frames in flight that can be asked for
+     *
+     * @return Whether the socket could be listened on
+     */
+    bool start(const std::string& path, const MetricsFile* metrics, uint32_t maxFramesInFlight);
+
+    /**
+     * Stops the background thread and removes the socket. Should be called
+     * before this object leaves scope
+     */
+    void stop();
+
+private:
+    /** How often the background thread checks whether it should stop */
+    static const int POLL_INTERVAL_MS = 100;
+    /** How long a client can be idle before it is disconnected */
+    static const int CLIENT_TIMEOUT_MS = 5000;
+    /** The longest command line */
+    static const size_t MAX_LINE_LENGTH = 512;
+    /** The default file for captures */
+    inline static const std::string DEFAULT_CAPTURE_PATH = "capture.vcap";
+
+    std::string path;
+    const MetricsFile* metrics = nullptr;
+    uint32_t maxFramesInFlight = 1;
+    int listenSocket = -1;
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    /**
+     * The main loop of the worker thread, serving one client at a time
+     */
+    void serve();
+
+    /**
+     * Reads commands from a client and answers them until it disconnects,
+     * goes idle or the server stops
+     */
+    void serveClient(int client);
+
+    /**
+     * Runs a command
+     *
+     * @param line The command, without the newline
+     *
+     * @return The answer, ending in a newline
+     */
+    std::string runCommand(const std::string& line);
+
+    /**
+     * @return The metrics in the Prometheus text format
+     */
+    std::string formatMetrics() const;
+
+    /**
+     * Lowers the priority of the calling thread as far as it goes, so
+     * serving never takes time from the render thread
+     */
+    static void lowerThreadPriority();
+};
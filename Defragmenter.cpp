@@ -0,0 +1,239 @@
+// October 18, 2026
+
+#include "Defragmenter.hpp"
+
+#include <algorithm>
+
+// ***** Public methods *****
+
+void Defragmenter::initialize(vk::Device device, MemoryAllocator* allocator, CompletionService* completionService,
+                              vk::Queue queue) {
+    this->device = device;
+    this->allocator = allocator;
+    this->completionService = completionService;
+    this->queue = queue;
+
+    resources.clear();
+    oldResources.clear();
+    nextResource = 0;
+    framesUntilCheck = CHECK_INTERVAL_FRAMES;
+}
+
+void Defragmenter::destroy() {
+    for (const OldResource& old : oldResources) {
+        destroyOld(old);
+    }
+    oldResources.clear();
+    resources.clear();
+}
+
+uint32_t Defragmenter::addBuffer(vk::Buffer buffer, const Allocation& allocation,
+                                 const vk::BufferCreateInfo& createInfo, BufferMoved onMoved) {
+    Resource resource{};
+    resource.live = true;
+    resource.isImage = false;
+    resource.buffer = buffer;
+    resource.allocation = allocation;
+    resource.bufferInfo = createInfo;
+    resource.onBufferMoved = std::move(onMoved);
+
+    // Reuse the slot of a removed resource
+    auto freeSlot = std::find_if(resources.begin(), resources.end(), [](const Resource& r) { return !r.live; });
+    if (freeSlot != resources.end()) {
+        *freeSlot = std::move(resource);
+        return (uint32_t)(freeSlot - resources.begin());
+    }
+    resources.push_back(std::move(resource));
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t Defragmenter::addImage(vk::Image image, const Allocation& allocation, const vk::ImageCreateInfo& createInfo,
+                                vk::ImageLayout layout, vk::ImageAspectFlags aspect, ImageMoved onMoved) {
+    Resource resource{};
+    resource.live = true;
+    resource.isImage = true;
+    resource.image = image;
+    resource.allocation = allocation;
+    resource.imageInfo = createInfo;
+    resource.layout = layout;
+    resource.aspect = aspect;
+    resource.onImageMoved = std::move(onMoved);
+
+    auto freeSlot = std::find_if(resources.begin(), resources.end(), [](const Resource& r) { return !r.live; });
+    if (freeSlot != resources.end()) {
+        *freeSlot = std::move(resource);
+        return (uint32_t)(freeSlot - resources.begin());
+    }
+    resources.push_back(std::move(resource));
+    return (uint32_t)resources.size() - 1;
+}
+
+void Defragmenter::remove(uint32_t id) {
+    resources[id] = Resource{};
+}
+
+void Defragmenter::beginFrame(vk::CommandBuffer commandBuffer) {
+    if (framesUntilCheck > 0) {
+        framesUntilCheck--;
+        return;
+    }
+
+    // Take the candidates in turn from where the last frame stopped, until
+    // the budget is spent or every resource has been looked at
+    size_t firstOld = oldResources.size();
+    std::vector<uint32_t> moved;
+    vk::DeviceSize movedBytes = 0;
+    for (size_t checked = 0; checked < resources.size() && moved.size() < MAX_MOVES_PER_FRAME; checked++) {
+        uint32_t id = nextResource;
+        nextResource = (nextResource + 1) % (uint32_t)resources.size();
+
+        Resource& resource = resources[id];
+        if (!resource.live || movedBytes + resource.allocation.size > MAX_BYTES_PER_FRAME ||
+            !allocator->isMoveCandidate(resource.allocation)) {
+            continue;
+        }
+
+        OldResource old;
+        if (relocate(&resource, &old)) {
+            moved.push_back(id);
+            oldResources.push_back(old);
+            movedBytes += resource.allocation.size;
+        }
+    }
+
+    // Nothing to move, or nowhere to move it, so wait a while before looking
+    // again
+    if (moved.empty()) {
+        framesUntilCheck = CHECK_INTERVAL_FRAMES;
+        return;
+    }
+
+    // Earlier frames may still write the old resources, and the new images
+    // start out undefined
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    for (size_t i = 0; i < moved.size(); i++) {
+        const Resource& resource = resources[moved[i]];
+        if (!resource.isImage) {
+            continue;
+        }
+        vk::ImageSubresourceRange range(resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
+        imageBarriers.push_back(vk::ImageMemoryBarrier(vk::AccessFlagBits::eMemoryWrite,
+            vk::AccessFlagBits::eTransferRead, resource.layout, vk::ImageLayout::eTransferSrcOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, oldResources[firstOld + i].image, range));
+        imageBarriers.push_back(vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eTransferWrite,
+            vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.image, range));
+    }
+    vk::MemoryBarrier memoryBarrier(vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eTransferRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, {},
+                                  memoryBarrier, nullptr, imageBarriers);
+
+    for (size_t i = 0; i < moved.size(); i++) {
+        recordCopy(commandBuffer, resources[moved[i]], oldResources[firstOld + i]);
+    }
+
+    // Everything after reads or writes the new resources
+    imageBarriers.clear();
+    for (uint32_t id : moved) {
+        const Resource& resource = resources[id];
+        if (!resource.isImage) {
+            continue;
+        }
+        vk::ImageSubresourceRange range(resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
+        imageBarriers.push_back(vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+            vk::ImageLayout::eTransferDstOptimal, resource.layout,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.image, range));
+    }
+    memoryBarrier = vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite,
+                                      vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {},
+                                  memoryBarrier, nullptr, imageBarriers);
+
+    // The owners rebind last, since a callback could add or remove resources
+    for (uint32_t id : moved) {
+        Resource resource = resources[id];
+        if (resource.isImage) {
+            resource.onImageMoved(resource.image, resource.allocation);
+        } else {
+            resource.onBufferMoved(resource.buffer, resource.allocation);
+        }
+    }
+}
+
+void Defragmenter::endFrame() {
+    if (oldResources.empty()) {
+        return;
+    }
+
+    // The copies wait for every earlier frame, so once this frame is done no
+    // frame uses the old resources
+    std::vector<OldResource> done;
+    done.swap(oldResources);
+    completionService->onQueueComplete(queue, [this, done]() {
+        for (const OldResource& old : done) {
+            destroyOld(old);
+        }
+    });
+}
+
+// ***** Private methods *****
+
+bool Defragmenter::relocate(Resource* resource, OldResource* old) {
+    Allocation allocation;
+    if (resource->isImage) {
+        vk::Image image = device.createImage(resource->imageInfo);
+        if (!allocator->allocateForMove(device.getImageMemoryRequirements(image), resource->allocation, &allocation)) {
+            device.destroyImage(image);
+            return false;
+        }
+        device.bindImageMemory(image, allocation.memory, allocation.offset);
+
+        old->buffer = nullptr;
+        old->image = resource->image;
+        resource->image = image;
+    } else {
+        vk::Buffer buffer = device.createBuffer(resource->bufferInfo);
+        if (!allocator->allocateForMove(device.getBufferMemoryRequirements(buffer), resource->allocation,
+                                        &allocation)) {
+            device.destroyBuffer(buffer);
+            return false;
+        }
+        device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+
+        old->buffer = resource->buffer;
+        old->image = nullptr;
+        resource->buffer = buffer;
+    }
+
+    old->allocation = resource->allocation;
+    resource->allocation = allocation;
+    return true;
+}
+
+void Defragmenter::recordCopy(vk::CommandBuffer commandBuffer, const Resource& resource, const OldResource& old) {
+    if (!resource.isImage) {
+        commandBuffer.copyBuffer(old.buffer, resource.buffer, vk::BufferCopy(0, 0, resource.bufferInfo.size));
+        return;
+    }
+
+    // One region per mip level, each with every layer
+    const vk::ImageCreateInfo& info = resource.imageInfo;
+    std::vector<vk::ImageCopy> regions;
+    for (uint32_t level = 0; level < info.mipLevels; level++) {
+        vk::ImageSubresourceLayers layers(resource.aspect, level, 0, info.arrayLayers);
+        vk::Extent3D extent(std::max(info.extent.width >> level, 1u), std::max(info.extent.height >> level, 1u),
+                            std::max(info.extent.depth >> level, 1u));
+        regions.push_back(vk::ImageCopy(layers, vk::Offset3D(), layers, vk::Offset3D(), extent));
+    }
+    commandBuffer.copyImage(old.image, vk::ImageLayout::eTransferSrcOptimal, resource.image,
+                            vk::ImageLayout::eTransferDstOptimal, regions);
+}
+
+void Defragmenter::destroyOld(const OldResource& old) {
+    if (old.image) {
+        allocator->destroyImage(old.image, old.allocation);
+    } else {
+        allocator->destroyBuffer(old.buffer, old.allocation);
+    }
+}
@@ -0,0 +1,177 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <functional>
+
+#include "MemoryAllocator.hpp"
+#include "CompletionService.hpp"
+
+/**
+ * Compacts device memory over a long run, by moving buffers and images out
+ * of the emptiest block of each memory type into fuller ones until the block
+ * is empty and the allocator gives it back.
+ *
+ * Only resources added by their owners are moved. A move creates the resource
+ * again at its new place, records a GPU copy at the start of the frame and
+ * calls the owner back with the new resource, so the owner can rebind it
+ * before recording anything else. The old resource is destroyed once the
+ * queue has finished the frame, since earlier frames may still use it.
+ *
+ * The copies of a frame are limited to MAX_BYTES_PER_FRAME and
+ * MAX_MOVES_PER_FRAME, so compacting never costs a frame more than a fraction
+ * of a millisecond, and a resource larger than the budget is never moved.
+ * While nothing needs moving, the resources are only looked at every
+ * CHECK_INTERVAL_FRAMES.
+ *
+ * The callback must leave nothing using the old resource in later frames.
+ * Descriptor sets can't be rewritten while frames in flight use them, so a
+ * resource in a descriptor set should only be added if its owner allocates a
+ * new set in the callback.
+ */
+class Defragmenter {
+public:
+    /** Called with a buffer's new handle and memory after it is moved */
+    using BufferMoved = std::function<void(vk::Buffer buffer, const Allocation& allocation)>;
+    /** Called with an image's new handle and memory after it is moved */
+    using ImageMoved = std::function<void(vk::Image image, const Allocation& allocation)>;
+
+    /** The most bytes copied in a frame */
+    inline static const vk::DeviceSize MAX_BYTES_PER_FRAME = 4ull * 1024 * 1024;
+    /** The most resources moved in a frame */
+    inline static const uint32_t MAX_MOVES_PER_FRAME = 8;
+    /** How often the resources are looked at while none need moving */
+    inline static const uint32_t CHECK_INTERVAL_FRAMES = 120;
+
+    /**
+     * @param device The logical device
+     * @param allocator The allocator the resources were created with
+     * @param completionService Tells when the old resources can be destroyed
+     * @param queue The queue the frames are submitted to
+     */
+    void initialize(vk::Device device, MemoryAllocator* allocator, CompletionService* completionService,
+                    vk::Queue queue);
+
+    /**
+     * Destroys the old resources of moves not yet handed to endFrame()
+     *
+     * Requires: Every resource added has been removed, and the device is idle
+     */
+    void destroy();
+
+    /**
+     * Adds a buffer that can be moved
+     *
+     * Requires: The buffer was made by the allocator with createInfo, which
+     *           has eTransferSrc and eTransferDst usage, no pNext and
+     *           exclusive sharing
+     *
+     * @param onMoved Called with the new buffer when it is moved
+     *
+     * @return The id to remove the buffer with
+     */
+    uint32_t addBuffer(vk::Buffer buffer, const Allocation& allocation, const vk::BufferCreateInfo& createInfo,
+                       BufferMoved onMoved);
+
+    /**
+     * Adds an image that can be moved. Every mip level and layer is copied
+     *
+     * Requires: The image was made by the allocator with createInfo, which
+     *           has eTransferSrc and eTransferDst usage, optimal tiling, one
+     *           sample, no pNext and exclusive sharing
+     *
+     * @param layout The layout the image is always in between frames
+     * @param aspect The aspects copied
+     * @param onMoved Called with the new image when it is moved. Views of the
+     *                image have to be made again
+     *
+     * @return The id to remove the image with
+     */
+    uint32_t addImage(vk::Image image, const Allocation& allocation, const vk::ImageCreateInfo& createInfo,
+                      vk::ImageLayout layout, vk::ImageAspectFlags aspect, ImageMoved onMoved);
+
+    /**
+     * Stops moving a resource, such as before it is destroyed
+     *
+     * @param id The id from addBuffer() or addImage()
+     */
+    void remove(uint32_t id);
+
+    /**
+     * Moves what fits in the budget, recording the copies. Must be called
+     * before anything else is recorded, so the callbacks' rebinding applies to
+     * the whole frame
+     *
+     * @param commandBuffer The frame's command buffer, outside of a render
+     *                      pass
+     */
+    void beginFrame(vk::CommandBuffer commandBuffer);
+
+    /**
+     * Destroys the old resources of this frame's moves once the queue has
+     * finished them
+     *
+     * Requires: The command buffer given to beginFrame() has been submitted
+     */
+    void endFrame();
+
+private:
+    /** A resource that can be moved */
+    struct Resource {
+        /** Whether the slot holds a resource, since ids must stay valid */
+        bool live;
+        bool isImage;
+        vk::Buffer buffer;
+        vk::Image image;
+        Allocation allocation;
+        vk::BufferCreateInfo bufferInfo;
+        vk::ImageCreateInfo imageInfo;
+        vk::ImageLayout layout;
+        vk::ImageAspectFlags aspect;
+        BufferMoved onBufferMoved;
+        ImageMoved onImageMoved;
+    };
+
+    /** A resource moved away from, destroyed once the queue is done with it */
+    struct OldResource {
+        vk::Buffer buffer;
+        vk::Image image;
+        Allocation allocation;
+    };
+
+    vk::Device device;
+    MemoryAllocator* allocator = nullptr;
+    CompletionService* completionService = nullptr;
+    vk::Queue queue;
+
+    std::vector<Resource> resources;
+    /** Where the next frame starts looking, so every resource gets a turn */
+    uint32_t nextResource = 0;
+    /** Frames until the resources are looked at again */
+    uint32_t framesUntilCheck = 0;
+    /** The old resources of the moves recorded since the last endFrame() */
+    std::vector<OldResource> oldResources;
+
+    /**
+     * Creates a resource again at a new place in a fuller block
+     *
+     * @param resource The resource, updated to the new handle and memory
+     * @param old Set to the handle and memory being moved away from
+     *
+     * @return Whether there was room
+     */
+    bool relocate(Resource* resource, OldResource* old);
+
+    /**
+     * Records the copy from the old resource to the new one
+     */
+    void recordCopy(vk::CommandBuffer commandBuffer, const Resource& resource, const OldResource& old);
+
+    /**
+     * Destroys the handle and frees the memory of an old resource
+     */
+    void destroyOld(const OldResource& old);
+};
@@ -0,0 +1,185 @@
+// October 18, 2026
+
+#include "DeviceFeatures.hpp"
+
+#include <stdexcept>
+
+// ***** Public methods *****
+
+void DeviceFeatures::query(vk::Instance instance, vk::PhysicalDevice physicalDevice,
+                           const std::unordered_set<std::string>& enabledExtensions) {
+    // Core features don't need any extension to be queried
+    vk::PhysicalDeviceFeatures coreFeatures = physicalDevice.getFeatures();
+    sparseResidencyImage2D = coreFeatures.sparseBinding && coreFeatures.sparseResidencyImage2D;
+    fragmentStoresAndAtomics = coreFeatures.fragmentStoresAndAtomics;
+
+    if (enabledExtensions.empty()) {
+        return;
+    }
+
+    // Load the query functions. They are not loaded by default because they
+    // are from an extension
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR) instance.getProcAddr("vkGetPhysicalDeviceFeatures2KHR");
+    auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR) instance.getProcAddr("vkGetPhysicalDeviceProperties2KHR");
+    if (getFeatures2 == nullptr || getProperties2 == nullptr) {
+        throw std::runtime_error("ERROR: Could not load physical device query functions.");
+    }
+
+    // Every struct for an enabled extension is chained onto the query, and
+    // filled in by the driver
+    vk::PhysicalDeviceFeatures2KHR features2{};
+    vk::PhysicalDeviceProperties2KHR properties2{};
+
+    // Any device with the timeline semaphore extension must support the
+    // feature, so it doesn't need to be queried
+    timelineSemaphore = enabledExtensions.count(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) > 0;
+
+#ifdef VK_EXT_graphics_pipeline_library
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryQuery{};
+    vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT graphicsPipelineLibraryProperties{};
+    // Pipeline libraries also need the base pipeline library extension
+    bool hasGraphicsPipelineLibrary =
+        enabledExtensions.count(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) > 0 &&
+        enabledExtensions.count(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) > 0;
+    if (hasGraphicsPipelineLibrary) {
+        chain(&features2, &graphicsPipelineLibraryQuery);
+        chain(&properties2, &graphicsPipelineLibraryProperties);
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state
+    vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateQuery{};
+    bool hasExtendedDynamicState = enabledExtensions.count(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) > 0;
+    if (hasExtendedDynamicState) {
+        chain(&features2, &extendedDynamicStateQuery);
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    vk::PhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Query{};
+    bool hasExtendedDynamicState2 = enabledExtensions.count(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME) > 0;
+    if (hasExtendedDynamicState2) {
+        chain(&features2, &extendedDynamicState2Query);
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+    // Only a property is used from this extension, so no features are enabled
+    vk::PhysicalDeviceExtendedDynamicState3PropertiesEXT extendedDynamicState3Properties{};
+    bool hasExtendedDynamicState3 = enabledExtensions.count(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME) > 0;
+    if (hasExtendedDynamicState3) {
+        chain(&properties2, &extendedDynamicState3Properties);
+    }
+#endif
+
+#ifdef VK_EXT_mesh_shader
+    vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderQuery{};
+    bool hasMeshShader = enabledExtensions.count(VK_EXT_MESH_SHADER_EXTENSION_NAME) > 0;
+    if (hasMeshShader) {
+        chain(&features2, &meshShaderQuery);
+    }
+#endif
+#ifdef VK_KHR_buffer_device_address
+    vk::PhysicalDeviceBufferDeviceAddressFeaturesKHR bufferDeviceAddressQuery{};
+    bool hasBufferDeviceAddress = enabledExtensions.count(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME) > 0;
+    if (hasBufferDeviceAddress) {
+        chain(&features2, &bufferDeviceAddressQuery);
+    }
+#endif
+
+    getFeatures2(static_cast<VkPhysicalDevice>(physicalDevice), reinterpret_cast<VkPhysicalDeviceFeatures2*>(&features2));
+    getProperties2(static_cast<VkPhysicalDevice>(physicalDevice), reinterpret_cast<VkPhysicalDeviceProperties2*>(&properties2));
+
+#ifdef VK_EXT_graphics_pipeline_library
+    if (hasGraphicsPipelineLibrary) {
+        graphicsPipelineLibrary = graphicsPipelineLibraryQuery.graphicsPipelineLibrary;
+        graphicsPipelineLibraryFastLinking = graphicsPipelineLibraryProperties.graphicsPipelineLibraryFastLinking;
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state
+    if (hasExtendedDynamicState) {
+        extendedDynamicState = extendedDynamicStateQuery.extendedDynamicState;
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    if (hasExtendedDynamicState2) {
+        extendedDynamicState2 = extendedDynamicState2Query.extendedDynamicState2;
+    }
+#endif
+#ifdef VK_EXT_mesh_shader
+    // The mesh path always starts from a task shader, so both are needed
+    if (hasMeshShader) {
+        meshShader = meshShaderQuery.taskShader && meshShaderQuery.meshShader;
+    }
+#endif
+#ifdef VK_KHR_buffer_device_address
+    if (hasBufferDeviceAddress) {
+        bufferDeviceAddress = bufferDeviceAddressQuery.bufferDeviceAddress;
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+    // Unrestricted topologies only matter if topology is dynamic at all
+    if (hasExtendedDynamicState3) {
+        dynamicPrimitiveTopologyUnrestricted =
+            extendedDynamicState && extendedDynamicState3Properties.dynamicPrimitiveTopologyUnrestricted;
+    }
+#endif
+}
+
+void DeviceFeatures::chainEnabledFeatures(vk::DeviceCreateInfo* createInfo) {
+    // Only the features that are used are enabled, since some features can
+    // make the driver take slower paths
+    if (timelineSemaphore) {
+        timelineFeatures = vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR{};
+        timelineFeatures.timelineSemaphore = VK_TRUE;
+        chain(createInfo, &timelineFeatures);
+    }
+
+#ifdef VK_EXT_graphics_pipeline_library
+    if (graphicsPipelineLibrary) {
+        graphicsPipelineLibraryFeatures = vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT{};
+        graphicsPipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+        chain(createInfo, &graphicsPipelineLibraryFeatures);
+    }
+#endif
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (extendedDynamicState) {
+        extendedDynamicStateFeatures = vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT{};
+        extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+        chain(createInfo, &extendedDynamicStateFeatures);
+    }
+#endif
+
+#ifdef VK_EXT_extended_dynamic_state2
+    if (extendedDynamicState2) {
+        extendedDynamicState2Features = vk::PhysicalDeviceExtendedDynamicState2FeaturesEXT{};
+        extendedDynamicState2Features.extendedDynamicState2 = VK_TRUE;
+        chain(createInfo, &extendedDynamicState2Features);
+    }
+#endif
+
+#ifdef VK_EXT_mesh_shader
+    if (meshShader) {
+        meshShaderFeatures = vk::PhysicalDeviceMeshShaderFeaturesEXT{};
+        meshShaderFeatures.taskShader = VK_TRUE;
+        meshShaderFeatures.meshShader = VK_TRUE;
+        chain(createInfo, &meshShaderFeatures);
+    }
+#endif
+
+#ifdef VK_KHR_buffer_device_address
+    if (bufferDeviceAddress) {
+        bufferDeviceAddressFeatures = vk::PhysicalDeviceBufferDeviceAddressFeaturesKHR{};
+        bufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
+        chain(createInfo, &bufferDeviceAddressFeatures);
+    }
+#endif
+}
+
+void DeviceFeatures::enableCoreFeatures(vk::PhysicalDeviceFeatures* enabledFeatures) const {
+    if (sparseResidencyImage2D) {
+        enabledFeatures->sparseBinding = VK_TRUE;
+        enabledFeatures->sparseResidencyImage2D = VK_TRUE;
+    }
+    if (fragmentStoresAndAtomics) {
+        enabledFeatures->fragmentStoresAndAtomics = VK_TRUE;
+    }
+}
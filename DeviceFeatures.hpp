@@ -0,0 +1,113 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <string>
+#include <unordered_set>
+
+/**
+ * Queries the features of the optional device extensions, and enables the
+ * ones that are used when the logical device is created. The few optional
+ * core features that are used are handled here too.
+ *
+ * Features are queried through vkGetPhysicalDeviceFeatures2KHR, which is
+ * loaded from the instance because it comes from the
+ * VK_KHR_get_physical_device_properties2 extension. Extensions missing from
+ * the Vulkan headers being built against are treated as unsupported.
+ */
+class DeviceFeatures {
+public:
+    // The supported features that will be enabled
+
+    /** Timeline semaphores, from VK_KHR_timeline_semaphore */
+    bool timelineSemaphore = false;
+    /** Separately compiled pipeline parts, from
+     *  VK_EXT_graphics_pipeline_library */
+    bool graphicsPipelineLibrary = false;
+    /** Whether linking pipeline libraries without link time optimization is
+     *  fast enough to do while drawing */
+    bool graphicsPipelineLibraryFastLinking = false;
+    /** Dynamic cull mode, front face, topology and depth test state, from
+     *  VK_EXT_extended_dynamic_state */
+    bool extendedDynamicState = false;
+    /** Dynamic primitive restart, from VK_EXT_extended_dynamic_state2 */
+    bool extendedDynamicState2 = false;
+    /** Whether a dynamic topology can be any topology, rather than only one
+     *  of the same class (points, lines, triangles or patches) as the
+     *  pipeline's. From VK_EXT_extended_dynamic_state3 */
+    bool dynamicPrimitiveTopologyUnrestricted = false;
+    /** Partially resident 2D images, from the core sparseBinding and
+     *  sparseResidencyImage2D features */
+    bool sparseResidencyImage2D = false;
+    /** Stores and atomics from fragment shaders, from the core feature */
+    bool fragmentStoresAndAtomics = false;
+    /** Task and mesh shaders, from VK_EXT_mesh_shader */
+    bool meshShader = false;
+    /** The addresses of buffers, for shaders to read through pointers, from
+     *  VK_KHR_buffer_device_address */
+    bool bufferDeviceAddress = false;
+
+    /**
+     * Queries the optional core features, and the features of the enabled
+     * optional extensions
+     *
+     * Requires: The instance has VK_KHR_get_physical_device_properties2
+     *           enabled, if any optional extensions are enabled
+     *
+     * @param instance The Vulkan instance, to load the query functions from
+     * @param physicalDevice The physical device to query
+     * @param enabledExtensions The optional device extensions that will be
+     *                          enabled on the device
+     */
+    void query(vk::Instance instance, vk::PhysicalDevice physicalDevice,
+               const std::unordered_set<std::string>& enabledExtensions);
+
+    /**
+     * Chains the structs that enable the supported features onto the pNext of
+     * the device create info
+     *
+     * Requires: This object outlives the creation of the device
+     *
+     * @param createInfo The create info of the logical device
+     */
+    void chainEnabledFeatures(vk::DeviceCreateInfo* createInfo);
+
+    /**
+     * Sets the supported optional core features in the features the device
+     * is created with
+     *
+     * @param enabledFeatures The core features of the logical device
+     */
+    void enableCoreFeatures(vk::PhysicalDeviceFeatures* enabledFeatures) const;
+
+private:
+    // The structs chained by chainEnabledFeatures(), kept here so they stay in
+    // scope until the device is created
+    vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+#ifdef VK_EXT_graphics_pipeline_library
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures{};
+#endif
+#ifdef VK_EXT_extended_dynamic_state
+    vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    vk::PhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features{};
+#endif
+#ifdef VK_EXT_mesh_shader
+    vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+#endif
+#ifdef VK_KHR_buffer_device_address
+    vk::PhysicalDeviceBufferDeviceAddressFeaturesKHR bufferDeviceAddressFeatures{};
+#endif
+
+    /**
+     * Adds a struct to the front of a pNext chain
+     */
+    template <typename S, typename T>
+    static void chain(S* head, T* next) {
+        next->pNext = const_cast<void*>(head->pNext);
+        head->pNext = next;
+    }
+};
@@ -0,0 +1,406 @@
+// October 18, 2026
+
+#include "FrameCapture.hpp"
+
+#include <stdexcept>
+
+// Appends the bytes of a value to a payload
+template <typename T>
+static void append(std::string* payload, const T& value) {
+    payload->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// ***** FrameCapture *****
+
+void FrameCapture::start(const std::string& path, uint32_t frameCount, vk::Format colorFormat,
+                         vk::Format depthFormat, PipelineLibrary::ShaderLoader shaderLoader) {
+    if (frameCount == 0) {
+        throw std::runtime_error("ERROR: A capture needs at least one frame");
+    }
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to create capture ") + path);
+    }
+
+    framesToRecord = frameCount;
+    this->shaderLoader = shaderLoader;
+    shaderIds.clear();
+    pipelineIds.clear();
+    recordingFrame = false;
+    pendingFrames.clear();
+
+    std::string header;
+    append(&header, MAGIC);
+    append(&header, VERSION);
+    append(&header, static_cast<uint32_t>(colorFormat));
+    append(&header, static_cast<uint32_t>(depthFormat));
+    file.write(header.data(), header.size());
+}
+
+void FrameCapture::stop() {
+    file.close();
+    framesToRecord = 0;
+    recordingFrame = false;
+    pendingFrames.clear();
+}
+
+void FrameCapture::createBuffer(uint64_t id, vk::DeviceSize size, vk::BufferUsageFlags usage) {
+    if (!isCapturing()) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, id);
+    append(&payload, (uint64_t)size);
+    append(&payload, static_cast<VkBufferUsageFlags>(usage));
+    writeRecord(CAPTURE_CREATE_BUFFER, payload);
+}
+
+void FrameCapture::uploadBuffer(uint64_t id, vk::DeviceSize offset, const void* data, vk::DeviceSize size) {
+    if (!isCapturing()) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, id);
+    append(&payload, (uint64_t)offset);
+    payload.append(reinterpret_cast<const char*>(data), size);
+    writeRecord(CAPTURE_UPLOAD_BUFFER, payload);
+}
+
+void FrameCapture::copyBuffer(uint64_t sourceId, uint64_t destinationId, vk::DeviceSize size) {
+    if (!isCapturing()) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, sourceId);
+    append(&payload, destinationId);
+    append(&payload, (uint64_t)size);
+    writeRecord(CAPTURE_COPY_BUFFER, payload);
+}
+
+void FrameCapture::beginFrame(vk::Extent2D extent) {
+    if (!isCapturing() || framesToRecord == 0) {
+        return;
+    }
+
+    recordingFrame = true;
+    frame = PendingFrame();
+    frame.extent = extent;
+}
+
+void FrameCapture::bindPipeline(const PipelineKey& key) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    // The full key is captured, since the device replaying may bake state
+    // that is dynamic on this one. The pipeline is written to the file
+    // straight away, so it comes before every frame that binds it
+    std::string serialized = key.serialize();
+    auto it = pipelineIds.find(serialized);
+    if (it == pipelineIds.end()) {
+        uint32_t id = (uint32_t)pipelineIds.size();
+        uint32_t vertexShaderId = getShaderId(key.vertexShader);
+        uint32_t fragmentShaderId = getShaderId(key.fragmentShader);
+
+        std::string payload;
+        append(&payload, id);
+        append(&payload, vertexShaderId);
+        append(&payload, fragmentShaderId);
+        append(&payload, static_cast<uint32_t>(key.topology));
+        append(&payload, (uint8_t)key.primitiveRestartEnable);
+        append(&payload, static_cast<VkCullModeFlags>(key.cullMode));
+        append(&payload, static_cast<uint32_t>(key.frontFace));
+        append(&payload, (uint8_t)key.depthTestEnable);
+        append(&payload, (uint8_t)key.depthWriteEnable);
+        writeRecord(CAPTURE_PIPELINE, payload);
+
+        it = pipelineIds.emplace(serialized, id).first;
+    }
+
+    std::string payload;
+    append(&payload, it->second);
+    recordCommand(CAPTURE_BIND_PIPELINE, payload);
+}
+
+void FrameCapture::bindVertexBuffer(uint32_t binding, uint64_t id, vk::DeviceSize offset) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, binding);
+    append(&payload, id);
+    append(&payload, (uint64_t)offset);
+    recordCommand(CAPTURE_BIND_VERTEX_BUFFER, payload);
+}
+
+void FrameCapture::bindIndexBuffer(uint64_t id, vk::DeviceSize offset, vk::IndexType indexType) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, id);
+    append(&payload, (uint64_t)offset);
+    append(&payload, static_cast<uint32_t>(indexType));
+    recordCommand(CAPTURE_BIND_INDEX_BUFFER, payload);
+}
+
+void FrameCapture::bindStorageBuffers(uint32_t set, const std::vector<std::pair<uint32_t, uint64_t> >& buffers) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, set);
+    append(&payload, (uint32_t)buffers.size());
+    for (const auto& buffer : buffers) {
+        append(&payload, buffer.first);
+        append(&payload, buffer.second);
+    }
+    recordCommand(CAPTURE_BIND_STORAGE_BUFFERS, payload);
+}
+
+void FrameCapture::pushConstants(vk::ShaderStageFlags stages, uint32_t offset, const void* data, uint32_t size) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, static_cast<VkShaderStageFlags>(stages));
+    append(&payload, offset);
+    payload.append(reinterpret_cast<const char*>(data), size);
+    recordCommand(CAPTURE_PUSH_CONSTANTS, payload);
+}
+
+void FrameCapture::pushBufferAddress(vk::ShaderStageFlags stages, uint32_t offset, uint64_t id) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, static_cast<VkShaderStageFlags>(stages));
+    append(&payload, offset);
+    append(&payload, id);
+    recordCommand(CAPTURE_PUSH_BUFFER_ADDRESS, payload);
+}
+
+void FrameCapture::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, vertexCount);
+    append(&payload, instanceCount);
+    append(&payload, firstVertex);
+    append(&payload, firstInstance);
+    recordCommand(CAPTURE_DRAW, payload);
+}
+
+void FrameCapture::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
+                               int32_t vertexOffset, uint32_t firstInstance) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, indexCount);
+    append(&payload, instanceCount);
+    append(&payload, firstIndex);
+    append(&payload, vertexOffset);
+    append(&payload, firstInstance);
+    recordCommand(CAPTURE_DRAW_INDEXED, payload);
+}
+
+void FrameCapture::drawIndexedIndirect(uint64_t id, vk::DeviceSize offset, uint32_t drawCount, uint32_t stride) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    std::string payload;
+    append(&payload, id);
+    append(&payload, (uint64_t)offset);
+    append(&payload, drawCount);
+    append(&payload, stride);
+    recordCommand(CAPTURE_DRAW_INDEXED_INDIRECT, payload);
+}
+
+void FrameCapture::uploadReadback(uint64_t id, vk::DeviceSize readbackOffset, vk::DeviceSize size) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    frame.readbacks.push_back({ id, readbackOffset, size });
+}
+
+void FrameCapture::endFrame(uint32_t slot) {
+    if (!recordingFrame) {
+        return;
+    }
+
+    recordCommand(CAPTURE_END_FRAME, std::string());
+    frame.slot = slot;
+    pendingFrames.push_back(std::move(frame));
+    recordingFrame = false;
+    framesToRecord--;
+}
+
+bool FrameCapture::getNextFinish(uint32_t* slot) const {
+    if (pendingFrames.empty()) {
+        return false;
+    }
+
+    *slot = pendingFrames.front().slot;
+    return true;
+}
+
+void FrameCapture::finishFrame(const void* readback) {
+    PendingFrame finished = std::move(pendingFrames.front());
+    pendingFrames.pop_front();
+
+    // What the GPU wrote is uploaded at the start of the frame, before
+    // anything reads it
+    std::string payload;
+    append(&payload, finished.extent.width);
+    append(&payload, finished.extent.height);
+    writeRecord(CAPTURE_BEGIN_FRAME, payload);
+    for (const Readback& upload : finished.readbacks) {
+        payload.clear();
+        append(&payload, upload.id);
+        append(&payload, (uint64_t)0);
+        payload.append(static_cast<const char*>(readback) + upload.offset, upload.size);
+        writeRecord(CAPTURE_UPLOAD_BUFFER, payload);
+    }
+    file.write(finished.records.data(), finished.records.size());
+    checkWrite();
+
+    if (framesToRecord == 0 && pendingFrames.empty()) {
+        file.close();
+        checkWrite();
+    }
+}
+
+uint32_t FrameCapture::getShaderId(const ShaderVariant& variant) {
+    std::string key = variant.sourcePath + '\n' + variant.spirvPath;
+    for (const auto& define : variant.defines) {
+        key += '\n' + define.first + '=' + define.second;
+    }
+
+    auto it = shaderIds.find(key);
+    if (it != shaderIds.end()) {
+        return it->second;
+    }
+
+    // The code is stored, so the capture replays the same shaders even after
+    // the sources change
+    uint32_t id = (uint32_t)shaderIds.size();
+    std::vector<uint32_t> code = shaderLoader(variant);
+
+    std::string payload;
+    append(&payload, id);
+    payload.append(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+    writeRecord(CAPTURE_SHADER, payload);
+
+    shaderIds[key] = id;
+    return id;
+}
+
+void FrameCapture::recordCommand(CaptureOpcode opcode, const std::string& payload) {
+    append(&frame.records, opcode);
+    append(&frame.records, (uint32_t)payload.size());
+    frame.records += payload;
+}
+
+void FrameCapture::writeRecord(CaptureOpcode opcode, const std::string& payload) {
+    std::string header;
+    append(&header, opcode);
+    append(&header, (uint32_t)payload.size());
+    file.write(header.data(), header.size());
+    file.write(payload.data(), payload.size());
+}
+
+void FrameCapture::checkWrite() {
+    if (!file) {
+        stop();
+        throw std::runtime_error("ERROR: Failed to write capture");
+    }
+}
+
+// ***** CaptureRecord *****
+
+const uint8_t* CaptureRecord::readBytes(size_t count) {
+    if (count > remaining()) {
+        throw std::runtime_error("ERROR: Capture record is too short");
+    }
+
+    const uint8_t* bytes = payload + position;
+    position += (uint32_t)count;
+    return bytes;
+}
+
+// ***** CaptureReader *****
+
+void CaptureReader::open(const std::string& path) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to open ") + path);
+    }
+
+    contents.resize(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(contents.data()), contents.size());
+    if (!file) {
+        throw std::runtime_error(std::string("ERROR: Failed to read ") + path);
+    }
+
+    uint32_t header[4];
+    if (contents.size() < sizeof(header)) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is not a capture");
+    }
+    memcpy(header, contents.data(), sizeof(header));
+    if (header[0] != FrameCapture::MAGIC) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is not a capture");
+    }
+    if (header[1] != FrameCapture::VERSION) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is from an unsupported version");
+    }
+
+    colorFormat = static_cast<vk::Format>(header[2]);
+    depthFormat = static_cast<vk::Format>(header[3]);
+    recordsStart = sizeof(header);
+    position = recordsStart;
+}
+
+bool CaptureReader::next(CaptureRecord* record) {
+    if (position == contents.size()) {
+        return false;
+    }
+
+    const size_t headerSize = sizeof(uint8_t) + sizeof(uint32_t);
+    if (contents.size() - position < headerSize) {
+        throw std::runtime_error("ERROR: Capture ends partway through a record");
+    }
+
+    uint32_t size;
+    memcpy(&size, contents.data() + position + sizeof(uint8_t), sizeof(size));
+    if (contents.size() - position - headerSize < size) {
+        throw std::runtime_error("ERROR: Capture ends partway through a record");
+    }
+
+    record->opcode = static_cast<CaptureOpcode>(contents[position]);
+    record->payload = contents.data() + position + headerSize;
+    record->size = size;
+    record->position = 0;
+
+    position += headerSize + size;
+    return true;
+}
+
+void CaptureReader::rewind() {
+    position = recordsStart;
+}
@@ -0,0 +1,324 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <unordered_map>
+#include <deque>
+#include <utility>
+#include <cstring>
+
+#include "PipelineLibrary.hpp"
+
+/** The kinds of record in a capture */
+enum CaptureOpcode : uint8_t {
+    CAPTURE_SHADER = 1,            // id, SPIR-V words
+    CAPTURE_PIPELINE,              // id, vertex and fragment shader ids, state
+    CAPTURE_CREATE_BUFFER,         // id, size, usage
+    CAPTURE_UPLOAD_BUFFER,         // id, offset, bytes
+    CAPTURE_BEGIN_FRAME,           // width, height
+    CAPTURE_BIND_PIPELINE,         // pipeline id
+    CAPTURE_BIND_VERTEX_BUFFER,    // binding, buffer id, offset
+    CAPTURE_BIND_INDEX_BUFFER,     // buffer id, offset, index type
+    CAPTURE_DRAW,                  // vertex count, instance count, first vertex, first instance
+    CAPTURE_DRAW_INDEXED,          // index count, instance count, first index, vertex offset, first instance
+    CAPTURE_END_FRAME,
+    CAPTURE_COPY_BUFFER,           // source id, destination id, size
+    CAPTURE_BIND_STORAGE_BUFFERS,  // set, count, then binding and buffer id for each
+    CAPTURE_PUSH_CONSTANTS,        // stages, offset, bytes
+    CAPTURE_PUSH_BUFFER_ADDRESS,   // stages, offset, buffer id
+    CAPTURE_DRAW_INDEXED_INDIRECT, // buffer id, offset, draw count, stride
+};
+
+/**
+ * Records the renderer's commands and resource uploads for a number of
+ * frames into a compact binary file, which the replay tool executes again
+ * without the window. Captures hold the high level commands (bind this
+ * pipeline, draw this many vertices) rather than Vulkan calls, and the
+ * SPIR-V of every shader used, so a replay doesn't depend on the shader
+ * sources.
+ *
+ * A capture of the app holds:
+ * - The geometry arena's vertex and index buffers and the scene's instances,
+ *   as they are when the capture starts, and every mesh added to the arena
+ *   and every time it grows after that
+ * - Both culling phases' draws of the scene, as indexed indirect draws, with
+ *   the indirect draws and instance lists that culling wrote for the frame
+ * - The fullscreen triangle
+ * It doesn't hold the culling and depth pyramid compute passes, whose
+ * results are captured instead, or the virtual texture, the meshlets and
+ * the performance overlay, which the replay tool can't draw.
+ *
+ * Shaders and pipelines are written once, the first time they are used, and
+ * are referred to by id after that. Buffers are identified by the caller,
+ * typically by their handles with getBufferId().
+ *
+ * Buffer creation, uploads and copies are written straight away. A frame's
+ * commands are held back until the GPU has finished the frame, since what
+ * the GPU wrote during it, like the results of culling, is only known then.
+ * The caller copies that into a host visible buffer at the end of the frame
+ * and hands it to finishFrame(), which writes it as uploads at the start of
+ * the frame, ahead of the commands that read it.
+ *
+ * File layout (all integers little endian):
+ *     Header      "VCAP", version, color format, depth format
+ *     Records     opcode (u8), payload size (u32), payload
+ */
+class FrameCapture {
+public:
+    /** The first bytes of a capture */
+    inline static const uint32_t MAGIC = 0x50414356; // "VCAP"
+    /** Increased whenever the format changes */
+    inline static const uint32_t VERSION = 2;
+
+    /**
+     * Starts capturing to a file
+     *
+     * @param path The file to write
+     * @param frameCount The number of frames to capture, after which the file
+     *                   is closed
+     * @param colorFormat The format of the images that are drawn to
+     * @param depthFormat The format of the depth buffer
+     * @param shaderLoader Loads the code of the shaders of captured pipelines
+     *
+     * @throw std::runtime_error if the frame count is 0, or the file couldn't
+     *        be created
+     */
+    void start(const std::string& path, uint32_t frameCount, vk::Format colorFormat, vk::Format depthFormat,
+               PipelineLibrary::ShaderLoader shaderLoader);
+
+    /**
+     * Closes the file, dropping the frames that haven't been finished. Does
+     * nothing if not capturing
+     */
+    void stop();
+
+    /**
+     * @return Whether the file is open, until every frame has been finished
+     */
+    bool isCapturing() const { return file.is_open(); }
+
+    /**
+     * @return Whether a frame is being recorded, between beginFrame() and
+     *         endFrame()
+     */
+    bool isRecordingFrame() const { return recordingFrame; }
+
+    /**
+     * @return The id of a buffer in the capture
+     */
+    static uint64_t getBufferId(vk::Buffer buffer) { return (uint64_t)static_cast<VkBuffer>(buffer); }
+
+    // Each of these writes a record straight away, if capturing. Nothing
+    // drawn by a frame still waiting to be finished may be changed by them
+
+    void createBuffer(uint64_t id, vk::DeviceSize size, vk::BufferUsageFlags usage);
+    void uploadBuffer(uint64_t id, vk::DeviceSize offset, const void* data, vk::DeviceSize size);
+    void copyBuffer(uint64_t sourceId, uint64_t destinationId, vk::DeviceSize size);
+
+    /**
+     * Starts recording a frame, unless every frame has been recorded
+     *
+     * @param extent The size of the frame
+     */
+    void beginFrame(vk::Extent2D extent);
+
+    // Each of these records a command, if recording a frame
+
+    void bindPipeline(const PipelineKey& key);
+    void bindVertexBuffer(uint32_t binding, uint64_t id, vk::DeviceSize offset);
+    void bindIndexBuffer(uint64_t id, vk::DeviceSize offset, vk::IndexType indexType);
+    /** Binds storage buffers to every binding of a set, as binding to id */
+    void bindStorageBuffers(uint32_t set, const std::vector<std::pair<uint32_t, uint64_t> >& buffers);
+    void pushConstants(vk::ShaderStageFlags stages, uint32_t offset, const void* data, uint32_t size);
+    /** Pushes the address the replayed buffer has */
+    void pushBufferAddress(vk::ShaderStageFlags stages, uint32_t offset, uint64_t id);
+    void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+    void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
+                     int32_t vertexOffset, uint32_t firstInstance);
+    void drawIndexedIndirect(uint64_t id, vk::DeviceSize offset, uint32_t drawCount, uint32_t stride);
+
+    /**
+     * Records that the GPU writes a whole buffer during the frame, and that
+     * its contents are in the frame's read back buffer, to be uploaded when
+     * the frame is finished
+     *
+     * @param id The buffer
+     * @param readbackOffset Where the contents are in the read back buffer
+     * @param size The size of the buffer
+     */
+    void uploadReadback(uint64_t id, vk::DeviceSize readbackOffset, vk::DeviceSize size);
+
+    /**
+     * Ends recording a frame. It is written by finishFrame() once the GPU
+     * has finished it
+     *
+     * @param slot Identifies the frame until then, such as its index among
+     *             the frames in flight
+     */
+    void endFrame(uint32_t slot);
+
+    /**
+     * Gets the oldest frame not yet finished. Frames must be finished in the
+     * order they were recorded
+     *
+     * @param slot Set to the slot the frame was recorded with
+     *
+     * @return Whether there is a frame to finish
+     */
+    bool getNextFinish(uint32_t* slot) const;
+
+    /**
+     * Writes the oldest frame not yet finished, with the uploads it read
+     * back, and closes the file if it was the last
+     *
+     * Requires: getNextFinish() is true, and the GPU has finished the frame
+     *
+     * @param readback The frame's read back buffer, visible to the host
+     *
+     * @throw std::runtime_error if writing failed, which stops the capture
+     */
+    void finishFrame(const void* readback);
+
+private:
+    /** A buffer's contents in a frame's read back buffer */
+    struct Readback {
+        uint64_t id;
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+    };
+
+    /** A frame waiting for the GPU to finish it */
+    struct PendingFrame {
+        uint32_t slot = 0;
+        vk::Extent2D extent;
+        /** The records of the frame after its beginning, without the uploads
+         *  read back */
+        std::string records;
+        std::vector<Readback> readbacks;
+    };
+
+    std::ofstream file;
+    /** The number of frames still to begin */
+    uint32_t framesToRecord = 0;
+    PipelineLibrary::ShaderLoader shaderLoader;
+
+    bool recordingFrame = false;
+    /** The frame being recorded */
+    PendingFrame frame;
+    /** The frames recorded and not yet finished, oldest first */
+    std::deque<PendingFrame> pendingFrames;
+
+    /** The ids of the shaders written, by their serialized variants */
+    std::unordered_map<std::string, uint32_t> shaderIds;
+    /** The ids of the pipelines written, by their serialized keys */
+    std::unordered_map<std::string, uint32_t> pipelineIds;
+
+    /**
+     * Gets the id of a shader, writing the shader if it is new
+     */
+    uint32_t getShaderId(const ShaderVariant& variant);
+
+    /**
+     * Appends a record to the frame being recorded
+     */
+    void recordCommand(CaptureOpcode opcode, const std::string& payload);
+
+    /**
+     * Writes a record to the file
+     */
+    void writeRecord(CaptureOpcode opcode, const std::string& payload);
+
+    /**
+     * Closes the file if writing failed
+     *
+     * @throw std::runtime_error if writing failed
+     */
+    void checkWrite();
+};
+
+/** A record read from a capture */
+struct CaptureRecord {
+    CaptureOpcode opcode;
+    const uint8_t* payload;
+    uint32_t size;
+    /** The read position in the payload */
+    uint32_t position = 0;
+
+    /**
+     * Reads the next value of the payload
+     *
+     * @throw std::runtime_error if the payload is too short
+     */
+    template <typename T>
+    T read() {
+        T value;
+        memcpy(&value, readBytes(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    /**
+     * Reads the next bytes of the payload
+     *
+     * @throw std::runtime_error if the payload is too short
+     */
+    const uint8_t* readBytes(size_t count);
+
+    /**
+     * @return The number of bytes of the payload that haven't been read
+     */
+    size_t remaining() const { return size - position; }
+};
+
+/**
+ * Reads the records of a capture. The whole file is read into memory up
+ * front, so replaying never waits on the disk
+ */
+class CaptureReader {
+public:
+    /**
+     * Reads a capture
+     *
+     * @throw std::runtime_error if the file is missing or isn't a capture
+     */
+    void open(const std::string& path);
+
+    /**
+     * @return The format of the images that were drawn to
+     */
+    vk::Format getColorFormat() const { return colorFormat; }
+
+    /**
+     * @return The format of the depth buffer
+     */
+    vk::Format getDepthFormat() const { return depthFormat; }
+
+    /**
+     * Reads the next record
+     *
+     * @param record Set to the record, which points into the reader
+     *
+     * @return Whether there was a record, or false at the end of the file
+     *
+     * @throw std::runtime_error if the file ends partway through a record
+     */
+    bool next(CaptureRecord* record);
+
+    /**
+     * Goes back to the first record
+     */
+    void rewind();
+
+private:
+    std::vector<uint8_t> contents;
+    vk::Format colorFormat;
+    vk::Format depthFormat;
+    /** The offset of the first record */
+    size_t recordsStart = 0;
+    /** The offset of the next record */
+    size_t position = 0;
+};
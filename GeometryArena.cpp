@@ -0,0 +1,265 @@
+// October 18, 2026
+
+#include "GeometryArena.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+// ***** Public methods *****
+
+void GeometryArena::initialize(vk::Device device, MemoryAllocator* allocator, CompletionService* completionService,
+                               bool bufferDeviceAddress, FrameCapture* frameCapture) {
+    this->device = device;
+    this->allocator = allocator;
+    this->completionService = completionService;
+    this->frameCapture = frameCapture;
+
+    // Only the vertex buffer's address is taken, for vertex pulling
+    vertexUsage = vk::BufferUsageFlagBits::eVertexBuffer;
+    vertexAddress = 0;
+#ifdef VK_KHR_buffer_device_address
+    getBufferDeviceAddress = nullptr;
+    if (bufferDeviceAddress) {
+        getBufferDeviceAddress = (PFN_vkGetBufferDeviceAddressKHR) device.getProcAddr("vkGetBufferDeviceAddressKHR");
+        if (getBufferDeviceAddress == nullptr) {
+            throw std::runtime_error("ERROR: Could not load vkGetBufferDeviceAddressKHR.");
+        }
+        vertexUsage |= vk::BufferUsageFlagBits::eShaderDeviceAddressKHR;
+    }
+#endif
+
+    vertexCapacity = INITIAL_VERTEX_CAPACITY;
+    indexCapacity = INITIAL_INDEX_CAPACITY;
+    vertexBuffer = allocator->createBuffer(getBufferInfo(vertexUsage, vertexCapacity),
+                                           vk::MemoryPropertyFlagBits::eDeviceLocal, {}, &vertexAllocation);
+    indexBuffer = allocator->createBuffer(getBufferInfo(vk::BufferUsageFlagBits::eIndexBuffer, indexCapacity),
+                                          vk::MemoryPropertyFlagBits::eDeviceLocal, {}, &indexAllocation);
+    updateVertexAddress();
+
+    freeVertexRanges.clear();
+    freeVertexRanges[0] = vertexCapacity;
+    freeIndexRanges.clear();
+    freeIndexRanges[0] = indexCapacity;
+    vertexBytesUsed = 0;
+    indexBytesUsed = 0;
+}
+
+void GeometryArena::destroy() {
+    allocator->destroyBuffer(vertexBuffer, vertexAllocation);
+    allocator->destroyBuffer(indexBuffer, indexAllocation);
+    freeVertexRanges.clear();
+    freeIndexRanges.clear();
+}
+
+GeometryArena::Mesh GeometryArena::add(vk::Queue queue, uint32_t queueFamilyIndex, const void* vertices,
+                                       uint32_t vertexCount, uint32_t vertexStride,
+                                       const std::vector<uint32_t>& indices) {
+    Mesh mesh;
+    mesh.vertexCount = vertexCount;
+    mesh.indexCount = (uint32_t)indices.size();
+    mesh.vertexSize = (vk::DeviceSize)vertexCount * vertexStride;
+    mesh.indexSize = indices.size() * sizeof(uint32_t);
+
+    // Nothing to copy, and Vulkan doesn't allow an empty staging buffer
+    if (mesh.vertexSize == 0 && mesh.indexSize == 0) {
+        return mesh;
+    }
+
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = mesh.vertexSize + mesh.indexSize;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    Allocation stagingAllocation;
+    vk::Buffer stagingBuffer = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible, {},
+                                                       &stagingAllocation);
+    if (mesh.vertexSize > 0) {
+        memcpy(stagingAllocation.mapped, vertices, mesh.vertexSize);
+    }
+    if (mesh.indexSize > 0) {
+        memcpy(static_cast<char*>(stagingAllocation.mapped) + mesh.vertexSize, indices.data(), mesh.indexSize);
+    }
+    allocator->flush(stagingAllocation, 0, bufferInfo.size);
+
+    vk::CommandPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    vk::CommandPool commandPool = device.createCommandPool(poolInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocateInfo.commandBufferCount = 1;
+    vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(allocateInfo)[0];
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+
+    // An empty part takes no room, so it has no range to free either
+    std::vector<std::pair<vk::Buffer, Allocation> > retired;
+    if (mesh.vertexSize > 0) {
+        if (!allocateRange(&freeVertexRanges, mesh.vertexSize, vertexStride, &mesh.vertexStart)) {
+            grow(commandBuffer, vertexUsage, mesh.vertexSize, vertexStride, &vertexBuffer, &vertexAllocation,
+                 &vertexCapacity, &freeVertexRanges, &retired);
+            allocateRange(&freeVertexRanges, mesh.vertexSize, vertexStride, &mesh.vertexStart);
+            updateVertexAddress();
+        }
+        commandBuffer.copyBuffer(stagingBuffer, vertexBuffer, vk::BufferCopy(0, mesh.vertexStart, mesh.vertexSize));
+        frameCapture->uploadBuffer(FrameCapture::getBufferId(vertexBuffer), mesh.vertexStart, vertices,
+                                   mesh.vertexSize);
+    }
+    if (mesh.indexSize > 0) {
+        if (!allocateRange(&freeIndexRanges, mesh.indexSize, sizeof(uint32_t), &mesh.indexStart)) {
+            grow(commandBuffer, vk::BufferUsageFlagBits::eIndexBuffer, mesh.indexSize, sizeof(uint32_t),
+                 &indexBuffer, &indexAllocation, &indexCapacity, &freeIndexRanges, &retired);
+            allocateRange(&freeIndexRanges, mesh.indexSize, sizeof(uint32_t), &mesh.indexStart);
+        }
+        commandBuffer.copyBuffer(stagingBuffer, indexBuffer,
+                                 vk::BufferCopy(mesh.vertexSize, mesh.indexStart, mesh.indexSize));
+        frameCapture->uploadBuffer(FrameCapture::getBufferId(indexBuffer), mesh.indexStart, indices.data(),
+                                   mesh.indexSize);
+    }
+    mesh.vertexOffset = (int32_t)(mesh.vertexStart / vertexStride);
+    mesh.firstIndex = (uint32_t)(mesh.indexStart / sizeof(uint32_t));
+    vertexBytesUsed += mesh.vertexSize;
+    indexBytesUsed += mesh.indexSize;
+
+    // Later frames read the mesh as vertices and indices, or through the
+    // vertex buffer's address, and growing the buffers copies them
+    vk::MemoryBarrier uploadBarrier(vk::AccessFlagBits::eTransferWrite,
+                                    vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead |
+                                    vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader |
+                                  vk::PipelineStageFlagBits::eTransfer,
+                                  {}, uploadBarrier, nullptr, nullptr);
+    commandBuffer.end();
+
+    // Earlier frames only read other ranges, or the buffers that were
+    // replaced, so the copy doesn't wait for them. The replaced buffers are
+    // freed after those frames too, since the queue finishes them first
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    queue.submit(submitInfo, nullptr);
+
+    completionService->onQueueComplete(queue, [this, commandPool, stagingBuffer, stagingAllocation, retired]() {
+        device.destroyCommandPool(commandPool);
+        allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+        for (const auto& buffer : retired) {
+            allocator->destroyBuffer(buffer.first, buffer.second);
+        }
+    });
+    return mesh;
+}
+
+void GeometryArena::remove(const Mesh& mesh) {
+    if (mesh.vertexSize > 0) {
+        freeRange(&freeVertexRanges, mesh.vertexStart, mesh.vertexSize);
+    }
+    if (mesh.indexSize > 0) {
+        freeRange(&freeIndexRanges, mesh.indexStart, mesh.indexSize);
+    }
+    vertexBytesUsed -= mesh.vertexSize;
+    indexBytesUsed -= mesh.indexSize;
+}
+
+void GeometryArena::bind(vk::CommandBuffer commandBuffer) const {
+    commandBuffer.bindVertexBuffers(0, vertexBuffer, vk::DeviceSize(0));
+    commandBuffer.bindIndexBuffer(indexBuffer, 0, INDEX_TYPE);
+}
+
+// ***** Private methods *****
+
+void GeometryArena::grow(vk::CommandBuffer commandBuffer, vk::BufferUsageFlags usage, vk::DeviceSize size,
+                         vk::DeviceSize alignment, vk::Buffer* buffer, Allocation* allocation,
+                         vk::DeviceSize* capacity, std::map<vk::DeviceSize, vk::DeviceSize>* freeRanges,
+                         std::vector<std::pair<vk::Buffer, Allocation> >* retired) {
+    // Doubling keeps the copies to a small multiple of the final size
+    vk::DeviceSize oldCapacity = *capacity;
+    vk::DeviceSize newCapacity = std::max(2 * oldCapacity, oldCapacity + size + alignment);
+
+    Allocation newAllocation;
+    vk::BufferCreateInfo bufferInfo = getBufferInfo(usage, newCapacity);
+    vk::Buffer newBuffer = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {},
+                                                   &newAllocation);
+    commandBuffer.copyBuffer(*buffer, newBuffer, vk::BufferCopy(0, 0, oldCapacity));
+    frameCapture->createBuffer(FrameCapture::getBufferId(newBuffer), newCapacity, bufferInfo.usage);
+    frameCapture->copyBuffer(FrameCapture::getBufferId(*buffer), FrameCapture::getBufferId(newBuffer), oldCapacity);
+
+    // The mesh's copy may write where the free space was copied to
+    vk::MemoryBarrier growBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {},
+                                  growBarrier, nullptr, nullptr);
+
+    retired->push_back(std::make_pair(*buffer, *allocation));
+    *buffer = newBuffer;
+    *allocation = newAllocation;
+    *capacity = newCapacity;
+    // Merges with a free range at the old end
+    freeRange(freeRanges, oldCapacity, newCapacity - oldCapacity);
+}
+
+void GeometryArena::updateVertexAddress() {
+#ifdef VK_KHR_buffer_device_address
+    if (getBufferDeviceAddress != nullptr) {
+        VkBufferDeviceAddressInfoKHR addressInfo{};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+        addressInfo.buffer = static_cast<VkBuffer>(vertexBuffer);
+        vertexAddress = getBufferDeviceAddress(static_cast<VkDevice>(device), &addressInfo);
+    }
+#endif
+}
+
+// ***** Static methods *****
+
+bool GeometryArena::allocateRange(std::map<vk::DeviceSize, vk::DeviceSize>* freeRanges, vk::DeviceSize size,
+                                  vk::DeviceSize alignment, vk::DeviceSize* offset) {
+    for (auto it = freeRanges->begin(); it != freeRanges->end(); it++) {
+        vk::DeviceSize rangeOffset = it->first;
+        vk::DeviceSize rangeSize = it->second;
+        vk::DeviceSize start = (rangeOffset + alignment - 1) / alignment * alignment;
+        if (start + size > rangeOffset + rangeSize) {
+            continue;
+        }
+
+        // What is left on either side stays free
+        freeRanges->erase(it);
+        if (start > rangeOffset) {
+            (*freeRanges)[rangeOffset] = start - rangeOffset;
+        }
+        if (start + size < rangeOffset + rangeSize) {
+            (*freeRanges)[start + size] = rangeOffset + rangeSize - start - size;
+        }
+        *offset = start;
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::freeRange(std::map<vk::DeviceSize, vk::DeviceSize>* freeRanges, vk::DeviceSize offset,
+                              vk::DeviceSize size) {
+    auto next = freeRanges->lower_bound(offset);
+    if (next != freeRanges->end() && offset + size == next->first) {
+        size += next->second;
+        next = freeRanges->erase(next);
+    }
+    if (next != freeRanges->begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            freeRanges->erase(previous);
+        }
+    }
+    (*freeRanges)[offset] = size;
+}
+
+vk::BufferCreateInfo GeometryArena::getBufferInfo(vk::BufferUsageFlags usage, vk::DeviceSize size) {
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = size;
+    bufferInfo.usage = usage | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    return bufferInfo;
+}
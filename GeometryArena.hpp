@@ -0,0 +1,234 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <map>
+#include <utility>
+
+#include "MemoryAllocator.hpp"
+#include "CompletionService.hpp"
+#include "FrameCapture.hpp"
+
+/**
+ * Holds the static geometry of every mesh in one vertex buffer and one index
+ * buffer, so the pair is bound once per frame however many meshes are drawn.
+ * A mesh is a range of each buffer, addressed in a draw or an indirect draw
+ * by its first index and vertex offset, which also lets meshes share a
+ * multi-draw.
+ *
+ * The ranges are handed out like the MemoryAllocator's: the free ranges of
+ * each buffer are kept in an ordered map so neighbouring ranges merge when
+ * freed, and a mesh goes at the first free range that fits. A mesh's
+ * vertices are aligned to their stride, so its vertex offset is a whole
+ * number of its vertices, and meshes of different layouts can share the
+ * buffer.
+ *
+ * Indices are 32 bit, since a mesh's indices count from its own first
+ * vertex and every mesh shares the one index type.
+ *
+ * The buffers start small and grow with the geometry. When a mesh doesn't
+ * fit, its buffer is replaced by one at least twice the size, and the old
+ * contents are copied over on the GPU along with the mesh's upload, so the
+ * meshes keep their offsets. The buffers are long lived blocks that are only
+ * replaced by growing, so they aren't given to the defragmenter. With buffer
+ * device addresses, the vertex buffer's address is kept up to date for
+ * vertex pulling.
+ *
+ * While a frame capture is running, every mesh added and every buffer grown
+ * is written to it, so the capture's copy of the buffers stays current.
+ */
+class GeometryArena {
+public:
+    /** The size each buffer starts at */
+    inline static const vk::DeviceSize INITIAL_VERTEX_CAPACITY = 64ull * 1024;
+    inline static const vk::DeviceSize INITIAL_INDEX_CAPACITY = 32ull * 1024;
+    /** The type of every index */
+    inline static const vk::IndexType INDEX_TYPE = vk::IndexType::eUint32;
+
+    /** Where a mesh's geometry is in the buffers */
+    struct Mesh {
+        /** The first of its indices, counted in indices */
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        /** Its first vertex, counted in its own vertices */
+        int32_t vertexOffset = 0;
+        uint32_t vertexCount = 0;
+        /** Its ranges of each buffer, in bytes */
+        vk::DeviceSize vertexStart = 0;
+        vk::DeviceSize vertexSize = 0;
+        vk::DeviceSize indexStart = 0;
+        vk::DeviceSize indexSize = 0;
+    };
+
+    /**
+     * Creates the buffers, empty
+     *
+     * @param device The logical device
+     * @param allocator Allocates the memory of the buffers
+     * @param completionService Frees the staging of each upload, and the
+     *                          buffers replaced by growing, once it is done
+     * @param bufferDeviceAddress Whether buffer device addresses are enabled,
+     *                            for taking the vertex buffer's address
+     * @param frameCapture Gets the meshes added and the buffers grown while
+     *                     it is capturing
+     */
+    void initialize(vk::Device device, MemoryAllocator* allocator, CompletionService* completionService,
+                    bool bufferDeviceAddress, FrameCapture* frameCapture);
+
+    /**
+     * Destroys the buffers
+     *
+     * Requires: No frame drawing from them is still in use
+     */
+    void destroy();
+
+    /**
+     * Copies a mesh into the buffers through a staging buffer, without
+     * waiting for the copy. Work submitted to the queue afterwards sees the
+     * mesh, and the staging buffer is freed once the copy is done. Either
+     * buffer grows if the mesh doesn't fit. A mesh without vertices or
+     * indices takes no room in that buffer, and nothing is submitted for one
+     * with neither
+     *
+     * Requires: The queue is not being used by another thread
+     *
+     * @param queue The queue to upload with
+     * @param queueFamilyIndex The family of the queue
+     * @param vertices The vertices, vertexCount * vertexStride bytes
+     * @param vertexCount The number of vertices
+     * @param vertexStride The size of each vertex
+     * @param indices The indices, counting from the mesh's first vertex
+     *
+     * @return Where the mesh is
+     */
+    Mesh add(vk::Queue queue, uint32_t queueFamilyIndex, const void* vertices, uint32_t vertexCount,
+             uint32_t vertexStride, const std::vector<uint32_t>& indices);
+
+    /**
+     * Frees a mesh's ranges, for other meshes to take
+     *
+     * Requires: No frame drawing the mesh is still in use
+     */
+    void remove(const Mesh& mesh);
+
+    /**
+     * Binds the vertex buffer to binding 0 and the index buffer. Draws of any
+     * mesh can follow, until something else is bound
+     */
+    void bind(vk::CommandBuffer commandBuffer) const;
+
+    /**
+     * @return The address of the vertex buffer, or 0 without buffer device
+     *         addresses. It changes when the buffer grows, so it must be got
+     *         again each frame
+     */
+    vk::DeviceAddress getVertexAddress() const { return vertexAddress; }
+
+    /**
+     * @return The bytes of each buffer in use
+     */
+    vk::DeviceSize getVertexBytesUsed() const { return vertexBytesUsed; }
+    vk::DeviceSize getIndexBytesUsed() const { return indexBytesUsed; }
+
+    /**
+     * @return The size of each buffer
+     */
+    vk::DeviceSize getVertexCapacity() const { return vertexCapacity; }
+    vk::DeviceSize getIndexCapacity() const { return indexCapacity; }
+
+    /**
+     * @return The buffers, which are replaced when they grow
+     */
+    vk::Buffer getVertexBuffer() const { return vertexBuffer; }
+    vk::Buffer getIndexBuffer() const { return indexBuffer; }
+
+    /**
+     * @return The usage each buffer is created with
+     */
+    vk::BufferUsageFlags getVertexUsage() const { return getBufferInfo(vertexUsage, 0).usage; }
+    vk::BufferUsageFlags getIndexUsage() const {
+        return getBufferInfo(vk::BufferUsageFlagBits::eIndexBuffer, 0).usage;
+    }
+
+private:
+    vk::Device device;
+    MemoryAllocator* allocator = nullptr;
+    CompletionService* completionService = nullptr;
+    FrameCapture* frameCapture = nullptr;
+
+    vk::Buffer vertexBuffer;
+    Allocation vertexAllocation;
+    vk::DeviceSize vertexCapacity = 0;
+    /** Has the device address usage when addresses are enabled */
+    vk::BufferUsageFlags vertexUsage;
+    vk::Buffer indexBuffer;
+    Allocation indexAllocation;
+    vk::DeviceSize indexCapacity = 0;
+
+    /** The free ranges of each buffer, as offset to size */
+    std::map<vk::DeviceSize, vk::DeviceSize> freeVertexRanges;
+    std::map<vk::DeviceSize, vk::DeviceSize> freeIndexRanges;
+    vk::DeviceSize vertexBytesUsed = 0;
+    vk::DeviceSize indexBytesUsed = 0;
+
+    vk::DeviceAddress vertexAddress = 0;
+#ifdef VK_KHR_buffer_device_address
+    // Loaded from the device, since it comes from an extension
+    PFN_vkGetBufferDeviceAddressKHR getBufferDeviceAddress = nullptr;
+#endif
+
+    /**
+     * Takes a range from the first free range it fits in
+     *
+     * @param freeRanges The free ranges of the buffer
+     * @param size The size of the range
+     * @param alignment What the offset must be a multiple of, which needn't
+     *                  be a power of 2
+     * @param offset Set to the offset of the range
+     *
+     * @return Whether a free range fit
+     */
+    static bool allocateRange(std::map<vk::DeviceSize, vk::DeviceSize>* freeRanges, vk::DeviceSize size,
+                              vk::DeviceSize alignment, vk::DeviceSize* offset);
+
+    /**
+     * Gives a range back, merging it with its free neighbours
+     */
+    static void freeRange(std::map<vk::DeviceSize, vk::DeviceSize>* freeRanges, vk::DeviceSize offset,
+                          vk::DeviceSize size);
+
+    /**
+     * @return How the buffers are created, which can be copied from so they
+     *         can grow
+     */
+    static vk::BufferCreateInfo getBufferInfo(vk::BufferUsageFlags usage, vk::DeviceSize size);
+
+    /**
+     * Replaces a buffer with a larger one, at least twice the size and with
+     * room for a range after its old end, and records the copy of the old
+     * contents
+     *
+     * @param commandBuffer Records the copy, and a barrier after it
+     * @param usage The usage of the buffer
+     * @param size The size of the range that must fit
+     * @param alignment The alignment of the range
+     * @param buffer The buffer, set to the new one
+     * @param allocation Its memory, set to the new one's
+     * @param capacity Its size, set to the new one's
+     * @param freeRanges Its free ranges, which get the new room
+     * @param retired Gets the old buffer and memory, to destroy once the
+     *                copy is done
+     */
+    void grow(vk::CommandBuffer commandBuffer, vk::BufferUsageFlags usage, vk::DeviceSize size,
+              vk::DeviceSize alignment, vk::Buffer* buffer, Allocation* allocation, vk::DeviceSize* capacity,
+              std::map<vk::DeviceSize, vk::DeviceSize>* freeRanges,
+              std::vector<std::pair<vk::Buffer, Allocation> >* retired);
+
+    /**
+     * Gets the address of the vertex buffer again, if addresses are enabled
+     */
+    void updateVertexAddress();
+};
@@ -0,0 +1,102 @@
+// October 18, 2026
+
+#include "LayoutCache.hpp"
+
+// Appends the bytes of a value to a cache key
+template <typename T>
+static void appendKey(std::string* key, const T& value) {
+    key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// ***** Public methods *****
+
+void LayoutCache::initialize(vk::Device device) {
+    this->device = device;
+}
+
+void LayoutCache::destroy() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const auto& entry : pipelineLayouts) {
+        device.destroyPipelineLayout(entry.second);
+    }
+    pipelineLayouts.clear();
+
+    for (const auto& entry : descriptorSetLayouts) {
+        device.destroyDescriptorSetLayout(entry.second);
+    }
+    descriptorSetLayouts.clear();
+}
+
+vk::PipelineLayout LayoutCache::getPipelineLayout(const ShaderReflection& reflection) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Sets must be contiguous in a pipeline layout, so any set that isn't
+    // used gets an empty layout
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    uint32_t setCount = reflection.descriptorSets.empty() ? 0 : reflection.descriptorSets.rbegin()->first + 1;
+    for (uint32_t set = 0; set < setCount; set++) {
+        auto it = reflection.descriptorSets.find(set);
+        if (it == reflection.descriptorSets.end()) {
+            setLayouts.push_back(getDescriptorSetLayoutLocked({}));
+        } else {
+            setLayouts.push_back(getDescriptorSetLayoutLocked(it->second));
+        }
+    }
+
+    // Set layouts are deduplicated, so their handles identify them
+    std::string key;
+    for (vk::DescriptorSetLayout setLayout : setLayouts) {
+        appendKey(&key, static_cast<VkDescriptorSetLayout>(setLayout));
+    }
+    for (const auto& range : reflection.pushConstantRanges) {
+        appendKey(&key, static_cast<VkShaderStageFlags>(range.stageFlags));
+        appendKey(&key, range.offset);
+        appendKey(&key, range.size);
+    }
+
+    auto it = pipelineLayouts.find(key);
+    if (it != pipelineLayouts.end()) {
+        return it->second;
+    }
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.setLayoutCount = (uint32_t)setLayouts.size();
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = (uint32_t)reflection.pushConstantRanges.size();
+    pipelineLayoutInfo.pPushConstantRanges = reflection.pushConstantRanges.data();
+
+    vk::PipelineLayout pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+    pipelineLayouts[key] = pipelineLayout;
+    return pipelineLayout;
+}
+
+vk::DescriptorSetLayout LayoutCache::getDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return getDescriptorSetLayoutLocked(bindings);
+}
+
+// ***** Private methods *****
+
+vk::DescriptorSetLayout LayoutCache::getDescriptorSetLayoutLocked(const std::vector<vk::DescriptorSetLayoutBinding>& bindings) {
+    std::string key;
+    for (const auto& binding : bindings) {
+        appendKey(&key, binding.binding);
+        appendKey(&key, static_cast<VkDescriptorType>(binding.descriptorType));
+        appendKey(&key, binding.descriptorCount);
+        appendKey(&key, static_cast<VkShaderStageFlags>(binding.stageFlags));
+    }
+
+    auto it = descriptorSetLayouts.find(key);
+    if (it != descriptorSetLayouts.end()) {
+        return it->second;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo createInfo{};
+    createInfo.bindingCount = (uint32_t)bindings.size();
+    createInfo.pBindings = bindings.data();
+
+    vk::DescriptorSetLayout setLayout = device.createDescriptorSetLayout(createInfo);
+    descriptorSetLayouts[key] = setLayout;
+    return setLayout;
+}
@@ -0,0 +1,73 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+#include "ShaderReflection.hpp"
+
+/**
+ * Creates descriptor set layouts and pipeline layouts, and shares them between
+ * every pipeline with the same interface. Layouts are looked up by their
+ * contents, so pipelines whose shaders declare the same bindings get the very
+ * same layout handles, and layouts are never created twice.
+ *
+ * The cache owns every layout it creates. It is safe to use from several
+ * threads, so pipelines can be built in the background.
+ */
+class LayoutCache {
+public:
+    /**
+     * @param device The logical device to create layouts with
+     */
+    void initialize(vk::Device device);
+
+    /**
+     * Destroys every layout created by the cache
+     *
+     * Requires: No pipeline using the layouts is still in use
+     */
+    void destroy();
+
+    /**
+     * Gets the pipeline layout matching the interface of a set of shaders,
+     * creating it (and its descriptor set layouts) if needed. Descriptor sets
+     * that are skipped by the shaders get empty layouts
+     *
+     * @param reflection The merged reflection of every stage of the pipeline
+     *
+     * @return The shared pipeline layout
+     */
+    vk::PipelineLayout getPipelineLayout(const ShaderReflection& reflection);
+
+    /**
+     * Gets the descriptor set layout with the given bindings, creating it if
+     * needed
+     *
+     * @param bindings The bindings of the set, sorted by binding number
+     *
+     * @return The shared descriptor set layout
+     */
+    vk::DescriptorSetLayout getDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+
+private:
+    vk::Device device;
+
+    std::mutex mutex;
+    /** Descriptor set layouts, by the serialized bindings */
+    std::unordered_map<std::string, vk::DescriptorSetLayout> descriptorSetLayouts;
+    /** Pipeline layouts, by the serialized set layouts and push constants */
+    std::unordered_map<std::string, vk::PipelineLayout> pipelineLayouts;
+
+    /**
+     * Gets a descriptor set layout, creating it if needed
+     *
+     * Requires: The mutex is held
+     */
+    vk::DescriptorSetLayout getDescriptorSetLayoutLocked(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+};
@@ -0,0 +1,424 @@
+// October 18, 2026
+
+#include "MemoryAllocator.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+// Rounds a value up to a multiple of an alignment
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// ***** Public methods *****
+
+void MemoryAllocator::initialize(vk::PhysicalDevice physicalDevice, vk::Device device, bool deviceAddresses) {
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->deviceAddresses = deviceAddresses;
+    memoryProperties = physicalDevice.getMemoryProperties();
+
+    vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+    granularity = limits.bufferImageGranularity;
+    nonCoherentAtomSize = limits.nonCoherentAtomSize;
+}
+
+void MemoryAllocator::destroy() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (Block& block : blocks) {
+        if (block.memory) {
+            // Freeing memory unmaps it
+            device.freeMemory(block.memory);
+        }
+    }
+    blocks.clear();
+    allocatedBytes = 0;
+    usedBytes = 0;
+}
+
+Allocation MemoryAllocator::allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags required,
+                                     vk::MemoryPropertyFlags preferred) {
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, required, preferred);
+    // Ranges are whole atoms, so flushing a range never touches a neighbour
+    vk::DeviceSize minAlignment = std::max(granularity, nonCoherentAtomSize);
+    vk::DeviceSize alignment = std::max(requirements.alignment, minAlignment);
+    vk::DeviceSize size = alignUp(requirements.size, minAlignment);
+
+    // Small heaps (like the 256MB device local and host visible heap) get
+    // smaller blocks, so one block doesn't take all of the heap
+    uint32_t heapIndex = memoryProperties.memoryTypes[memoryType].heapIndex;
+    vk::DeviceSize blockSize = std::min(BLOCK_SIZE, memoryProperties.memoryHeaps[heapIndex].size / 8);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Allocation allocation;
+    allocation.memoryType = memoryType;
+    allocation.size = size;
+
+    // Large allocations would waste most of a block, so they get their own
+    // memory
+    if (size > blockSize / 2) {
+        allocation.memory = allocateMemory(size, memoryType, &allocation.mapped);
+        allocation.offset = 0;
+        allocation.block = DEDICATED;
+        allocatedBytes += size;
+        usedBytes += size;
+        return allocation;
+    }
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (blocks[i].memory && blocks[i].memoryType == memoryType &&
+            allocateFromBlock(i, size, alignment, &allocation)) {
+
+            return allocation;
+        }
+    }
+
+    // No block has room, so make a new one, reusing the slot of a freed one
+    Block block;
+    block.memory = allocateMemory(blockSize, memoryType, &block.mapped);
+    block.size = blockSize;
+    block.memoryType = memoryType;
+    block.freeRanges[0] = blockSize;
+    allocatedBytes += blockSize;
+
+    auto freeSlot = std::find_if(blocks.begin(), blocks.end(), [](const Block& b) { return !b.memory; });
+    uint32_t blockIndex = (uint32_t)(freeSlot - blocks.begin());
+    if (freeSlot == blocks.end()) {
+        blocks.push_back(std::move(block));
+    } else {
+        *freeSlot = std::move(block);
+    }
+
+    // A new block always has room, since the size is at most half of it
+    allocateFromBlock(blockIndex, size, alignment, &allocation);
+    return allocation;
+}
+
+void MemoryAllocator::free(const Allocation& allocation) {
+    if (!allocation.memory) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    usedBytes -= allocation.size;
+
+    if (allocation.block == DEDICATED) {
+        device.freeMemory(allocation.memory);
+        allocatedBytes -= allocation.size;
+        return;
+    }
+
+    Block& block = blocks[allocation.block];
+    block.used -= allocation.size;
+    vk::DeviceSize offset = allocation.offset;
+    vk::DeviceSize size = allocation.size;
+
+    // Merge with the free range after, and then the one before
+    auto next = block.freeRanges.lower_bound(offset);
+    if (next != block.freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = block.freeRanges.erase(next);
+    }
+    if (next != block.freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            block.freeRanges.erase(previous);
+        }
+    }
+    block.freeRanges[offset] = size;
+
+    // Empty blocks are given back to the device, keeping one spare per
+    // memory type so allocating and freeing in a loop doesn't thrash
+    if (size == block.size) {
+        bool hasSpare = false;
+        for (uint32_t i = 0; i < blocks.size(); i++) {
+            if (i != allocation.block && blocks[i].memory && blocks[i].memoryType == block.memoryType &&
+                blocks[i].freeRanges.size() == 1 && blocks[i].freeRanges.begin()->second == blocks[i].size) {
+
+                hasSpare = true;
+                break;
+            }
+        }
+
+        if (hasSpare) {
+            device.freeMemory(block.memory);
+            allocatedBytes -= block.size;
+            block.memory = nullptr;
+            block.mapped = nullptr;
+            block.freeRanges.clear();
+        }
+    }
+}
+
+vk::Buffer MemoryAllocator::createBuffer(const vk::BufferCreateInfo& createInfo, vk::MemoryPropertyFlags required,
+                                         vk::MemoryPropertyFlags preferred, Allocation* allocation) {
+    vk::Buffer buffer = device.createBuffer(createInfo);
+
+    try {
+        *allocation = allocate(device.getBufferMemoryRequirements(buffer), required, preferred);
+    } catch (...) {
+        device.destroyBuffer(buffer);
+        throw;
+    }
+    device.bindBufferMemory(buffer, allocation->memory, allocation->offset);
+
+    return buffer;
+}
+
+vk::Image MemoryAllocator::createImage(const vk::ImageCreateInfo& createInfo, vk::MemoryPropertyFlags required,
+                                       vk::MemoryPropertyFlags preferred, Allocation* allocation) {
+    vk::Image image = device.createImage(createInfo);
+
+    try {
+        *allocation = allocate(device.getImageMemoryRequirements(image), required, preferred);
+    } catch (...) {
+        device.destroyImage(image);
+        throw;
+    }
+    device.bindImageMemory(image, allocation->memory, allocation->offset);
+
+    return image;
+}
+
+void MemoryAllocator::destroyBuffer(vk::Buffer buffer, const Allocation& allocation) {
+    device.destroyBuffer(buffer);
+    free(allocation);
+}
+
+void MemoryAllocator::destroyImage(vk::Image image, const Allocation& allocation) {
+    device.destroyImage(image);
+    free(allocation);
+}
+
+void MemoryAllocator::flush(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size) {
+    if (!isCoherent(allocation.memoryType)) {
+        device.flushMappedMemoryRanges(getAtomRange(allocation, offset, size));
+    }
+}
+
+void MemoryAllocator::addFlushRange(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size,
+                                    std::vector<vk::MappedMemoryRange>* ranges) const {
+    if (isCoherent(allocation.memoryType) || size == 0) {
+        return;
+    }
+
+    vk::MappedMemoryRange range = getAtomRange(allocation, offset, size);
+    if (!ranges->empty()) {
+        vk::MappedMemoryRange& last = ranges->back();
+        if (last.memory == range.memory && range.offset <= last.offset + last.size &&
+            last.offset <= range.offset + range.size) {
+
+            vk::DeviceSize end = std::max(last.offset + last.size, range.offset + range.size);
+            last.offset = std::min(last.offset, range.offset);
+            last.size = end - last.offset;
+            return;
+        }
+    }
+    ranges->push_back(range);
+}
+
+void MemoryAllocator::flush(std::vector<vk::MappedMemoryRange>* ranges) {
+    if (ranges->empty()) {
+        return;
+    }
+
+    // Ranges from different sources can still share memory, so they are
+    // merged again once they are all together
+    std::sort(ranges->begin(), ranges->end(), [](const vk::MappedMemoryRange& a, const vk::MappedMemoryRange& b) {
+        return a.memory != b.memory ? a.memory < b.memory : a.offset < b.offset;
+    });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges->size(); i++) {
+        vk::MappedMemoryRange& last = (*ranges)[merged];
+        const vk::MappedMemoryRange& range = (*ranges)[i];
+        if (range.memory == last.memory && range.offset <= last.offset + last.size) {
+            last.size = std::max(last.offset + last.size, range.offset + range.size) - last.offset;
+        } else {
+            (*ranges)[++merged] = range;
+        }
+    }
+    ranges->resize(merged + 1);
+
+    device.flushMappedMemoryRanges(*ranges);
+    ranges->clear();
+}
+
+void MemoryAllocator::invalidate(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size) {
+    if (!isCoherent(allocation.memoryType)) {
+        device.invalidateMappedMemoryRanges(getAtomRange(allocation, offset, size));
+    }
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags required,
+                                         vk::MemoryPropertyFlags preferred) const {
+    // Memory types are ordered by the driver from best to worst, so the first
+    // match is taken
+    for (vk::MemoryPropertyFlags wanted : { required | preferred, required }) {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted) {
+                return i;
+            }
+        }
+    }
+
+    throw std::runtime_error("ERROR: Failed to find a suitable memory type.");
+}
+
+bool MemoryAllocator::isCoherent(uint32_t memoryType) const {
+    return (bool)(memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+vk::DeviceSize MemoryAllocator::getAllocatedBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocatedBytes;
+}
+
+vk::DeviceSize MemoryAllocator::getUsedBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
+
+void MemoryAllocator::releaseEmptyBlocks() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (Block& block : blocks) {
+        if (block.memory && block.freeRanges.size() == 1 && block.freeRanges.begin()->second == block.size) {
+            device.freeMemory(block.memory);
+            allocatedBytes -= block.size;
+            block.memory = nullptr;
+            block.mapped = nullptr;
+            block.freeRanges.clear();
+        }
+    }
+}
+
+bool MemoryAllocator::isMoveCandidate(const Allocation& allocation) {
+    if (allocation.block == DEDICATED) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const Block& source = blocks[allocation.block];
+    vk::DeviceSize room = 0;
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        const Block& block = blocks[i];
+        // Moving into the spare would only trade one block for another
+        if (i == allocation.block || !block.memory || block.memoryType != source.memoryType || block.used == 0) {
+            continue;
+        }
+        // Ties go to the later block, so only one block is emptied at a time
+        if (block.used < source.used || (block.used == source.used && i > allocation.block)) {
+            return false;
+        }
+        room += block.size - block.used;
+    }
+
+    return room >= source.used;
+}
+
+bool MemoryAllocator::allocateForMove(const vk::MemoryRequirements& requirements, const Allocation& current,
+                                      Allocation* moved) {
+    if (current.block == DEDICATED || !(requirements.memoryTypeBits & (1u << current.memoryType))) {
+        return false;
+    }
+
+    // Placed like allocate() would
+    vk::DeviceSize minAlignment = std::max(granularity, nonCoherentAtomSize);
+    vk::DeviceSize alignment = std::max(requirements.alignment, minAlignment);
+    vk::DeviceSize size = alignUp(requirements.size, minAlignment);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    vk::DeviceSize sourceUsed = blocks[current.block].used;
+    moved->memoryType = current.memoryType;
+    moved->size = size;
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (i != current.block && blocks[i].memory && blocks[i].memoryType == current.memoryType &&
+            blocks[i].used > 0 && blocks[i].used >= sourceUsed && allocateFromBlock(i, size, alignment, moved)) {
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ***** Private methods *****
+
+vk::MappedMemoryRange MemoryAllocator::getAtomRange(const Allocation& allocation, vk::DeviceSize offset,
+                                                    vk::DeviceSize size) const {
+    // Ranges must be aligned to the atom size, which allocations always are,
+    // so the range never leaves the allocation
+    vk::DeviceSize start = (allocation.offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+    vk::DeviceSize end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+
+    vk::MappedMemoryRange range{};
+    range.memory = allocation.memory;
+    range.offset = start;
+    range.size = end - start;
+    return range;
+}
+
+vk::DeviceMemory MemoryAllocator::allocateMemory(vk::DeviceSize size, uint32_t memoryType, void** mapped) {
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.allocationSize = size;
+    allocateInfo.memoryTypeIndex = memoryType;
+
+#ifdef VK_KHR_buffer_device_address
+    // Any buffer could be placed in any block, so every block gets the flag
+    vk::MemoryAllocateFlagsInfo flagsInfo{};
+    if (deviceAddresses) {
+        flagsInfo.flags = vk::MemoryAllocateFlagBits::eDeviceAddressKHR;
+        allocateInfo.pNext = &flagsInfo;
+    }
+#endif
+
+    vk::DeviceMemory memory = device.allocateMemory(allocateInfo);
+
+    *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+        *mapped = device.mapMemory(memory, 0, VK_WHOLE_SIZE);
+    }
+
+    return memory;
+}
+
+bool MemoryAllocator::allocateFromBlock(uint32_t blockIndex, vk::DeviceSize size, vk::DeviceSize alignment,
+                                        Allocation* allocation) {
+    Block& block = blocks[blockIndex];
+
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); it++) {
+        vk::DeviceSize rangeOffset = it->first;
+        vk::DeviceSize rangeSize = it->second;
+        vk::DeviceSize offset = alignUp(rangeOffset, alignment);
+        if (offset + size > rangeOffset + rangeSize) {
+            continue;
+        }
+
+        // Split the range, keeping what is left before and after. The padding
+        // before is kept free, so it can merge back when neighbours are freed
+        block.freeRanges.erase(it);
+        if (offset > rangeOffset) {
+            block.freeRanges[rangeOffset] = offset - rangeOffset;
+        }
+        if (offset + size < rangeOffset + rangeSize) {
+            block.freeRanges[offset + size] = rangeOffset + rangeSize - offset - size;
+        }
+
+        allocation->memory = block.memory;
+        allocation->offset = offset;
+        allocation->mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        allocation->block = blockIndex;
+        block.used += size;
+        usedBytes += size;
+        return true;
+    }
+
+    return false;
+}
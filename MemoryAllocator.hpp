@@ -0,0 +1,258 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <map>
+#include <mutex>
+
+/** A range of device memory handed out by the MemoryAllocator */
+struct Allocation {
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    /** The address of the range, if the memory is host visible */
+    void* mapped = nullptr;
+    /** The memory type the range was allocated from */
+    uint32_t memoryType = 0;
+    /** The block the range is in, or DEDICATED if it has its own memory */
+    uint32_t block = 0;
+};
+
+/**
+ * Sub-allocates buffers and images from large blocks of device memory, since
+ * devices only allow a few thousand allocations and each one is slow.
+ *
+ * Each block belongs to one memory type, and keeps its free ranges in an
+ * ordered map so neighbouring ranges merge when freed. Allocations are placed
+ * at the first free range that fits. Host visible blocks stay mapped for their
+ * whole life, so allocations in them can be written to directly. Allocations
+ * too large to share a block get their own memory.
+ *
+ * Every range is aligned to bufferImageGranularity, so buffers and optimally
+ * tiled images can share blocks, and to the non-coherent atom size, so
+ * flushing one range never touches another.
+ *
+ * Long runs leave holes as allocations come and go. The Defragmenter moves
+ * allocations out of the emptiest block of a type into fuller ones, using
+ * isMoveCandidate() and allocateForMove(), so the block can be given back.
+ */
+class MemoryAllocator {
+public:
+    /** The block index of allocations with their own memory */
+    inline static const uint32_t DEDICATED = UINT32_MAX;
+    /** The size of each block, unless the heap is small */
+    inline static const vk::DeviceSize BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    /**
+     * @param physicalDevice The physical device, for its memory types
+     * @param device The logical device to allocate from
+     * @param deviceAddresses Whether buffers with eShaderDeviceAddress usage
+     *                        may be created, in which case all memory is
+     *                        allocated so their addresses can be taken
+     */
+    void initialize(vk::PhysicalDevice physicalDevice, vk::Device device, bool deviceAddresses);
+
+    /**
+     * Frees every block
+     *
+     * Requires: Every buffer and image using the memory has been destroyed
+     */
+    void destroy();
+
+    /**
+     * Allocates memory
+     *
+     * @param requirements The size, alignment and memory types allowed
+     * @param required The properties the memory must have
+     * @param preferred Properties the memory should have if a type with them
+     *                  exists, like host cached for reading back
+     *
+     * @return The allocation
+     *
+     * @throw std::runtime_error if no memory type fits, or the device is out
+     *        of memory
+     */
+    Allocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags required,
+                        vk::MemoryPropertyFlags preferred = {});
+
+    /**
+     * Returns an allocation to its block
+     */
+    void free(const Allocation& allocation);
+
+    /**
+     * Creates a buffer and binds memory to it
+     *
+     * @param allocation Set to the memory of the buffer
+     */
+    vk::Buffer createBuffer(const vk::BufferCreateInfo& createInfo, vk::MemoryPropertyFlags required,
+                            vk::MemoryPropertyFlags preferred, Allocation* allocation);
+
+    /**
+     * Creates an image and binds memory to it
+     *
+     * @param allocation Set to the memory of the image
+     */
+    vk::Image createImage(const vk::ImageCreateInfo& createInfo, vk::MemoryPropertyFlags required,
+                          vk::MemoryPropertyFlags preferred, Allocation* allocation);
+
+    /**
+     * Destroys a buffer made by createBuffer(), and frees its memory
+     */
+    void destroyBuffer(vk::Buffer buffer, const Allocation& allocation);
+
+    /**
+     * Destroys an image made by createImage(), and frees its memory
+     */
+    void destroyImage(vk::Image image, const Allocation& allocation);
+
+    /**
+     * Makes host writes to part of an allocation visible to the device. Does
+     * nothing for host coherent memory
+     *
+     * @param allocation A host visible allocation
+     * @param offset The start of the written range, within the allocation
+     * @param size The size of the written range
+     */
+    void flush(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size);
+
+    /**
+     * Adds host writes to part of an allocation to a batch, to be made
+     * visible later by flush(). The range is widened to whole atoms, and
+     * merged into the last range of the batch if they touch, as they do for
+     * writes going linearly through a ring. Does nothing for host coherent
+     * memory
+     *
+     * @param allocation A host visible allocation
+     * @param offset The start of the written range, within the allocation
+     * @param size The size of the written range
+     * @param ranges The batch
+     */
+    void addFlushRange(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size,
+                       std::vector<vk::MappedMemoryRange>* ranges) const;
+
+    /**
+     * Makes a batch of host writes visible to the device in one call, after
+     * merging the ranges that overlap or touch. Empties the batch
+     *
+     * Requires: The memory of every range is still allocated
+     *
+     * @param ranges The batch, from addFlushRange()
+     */
+    void flush(std::vector<vk::MappedMemoryRange>* ranges);
+
+    /**
+     * Makes device writes to part of an allocation visible to the host. Does
+     * nothing for host coherent memory
+     *
+     * @param allocation A host visible allocation
+     * @param offset The start of the range to read, within the allocation
+     * @param size The size of the range to read
+     */
+    void invalidate(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size);
+
+    /**
+     * Finds a memory type
+     *
+     * @param typeBits The memory types allowed, as a bit mask
+     * @param required The properties the type must have
+     * @param preferred Properties the type should have if possible
+     *
+     * @return The index of the memory type
+     *
+     * @throw std::runtime_error if no memory type fits
+     */
+    uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags required,
+                            vk::MemoryPropertyFlags preferred = {}) const;
+
+    /**
+     * @return Whether a memory type is host coherent
+     */
+    bool isCoherent(uint32_t memoryType) const;
+
+    /**
+     * @return The bytes of device memory allocated, in blocks and dedicated
+     *         allocations
+     */
+    vk::DeviceSize getAllocatedBytes();
+
+    /**
+     * @return The bytes handed out in allocations
+     */
+    vk::DeviceSize getUsedBytes();
+
+    /**
+     * Gives every empty block back to the device, including the spare kept
+     * for each memory type, for when the app won't allocate for a while
+     */
+    void releaseEmptyBlocks();
+
+    /**
+     * @return Whether moving an allocation would help empty a block: it is
+     *         in the emptiest block of its memory type that is in use, and
+     *         the other blocks of the type have room for all of that block
+     */
+    bool isMoveCandidate(const Allocation& allocation);
+
+    /**
+     * Allocates a new place for an allocation being moved, in a fuller block
+     * of the same memory type. Never makes a block, so moving only ever
+     * packs allocations into fewer blocks
+     *
+     * @param requirements The requirements of the resource at its new place
+     * @param current The allocation being moved, which is freed by the caller
+     *                once nothing uses it
+     * @param moved Set to the new place
+     *
+     * @return Whether a fuller block had room
+     */
+    bool allocateForMove(const vk::MemoryRequirements& requirements, const Allocation& current, Allocation* moved);
+
+private:
+    /** A block of memory shared by many allocations */
+    struct Block {
+        vk::DeviceMemory memory;
+        vk::DeviceSize size;
+        uint32_t memoryType;
+        void* mapped;
+        /** The bytes handed out in allocations */
+        vk::DeviceSize used = 0;
+        /** The free ranges, as offset to size */
+        std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+    };
+
+    vk::PhysicalDevice physicalDevice;
+    vk::Device device;
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    vk::DeviceSize granularity = 1;
+    vk::DeviceSize nonCoherentAtomSize = 1;
+    bool deviceAddresses = false;
+
+    std::mutex mutex;
+    /** The blocks, where destroyed blocks are left with a null memory so
+     *  block indices stay valid */
+    std::vector<Block> blocks;
+    vk::DeviceSize allocatedBytes = 0;
+    vk::DeviceSize usedBytes = 0;
+
+    /**
+     * Gets the atom aligned range covering part of an allocation, for
+     * flushing and invalidating
+     */
+    vk::MappedMemoryRange getAtomRange(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size) const;
+
+    /**
+     * Allocates and maps device memory
+     */
+    vk::DeviceMemory allocateMemory(vk::DeviceSize size, uint32_t memoryType, void** mapped);
+
+    /**
+     * Takes a range out of a block, if one fits
+     *
+     * @return Whether the range was found
+     */
+    bool allocateFromBlock(uint32_t blockIndex, vk::DeviceSize size, vk::DeviceSize alignment, Allocation* allocation);
+};
@@ -0,0 +1,285 @@
+// October 18, 2026
+
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace {
+
+// A FIFO vertex cache, simulated with the time each vertex went in. A vertex
+// is cached while fewer than CACHE_SIZE others have gone in since
+struct FifoCache {
+    std::vector<uint32_t> times;
+    uint32_t time = MeshOptimizer::CACHE_SIZE + 1;
+
+    explicit FifoCache(size_t vertexCount) : times(vertexCount, 0) {}
+
+    // Looks up a vertex, adding it on a miss. Returns whether it missed
+    bool access(uint32_t vertex) {
+        if (time - times[vertex] <= MeshOptimizer::CACHE_SIZE) {
+            return false;
+        }
+        times[vertex] = time++;
+        return true;
+    }
+
+    // Empties the cache, by moving time past everything in it
+    void clear() {
+        time += MeshOptimizer::CACHE_SIZE + 1;
+    }
+};
+
+} // namespace
+
+// The cross product of a triangle's edges, twice its area long
+static void faceNormal(const float* a, const float* b, const float* c, double* normal) {
+    double ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    double ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+// ***** Static methods *****
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>* indices, size_t vertexCount) {
+    size_t triangleCount = indices->size() / 3;
+
+    // The triangles around each vertex, as runs in one list
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : *indices) {
+        liveTriangles[index]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        offsets[vertex + 1] = offsets[vertex] + liveTriangles[vertex];
+    }
+    std::vector<uint32_t> adjacency(offsets.back());
+    std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        adjacency[filled[(*indices)[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTimes(vertexCount, 0);
+    uint32_t time = CACHE_SIZE + 1;
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    std::vector<uint32_t> clusters = { 0 };
+
+    uint32_t cursor = 0;
+    int64_t fan = skipDeadEnd(liveTriangles, &deadEnds, &cursor);
+    while (fan >= 0) {
+        // Draws every triangle left around the vertex
+        candidates.clear();
+        for (uint32_t i = offsets[fan]; i < offsets[fan + 1]; i++) {
+            uint32_t triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = (*indices)[(size_t)triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTimes[vertex] > CACHE_SIZE) {
+                    cacheTimes[vertex] = time++;
+                }
+            }
+        }
+
+        bool jumped = false;
+        fan = getNextVertex(candidates, liveTriangles, cacheTimes, time, &deadEnds, &cursor, &jumped);
+        if (jumped && fan >= 0) {
+            clusters.push_back((uint32_t)(output.size() / 3));
+        }
+    }
+
+    // Whatever isn't a whole triangle is kept at the end, as it was
+    output.insert(output.end(), indices->begin() + triangleCount * 3, indices->end());
+    indices->swap(output);
+    return clusters;
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<MeshletMesh::Vertex>& vertices,
+                                     const std::vector<uint32_t>& clusters, float threshold) {
+    size_t triangleCount = indices->size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Each cluster is split once the ACMR of its start, drawn from an empty
+    // cache, is low enough. The pieces can then go anywhere, since each one
+    // only loses what its first few triangles found cached
+    float targetAcmr = analyzeVertexCache(*indices, vertices.size()).acmr * threshold;
+    std::vector<uint32_t> pieces;
+    FifoCache cache(vertices.size());
+    for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+        uint32_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : (uint32_t)triangleCount;
+        uint32_t start = clusters[cluster];
+        uint32_t misses = 0;
+        cache.clear();
+        pieces.push_back(start);
+        for (uint32_t triangle = start; triangle < end; triangle++) {
+            for (int corner = 0; corner < 3; corner++) {
+                misses += cache.access((*indices)[(size_t)triangle * 3 + corner]) ? 1 : 0;
+            }
+            if (triangle + 1 < end && (float)misses <= targetAcmr * (float)(triangle + 1 - start)) {
+                start = triangle + 1;
+                misses = 0;
+                cache.clear();
+                pieces.push_back(start);
+            }
+        }
+    }
+
+    // The center of the mesh, weighting each triangle by its area
+    double meshCenter[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+    std::vector<double> centers(pieces.size() * 3, 0.0);
+    std::vector<double> normals(pieces.size() * 3, 0.0);
+    for (size_t piece = 0; piece < pieces.size(); piece++) {
+        uint32_t end = piece + 1 < pieces.size() ? pieces[piece + 1] : (uint32_t)triangleCount;
+        double pieceArea = 0.0;
+        for (uint32_t triangle = pieces[piece]; triangle < end; triangle++) {
+            const float* a = vertices[(*indices)[(size_t)triangle * 3]].position;
+            const float* b = vertices[(*indices)[(size_t)triangle * 3 + 1]].position;
+            const float* c = vertices[(*indices)[(size_t)triangle * 3 + 2]].position;
+            double normal[3];
+            faceNormal(a, b, c, normal);
+            double area = std::hypot(normal[0], normal[1], normal[2]) / 2.0;
+            for (int axis = 0; axis < 3; axis++) {
+                double center = (a[axis] + b[axis] + c[axis]) / 3.0;
+                centers[piece * 3 + axis] += center * area;
+                normals[piece * 3 + axis] += normal[axis];
+                meshCenter[axis] += center * area;
+            }
+            pieceArea += area;
+        }
+        for (int axis = 0; axis < 3 && pieceArea > 0.0; axis++) {
+            centers[piece * 3 + axis] /= pieceArea;
+        }
+        meshArea += pieceArea;
+    }
+    for (int axis = 0; axis < 3 && meshArea > 0.0; axis++) {
+        meshCenter[axis] /= meshArea;
+    }
+
+    // Pieces far out along their own normal are on the outside, facing out,
+    // and are drawn first
+    std::vector<double> keys(pieces.size(), 0.0);
+    for (size_t piece = 0; piece < pieces.size(); piece++) {
+        const double* normal = &normals[piece * 3];
+        double length = std::hypot(normal[0], normal[1], normal[2]);
+        if (length == 0.0) {
+            continue;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            keys[piece] += (centers[piece * 3 + axis] - meshCenter[axis]) * normal[axis] / length;
+        }
+    }
+    std::vector<uint32_t> order(pieces.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices->size());
+    for (uint32_t piece : order) {
+        uint32_t end = piece + 1 < pieces.size() ? pieces[piece + 1] : (uint32_t)triangleCount;
+        output.insert(output.end(), indices->begin() + (size_t)pieces[piece] * 3, indices->begin() + (size_t)end * 3);
+    }
+    output.insert(output.end(), indices->begin() + triangleCount * 3, indices->end());
+    indices->swap(output);
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(std::vector<MeshletMesh::Vertex>* vertices,
+                                                         std::vector<uint32_t>* indices) {
+    std::vector<uint32_t> remap(vertices->size(), ~0u);
+    std::vector<MeshletMesh::Vertex> reordered;
+    reordered.reserve(vertices->size());
+    for (uint32_t& index : *indices) {
+        if (remap[index] == ~0u) {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back((*vertices)[index]);
+        }
+        index = remap[index];
+    }
+    vertices->swap(reordered);
+    return remap;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount) {
+    FifoCache cache(vertexCount);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0;
+    size_t usedCount = 0;
+    for (uint32_t index : indices) {
+        misses += cache.access(index) ? 1 : 0;
+        if (!used[index]) {
+            used[index] = true;
+            usedCount++;
+        }
+    }
+
+    CacheStats stats{};
+    size_t triangleCount = indices.size() / 3;
+    stats.acmr = triangleCount > 0 ? (float)misses / (float)triangleCount : 0.f;
+    stats.atvr = usedCount > 0 ? (float)misses / (float)usedCount : 0.f;
+    return stats;
+}
+
+// ***** Private methods *****
+
+int64_t MeshOptimizer::getNextVertex(const std::vector<uint32_t>& candidates,
+                                     const std::vector<uint32_t>& liveTriangles,
+                                     const std::vector<uint32_t>& cacheTimes, uint32_t time,
+                                     std::vector<uint32_t>* deadEnds, uint32_t* cursor, bool* jumped) {
+    // A vertex that will still be cached after its own triangles are drawn
+    // is best, the longer it has been cached the better, since it is
+    // closest to falling out
+    int64_t best = -1;
+    int64_t bestPriority = -1;
+    for (uint32_t vertex : candidates) {
+        if (liveTriangles[vertex] == 0) {
+            continue;
+        }
+        int64_t priority = 0;
+        int64_t age = (int64_t)time - cacheTimes[vertex];
+        if (age + 2 * (int64_t)liveTriangles[vertex] <= CACHE_SIZE) {
+            priority = age;
+        }
+        if (priority > bestPriority) {
+            best = vertex;
+            bestPriority = priority;
+        }
+    }
+
+    if (best < 0) {
+        *jumped = true;
+        return skipDeadEnd(liveTriangles, deadEnds, cursor);
+    }
+    return best;
+}
+
+int64_t MeshOptimizer::skipDeadEnd(const std::vector<uint32_t>& liveTriangles, std::vector<uint32_t>* deadEnds,
+                                   uint32_t* cursor) {
+    while (!deadEnds->empty()) {
+        uint32_t vertex = deadEnds->back();
+        deadEnds->pop_back();
+        if (liveTriangles[vertex] > 0) {
+            return vertex;
+        }
+    }
+    for (; *cursor < liveTriangles.size(); (*cursor)++) {
+        if (liveTriangles[*cursor] > 0) {
+            return *cursor;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,119 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "MeshletMesh.hpp"
+
+/**
+ * Reorders a triangle mesh for the GPU without changing what it draws, before
+ * it is split into meshlets.
+ *
+ * The triangles are ordered for the post-transform vertex cache with Tipsify
+ * (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+ * and Reduced Overdraw"), which fans around each vertex while its neighbors
+ * are still cached. Meshlets are built from the triangles in order, so the
+ * same locality keeps their vertex lists short.
+ *
+ * Optionally, the clusters of triangles Tipsify leaves are then sorted so
+ * those facing out from the center of the mesh are drawn first, since they
+ * tend to hide the rest. Inside a cluster the order is kept, so the cache
+ * stays almost as good.
+ *
+ * Last, the vertices are renumbered in the order the triangles first use
+ * them, so vertex fetches walk through memory.
+ *
+ * How well the cache works is measured by simulating a FIFO cache of
+ * CACHE_SIZE vertices. The ACMR (average cache miss ratio) is the vertices
+ * transformed for each triangle, from 3 down to about 0.5 for a regular
+ * grid. The ATVR (average transformed vertex ratio) is the vertices
+ * transformed for each vertex used, 1 at best.
+ */
+class MeshOptimizer {
+public:
+    /** The vertices the simulated cache holds. Tipsify orders for it, and a
+     *  smaller real cache only loses a little */
+    inline static const uint32_t CACHE_SIZE = 16;
+
+    /** The results of simulating the cache */
+    struct CacheStats {
+        /** The vertices transformed for each triangle */
+        float acmr;
+        /** The vertices transformed for each vertex used */
+        float atvr;
+    };
+
+    /**
+     * Reorders the triangles for the vertex cache
+     *
+     * @param indices 3 vertex indices for each triangle, reordered in place.
+     *                Each triangle keeps its winding
+     * @param vertexCount The number of vertices the indices index into
+     *
+     * @return The first triangle of each cluster, the runs of triangles
+     *         between the points where Tipsify had to jump elsewhere in the
+     *         mesh. Starts with 0
+     */
+    static std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>* indices, size_t vertexCount);
+
+    /**
+     * Sorts the clusters from optimizeVertexCache() so those facing out from
+     * the center of the mesh come first. Clusters are first split wherever
+     * that costs little in the cache, so they are small enough to sort
+     *
+     * Requires: The indices are as optimizeVertexCache() left them
+     *
+     * @param indices 3 vertex indices for each triangle, reordered in place
+     * @param vertices The vertices of the mesh
+     * @param clusters The first triangle of each cluster
+     * @param threshold How much worse than optimizeVertexCache()'s ACMR the
+     *                  ACMR may get, such as 1.05 for 5% worse
+     */
+    static void optimizeOverdraw(std::vector<uint32_t>* indices, const std::vector<MeshletMesh::Vertex>& vertices,
+                                 const std::vector<uint32_t>& clusters, float threshold);
+
+    /**
+     * Renumbers the vertices in the order the triangles first use them, and
+     * drops those no triangle uses
+     *
+     * @param vertices The vertices, reordered in place
+     * @param indices 3 vertex indices for each triangle, renumbered in place
+     *
+     * @return The new index of each old vertex, or ~0u if it was dropped, so
+     *         other index lists into the vertices can be renumbered
+     */
+    static std::vector<uint32_t> optimizeVertexFetch(std::vector<MeshletMesh::Vertex>* vertices,
+                                                     std::vector<uint32_t>* indices);
+
+    /**
+     * Simulates drawing the triangles through a FIFO cache of CACHE_SIZE
+     * vertices
+     *
+     * @param indices 3 vertex indices for each triangle
+     * @param vertexCount The number of vertices the indices index into
+     */
+    static CacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+private:
+    /**
+     * Picks the next vertex to fan around from the vertices of the last fan:
+     * the one whose triangles will still find the most vertices cached. Falls
+     * back to skipDeadEnd() if none has triangles left
+     *
+     * @return The vertex, or -1 if every triangle has been drawn
+     */
+    static int64_t getNextVertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& liveTriangles,
+                                 const std::vector<uint32_t>& cacheTimes, uint32_t time,
+                                 std::vector<uint32_t>* deadEnds, uint32_t* cursor, bool* jumped);
+
+    /**
+     * Picks a vertex with triangles left, first from the recently used
+     * vertices and then in order from the cursor
+     *
+     * @return The vertex, or -1 if every triangle has been drawn
+     */
+    static int64_t skipDeadEnd(const std::vector<uint32_t>& liveTriangles, std::vector<uint32_t>* deadEnds,
+                               uint32_t* cursor);
+};
@@ -0,0 +1,324 @@
+// October 18, 2026
+
+#include "MeshSimplifier.hpp"
+
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+
+// The cross product of b - a and c - a
+static void triangleNormal(const float* a, const float* b, const float* c, double* normal) {
+    double ab[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+    double ac[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+// Scales a vector to unit length, returning its length before
+static double normalize(double* vector) {
+    double length = std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+    if (length > 0.0) {
+        vector[0] /= length;
+        vector[1] /= length;
+        vector[2] /= length;
+    }
+    return length;
+}
+
+// ***** Quadric *****
+
+void MeshSimplifier::Quadric::addPlane(const double* normal, double distance, double weight) {
+    const double plane[4] = { normal[0], normal[1], normal[2], distance };
+    int i = 0;
+    for (int row = 0; row < 4; row++) {
+        for (int column = row; column < 4; column++) {
+            m[i++] += weight * plane[row] * plane[column];
+        }
+    }
+}
+
+void MeshSimplifier::Quadric::add(const Quadric& other) {
+    for (int i = 0; i < 10; i++) {
+        m[i] += other.m[i];
+    }
+}
+
+double MeshSimplifier::Quadric::evaluate(const float* position) const {
+    const double point[4] = { position[0], position[1], position[2], 1.0 };
+    double sum = 0.0;
+    int i = 0;
+    for (int row = 0; row < 4; row++) {
+        for (int column = row; column < 4; column++) {
+            // The entries off the diagonal stand for both halves
+            sum += (row == column ? 1.0 : 2.0) * m[i++] * point[row] * point[column];
+        }
+    }
+    return std::max(sum, 0.0);
+}
+
+// ***** Public methods *****
+
+MeshSimplifier::MeshSimplifier(const std::vector<MeshletMesh::Vertex>& vertices,
+                               const std::vector<uint32_t>& indices) : vertices(vertices) {
+    // Weld the vertices by position, so hard edges move as one
+    std::map<std::array<float, 3>, uint32_t> weldedIds;
+    welded.resize(vertices.size());
+    for (uint32_t i = 0; i < vertices.size(); i++) {
+        std::array<float, 3> position = { vertices[i].position[0], vertices[i].position[1], vertices[i].position[2] };
+        auto inserted = weldedIds.emplace(position, (uint32_t)weldedVertices.size());
+        if (inserted.second) {
+            weldedVertices.emplace_back();
+        }
+        welded[i] = inserted.first->second;
+        weldedVertices[welded[i]].push_back(i);
+    }
+
+    size_t weldedCount = weldedVertices.size();
+    quadrics.resize(weldedCount);
+    collapsed.assign(weldedCount, false);
+    versions.assign(weldedCount, 0);
+    weldedTriangles.resize(weldedCount);
+
+    // Triangles that are already degenerate are dropped
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+        uint32_t a = welded[triangle[0]], b = welded[triangle[1]], c = welded[triangle[2]];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+
+        uint32_t id = (uint32_t)triangles.size();
+        triangles.push_back(triangle);
+        weldedTriangles[a].push_back(id);
+        weldedTriangles[b].push_back(id);
+        weldedTriangles[c].push_back(id);
+
+        double normal[3];
+        triangleNormal(getPosition(a), getPosition(b), getPosition(c), normal);
+        if (normalize(normal) == 0.0) {
+            continue;
+        }
+        const float* p = getPosition(a);
+        double distance = -(normal[0] * p[0] + normal[1] * p[1] + normal[2] * p[2]);
+        for (uint32_t corner : { a, b, c }) {
+            quadrics[corner].addPlane(normal, distance, 1.0);
+        }
+    }
+    triangleAlive.assign(triangles.size(), true);
+    liveTriangleCount = triangles.size();
+
+    // Edges with a triangle on only one side are borders, which get a plane
+    // through the edge at right angles to the triangle, so collapses keep
+    // them where they are
+    std::map<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, uint32_t> > edges;
+    for (uint32_t id = 0; id < triangles.size(); id++) {
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t a = welded[triangles[id][corner]];
+            uint32_t b = welded[triangles[id][(corner + 1) % 3]];
+            auto& edge = edges[std::make_pair(std::min(a, b), std::max(a, b))];
+            edge.first++;
+            edge.second = id;
+        }
+    }
+    for (const auto& edge : edges) {
+        uint32_t a = edge.first.first;
+        uint32_t b = edge.first.second;
+        if (edge.second.first == 1) {
+            const auto& triangle = triangles[edge.second.second];
+            double faceNormal[3];
+            triangleNormal(getPosition(welded[triangle[0]]), getPosition(welded[triangle[1]]),
+                           getPosition(welded[triangle[2]]), faceNormal);
+            const float* pa = getPosition(a);
+            const float* pb = getPosition(b);
+            double direction[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+            double length = normalize(direction);
+            double normal[3] = {
+                direction[1] * faceNormal[2] - direction[2] * faceNormal[1],
+                direction[2] * faceNormal[0] - direction[0] * faceNormal[2],
+                direction[0] * faceNormal[1] - direction[1] * faceNormal[0],
+            };
+            if (normalize(normal) > 0.0) {
+                double distance = -(normal[0] * pa[0] + normal[1] * pa[1] + normal[2] * pa[2]);
+                // Weighted by length, so long borders hold as firmly as the
+                // surface around them
+                quadrics[a].addPlane(normal, distance, BORDER_WEIGHT * length * length);
+                quadrics[b].addPlane(normal, distance, BORDER_WEIGHT * length * length);
+            }
+        }
+        queueEdge(a, b);
+    }
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(size_t targetTriangleCount) {
+    while (liveTriangleCount > targetTriangleCount && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+
+        // Collapses queued before their vertices last changed are stale, and
+        // were queued again with the new costs
+        if (collapsed[collapse.from] || collapsed[collapse.to] ||
+            versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion) {
+            continue;
+        }
+        if (!isValid(collapse)) {
+            continue;
+        }
+        apply(collapse);
+    }
+
+    std::vector<uint32_t> indices;
+    indices.reserve(liveTriangleCount * 3);
+    for (uint32_t id = 0; id < triangles.size(); id++) {
+        if (triangleAlive[id]) {
+            indices.insert(indices.end(), triangles[id].begin(), triangles[id].end());
+        }
+    }
+    return indices;
+}
+
+float MeshSimplifier::getError() const {
+    // The cost sums the squared distances to the planes, so its root is at
+    // least the distance to any one of them
+    return (float)std::sqrt(maxCost);
+}
+
+// ***** Private methods *****
+
+const float* MeshSimplifier::getPosition(uint32_t weldedVertex) const {
+    return vertices[weldedVertices[weldedVertex][0]].position;
+}
+
+std::vector<uint32_t> MeshSimplifier::getNeighbors(uint32_t weldedVertex) const {
+    std::vector<uint32_t> neighbors;
+    for (uint32_t id : weldedTriangles[weldedVertex]) {
+        if (!triangleAlive[id]) {
+            continue;
+        }
+        for (uint32_t vertex : triangles[id]) {
+            if (welded[vertex] != weldedVertex) {
+                neighbors.push_back(welded[vertex]);
+            }
+        }
+    }
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    return neighbors;
+}
+
+void MeshSimplifier::queueEdge(uint32_t a, uint32_t b) {
+    Quadric quadric = quadrics[a];
+    quadric.add(quadrics[b]);
+    double costToA = quadric.evaluate(getPosition(a));
+    double costToB = quadric.evaluate(getPosition(b));
+    if (costToA < costToB) {
+        queue.push(Collapse{ costToA, b, a, versions[b], versions[a] });
+    } else {
+        queue.push(Collapse{ costToB, a, b, versions[a], versions[b] });
+    }
+}
+
+bool MeshSimplifier::isValid(const Collapse& collapse) const {
+    // The link condition: the only neighbors the two share are the third
+    // corners of the triangles between them. Any other would pinch the
+    // surface into a non-manifold edge
+    std::vector<uint32_t> fromNeighbors = getNeighbors(collapse.from);
+    std::vector<uint32_t> toNeighbors = getNeighbors(collapse.to);
+    std::vector<uint32_t> shared;
+    std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(), toNeighbors.begin(), toNeighbors.end(),
+                          std::back_inserter(shared));
+    size_t sharedTriangles = 0;
+    for (uint32_t id : weldedTriangles[collapse.from]) {
+        if (!triangleAlive[id]) {
+            continue;
+        }
+        bool hasTo = false;
+        for (uint32_t vertex : triangles[id]) {
+            hasTo = hasTo || welded[vertex] == collapse.to;
+        }
+        if (hasTo) {
+            sharedTriangles++;
+            continue;
+        }
+
+        // The triangles that stay mustn't flip over or collapse to a line
+        const float* corners[3];
+        const float* moved[3];
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = welded[triangles[id][corner]];
+            corners[corner] = getPosition(vertex);
+            moved[corner] = vertex == collapse.from ? getPosition(collapse.to) : corners[corner];
+        }
+        double before[3];
+        double after[3];
+        triangleNormal(corners[0], corners[1], corners[2], before);
+        triangleNormal(moved[0], moved[1], moved[2], after);
+        if (normalize(after) == 0.0) {
+            return false;
+        }
+        normalize(before);
+        if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] < MIN_NORMAL_COSINE) {
+            return false;
+        }
+    }
+    return shared.size() <= sharedTriangles;
+}
+
+void MeshSimplifier::apply(const Collapse& collapse) {
+    const std::vector<uint32_t>& targets = weldedVertices[collapse.to];
+
+    for (uint32_t id : weldedTriangles[collapse.from]) {
+        if (!triangleAlive[id]) {
+            continue;
+        }
+
+        bool hasTo = false;
+        for (uint32_t vertex : triangles[id]) {
+            hasTo = hasTo || welded[vertex] == collapse.to;
+        }
+        if (hasTo) {
+            triangleAlive[id] = false;
+            liveTriangleCount--;
+            continue;
+        }
+
+        // Each corner takes the vertex at the new position whose normal is
+        // closest to its own, which keeps hard edges hard
+        for (uint32_t& vertex : triangles[id]) {
+            if (welded[vertex] != collapse.from) {
+                continue;
+            }
+            const float* normal = vertices[vertex].normal;
+            uint32_t best = targets[0];
+            float bestDot = -2.f;
+            for (uint32_t target : targets) {
+                const float* targetNormal = vertices[target].normal;
+                float dot = normal[0] * targetNormal[0] + normal[1] * targetNormal[1] + normal[2] * targetNormal[2];
+                if (dot > bestDot) {
+                    bestDot = dot;
+                    best = target;
+                }
+            }
+            vertex = best;
+        }
+        weldedTriangles[collapse.to].push_back(id);
+    }
+
+    collapsed[collapse.from] = true;
+    weldedTriangles[collapse.from].clear();
+    quadrics[collapse.to].add(quadrics[collapse.from]);
+    versions[collapse.to]++;
+    maxCost = std::max(maxCost, collapse.cost);
+
+    // Drop the dead triangles, so the lists don't keep growing
+    std::vector<uint32_t>& toTriangles = weldedTriangles[collapse.to];
+    toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+                                     [this](uint32_t id) { return !triangleAlive[id]; }),
+                      toTriangles.end());
+
+    // Every edge around the moved vertex has a new cost
+    for (uint32_t neighbor : getNeighbors(collapse.to)) {
+        queueEdge(collapse.to, neighbor);
+    }
+}
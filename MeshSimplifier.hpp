@@ -0,0 +1,131 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <array>
+#include <cstdint>
+
+#include "MeshletMesh.hpp"
+
+/**
+ * Simplifies a triangle mesh by collapsing edges, cheapest first, with the
+ * cost of a collapse measured by quadric error metrics (Garland and
+ * Heckbert).
+ *
+ * Each collapse moves one vertex onto a neighbor rather than to a new
+ * position, so every level of detail indexes into the original vertices, and
+ * the levels can share one vertex buffer. Vertices with the same position
+ * but different normals (a hard edge) move together, so seams stay closed.
+ *
+ * Simplification is progressive: each call to simplify() continues from
+ * where the last one stopped, so a mesh's levels of detail come from one
+ * run, each coarser than the last.
+ */
+class MeshSimplifier {
+public:
+    /**
+     * @param vertices The vertices of the mesh
+     * @param indices 3 vertex indices for each triangle
+     */
+    MeshSimplifier(const std::vector<MeshletMesh::Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+    /**
+     * Collapses edges until the mesh has at most the target number of
+     * triangles, or no collapse is left that doesn't fold the surface over
+     *
+     * @param targetTriangleCount The number of triangles to stop at
+     *
+     * @return 3 vertex indices for each triangle left
+     */
+    std::vector<uint32_t> simplify(size_t targetTriangleCount);
+
+    /**
+     * @return The number of triangles left
+     */
+    size_t getTriangleCount() const { return liveTriangleCount; }
+
+    /**
+     * @return A bound on how far the simplified surface is from the
+     *         original, in the units of the positions
+     */
+    float getError() const;
+
+private:
+    /** The weight of the planes that keep open borders in place, relative to
+     *  the planes of the triangles */
+    inline static const double BORDER_WEIGHT = 10.0;
+    /** The least cosine between a triangle's normal before and after a
+     *  collapse. Anything lower is a fold, and the collapse is skipped */
+    inline static const double MIN_NORMAL_COSINE = 0.2;
+
+    /** A symmetric 4x4 matrix, summing the squared distances to planes */
+    struct Quadric {
+        double m[10] = {};
+
+        void addPlane(const double* normal, double distance, double weight);
+        void add(const Quadric& other);
+        double evaluate(const float* position) const;
+    };
+
+    /** A possible collapse, moving one welded vertex onto another */
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        /** The versions of the two vertices when this was queued. If either
+         *  has changed, the collapse is stale */
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    std::vector<MeshletMesh::Vertex> vertices;
+    /** The welded vertex of each vertex, shared by vertices with the same
+     *  position */
+    std::vector<uint32_t> welded;
+    /** The vertices of each welded vertex */
+    std::vector<std::vector<uint32_t> > weldedVertices;
+    std::vector<Quadric> quadrics;
+    std::vector<bool> collapsed;
+    std::vector<uint32_t> versions;
+
+    /** The vertex indices of each triangle, which collapses rewrite */
+    std::vector<std::array<uint32_t, 3> > triangles;
+    std::vector<bool> triangleAlive;
+    /** The triangles around each welded vertex. May list dead triangles */
+    std::vector<std::vector<uint32_t> > weldedTriangles;
+    size_t liveTriangleCount = 0;
+    /** The cost of the most costly collapse so far */
+    double maxCost = 0.0;
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > queue;
+
+    /**
+     * @return The position of a welded vertex
+     */
+    const float* getPosition(uint32_t weldedVertex) const;
+
+    /**
+     * @return The welded vertices sharing a live triangle with one
+     */
+    std::vector<uint32_t> getNeighbors(uint32_t weldedVertex) const;
+
+    /**
+     * Queues the cheaper direction of collapsing an edge
+     */
+    void queueEdge(uint32_t a, uint32_t b);
+
+    /**
+     * @return Whether a collapse keeps the surface manifold and unfolded
+     */
+    bool isValid(const Collapse& collapse) const;
+
+    /**
+     * Moves a welded vertex onto another, removing the triangles between them
+     */
+    void apply(const Collapse& collapse);
+};
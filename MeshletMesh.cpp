@@ -0,0 +1,420 @@
+// October 18, 2026
+
+#include "MeshletMesh.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// The shaders read these with std430 layouts
+static_assert(sizeof(MeshletMesh::Vertex) == 24, "Vertex must match the shaders");
+static_assert(sizeof(MeshletMesh::QuantizedVertex) == 12, "QuantizedVertex must match the shaders");
+static_assert(sizeof(MeshletMesh::Meshlet) == 48, "Meshlet must match the shaders");
+static_assert(sizeof(MeshletMesh::Lod) == 16, "Lod must match the shaders");
+
+// Cones wider than this (the cosine of the widest normal's angle from the
+// axis) almost never cull, so they aren't tested at all
+static const float MIN_CONE_SPREAD = 0.1f;
+
+static void writeU32(std::ofstream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static uint32_t readU32(std::ifstream& in) {
+    uint32_t value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+template <typename T>
+static void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+// Encodes a unit vector by folding the octahedron |x| + |y| + |z| = 1 onto
+// the square [-1, 1]^2, its lower half folded over the diagonals
+static void encodeOctahedral(const float* normal, int16_t* encoded) {
+    float sum = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    float u = sum > 0.f ? normal[0] / sum : 0.f;
+    float v = sum > 0.f ? normal[1] / sum : 0.f;
+    if (normal[2] < 0.f) {
+        float foldedU = (1.f - std::fabs(v)) * (u >= 0.f ? 1.f : -1.f);
+        float foldedV = (1.f - std::fabs(u)) * (v >= 0.f ? 1.f : -1.f);
+        u = foldedU;
+        v = foldedV;
+    }
+    encoded[0] = (int16_t)std::lround(std::clamp(u, -1.f, 1.f) * 32767.f);
+    encoded[1] = (int16_t)std::lround(std::clamp(v, -1.f, 1.f) * 32767.f);
+}
+
+template <typename T>
+static void readArray(std::ifstream& in, std::vector<T>* values, size_t count) {
+    values->resize(count);
+    in.read(reinterpret_cast<char*>(values->data()), count * sizeof(T));
+}
+
+// ***** Static methods *****
+
+MeshletMesh MeshletMesh::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    MeshletMesh mesh;
+    mesh.vertices = vertices;
+
+    // The bounding sphere of the mesh, around the center of its box
+    float minimum[3] = { INFINITY, INFINITY, INFINITY };
+    float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (const Vertex& vertex : vertices) {
+        for (int axis = 0; axis < 3; axis++) {
+            minimum[axis] = std::min(minimum[axis], vertex.position[axis]);
+            maximum[axis] = std::max(maximum[axis], vertex.position[axis]);
+        }
+    }
+    for (int axis = 0; axis < 3 && !vertices.empty(); axis++) {
+        mesh.center[axis] = (minimum[axis] + maximum[axis]) / 2.f;
+    }
+    for (const Vertex& vertex : vertices) {
+        float distance = std::hypot(vertex.position[0] - mesh.center[0], vertex.position[1] - mesh.center[1],
+                                    vertex.position[2] - mesh.center[2]);
+        mesh.radius = std::max(mesh.radius, distance);
+    }
+
+    mesh.addLod(indices, 0.f);
+    return mesh;
+}
+
+MeshletMesh MeshletMesh::read(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to open ") + path);
+    }
+
+    uint32_t magic = readU32(in);
+    uint32_t version = readU32(in);
+    if (!in || magic != MAGIC) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is not a meshlet file");
+    }
+    if (version != VERSION) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is from an unsupported version");
+    }
+
+    uint32_t vertexCount = readU32(in);
+    uint32_t meshletCount = readU32(in);
+    uint32_t meshletVertexCount = readU32(in);
+    uint32_t triangleCount = readU32(in);
+    uint32_t lodCount = readU32(in);
+    if (lodCount == 0 || lodCount > MAX_LODS) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " has an invalid number of levels of detail");
+    }
+
+    MeshletMesh mesh;
+    in.read(reinterpret_cast<char*>(mesh.center), sizeof(mesh.center));
+    in.read(reinterpret_cast<char*>(&mesh.radius), sizeof(mesh.radius));
+    uint32_t vertexFormat = readU32(in);
+    in.read(reinterpret_cast<char*>(mesh.quantization), sizeof(mesh.quantization));
+    if (vertexFormat == VERTEX_FORMAT_FLOAT) {
+        readArray(in, &mesh.vertices, vertexCount);
+    } else if (vertexFormat == VERTEX_FORMAT_QUANTIZED) {
+        readArray(in, &mesh.quantizedVertices, vertexCount);
+    } else {
+        throw std::runtime_error(std::string("ERROR: ") + path + " has an unknown vertex format");
+    }
+    mesh.vertexFormat = (VertexFormat)vertexFormat;
+    readArray(in, &mesh.meshlets, meshletCount);
+    readArray(in, &mesh.lods, lodCount);
+    readArray(in, &mesh.meshletVertices, meshletVertexCount);
+    readArray(in, &mesh.meshletTriangles, ((size_t)triangleCount * 3 + 3) / 4 * 4);
+    if (!in) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is truncated");
+    }
+
+    // The shaders trust the offsets, so a bad file must not get that far
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        if (meshlet.vertexCount > MAX_VERTICES || meshlet.triangleCount > MAX_TRIANGLES ||
+            (size_t)meshlet.vertexOffset + meshlet.vertexCount > meshletVertexCount ||
+            (size_t)meshlet.triangleOffset + meshlet.triangleCount > triangleCount) {
+            throw std::runtime_error(std::string("ERROR: ") + path + " has a meshlet out of range");
+        }
+    }
+    for (const Lod& lod : mesh.lods) {
+        if ((size_t)lod.meshletOffset + lod.meshletCount > meshletCount) {
+            throw std::runtime_error(std::string("ERROR: ") + path + " has a level of detail out of range");
+        }
+    }
+    for (uint32_t index : mesh.meshletVertices) {
+        if (index >= vertexCount) {
+            throw std::runtime_error(std::string("ERROR: ") + path + " has a vertex out of range");
+        }
+    }
+
+    return mesh;
+}
+
+// ***** Public methods *****
+
+void MeshletMesh::quantize() {
+    computeQuantization(quantization);
+    float error = getQuantizationError();
+
+    quantizedVertices.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        QuantizedVertex& quantized = quantizedVertices[i];
+        for (int axis = 0; axis < 3; axis++) {
+            float steps = (vertices[i].position[axis] - quantization[axis]) / quantization[3];
+            quantized.position[axis] = (uint16_t)std::lround(std::clamp(steps, 0.f, QUANTIZATION_STEPS));
+        }
+        encodeOctahedral(vertices[i].normal, quantized.normal);
+        quantized.padding = 0;
+    }
+    vertices.clear();
+    vertexFormat = VERTEX_FORMAT_QUANTIZED;
+
+    // Rounding moves each position at most this far, so the spheres still
+    // hold the triangles. The cones are left, since the error is far below
+    // a triangle's size
+    for (Meshlet& meshlet : meshlets) {
+        meshlet.radius += error;
+    }
+    radius += error;
+}
+
+float MeshletMesh::getQuantizationError() const {
+    float current[4];
+    if (vertexFormat == VERTEX_FORMAT_QUANTIZED) {
+        std::copy(quantization, quantization + 4, current);
+    } else {
+        computeQuantization(current);
+    }
+    // Half a step on each axis
+    return std::sqrt(3.f) / 2.f * current[3];
+}
+
+size_t MeshletMesh::getVertexCount() const {
+    return vertexFormat == VERTEX_FORMAT_QUANTIZED ? quantizedVertices.size() : vertices.size();
+}
+
+size_t MeshletMesh::getVertexDataSize() const {
+    return vertexFormat == VERTEX_FORMAT_QUANTIZED ? quantizedVertices.size() * sizeof(QuantizedVertex)
+                                                   : vertices.size() * sizeof(Vertex);
+}
+
+const void* MeshletMesh::getVertexData() const {
+    if (vertexFormat == VERTEX_FORMAT_QUANTIZED) {
+        return quantizedVertices.data();
+    }
+    return vertices.data();
+}
+
+void MeshletMesh::addLod(const std::vector<uint32_t>& indices, float error) {
+    if (lods.size() >= MAX_LODS) {
+        throw std::runtime_error("ERROR: Too many levels of detail");
+    }
+
+    // The padding of the last level's triangles is dropped, and added back
+    // after this level's
+    uint32_t triangleCount = meshlets.empty() ? 0 : meshlets.back().triangleOffset + meshlets.back().triangleCount;
+    meshletTriangles.resize((size_t)triangleCount * 3);
+
+    Lod lod{};
+    lod.meshletOffset = (uint32_t)meshlets.size();
+    lod.error = lods.empty() ? error : std::max(error, lods.back().error);
+    lod.triangleCount = (uint32_t)(indices.size() / 3);
+
+    // The local index of each vertex in the meshlet being built, or 0xff if
+    // it isn't in it yet
+    std::vector<uint8_t> localIndices(vertices.size(), 0xff);
+    Meshlet meshlet{};
+    meshlet.vertexOffset = (uint32_t)meshletVertices.size();
+    meshlet.triangleOffset = triangleCount;
+
+    auto finish = [&]() {
+        if (meshlet.triangleCount == 0) {
+            return;
+        }
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+            localIndices[meshletVertices[meshlet.vertexOffset + i]] = 0xff;
+        }
+        computeBounds(&meshlet);
+        meshlets.push_back(meshlet);
+
+        meshlet = Meshlet{};
+        meshlet.vertexOffset = (uint32_t)meshletVertices.size();
+        meshlet.triangleOffset = (uint32_t)(meshletTriangles.size() / 3);
+    };
+
+    for (size_t triangle = 0; triangle + 2 < indices.size(); triangle += 3) {
+        const uint32_t* corners = &indices[triangle];
+        uint32_t newVertices = 0;
+        for (int i = 0; i < 3; i++) {
+            if (corners[i] >= vertices.size()) {
+                throw std::runtime_error("ERROR: Triangle index out of range");
+            }
+            // A repeated index in a degenerate triangle is only new once
+            bool repeated = (i > 0 && corners[i] == corners[0]) || (i > 1 && corners[i] == corners[1]);
+            if (localIndices[corners[i]] == 0xff && !repeated) {
+                newVertices++;
+            }
+        }
+
+        if (meshlet.vertexCount + newVertices > MAX_VERTICES || meshlet.triangleCount + 1 > MAX_TRIANGLES) {
+            finish();
+        }
+
+        for (int i = 0; i < 3; i++) {
+            uint8_t& local = localIndices[corners[i]];
+            if (local == 0xff) {
+                local = (uint8_t)meshlet.vertexCount++;
+                meshletVertices.push_back(corners[i]);
+            }
+            meshletTriangles.push_back(local);
+        }
+        meshlet.triangleCount++;
+    }
+    finish();
+
+    lod.meshletCount = (uint32_t)meshlets.size() - lod.meshletOffset;
+    lods.push_back(lod);
+
+    // The triangles are read as 32 bit words
+    while (meshletTriangles.size() % 4 != 0) {
+        meshletTriangles.push_back(0);
+    }
+}
+
+void MeshletMesh::write(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to create ") + path);
+    }
+
+    uint32_t triangleCount = 0;
+    for (const Meshlet& meshlet : meshlets) {
+        triangleCount = std::max(triangleCount, meshlet.triangleOffset + meshlet.triangleCount);
+    }
+
+    writeU32(out, MAGIC);
+    writeU32(out, VERSION);
+    writeU32(out, (uint32_t)getVertexCount());
+    writeU32(out, (uint32_t)meshlets.size());
+    writeU32(out, (uint32_t)meshletVertices.size());
+    writeU32(out, triangleCount);
+    writeU32(out, (uint32_t)lods.size());
+    out.write(reinterpret_cast<const char*>(center), sizeof(center));
+    out.write(reinterpret_cast<const char*>(&radius), sizeof(radius));
+    writeU32(out, vertexFormat);
+    out.write(reinterpret_cast<const char*>(quantization), sizeof(quantization));
+    if (vertexFormat == VERTEX_FORMAT_QUANTIZED) {
+        writeArray(out, quantizedVertices);
+    } else {
+        writeArray(out, vertices);
+    }
+    writeArray(out, meshlets);
+    writeArray(out, lods);
+    writeArray(out, meshletVertices);
+    writeArray(out, meshletTriangles);
+
+    out.close();
+    if (!out) {
+        throw std::runtime_error(std::string("ERROR: Failed to write ") + path);
+    }
+}
+
+// ***** Private methods *****
+
+void MeshletMesh::computeQuantization(float* result) const {
+    // A cube rather than the box, so a step is the same length on every axis
+    // and the shaders scale by one number
+    float minimum[3] = { INFINITY, INFINITY, INFINITY };
+    float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (const Vertex& vertex : vertices) {
+        for (int axis = 0; axis < 3; axis++) {
+            minimum[axis] = std::min(minimum[axis], vertex.position[axis]);
+            maximum[axis] = std::max(maximum[axis], vertex.position[axis]);
+        }
+    }
+    float size = 0.f;
+    for (int axis = 0; axis < 3; axis++) {
+        result[axis] = vertices.empty() ? 0.f : minimum[axis];
+        size = std::max(size, vertices.empty() ? 0.f : maximum[axis] - minimum[axis]);
+    }
+    result[3] = size > 0.f ? size / QUANTIZATION_STEPS : 1.f;
+}
+
+void MeshletMesh::computeBounds(Meshlet* meshlet) const {
+    // The sphere is around the center of the meshlet's box, which is close
+    // enough to the smallest sphere for culling
+    float minimum[3] = { INFINITY, INFINITY, INFINITY };
+    float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (uint32_t i = 0; i < meshlet->vertexCount; i++) {
+        const Vertex& vertex = vertices[meshletVertices[meshlet->vertexOffset + i]];
+        for (int axis = 0; axis < 3; axis++) {
+            minimum[axis] = std::min(minimum[axis], vertex.position[axis]);
+            maximum[axis] = std::max(maximum[axis], vertex.position[axis]);
+        }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        meshlet->center[axis] = (minimum[axis] + maximum[axis]) / 2.f;
+    }
+    meshlet->radius = 0.f;
+    for (uint32_t i = 0; i < meshlet->vertexCount; i++) {
+        const Vertex& vertex = vertices[meshletVertices[meshlet->vertexOffset + i]];
+        float distance = std::hypot(vertex.position[0] - meshlet->center[0], vertex.position[1] - meshlet->center[1],
+                                    vertex.position[2] - meshlet->center[2]);
+        meshlet->radius = std::max(meshlet->radius, distance);
+    }
+
+    // The face normals of the triangles, which the cone must contain
+    std::vector<std::array<float, 3> > normals;
+    float axis[3] = { 0.f, 0.f, 0.f };
+    for (uint32_t triangle = 0; triangle < meshlet->triangleCount; triangle++) {
+        const uint8_t* corners = &meshletTriangles[(size_t)(meshlet->triangleOffset + triangle) * 3];
+        const float* a = vertices[meshletVertices[meshlet->vertexOffset + corners[0]]].position;
+        const float* b = vertices[meshletVertices[meshlet->vertexOffset + corners[1]]].position;
+        const float* c = vertices[meshletVertices[meshlet->vertexOffset + corners[2]]].position;
+        float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        std::array<float, 3> normal = {
+            ab[1] * ac[2] - ab[2] * ac[1],
+            ab[2] * ac[0] - ab[0] * ac[2],
+            ab[0] * ac[1] - ab[1] * ac[0],
+        };
+        float length = std::hypot(normal[0], normal[1], normal[2]);
+        // Degenerate triangles are never drawn, so they don't widen the cone
+        if (length == 0.f) {
+            continue;
+        }
+        for (int i = 0; i < 3; i++) {
+            normal[i] /= length;
+            axis[i] += normal[i];
+        }
+        normals.push_back(normal);
+    }
+
+    meshlet->coneAxis[0] = 0.f;
+    meshlet->coneAxis[1] = 0.f;
+    meshlet->coneAxis[2] = 0.f;
+    meshlet->coneCutoff = 1.f;
+    float axisLength = std::hypot(axis[0], axis[1], axis[2]);
+    if (normals.empty() || axisLength == 0.f) {
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        axis[i] /= axisLength;
+    }
+
+    float minimumDot = 1.f;
+    for (const auto& normal : normals) {
+        minimumDot = std::min(minimumDot, normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2]);
+    }
+    if (minimumDot <= MIN_CONE_SPREAD) {
+        return;
+    }
+
+    // Every triangle faces away once the direction from the camera is within
+    // 90 degrees less the cone's half angle of the axis, whose cosine is the
+    // sine of the half angle
+    for (int i = 0; i < 3; i++) {
+        meshlet->coneAxis[i] = axis[i];
+    }
+    meshlet->coneCutoff = std::sqrt(1.f - minimumDot * minimumDot);
+}
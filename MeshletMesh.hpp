@@ -0,0 +1,213 @@
+// October 18, 2026
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * A triangle mesh split into meshlets, small clusters of triangles that are
+ * culled and drawn together. Each meshlet has at most MAX_VERTICES vertices
+ * and MAX_TRIANGLES triangles, and its triangles index into its own list of
+ * vertices with 8 bit local indices, so a mesh shader can transform each of
+ * its vertices once.
+ *
+ * Each meshlet has a bounding sphere, for frustum culling, and a cone around
+ * the normals of its triangles, for culling meshlets that face away from the
+ * camera. A meshlet is back facing if
+ *     dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius
+ * and a cutoff of 1 never culls.
+ *
+ * A mesh has up to MAX_LODS levels of detail, from the full mesh down. Each
+ * level is its own run of meshlets, and every level indexes into the same
+ * vertices, so they share one vertex buffer.
+ *
+ * Meshes are split offline by the meshlet_pack tool, since building meshlets
+ * (and simplifying the levels of detail) is too slow for load time.
+ *
+ * The vertices are either full floats or quantized, picked for each mesh
+ * when it is packed. A QuantizedVertex is half the size of a Vertex: its
+ * position is 16 bits on each axis of a cube around the mesh, and its normal
+ * is octahedral encoded in two 16 bit snorms. The shaders decode it with the
+ * mesh's quantization, position = offset + stored * scale.
+ *
+ * File layout (all integers little endian):
+ *     Header          "MSHL", version, vertex, meshlet, meshlet vertex,
+ *                     triangle and level of detail counts, then the bounding
+ *                     sphere of the mesh, the vertex format and the
+ *                     quantization
+ *     Vertices        A Vertex or QuantizedVertex for each vertex
+ *     Meshlets        A Meshlet for each meshlet
+ *     Levels          A Lod for each level of detail, finest first
+ *     Vertex lists    A uint32_t vertex index for each meshlet vertex
+ *     Triangles       3 uint8_t local indices for each triangle, padded to a
+ *                     multiple of 4 bytes
+ */
+class MeshletMesh {
+public:
+    /** The most vertices in a meshlet. Small enough that a mesh shader
+     *  workgroup writes them in a couple of passes */
+    inline static const uint32_t MAX_VERTICES = 64;
+    /** The most triangles in a meshlet. 124 rather than 128 leaves room for
+     *  the primitive count in 128 bytes on some hardware */
+    inline static const uint32_t MAX_TRIANGLES = 124;
+    /** The most levels of detail in a mesh */
+    inline static const uint32_t MAX_LODS = 8;
+
+    /** How the vertices are stored */
+    enum VertexFormat : uint32_t {
+        VERTEX_FORMAT_FLOAT = 0,
+        VERTEX_FORMAT_QUANTIZED = 1,
+    };
+
+    /** A vertex, as read by the shaders */
+    struct Vertex {
+        float position[3];
+        float normal[3];
+    };
+
+    /** A quantized vertex, as read by the shaders */
+    struct QuantizedVertex {
+        /** Steps of the quantization's scale from its offset */
+        uint16_t position[3];
+        /** The octahedral encoding of the normal */
+        int16_t normal[2];
+        /** Keeps the vertices 4 byte aligned */
+        uint16_t padding;
+    };
+
+    /** A meshlet, as read by the shaders */
+    struct Meshlet {
+        /** The first of its entries in the vertex lists */
+        uint32_t vertexOffset;
+        /** The first of its triangles, counted in triangles */
+        uint32_t triangleOffset;
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+        /** The bounding sphere */
+        float center[3];
+        float radius;
+        /** The normal cone */
+        float coneAxis[3];
+        float coneCutoff;
+    };
+
+    /** A level of detail, as read by the shaders */
+    struct Lod {
+        /** Its run of meshlets */
+        uint32_t meshletOffset;
+        uint32_t meshletCount;
+        /** How far its surface may be from the full mesh's, in the units of
+         *  the positions. 0 for the full mesh */
+        float error;
+        uint32_t triangleCount;
+    };
+
+    VertexFormat vertexFormat = VERTEX_FORMAT_FLOAT;
+    /** The vertices, if they are full floats */
+    std::vector<Vertex> vertices;
+    /** The vertices, if they are quantized */
+    std::vector<QuantizedVertex> quantizedVertices;
+    /** The corner of the cube the positions are quantized in, and the size
+     *  of a step, in xyz and w */
+    float quantization[4] = { 0.f, 0.f, 0.f, 1.f };
+    std::vector<Meshlet> meshlets;
+    /** The levels of detail, finest first, with increasing errors */
+    std::vector<Lod> lods;
+    /** The vertices of each meshlet, as indices into vertices */
+    std::vector<uint32_t> meshletVertices;
+    /** The triangles of each meshlet, as 3 indices into its vertex list */
+    std::vector<uint8_t> meshletTriangles;
+    /** The bounding sphere of the whole mesh */
+    float center[3] = { 0.f, 0.f, 0.f };
+    float radius = 0.f;
+
+    /**
+     * Splits a triangle mesh into meshlets, as its first level of detail.
+     * Triangles are added in order, so meshlets are only as compact as the
+     * triangle order is local
+     *
+     * @param vertices The vertices of the mesh
+     * @param indices 3 vertex indices for each triangle
+     *
+     * @return The mesh split into meshlets
+     */
+    static MeshletMesh build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+    /**
+     * Splits a simplified version of the mesh into meshlets, as its next
+     * level of detail
+     *
+     * Requires: There are fewer than MAX_LODS levels
+     *
+     * @param indices 3 indices into the vertices for each triangle
+     * @param error How far the simplified surface may be from the full mesh's.
+     *              At least the error of the last level
+     */
+    void addLod(const std::vector<uint32_t>& indices, float error);
+
+    /**
+     * Quantizes the vertices, and widens the bounding spheres by the error
+     * that adds to the positions
+     *
+     * Requires: The vertices are full floats, and every level of detail has
+     *           been added
+     */
+    void quantize();
+
+    /**
+     * @return The largest error quantize() would add to a position
+     */
+    float getQuantizationError() const;
+
+    /**
+     * @return The number of vertices, in whichever format
+     */
+    size_t getVertexCount() const;
+
+    /**
+     * @return The size of the vertices, in whichever format
+     */
+    size_t getVertexDataSize() const;
+
+    /**
+     * @return The vertices, in whichever format
+     */
+    const void* getVertexData() const;
+
+    /**
+     * Reads a mesh written by write()
+     *
+     * @throw std::runtime_error if the file is missing or isn't a meshlet
+     *        file
+     */
+    static MeshletMesh read(const std::string& path);
+
+    /**
+     * Writes the mesh to a file
+     *
+     * @throw std::runtime_error if the file couldn't be written
+     */
+    void write(const std::string& path) const;
+
+private:
+    /** The first bytes of a meshlet file */
+    inline static const uint32_t MAGIC = 0x4c48534d; // "MSHL"
+    /** Increased whenever the format changes */
+    inline static const uint32_t VERSION = 3;
+    /** The steps of a quantized position on each axis */
+    inline static const float QUANTIZATION_STEPS = 65535.f;
+
+    /**
+     * Finds the cube the full float positions are quantized in
+     *
+     * @param result Set to the corner of the cube and the size of a step
+     */
+    void computeQuantization(float* result) const;
+
+    /**
+     * Computes the bounding sphere and normal cone of a finished meshlet
+     */
+    void computeBounds(Meshlet* meshlet) const;
+};
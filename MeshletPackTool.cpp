@@ -0,0 +1,264 @@
+// October 18, 2026
+
+// The offline step that splits a mesh into meshlets. The mesh is read from a
+// Wavefront OBJ file, of which only the positions, normals and faces are
+// used. Polygons are split into fans of triangles, and a mesh without normals
+// gets smooth normals averaged from its faces.
+//
+// Before the mesh is split, its triangles are reordered for the vertex cache
+// and its vertices for fetching, and with --overdraw its triangles facing
+// out are moved first. The vertex cache's ACMR and ATVR are printed before
+// and after for each level of detail.
+//
+// Each level of detail after the first is the last one simplified to about
+// half its triangles, until simplifying stops paying for another level, and
+// is then reordered for the vertex cache too.
+//
+// The vertices are quantized to half their size, unless --float is given or
+// the mesh is so large next to its triangles that quantizing would visibly
+// move them.
+//
+// Usage: meshlet_pack [--float] [--overdraw] <input.obj> <output.meshlets>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+#include "MeshletMesh.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+
+// Each level of detail aims for this fraction of the last one's triangles
+static const double LOD_REDUCTION = 0.5;
+// A level that doesn't remove at least this fraction of the last one's
+// triangles isn't worth its memory, and ends the levels
+static const double MIN_LOD_REDUCTION = 0.1;
+// Meshes are never simplified below this many triangles, about a meshlet
+static const size_t MIN_LOD_TRIANGLES = 64;
+// Vertices are only quantized if that moves them at most this fraction of
+// the average edge's length
+static const float MAX_QUANTIZATION_ERROR = 0.01f;
+// How much worse the vertex cache may get to order triangles for overdraw
+static const float OVERDRAW_THRESHOLD = 1.05f;
+
+// Resolves an OBJ index, which counts from 1, or back from the end if negative
+static uint32_t resolveIndex(long index, size_t count, uint32_t lineNumber) {
+    long resolved = index > 0 ? index - 1 : (long)count + index;
+    if (index == 0 || resolved < 0 || resolved >= (long)count) {
+        throw std::runtime_error("ERROR: Index out of range on line " + std::to_string(lineNumber));
+    }
+    return (uint32_t)resolved;
+}
+
+int main(int argc, char** argv) {
+    bool keepFloats = false;
+    bool optimizeOverdraw = false;
+    int argument = 1;
+    for (; argument < argc - 2; argument++) {
+        std::string option = argv[argument];
+        if (option == "--float") {
+            keepFloats = true;
+        } else if (option == "--overdraw") {
+            optimizeOverdraw = true;
+        } else {
+            break;
+        }
+    }
+    if (argc < 3 || argument != argc - 2) {
+        std::cerr << "Usage: " << argv[0] << " [--float] [--overdraw] <input.obj> <output.meshlets>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string inputPath = argv[argc - 2];
+    std::string outputPath = argv[argc - 1];
+
+    try {
+        std::ifstream in(inputPath);
+        if (!in.is_open()) {
+            throw std::runtime_error(std::string("ERROR: Failed to open ") + inputPath);
+        }
+
+        std::vector<std::array<float, 3> > positions;
+        std::vector<std::array<float, 3> > normals;
+        std::vector<MeshletMesh::Vertex> vertices;
+        std::vector<uint32_t> indices;
+        // Each distinct pair of position and normal is one vertex
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> vertexIds;
+        bool hasNormals = true;
+
+        std::string line;
+        uint32_t lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            std::istringstream words(line);
+            std::string type;
+            words >> type;
+
+            if (type == "v") {
+                std::array<float, 3> position;
+                words >> position[0] >> position[1] >> position[2];
+                positions.push_back(position);
+            } else if (type == "vn") {
+                std::array<float, 3> normal;
+                words >> normal[0] >> normal[1] >> normal[2];
+                normals.push_back(normal);
+            } else if (type == "f") {
+                // Corners are v, v/vt, v//vn or v/vt/vn
+                std::vector<uint32_t> face;
+                std::string corner;
+                while (words >> corner) {
+                    size_t firstSlash = corner.find('/');
+                    uint32_t position = resolveIndex(std::stol(corner.substr(0, firstSlash)), positions.size(), lineNumber);
+                    uint32_t normal = ~0u;
+                    size_t lastSlash = corner.rfind('/');
+                    if (firstSlash != std::string::npos && lastSlash != firstSlash && lastSlash + 1 < corner.size()) {
+                        normal = resolveIndex(std::stol(corner.substr(lastSlash + 1)), normals.size(), lineNumber);
+                    } else {
+                        hasNormals = false;
+                    }
+
+                    auto inserted = vertexIds.emplace(std::make_pair(position, normal), (uint32_t)vertices.size());
+                    if (inserted.second) {
+                        MeshletMesh::Vertex vertex{};
+                        for (int axis = 0; axis < 3; axis++) {
+                            vertex.position[axis] = positions[position][axis];
+                            vertex.normal[axis] = normal != ~0u ? normals[normal][axis] : 0.f;
+                        }
+                        vertices.push_back(vertex);
+                    }
+                    face.push_back(inserted.first->second);
+                }
+                if (face.size() < 3) {
+                    throw std::runtime_error("ERROR: Face with fewer than 3 corners on line " + std::to_string(lineNumber));
+                }
+                for (size_t i = 1; i + 1 < face.size(); i++) {
+                    indices.push_back(face[0]);
+                    indices.push_back(face[i]);
+                    indices.push_back(face[i + 1]);
+                }
+            }
+        }
+        if (indices.empty()) {
+            throw std::runtime_error(std::string("ERROR: ") + inputPath + " has no faces");
+        }
+
+        // Smooth normals, weighted by the area of each face since the cross
+        // product's length is twice the area
+        if (!hasNormals) {
+            for (MeshletMesh::Vertex& vertex : vertices) {
+                vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.f;
+            }
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                const float* a = vertices[indices[i]].position;
+                const float* b = vertices[indices[i + 1]].position;
+                const float* c = vertices[indices[i + 2]].position;
+                float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                float normal[3] = {
+                    ab[1] * ac[2] - ab[2] * ac[1],
+                    ab[2] * ac[0] - ab[0] * ac[2],
+                    ab[0] * ac[1] - ab[1] * ac[0],
+                };
+                for (int corner = 0; corner < 3; corner++) {
+                    for (int axis = 0; axis < 3; axis++) {
+                        vertices[indices[i + corner]].normal[axis] += normal[axis];
+                    }
+                }
+            }
+            for (MeshletMesh::Vertex& vertex : vertices) {
+                float length = std::hypot(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+                for (int axis = 0; axis < 3 && length > 0.f; axis++) {
+                    vertex.normal[axis] /= length;
+                }
+            }
+        }
+
+        // Reordering the triangles and then renumbering the vertices keeps
+        // both in the order they are drawn. A level that already comes in a
+        // better order, such as one the simplifier left in order, keeps it
+        std::vector<MeshOptimizer::CacheStats> statsBefore;
+        std::vector<MeshOptimizer::CacheStats> statsAfter;
+        std::vector<bool> keptOrder;
+        auto optimize = [&](std::vector<uint32_t>* levelIndices) {
+            MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(*levelIndices, vertices.size());
+            std::vector<uint32_t> optimized = *levelIndices;
+            std::vector<uint32_t> clusters = MeshOptimizer::optimizeVertexCache(&optimized, vertices.size());
+            if (optimizeOverdraw) {
+                MeshOptimizer::optimizeOverdraw(&optimized, vertices, clusters, OVERDRAW_THRESHOLD);
+            }
+            MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(optimized, vertices.size());
+
+            bool keep = after.acmr >= before.acmr;
+            if (!keep) {
+                levelIndices->swap(optimized);
+            }
+            statsBefore.push_back(before);
+            statsAfter.push_back(keep ? before : after);
+            keptOrder.push_back(keep);
+        };
+        optimize(&indices);
+        MeshOptimizer::optimizeVertexFetch(&vertices, &indices);
+
+        MeshletMesh mesh = MeshletMesh::build(vertices, indices);
+
+        MeshSimplifier simplifier(vertices, indices);
+        size_t triangleCount = indices.size() / 3;
+        while (mesh.lods.size() < MeshletMesh::MAX_LODS && triangleCount > MIN_LOD_TRIANGLES) {
+            size_t target = std::max((size_t)(triangleCount * LOD_REDUCTION), MIN_LOD_TRIANGLES);
+            std::vector<uint32_t> simplified = simplifier.simplify(target);
+            size_t simplifiedCount = simplified.size() / 3;
+            if (simplifiedCount > triangleCount * (1.0 - MIN_LOD_REDUCTION)) {
+                break;
+            }
+            optimize(&simplified);
+            mesh.addLod(simplified, simplifier.getError());
+            triangleCount = simplifiedCount;
+        }
+
+        // Quantized last, since the levels of detail are simplified from the
+        // full positions
+        double edgeLength = 0.0;
+        for (size_t i = 0; i < indices.size(); i++) {
+            const float* a = vertices[indices[i]].position;
+            const float* b = vertices[indices[i % 3 == 2 ? i - 2 : i + 1]].position;
+            edgeLength += std::hypot(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+        }
+        edgeLength /= (double)indices.size();
+        float quantizationError = mesh.getQuantizationError();
+        if (keepFloats) {
+            std::cout << "Keeping full float vertices" << std::endl;
+        } else if (quantizationError > MAX_QUANTIZATION_ERROR * edgeLength) {
+            std::cout << "Keeping full float vertices, since quantizing would move them by up to "
+                      << quantizationError << ", against edges of " << edgeLength << " on average" << std::endl;
+        } else {
+            mesh.quantize();
+            std::cout << "Quantized the vertices, moving them by up to " << quantizationError << std::endl;
+        }
+        mesh.write(outputPath);
+
+        std::cout << "Wrote " << mesh.meshlets.size() << " meshlets of " << vertices.size() << " vertices and "
+                  << indices.size() / 3 << " triangles to " << outputPath << " ("
+                  << (double)mesh.meshletVertices.size() / vertices.size() << " meshlet vertices per vertex, "
+                  << mesh.getVertexDataSize() << " bytes of vertices)" << std::endl;
+        for (size_t i = 0; i < mesh.lods.size(); i++) {
+            const MeshletMesh::Lod& lod = mesh.lods[i];
+            std::cout << "    Level " << i << ": " << lod.triangleCount << " triangles in " << lod.meshletCount
+                      << " meshlets, error " << lod.error << ", ACMR " << statsBefore[i].acmr << " -> "
+                      << statsAfter[i].acmr << ", ATVR " << statsBefore[i].atvr << " -> " << statsAfter[i].atvr
+                      << (keptOrder[i] ? " (kept the incoming order, which was better)" : "") << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
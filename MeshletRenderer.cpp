@@ -0,0 +1,372 @@
+// October 18, 2026
+
+#include "MeshletRenderer.hpp"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Camera.hpp"
+
+// ***** Public methods *****
+
+void MeshletRenderer::initialize(vk::Device device, vk::Queue queue, uint32_t queueFamilyIndex,
+                                 const DeviceFeatures& features, MemoryAllocator* allocator,
+                                 CompletionService* completionService, PipelineLibrary* pipelineLibrary,
+                                 LayoutCache* layoutCache, const std::string& path, float pathLength) {
+    this->device = device;
+    this->allocator = allocator;
+    this->completionService = completionService;
+
+    MeshletMesh mesh = MeshletMesh::read(path);
+    if (mesh.meshlets.empty()) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " has no meshlets");
+    }
+    lodCount = (uint32_t)mesh.lods.size();
+    maxLodMeshletCount = 0;
+    for (const MeshletMesh::Lod& lod : mesh.lods) {
+        maxLodMeshletCount = std::max(maxLodMeshletCount, lod.meshletCount);
+    }
+    vertexCount = (uint32_t)mesh.getVertexCount();
+    memcpy(bounds, mesh.center, sizeof(mesh.center));
+    bounds[3] = mesh.radius;
+    quantized = mesh.vertexFormat == MeshletMesh::VERTEX_FORMAT_QUANTIZED;
+    memcpy(quantization, mesh.quantization, sizeof(quantization));
+
+    useMeshShader = false;
+#ifdef VK_EXT_mesh_shader
+    if (features.meshShader) {
+        cmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT) device.getProcAddr("vkCmdDrawMeshTasksEXT");
+        if (cmdDrawMeshTasks == nullptr) {
+            throw std::runtime_error("ERROR: Could not load mesh shader functions.");
+        }
+        useMeshShader = true;
+    }
+#endif
+
+    // The fallback dispatches a workgroup for each meshlet of each copy, and
+    // packs the copy and its level into its indices
+    instanceCount = INSTANCE_COUNT;
+    if (!useMeshShader) {
+        if (maxLodMeshletCount > MAX_GROUP_COUNT) {
+            throw std::runtime_error(std::string("ERROR: ") + path + " has too many meshlets to cull");
+        }
+        instanceCount = std::min(instanceCount, MAX_INDEX_VALUE / (2 * vertexCount));
+        if (instanceCount == 0) {
+            throw std::runtime_error(std::string("ERROR: ") + path + " has too many vertices to draw");
+        }
+    }
+
+    // The copies are spaced down the street, each scaled to the same size and
+    // centered on its place
+    float scale = mesh.radius > 0.f ? INSTANCE_RADIUS / mesh.radius : 1.f;
+    std::vector<float> instances;
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        float place[3] = { ((float)i + 0.5f) / (float)instanceCount * pathLength - pathLength / 2.f,
+                           INSTANCE_HEIGHT, 0.f };
+        for (int axis = 0; axis < 3; axis++) {
+            instances.push_back(place[axis] - mesh.center[axis] * scale);
+        }
+        instances.push_back(scale);
+    }
+
+    vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eTransferDst;
+    std::vector<vk::DeviceSize> sizes = {
+        mesh.meshlets.size() * sizeof(MeshletMesh::Meshlet),
+        instances.size() * sizeof(float),
+        mesh.getVertexDataSize(),
+        mesh.meshletVertices.size() * sizeof(uint32_t),
+        mesh.meshletTriangles.size() * sizeof(uint8_t),
+        mesh.lods.size() * sizeof(MeshletMesh::Lod),
+    };
+    meshletBuffer = createBuffer(sizes[0], usage, &meshletAllocation);
+    instanceBuffer = createBuffer(sizes[1], usage, &instanceAllocation);
+    vertexBuffer = createBuffer(sizes[2], usage, &vertexAllocation);
+    meshletVertexBuffer = createBuffer(sizes[3], usage, &meshletVertexAllocation);
+    meshletTriangleBuffer = createBuffer(sizes[4], usage, &meshletTriangleAllocation);
+    lodBuffer = createBuffer(sizes[5], usage, &lodAllocation);
+    upload(queue, queueFamilyIndex,
+           { meshletBuffer, instanceBuffer, vertexBuffer, meshletVertexBuffer, meshletTriangleBuffer, lodBuffer },
+           { mesh.meshlets.data(), instances.data(), mesh.getVertexData(), mesh.meshletVertices.data(),
+             mesh.meshletTriangles.data(), mesh.lods.data() },
+           sizes);
+
+    if (!useMeshShader) {
+        updatePipelines(pipelineLibrary);
+
+        // Room for every triangle of every copy, in case nothing is culled.
+        // A copy draws at most two neighboring levels
+        vk::DeviceSize indexCount = 0;
+        for (size_t i = 0; i < mesh.lods.size(); i++) {
+            vk::DeviceSize triangleCount = mesh.lods[i].triangleCount;
+            if (i + 1 < mesh.lods.size()) {
+                triangleCount += mesh.lods[i + 1].triangleCount;
+            }
+            indexCount = std::max(indexCount, triangleCount * 3);
+        }
+        drawBuffer = createBuffer(sizeof(vk::DrawIndexedIndirectCommand),
+                                  vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                  &drawAllocation);
+        indexBuffer = createBuffer(indexCount * instanceCount * sizeof(uint32_t), vk::BufferUsageFlagBits::eIndexBuffer,
+                                   &indexAllocation);
+    }
+
+    createDescriptorSets(layoutCache);
+}
+
+void MeshletRenderer::destroy() {
+    device.destroyDescriptorPool(descriptorPool);
+
+    allocator->destroyBuffer(meshletBuffer, meshletAllocation);
+    allocator->destroyBuffer(instanceBuffer, instanceAllocation);
+    allocator->destroyBuffer(vertexBuffer, vertexAllocation);
+    allocator->destroyBuffer(meshletVertexBuffer, meshletVertexAllocation);
+    allocator->destroyBuffer(meshletTriangleBuffer, meshletTriangleAllocation);
+    allocator->destroyBuffer(lodBuffer, lodAllocation);
+    if (!useMeshShader) {
+        allocator->destroyBuffer(drawBuffer, drawAllocation);
+        allocator->destroyBuffer(indexBuffer, indexAllocation);
+    }
+}
+
+PipelineKey MeshletRenderer::getPipelineKey() const {
+    PipelineKey key;
+    // Only the shaders that read the vertices decode them
+    if (useMeshShader) {
+        key.taskShader = ShaderVariant{ TASK_SOURCE_PATH, TASK_PATH, {} };
+        key.meshShader = quantized
+            ? ShaderVariant{ MESH_SOURCE_PATH, MESH_QUANTIZED_PATH, { { "QUANTIZED_VERTICES", "1" } } }
+            : ShaderVariant{ MESH_SOURCE_PATH, MESH_PATH, {} };
+    } else {
+        key.vertexShader = quantized
+            ? ShaderVariant{ VERT_SOURCE_PATH, VERT_QUANTIZED_PATH, { { "QUANTIZED_VERTICES", "1" } } }
+            : ShaderVariant{ VERT_SOURCE_PATH, VERT_PATH, {} };
+    }
+    key.fragmentShader = ShaderVariant{ FRAG_SOURCE_PATH, FRAG_PATH, {} };
+    key.cullMode = vk::CullModeFlagBits::eBack;
+    // Meshes are counterclockwise, like the scene
+    key.frontFace = vk::FrontFace::eCounterClockwise;
+    key.depthTestEnable = true;
+    key.depthWriteEnable = true;
+    return key;
+}
+
+void MeshletRenderer::updatePipelines(PipelineLibrary* pipelineLibrary) {
+    if (useMeshShader) {
+        return;
+    }
+    cullPipeline = pipelineLibrary->getComputePipeline(ShaderVariant{ CULL_SOURCE_PATH, CULL_PATH, {} }, &cullLayout);
+}
+
+void MeshletRenderer::cull(vk::CommandBuffer commandBuffer, const float* viewProjection, const float* cameraPosition,
+                           uint32_t viewportHeight) {
+    memcpy(pushConstants.viewProjection, viewProjection, sizeof(pushConstants.viewProjection));
+    memcpy(pushConstants.bounds, bounds, sizeof(pushConstants.bounds));
+    memcpy(pushConstants.cameraPosition, cameraPosition, sizeof(pushConstants.cameraPosition));
+    pushConstants.lodCount = lodCount;
+    pushConstants.vertexCount = vertexCount;
+    pushConstants.lodScale = (float)viewportHeight / (2.f * std::tan(Camera::FIELD_OF_VIEW / 2.f));
+    memcpy(pushConstants.quantization, quantization, sizeof(pushConstants.quantization));
+
+    // The task shader culls as it draws
+    if (useMeshShader) {
+        return;
+    }
+
+    // The last frame's draw and culling are done with the buffers
+    vk::MemoryBarrier reuseBarrier(vk::AccessFlagBits::eShaderWrite,
+                                   vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput |
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, reuseBarrier, nullptr, nullptr);
+
+    // The culling pass appends to the index count
+    vk::DrawIndexedIndirectCommand drawCommand(0, 1, 0, 0, 0);
+    commandBuffer.updateBuffer(drawBuffer, 0, sizeof(drawCommand), &drawCommand);
+
+    vk::MemoryBarrier resetBarrier(vk::AccessFlagBits::eTransferWrite,
+                                   vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, resetBarrier, nullptr, nullptr);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullLayout, 0, cullSet, nullptr);
+    commandBuffer.pushConstants(cullLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(pushConstants),
+                                &pushConstants);
+    // Each copy has a row for its level and one for the level it fades to
+    commandBuffer.dispatch(maxLodMeshletCount, instanceCount * 2, 1);
+
+    vk::MemoryBarrier drawBarrier(vk::AccessFlagBits::eShaderWrite,
+                                  vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+                                  {}, drawBarrier, nullptr, nullptr);
+}
+
+void MeshletRenderer::draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout) {
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, drawSet, nullptr);
+
+#ifdef VK_EXT_mesh_shader
+    if (useMeshShader) {
+        commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT,
+                                    0, sizeof(pushConstants), &pushConstants);
+        // Each task workgroup culls TASK_GROUP_SIZE meshlets of one level of
+        // one copy
+        cmdDrawMeshTasks(static_cast<VkCommandBuffer>(commandBuffer),
+                         (maxLodMeshletCount + TASK_GROUP_SIZE - 1) / TASK_GROUP_SIZE, instanceCount * 2, 1);
+        return;
+    }
+#endif
+
+    commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(pushConstants), &pushConstants);
+    commandBuffer.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+    commandBuffer.drawIndexedIndirect(drawBuffer, 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+// ***** Private methods *****
+
+vk::Buffer MeshletRenderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation* allocation) {
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = size;
+    bufferInfo.usage = usage | vk::BufferUsageFlagBits::eStorageBuffer;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    return allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {}, allocation);
+}
+
+void MeshletRenderer::upload(vk::Queue queue, uint32_t queueFamilyIndex, const std::vector<vk::Buffer>& buffers,
+                             const std::vector<const void*>& data, const std::vector<vk::DeviceSize>& sizes) {
+    vk::DeviceSize totalSize = 0;
+    for (vk::DeviceSize size : sizes) {
+        totalSize += size;
+    }
+
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = totalSize;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    Allocation stagingAllocation;
+    vk::Buffer stagingBuffer = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible, {},
+                                                       &stagingAllocation);
+
+    vk::CommandPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    vk::CommandPool commandPool = device.createCommandPool(poolInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocateInfo.commandBufferCount = 1;
+    vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(allocateInfo)[0];
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+    vk::DeviceSize offset = 0;
+    for (size_t i = 0; i < buffers.size(); i++) {
+        memcpy(static_cast<char*>(stagingAllocation.mapped) + offset, data[i], sizes[i]);
+        commandBuffer.copyBuffer(stagingBuffer, buffers[i], vk::BufferCopy(offset, 0, sizes[i]));
+        offset += sizes[i];
+    }
+
+    // Every shader of later frames reads the buffers, whichever path draws
+    vk::PipelineStageFlags readStages = vk::PipelineStageFlagBits::eComputeShader |
+                                        vk::PipelineStageFlagBits::eVertexShader;
+#ifdef VK_EXT_mesh_shader
+    if (useMeshShader) {
+        readStages |= vk::PipelineStageFlagBits::eTaskShaderEXT | vk::PipelineStageFlagBits::eMeshShaderEXT;
+    }
+#endif
+    vk::MemoryBarrier uploadBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, readStages, {}, uploadBarrier, nullptr,
+                                  nullptr);
+    commandBuffer.end();
+    allocator->flush(stagingAllocation, 0, totalSize);
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    queue.submit(submitInfo, nullptr);
+
+    completionService->onQueueComplete(queue, [this, commandPool, stagingBuffer, stagingAllocation]() {
+        device.destroyCommandPool(commandPool);
+        allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+    });
+}
+
+void MeshletRenderer::createDescriptorSets(LayoutCache* layoutCache) {
+    // The same bindings the shaders' reflection gives. Every shader numbers
+    // the buffers alike, and each set only has the ones its shaders read
+    vk::Buffer buffers[] = {
+        meshletBuffer, instanceBuffer, vertexBuffer, meshletVertexBuffer, meshletTriangleBuffer,
+        drawBuffer, indexBuffer, lodBuffer,
+    };
+    auto makeBinding = [](uint32_t binding, vk::ShaderStageFlags stages) {
+        return vk::DescriptorSetLayoutBinding(binding, vk::DescriptorType::eStorageBuffer, 1, stages);
+    };
+
+    std::vector<vk::DescriptorSetLayoutBinding> drawBindings;
+    std::vector<vk::DescriptorSetLayoutBinding> cullBindings;
+#ifdef VK_EXT_mesh_shader
+    if (useMeshShader) {
+        vk::ShaderStageFlags taskAndMesh = vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT;
+        drawBindings = {
+            makeBinding(0, taskAndMesh),
+            makeBinding(1, taskAndMesh),
+            makeBinding(2, vk::ShaderStageFlagBits::eMeshEXT),
+            makeBinding(3, vk::ShaderStageFlagBits::eMeshEXT),
+            makeBinding(4, vk::ShaderStageFlagBits::eMeshEXT),
+            makeBinding(7, vk::ShaderStageFlagBits::eTaskEXT),
+        };
+    }
+#endif
+    if (!useMeshShader) {
+        drawBindings = {
+            makeBinding(1, vk::ShaderStageFlagBits::eVertex),
+            makeBinding(2, vk::ShaderStageFlagBits::eVertex),
+            makeBinding(7, vk::ShaderStageFlagBits::eVertex),
+        };
+        for (uint32_t binding : { 0, 1, 3, 4, 5, 6, 7 }) {
+            cullBindings.push_back(makeBinding(binding, vk::ShaderStageFlagBits::eCompute));
+        }
+    }
+
+    uint32_t setCount = cullBindings.empty() ? 1 : 2;
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer,
+                                    (uint32_t)(drawBindings.size() + cullBindings.size()));
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = setCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    descriptorPool = device.createDescriptorPool(poolInfo);
+
+    std::vector<vk::DescriptorSetLayout> setLayouts = { layoutCache->getDescriptorSetLayout(drawBindings) };
+    if (!cullBindings.empty()) {
+        setLayouts.push_back(layoutCache->getDescriptorSetLayout(cullBindings));
+    }
+    vk::DescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.descriptorPool = descriptorPool;
+    allocateInfo.descriptorSetCount = setCount;
+    allocateInfo.pSetLayouts = setLayouts.data();
+    std::vector<vk::DescriptorSet> sets = device.allocateDescriptorSets(allocateInfo);
+    drawSet = sets[0];
+    cullSet = setCount > 1 ? sets[1] : vk::DescriptorSet();
+
+    // The infos must outlive the update, so there is one for each buffer
+    std::vector<vk::DescriptorBufferInfo> infos;
+    for (vk::Buffer buffer : buffers) {
+        infos.push_back(vk::DescriptorBufferInfo(buffer, 0, VK_WHOLE_SIZE));
+    }
+    std::vector<vk::WriteDescriptorSet> writes;
+    for (const auto& binding : drawBindings) {
+        writes.push_back(vk::WriteDescriptorSet(drawSet, binding.binding, 0, 1, vk::DescriptorType::eStorageBuffer,
+                                                nullptr, &infos[binding.binding]));
+    }
+    for (const auto& binding : cullBindings) {
+        writes.push_back(vk::WriteDescriptorSet(cullSet, binding.binding, 0, 1, vk::DescriptorType::eStorageBuffer,
+                                                nullptr, &infos[binding.binding]));
+    }
+    device.updateDescriptorSets(writes, nullptr);
+}
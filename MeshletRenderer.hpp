@@ -0,0 +1,238 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+
+#include "MemoryAllocator.hpp"
+#include "CompletionService.hpp"
+#include "PipelineLibrary.hpp"
+#include "LayoutCache.hpp"
+#include "DeviceFeatures.hpp"
+#include "MeshletMesh.hpp"
+
+/**
+ * Draws copies of a mesh split into meshlets, culling each meshlet against
+ * the view frustum and by its normal cone before any of its vertices are
+ * transformed.
+ *
+ * With VK_EXT_mesh_shader, a task shader culls the meshlets and launches a
+ * mesh shader workgroup for each one left, so culled meshlets cost nothing
+ * past the test. Without it, a compute pass runs the same tests and writes
+ * the indices of the meshlets left into one buffer, drawn by a single
+ * vkCmdDrawIndexedIndirect. Both paths draw the same pixels.
+ *
+ * Each copy also picks its level of detail as it is culled, from how large
+ * the error of each level would be on screen. A copy near the switch to a
+ * coarser level draws both, each in a dithered share of its pixels, so the
+ * switch fades in rather than popping.
+ *
+ * A mesh packed with quantized vertices is drawn with permutations of the
+ * shaders that decode them, so it takes half the memory and vertex fetches.
+ */
+class MeshletRenderer {
+public:
+    /** The number of copies of the mesh, spaced down the street */
+    inline static const uint32_t INSTANCE_COUNT = 8;
+
+    /**
+     * Reads the mesh, uploads it, and gets the culling pipeline if the mesh
+     * shader path isn't used. The upload isn't waited for, but work submitted
+     * to the queue afterwards sees the mesh
+     *
+     * Requires: The queue is not being used by another thread
+     *
+     * @param device The logical device
+     * @param queue The queue to upload with
+     * @param queueFamilyIndex The family of the queue
+     * @param features The enabled device features, which decide the path
+     * @param allocator Allocates the memory of the buffers
+     * @param completionService Frees the staging once the upload is done
+     * @param pipelineLibrary Builds the culling pipeline
+     * @param layoutCache Gives the descriptor set layouts
+     * @param path The meshlet file, written by meshlet_pack
+     * @param pathLength The length of the street the copies are spaced along
+     *
+     * @throw std::runtime_error if the file can't be read, or the mesh is too
+     *        large to draw
+     */
+    void initialize(vk::Device device, vk::Queue queue, uint32_t queueFamilyIndex, const DeviceFeatures& features,
+                    MemoryAllocator* allocator, CompletionService* completionService,
+                    PipelineLibrary* pipelineLibrary, LayoutCache* layoutCache, const std::string& path,
+                    float pathLength);
+
+    /**
+     * Destroys the buffers and descriptor sets
+     *
+     * Requires: No frame drawing the mesh is still in use
+     */
+    void destroy();
+
+    /**
+     * @return Whether the meshlets are drawn with task and mesh shaders
+     */
+    bool usesMeshShader() const { return useMeshShader; }
+
+    /**
+     * @return The shaders and state of the pipeline that draws the meshlets
+     */
+    PipelineKey getPipelineKey() const;
+
+    /**
+     * @return The GLSL sources of the shaders of both paths, for the shader
+     *         watcher
+     */
+    static std::vector<std::string> getShaderSources() {
+        return { TASK_SOURCE_PATH, MESH_SOURCE_PATH, CULL_SOURCE_PATH, VERT_SOURCE_PATH, FRAG_SOURCE_PATH };
+    }
+
+    /**
+     * Gets the culling pipeline again, after the pipeline library replaced
+     * it. Does nothing if the mesh shader path is used
+     *
+     * @param pipelineLibrary The library initialize() got the pipeline from
+     */
+    void updatePipelines(PipelineLibrary* pipelineLibrary);
+
+    /**
+     * Records the culling of the meshlets for this frame. Must be recorded
+     * outside a render pass, before draw()
+     *
+     * @param commandBuffer The command buffer of the frame
+     * @param viewProjection The view projection matrix, as 16 floats
+     * @param cameraPosition The position of the camera, as 3 floats
+     * @param viewportHeight The height of the viewport in pixels, which
+     *                       scales the errors of the levels of detail
+     */
+    void cull(vk::CommandBuffer commandBuffer, const float* viewProjection, const float* cameraPosition,
+              uint32_t viewportHeight);
+
+    /**
+     * Draws the meshlets left by cull()
+     *
+     * Requires: The pipeline of getPipelineKey() is bound
+     *
+     * @param commandBuffer The command buffer, in a render pass
+     * @param layout The layout of the pipeline
+     */
+    void draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout);
+
+private:
+    /** The paths to the shaders */
+    inline static const std::string TASK_SOURCE_PATH = "shaders/meshlet.task";
+    inline static const std::string TASK_PATH = "shaders/meshlet_task.spv";
+    inline static const std::string MESH_SOURCE_PATH = "shaders/meshlet.mesh";
+    inline static const std::string MESH_PATH = "shaders/meshlet_mesh.spv";
+    inline static const std::string MESH_QUANTIZED_PATH = "shaders/meshlet_quantized_mesh.spv";
+    inline static const std::string CULL_SOURCE_PATH = "shaders/meshlet_cull.comp";
+    inline static const std::string CULL_PATH = "shaders/meshlet_cull_comp.spv";
+    inline static const std::string VERT_SOURCE_PATH = "shaders/meshlet.vert";
+    inline static const std::string VERT_PATH = "shaders/meshlet_vert.spv";
+    inline static const std::string VERT_QUANTIZED_PATH = "shaders/meshlet_quantized_vert.spv";
+    inline static const std::string FRAG_SOURCE_PATH = "shaders/meshlet.frag";
+    inline static const std::string FRAG_PATH = "shaders/meshlet_frag.spv";
+    /** The local size of the task shader, and the meshlets each one culls */
+    inline static const uint32_t TASK_GROUP_SIZE = 32;
+    /** The most workgroups in one dimension of a dispatch on any device */
+    inline static const uint32_t MAX_GROUP_COUNT = 65535;
+    /** The largest index any device can draw. The fallback's indices hold the
+     *  copy, its level of detail and the vertex, so this limits its copies */
+    inline static const uint32_t MAX_INDEX_VALUE = (1u << 24) - 1;
+    /** The height the copies hang above the street at, and their radius */
+    inline static const float INSTANCE_HEIGHT = 12.f;
+    inline static const float INSTANCE_RADIUS = 3.f;
+
+    /** The push constants of every meshlet shader, filling the 128 bytes
+     *  every device has */
+    struct PushConstants {
+        float viewProjection[16];
+        /** The bounding sphere of the mesh, before each copy moves it */
+        float bounds[4];
+        float cameraPosition[3];
+        uint32_t lodCount;
+        uint32_t vertexCount;
+        /** The pixels a size of 1 covers at distance 1 */
+        float lodScale;
+        /** The shaders align the vec4 after to 16 bytes */
+        float padding[2];
+        /** Decodes quantized positions, as in MeshletMesh */
+        float quantization[4];
+    };
+
+    vk::Device device;
+    MemoryAllocator* allocator = nullptr;
+    CompletionService* completionService = nullptr;
+    bool useMeshShader = false;
+#ifdef VK_EXT_mesh_shader
+    // Loaded from the device, since it is from an extension
+    PFN_vkCmdDrawMeshTasksEXT cmdDrawMeshTasks = nullptr;
+#endif
+
+    uint32_t lodCount = 0;
+    /** The meshlets of the largest level of detail */
+    uint32_t maxLodMeshletCount = 0;
+    uint32_t vertexCount = 0;
+    float bounds[4] = {};
+    /** Whether the vertices are quantized, which picks the shaders */
+    bool quantized = false;
+    float quantization[4] = {};
+    /** The copies drawn, which the fallback may have to limit */
+    uint32_t instanceCount = 0;
+    /** Set by cull() for draw() */
+    PushConstants pushConstants{};
+
+    vk::Buffer meshletBuffer;
+    Allocation meshletAllocation;
+    vk::Buffer instanceBuffer;
+    Allocation instanceAllocation;
+    vk::Buffer vertexBuffer;
+    Allocation vertexAllocation;
+    vk::Buffer meshletVertexBuffer;
+    Allocation meshletVertexAllocation;
+    vk::Buffer meshletTriangleBuffer;
+    Allocation meshletTriangleAllocation;
+    vk::Buffer lodBuffer;
+    Allocation lodAllocation;
+
+    // Only used without mesh shaders
+    vk::Pipeline cullPipeline;
+    vk::PipelineLayout cullLayout;
+    /** The vk::DrawIndexedIndirectCommand written by the culling pass */
+    vk::Buffer drawBuffer;
+    Allocation drawAllocation;
+    /** The indices of the triangles left by the culling pass */
+    vk::Buffer indexBuffer;
+    Allocation indexAllocation;
+
+    vk::DescriptorPool descriptorPool;
+    /** The set the draw reads */
+    vk::DescriptorSet drawSet;
+    /** The set the culling pass reads, without mesh shaders */
+    vk::DescriptorSet cullSet;
+
+    /**
+     * Creates a device local buffer
+     */
+    vk::Buffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation* allocation);
+
+    /**
+     * Copies data into device local buffers through one staging buffer, in
+     * one submission. The staging buffer is freed once the copy is done
+     *
+     * @param queue The queue to copy with
+     * @param queueFamilyIndex The family of the queue
+     * @param buffers The buffers to copy into
+     * @param data The data of each buffer, as much as each one holds
+     * @param sizes The size of each buffer's data
+     */
+    void upload(vk::Queue queue, uint32_t queueFamilyIndex, const std::vector<vk::Buffer>& buffers,
+                const std::vector<const void*>& data, const std::vector<vk::DeviceSize>& sizes);
+
+    /**
+     * Creates the descriptor sets and points them at the buffers
+     */
+    void createDescriptorSets(LayoutCache* layoutCache);
+};
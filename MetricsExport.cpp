@@ -0,0 +1,90 @@
+// October 18, 2026
+
+#include "MetricsExport.hpp"
+
+#include <algorithm>
+
+// ***** Public methods *****
+
+bool MetricsExport::initialize(const std::string& path, MemoryAllocator* allocator) {
+    this->allocator = allocator;
+    frameTimes.assign(HISTORY_LENGTH, 0.f);
+    sortedFrameTimes.assign(HISTORY_LENGTH, 0.f);
+    startTime = std::chrono::steady_clock::now();
+    lastFrameEnd = startTime;
+    lastPublish = startTime;
+
+    enabled = file.create(path);
+    return enabled;
+}
+
+void MetricsExport::destroy() {
+    file.close();
+    enabled = false;
+}
+
+void MetricsExport::endFrame(float gpuFrameTime) {
+    if (!enabled) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    lastFrameTime = std::chrono::duration<float, std::milli>(now - lastFrameEnd).count();
+    lastFrameEnd = now;
+    frameTimes[historyNext] = lastFrameTime;
+    historyNext = (historyNext + 1) % HISTORY_LENGTH;
+    historyCount = std::min(historyCount + 1, HISTORY_LENGTH);
+    frameCount++;
+
+    if (std::chrono::duration<float>(now - lastPublish).count() >= PUBLISH_INTERVAL_SECONDS) {
+        lastPublish = now;
+        publish(gpuFrameTime);
+    }
+}
+
+void MetricsExport::recordSwapchainRecreate(float milliseconds) {
+    swapchainRecreateCount++;
+    lastSwapchainRecreateTime = milliseconds;
+    totalSwapchainRecreateTime += milliseconds;
+}
+
+void MetricsExport::restartFrameTimer() {
+    lastFrameEnd = std::chrono::steady_clock::now();
+}
+
+// ***** Private methods *****
+
+void MetricsExport::publish(float gpuFrameTime) {
+    MetricsFile::Snapshot snapshot{};
+    snapshot.frameCount = frameCount;
+    snapshot.swapchainRecreateCount = swapchainRecreateCount;
+    snapshot.allocatedBytes = allocator->getAllocatedBytes();
+    snapshot.usedBytes = allocator->getUsedBytes();
+    snapshot.uptime = std::chrono::duration<double>(lastFrameEnd - startTime).count();
+    snapshot.lastFrameTime = lastFrameTime;
+    snapshot.gpuFrameTime = gpuFrameTime;
+    snapshot.lastSwapchainRecreateTime = lastSwapchainRecreateTime;
+    snapshot.totalSwapchainRecreateTime = totalSwapchainRecreateTime;
+
+    // The ring's order doesn't matter for these
+    std::copy(frameTimes.begin(), frameTimes.begin() + historyCount, sortedFrameTimes.begin());
+    double sum = 0.0;
+    for (uint32_t i = 0; i < historyCount; i++) {
+        sum += sortedFrameTimes[i];
+    }
+    snapshot.averageFrameTime = sum / historyCount;
+    snapshot.maxFrameTime = *std::max_element(sortedFrameTimes.begin(), sortedFrameTimes.begin() + historyCount);
+    snapshot.medianFrameTime = getPercentile(0.5f);
+    snapshot.p95FrameTime = getPercentile(0.95f);
+    snapshot.p99FrameTime = getPercentile(0.99f);
+
+    file.publish(snapshot);
+}
+
+float MetricsExport::getPercentile(float fraction) {
+    // Partial sorting is enough to find one rank
+    uint32_t rank = std::min((uint32_t)(fraction * historyCount), historyCount - 1);
+    std::nth_element(sortedFrameTimes.begin(), sortedFrameTimes.begin() + rank,
+                     sortedFrameTimes.begin() + historyCount);
+    return sortedFrameTimes[rank];
+}
@@ -0,0 +1,103 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+#include "MetricsFile.hpp"
+#include "MemoryAllocator.hpp"
+
+/**
+ * Publishes the app's metrics to a MetricsFile for monitoring: frame time
+ * percentiles over the last HISTORY_LENGTH frames, GPU time, device memory
+ * and the number and duration of swapchain recreations.
+ *
+ * Frames only add to a ring of frame times. The percentiles are worked out
+ * and published every PUBLISH_INTERVAL_SECONDS, without allocating, so the
+ * export costs the render thread next to nothing.
+ */
+class MetricsExport {
+public:
+    /**
+     * Creates the metrics file. If it can't be created, the app runs without
+     * exporting metrics
+     *
+     * @param path The file to publish to
+     * @param allocator Gives the device memory in use
+     *
+     * @return Whether the metrics are exported
+     */
+    bool initialize(const std::string& path, MemoryAllocator* allocator);
+
+    /**
+     * Unmaps the metrics file, leaving the last metrics in it
+     */
+    void destroy();
+
+    /**
+     * Adds a frame, and publishes the metrics if it is time to
+     *
+     * @param gpuFrameTime The milliseconds the GPU took for the last frame it
+     *                     timed, or 0 if it isn't timed
+     */
+    void endFrame(float gpuFrameTime);
+
+    /**
+     * Counts a recreation of the swapchain
+     *
+     * @param milliseconds How long the recreation took
+     */
+    void recordSwapchainRecreate(float milliseconds);
+
+    /**
+     * Starts timing the next frame from now, so time spent not drawing, like
+     * while the window is hidden, isn't counted as a frame
+     */
+    void restartFrameTimer();
+
+    /**
+     * @return The file the metrics are published to, which other threads can
+     *         read, or null if they aren't exported
+     */
+    const MetricsFile* getFile() const { return enabled ? &file : nullptr; }
+
+private:
+    /** The frames the percentiles are taken over */
+    inline static const uint32_t HISTORY_LENGTH = 512;
+    /** How often the metrics are published */
+    inline static const float PUBLISH_INTERVAL_SECONDS = 0.1f;
+
+    MetricsFile file;
+    bool enabled = false;
+    MemoryAllocator* allocator = nullptr;
+
+    /** The ring of frame times in milliseconds, and a copy to sort */
+    std::vector<float> frameTimes;
+    std::vector<float> sortedFrameTimes;
+    uint32_t historyCount = 0;
+    uint32_t historyNext = 0;
+    uint64_t frameCount = 0;
+    float lastFrameTime = 0.f;
+    uint64_t swapchainRecreateCount = 0;
+    float lastSwapchainRecreateTime = 0.f;
+    double totalSwapchainRecreateTime = 0.0;
+
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point lastFrameEnd;
+    std::chrono::steady_clock::time_point lastPublish;
+
+    /**
+     * Works out the metrics and publishes them
+     */
+    void publish(float gpuFrameTime);
+
+    /**
+     * @return The frame time that a fraction of the frames are at most
+     *
+     * Requires: The frame times to sort hold the history
+     */
+    float getPercentile(float fraction);
+};
@@ -0,0 +1,122 @@
+// October 18, 2026
+
+#include "MetricsFile.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ***** Public methods *****
+
+bool MetricsFile::create(const std::string& path) {
+#if defined(__linux__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, sizeof(Region)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    // The mapping keeps the file open
+    void* memory = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    // The sequence is 0 until the first snapshot, so readers can tell there
+    // is nothing yet
+    region = new (memory) Region();
+    region->magic = MAGIC;
+    region->version = VERSION;
+    region->sequence.store(0, std::memory_order_release);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MetricsFile::open(const std::string& path) {
+#if defined(__linux__) || defined(__APPLE__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("ERROR: Failed to open ") + path);
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(Region)) {
+        ::close(fd);
+        throw std::runtime_error(std::string("ERROR: ") + path + " is not a metrics file");
+    }
+    void* memory = mmap(nullptr, sizeof(Region), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error(std::string("ERROR: Failed to map ") + path);
+    }
+
+    region = static_cast<Region*>(memory);
+    if (region->magic != MAGIC || region->version != VERSION) {
+        close();
+        throw std::runtime_error(std::string("ERROR: ") + path + " is not a metrics file of this version");
+    }
+#else
+    throw std::runtime_error("ERROR: Metrics files are only supported on POSIX systems");
+#endif
+}
+
+void MetricsFile::close() {
+#if defined(__linux__) || defined(__APPLE__)
+    if (region != nullptr) {
+        munmap(region, sizeof(Region));
+        region = nullptr;
+    }
+#endif
+}
+
+void MetricsFile::publish(const Snapshot& snapshot) {
+    uint64_t words[SNAPSHOT_WORDS];
+    std::memcpy(words, &snapshot, sizeof(snapshot));
+
+    // Odd while writing. The fence keeps the words from being written before
+    // readers can see the sequence is odd
+    uint64_t sequence = region->sequence.load(std::memory_order_relaxed);
+    region->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < SNAPSHOT_WORDS; i++) {
+        region->words[i].store(words[i], std::memory_order_relaxed);
+    }
+    region->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool MetricsFile::read(Snapshot* snapshot) const {
+    uint64_t words[SNAPSHOT_WORDS];
+    uint64_t before;
+    uint64_t after;
+    uint32_t attempts = 0;
+    do {
+        // A writer that died while publishing leaves the sequence odd
+        if (attempts++ == MAX_READ_ATTEMPTS) {
+            return false;
+        }
+        before = region->sequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < SNAPSHOT_WORDS; i++) {
+            words[i] = region->words[i].load(std::memory_order_relaxed);
+        }
+        // Keeps the words from being read after the second sequence
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = region->sequence.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1) != 0);
+
+    if (before == 0) {
+        return false;
+    }
+    std::memcpy(snapshot, words, sizeof(*snapshot));
+    return true;
+}
@@ -0,0 +1,123 @@
+// October 18, 2026
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+/**
+ * A memory mapped file that one process publishes the app's live metrics to
+ * and any number of other local processes read, without either side making
+ * a system call after the file is mapped.
+ *
+ * The metrics are guarded by a sequence lock: the writer makes the sequence
+ * odd, copies the snapshot in, and makes it even again. A reader copies the
+ * snapshot out between two reads of the same even sequence, and retries
+ * otherwise. The writer never waits for readers, so reading can't slow the
+ * app down, and a reader never sees a half written snapshot.
+ *
+ * Only POSIX systems map the file. Elsewhere open() returns false, and the
+ * app runs without exporting metrics.
+ */
+class MetricsFile {
+public:
+    /** Where the app publishes its metrics, on a memory backed file system
+     *  where there is one */
+#ifdef __linux__
+    inline static const std::string DEFAULT_PATH = "/dev/shm/vulkan_app.metrics";
+#else
+    inline static const std::string DEFAULT_PATH = "/tmp/vulkan_app.metrics";
+#endif
+
+    /** The metrics, as copied in and out. Times are in milliseconds */
+    struct Snapshot {
+        uint64_t frameCount;
+        uint64_t swapchainRecreateCount;
+        uint64_t allocatedBytes;
+        uint64_t usedBytes;
+        /** Seconds since the app started, so readers can tell a stale file */
+        double uptime;
+        double lastFrameTime;
+        double averageFrameTime;
+        double medianFrameTime;
+        double p95FrameTime;
+        double p99FrameTime;
+        double maxFrameTime;
+        /** The time the GPU took for the last timed frame, or 0 without
+         *  timestamps */
+        double gpuFrameTime;
+        /** How long the last swapchain recreation took, and all of them */
+        double lastSwapchainRecreateTime;
+        double totalSwapchainRecreateTime;
+    };
+
+    MetricsFile() = default;
+    MetricsFile(const MetricsFile&) = delete;
+    MetricsFile& operator=(const MetricsFile&) = delete;
+    ~MetricsFile() { close(); }
+
+    /**
+     * Creates the file, or truncates it, and maps it for publishing
+     *
+     * @param path The file to publish to
+     *
+     * @return Whether the file could be mapped
+     */
+    bool create(const std::string& path);
+
+    /**
+     * Maps an existing file for reading
+     *
+     * @param path The file the app publishes to
+     *
+     * @throw std::runtime_error if the file doesn't exist, or isn't a metrics
+     *        file of this version
+     */
+    void open(const std::string& path);
+
+    /**
+     * Unmaps the file. The file is left behind, so readers can see the last
+     * metrics
+     */
+    void close();
+
+    /**
+     * Publishes a snapshot. Never waits
+     *
+     * Requires: The file was mapped by create()
+     */
+    void publish(const Snapshot& snapshot);
+
+    /**
+     * Copies out the latest snapshot, retrying while it is being published
+     *
+     * @return false if nothing has been published yet, or a publish never
+     *         finished
+     */
+    bool read(Snapshot* snapshot) const;
+
+private:
+    inline static const uint32_t MAGIC = 0x4d455452; // "METR"
+    inline static const uint32_t VERSION = 2;
+    /** The snapshot, copied a word at a time */
+    inline static const size_t SNAPSHOT_WORDS = sizeof(Snapshot) / sizeof(uint64_t);
+    /** The most times a read is retried. A publish takes far less time than
+     *  this many tries */
+    inline static const uint32_t MAX_READ_ATTEMPTS = 1000000;
+
+    static_assert(sizeof(Snapshot) % sizeof(uint64_t) == 0, "Snapshot must be whole words");
+    // The atomics are shared with other processes, so they can't be locks
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "64 bit atomics must be lock free");
+
+    /** The layout of the file */
+    struct Region {
+        uint32_t magic;
+        uint32_t version;
+        /** Odd while a snapshot is being published, and 0 before the first */
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> words[SNAPSHOT_WORDS];
+    };
+
+    Region* region = nullptr;
+};
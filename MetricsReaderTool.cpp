@@ -0,0 +1,66 @@
+// October 18, 2026
+
+// Prints the live metrics the app publishes. Reading never slows the app
+// down, so this can sample as often as it likes.
+//
+// Usage: metrics_reader [file] [interval_ms]
+//
+// With an interval, the metrics are printed again after each interval until
+// the reader is stopped.
+
+#include <iostream>
+#include <iomanip>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include "MetricsFile.hpp"
+
+static void printSnapshot(const MetricsFile::Snapshot& snapshot) {
+    const double megabyte = 1024.0 * 1024.0;
+    std::cout << std::fixed << std::setprecision(2)
+              << "uptime " << snapshot.uptime << " s, " << snapshot.frameCount << " frames, "
+              << snapshot.swapchainRecreateCount << " swapchain recreations ("
+              << snapshot.totalSwapchainRecreateTime << " ms, last " << snapshot.lastSwapchainRecreateTime << " ms)\n"
+              << "frame ms: last " << snapshot.lastFrameTime << ", average " << snapshot.averageFrameTime
+              << ", median " << snapshot.medianFrameTime << ", p95 " << snapshot.p95FrameTime
+              << ", p99 " << snapshot.p99FrameTime << ", max " << snapshot.maxFrameTime << "\n"
+              << "gpu ms: " << snapshot.gpuFrameTime << "\n"
+              << "memory MB: " << snapshot.usedBytes / megabyte << " used of "
+              << snapshot.allocatedBytes / megabyte << " allocated" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " [file] [interval_ms]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string path = argc > 1 ? argv[1] : MetricsFile::DEFAULT_PATH;
+
+    try {
+        long interval = argc > 2 ? std::stol(argv[2]) : 0;
+
+        MetricsFile file;
+        file.open(path);
+
+        do {
+            MetricsFile::Snapshot snapshot;
+            if (file.read(&snapshot)) {
+                printSnapshot(snapshot);
+            } else {
+                std::cout << "No metrics published yet" << std::endl;
+            }
+            if (interval > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+            }
+        } while (interval > 0);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -0,0 +1,328 @@
+// October 18, 2026
+
+#include "OcclusionCuller.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+// The largest power of two that is at most a value
+static uint32_t floorPowerOfTwo(uint32_t value) {
+    uint32_t power = 1;
+    while (power * 2 <= value) {
+        power *= 2;
+    }
+    return power;
+}
+
+// ***** Public methods *****
+
+void OcclusionCuller::initialize(vk::Device device, MemoryAllocator* allocator, PipelineLibrary* pipelineLibrary,
+                                 LayoutCache* layoutCache, vk::Buffer instanceBuffer, uint32_t instanceCount,
+                                 uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset) {
+    this->device = device;
+    this->allocator = allocator;
+    this->layoutCache = layoutCache;
+    this->instanceCount = instanceCount;
+    this->indexCount = indexCount;
+    this->firstIndex = firstIndex;
+    this->vertexOffset = vertexOffset;
+
+    updatePipelines(pipelineLibrary);
+
+    vk::DeviceSize listSize = (vk::DeviceSize)instanceCount * sizeof(uint32_t);
+    visibilityBuffer = createBuffer(listSize, vk::BufferUsageFlagBits::eTransferDst, &visibilityAllocation);
+    visibilityCleared = false;
+    for (uint32_t phase = 0; phase < 2; phase++) {
+        drawBuffers[phase] = createBuffer(sizeof(vk::DrawIndexedIndirectCommand),
+                                          vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                          &drawAllocations[phase]);
+        visibleBuffers[phase] = createBuffer(listSize, {}, &visibleAllocations[phase]);
+    }
+
+    vk::SamplerCreateInfo samplerInfo{};
+    samplerInfo.magFilter = vk::Filter::eNearest;
+    samplerInfo.minFilter = vk::Filter::eNearest;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.minLod = 0.f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    pyramidSampler = device.createSampler(samplerInfo);
+
+    // The same bindings the shaders' reflection gives
+    std::vector<vk::DescriptorSetLayoutBinding> cullBindings(5);
+    for (uint32_t i = 0; i < cullBindings.size(); i++) {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+    cullBindings[4].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+
+    std::vector<vk::DescriptorSetLayoutBinding> instanceBindings(2);
+    for (uint32_t i = 0; i < instanceBindings.size(); i++) {
+        instanceBindings[i].binding = i;
+        instanceBindings[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+        instanceBindings[i].descriptorCount = 1;
+        instanceBindings[i].stageFlags = vk::ShaderStageFlagBits::eVertex;
+    }
+
+    std::vector<vk::DescriptorPoolSize> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 2 * 4 + 2 * 2),
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2),
+    };
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = 4;
+    poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    descriptorPool = device.createDescriptorPool(poolInfo);
+
+    vk::DescriptorSetLayout cullSetLayout = layoutCache->getDescriptorSetLayout(cullBindings);
+    vk::DescriptorSetLayout instanceSetLayout = layoutCache->getDescriptorSetLayout(instanceBindings);
+    std::vector<vk::DescriptorSetLayout> setLayouts = { cullSetLayout, cullSetLayout, instanceSetLayout, instanceSetLayout };
+    vk::DescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.descriptorPool = descriptorPool;
+    allocateInfo.descriptorSetCount = (uint32_t)setLayouts.size();
+    allocateInfo.pSetLayouts = setLayouts.data();
+    std::vector<vk::DescriptorSet> sets = device.allocateDescriptorSets(allocateInfo);
+
+    // The pyramid is bound once it exists
+    vk::DescriptorBufferInfo instanceInfo(instanceBuffer, 0, VK_WHOLE_SIZE);
+    vk::DescriptorBufferInfo visibilityInfo(visibilityBuffer, 0, VK_WHOLE_SIZE);
+    for (uint32_t phase = 0; phase < 2; phase++) {
+        cullSets[phase] = sets[phase];
+        instanceSets[phase] = sets[2 + phase];
+
+        vk::DescriptorBufferInfo drawInfo(drawBuffers[phase], 0, VK_WHOLE_SIZE);
+        vk::DescriptorBufferInfo visibleInfo(visibleBuffers[phase], 0, VK_WHOLE_SIZE);
+        const vk::DescriptorBufferInfo* cullInfos[] = { &instanceInfo, &visibilityInfo, &drawInfo, &visibleInfo };
+        const vk::DescriptorBufferInfo* instanceInfos[] = { &instanceInfo, &visibleInfo };
+
+        std::vector<vk::WriteDescriptorSet> writes;
+        for (uint32_t binding = 0; binding < 4; binding++) {
+            writes.push_back(vk::WriteDescriptorSet(cullSets[phase], binding, 0, 1, vk::DescriptorType::eStorageBuffer,
+                                                    nullptr, cullInfos[binding]));
+        }
+        for (uint32_t binding = 0; binding < 2; binding++) {
+            writes.push_back(vk::WriteDescriptorSet(instanceSets[phase], binding, 0, 1, vk::DescriptorType::eStorageBuffer,
+                                                    nullptr, instanceInfos[binding]));
+        }
+        device.updateDescriptorSets(writes, nullptr);
+    }
+}
+
+void OcclusionCuller::destroy() {
+    device.destroyDescriptorPool(descriptorPool);
+    device.destroySampler(pyramidSampler);
+
+    allocator->destroyBuffer(visibilityBuffer, visibilityAllocation);
+    for (uint32_t phase = 0; phase < 2; phase++) {
+        allocator->destroyBuffer(drawBuffers[phase], drawAllocations[phase]);
+        allocator->destroyBuffer(visibleBuffers[phase], visibleAllocations[phase]);
+    }
+}
+
+void OcclusionCuller::updatePipelines(PipelineLibrary* pipelineLibrary) {
+    cullPipeline = pipelineLibrary->getComputePipeline(ShaderVariant{ CULL_SOURCE_PATH, CULL_PATH, {} }, &cullLayout);
+    pyramidPipeline = pipelineLibrary->getComputePipeline(ShaderVariant{ PYRAMID_SOURCE_PATH, PYRAMID_PATH, {} },
+                                                          &pyramidLayout);
+}
+
+void OcclusionCuller::createPyramid(vk::ImageView depthView, vk::Extent2D depthExtent) {
+    this->depthExtent = depthExtent;
+    pyramidExtent = vk::Extent2D(floorPowerOfTwo(depthExtent.width), floorPowerOfTwo(depthExtent.height));
+    uint32_t levelCount = 1;
+    while ((std::max(pyramidExtent.width, pyramidExtent.height) >> levelCount) > 0) {
+        levelCount++;
+    }
+
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = vk::Format::eR32Sfloat;
+    imageInfo.extent = vk::Extent3D(pyramidExtent.width, pyramidExtent.height, 1);
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    pyramidImage = allocator->createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {}, &pyramidAllocation);
+
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = pyramidImage;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = vk::Format::eR32Sfloat;
+    viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1);
+    pyramidView = device.createImageView(viewInfo);
+
+    pyramidLevelViews.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        pyramidLevelViews[level] = device.createImageView(viewInfo);
+    }
+
+    std::vector<vk::DescriptorPoolSize> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, levelCount),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, levelCount),
+    };
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = levelCount;
+    poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    pyramidPool = device.createDescriptorPool(poolInfo);
+
+    std::vector<vk::DescriptorSetLayoutBinding> bindings(2);
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+    bindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    bindings[1].descriptorType = vk::DescriptorType::eStorageImage;
+    std::vector<vk::DescriptorSetLayout> setLayouts(levelCount, layoutCache->getDescriptorSetLayout(bindings));
+
+    vk::DescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.descriptorPool = pyramidPool;
+    allocateInfo.descriptorSetCount = levelCount;
+    allocateInfo.pSetLayouts = setLayouts.data();
+    pyramidSets = device.allocateDescriptorSets(allocateInfo);
+
+    // Each level reads the one below it, and level 0 reads the depth buffer
+    for (uint32_t level = 0; level < levelCount; level++) {
+        vk::DescriptorImageInfo sourceInfo = level == 0
+            ? vk::DescriptorImageInfo(pyramidSampler, depthView, vk::ImageLayout::eShaderReadOnlyOptimal)
+            : vk::DescriptorImageInfo(pyramidSampler, pyramidLevelViews[level - 1], vk::ImageLayout::eGeneral);
+        vk::DescriptorImageInfo destinationInfo(nullptr, pyramidLevelViews[level], vk::ImageLayout::eGeneral);
+
+        std::vector<vk::WriteDescriptorSet> writes = {
+            vk::WriteDescriptorSet(pyramidSets[level], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &sourceInfo),
+            vk::WriteDescriptorSet(pyramidSets[level], 1, 0, 1, vk::DescriptorType::eStorageImage, &destinationInfo),
+        };
+        device.updateDescriptorSets(writes, nullptr);
+    }
+
+    vk::DescriptorImageInfo pyramidInfo(pyramidSampler, pyramidView, vk::ImageLayout::eGeneral);
+    for (uint32_t phase = 0; phase < 2; phase++) {
+        vk::WriteDescriptorSet write(cullSets[phase], 4, 0, 1, vk::DescriptorType::eCombinedImageSampler, &pyramidInfo);
+        device.updateDescriptorSets(write, nullptr);
+    }
+}
+
+void OcclusionCuller::destroyPyramid() {
+    device.destroyDescriptorPool(pyramidPool);
+    pyramidPool = nullptr;
+    pyramidSets.clear();
+    for (vk::ImageView view : pyramidLevelViews) {
+        device.destroyImageView(view);
+    }
+    pyramidLevelViews.clear();
+    device.destroyImageView(pyramidView);
+    pyramidView = nullptr;
+    allocator->destroyImage(pyramidImage, pyramidAllocation);
+    pyramidImage = nullptr;
+    pyramidAllocation = Allocation();
+}
+
+void OcclusionCuller::cull(vk::CommandBuffer commandBuffer, uint32_t phase, const float* viewProjection) {
+    if (phase == PHASE_EARLY) {
+        // The last frame's draws and culling are done with the buffers
+        vk::MemoryBarrier reuseBarrier(vk::AccessFlagBits::eShaderWrite,
+                                       vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader |
+                                      vk::PipelineStageFlagBits::eComputeShader,
+                                      vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, reuseBarrier, nullptr, nullptr);
+
+        // Nothing was visible before the first frame
+        if (!visibilityCleared) {
+            commandBuffer.fillBuffer(visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+            visibilityCleared = true;
+        }
+
+        // Both phases start with no instances
+        vk::DrawIndexedIndirectCommand drawCommand(indexCount, 0, firstIndex, vertexOffset, 0);
+        for (uint32_t i = 0; i < 2; i++) {
+            commandBuffer.updateBuffer(drawBuffers[i], 0, sizeof(drawCommand), &drawCommand);
+        }
+
+        vk::MemoryBarrier resetBarrier(vk::AccessFlagBits::eTransferWrite,
+                                       vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, resetBarrier, nullptr, nullptr);
+    }
+
+    CullConstants constants;
+    memcpy(constants.viewProjection, viewProjection, sizeof(constants.viewProjection));
+    constants.pyramidSize[0] = (float)pyramidExtent.width;
+    constants.pyramidSize[1] = (float)pyramidExtent.height;
+    constants.instanceCount = instanceCount;
+    constants.late = phase == PHASE_LATE ? 1 : 0;
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullLayout, 0, cullSets[phase], nullptr);
+    commandBuffer.pushConstants(cullLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+    commandBuffer.dispatch((instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    vk::MemoryBarrier drawBarrier(vk::AccessFlagBits::eShaderWrite,
+                                  vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+                                  {}, drawBarrier, nullptr, nullptr);
+}
+
+void OcclusionCuller::buildPyramid(vk::CommandBuffer commandBuffer) {
+    uint32_t levelCount = (uint32_t)pyramidLevelViews.size();
+
+    // Every level is written again, so the last frame's contents are dropped.
+    // The last frame's late phase must be done reading them
+    vk::ImageMemoryBarrier barrier{};
+    barrier.srcAccessMask = {};
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eGeneral;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = pyramidImage;
+    barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, nullptr, nullptr, barrier);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pyramidPipeline);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        vk::Extent2D source = level == 0 ? depthExtent : getLevelExtent(level - 1);
+        vk::Extent2D destination = getLevelExtent(level);
+        PyramidConstants constants = { { source.width, source.height }, { destination.width, destination.height } };
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pyramidLayout, 0, pyramidSets[level], nullptr);
+        commandBuffer.pushConstants(pyramidLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+        commandBuffer.dispatch((destination.width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+                               (destination.height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+
+        // The next level, and then the late phase, read this one
+        barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        barrier.oldLayout = vk::ImageLayout::eGeneral;
+        barrier.subresourceRange.baseMipLevel = level;
+        barrier.subresourceRange.levelCount = 1;
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, nullptr, nullptr, barrier);
+    }
+}
+
+// ***** Private methods *****
+
+vk::Buffer OcclusionCuller::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation* allocation) {
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = size;
+    // Frame captures read the buffers back
+    bufferInfo.usage = usage | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    return allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {}, allocation);
+}
+
+vk::Extent2D OcclusionCuller::getLevelExtent(uint32_t level) const {
+    return vk::Extent2D(std::max(1u, pyramidExtent.width >> level), std::max(1u, pyramidExtent.height >> level));
+}
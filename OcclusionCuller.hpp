@@ -0,0 +1,216 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+
+#include "MemoryAllocator.hpp"
+#include "PipelineLibrary.hpp"
+#include "LayoutCache.hpp"
+
+/**
+ * Culls instances on the GPU against the view frustum and a hierarchical
+ * depth (Hi-Z) pyramid, writing what is left into indirect draws.
+ *
+ * Culling runs in two phases each frame:
+ * 1. The early phase draws the instances that were visible last frame and
+ *    are in the frustum, without testing occlusion
+ * 2. The depth pyramid is built in compute from the depth they drew, each
+ *    level holding the farthest depth of the level below
+ * 3. The late phase tests every instance against the pyramid, draws the
+ *    ones that weren't drawn early but are visible now, and records what is
+ *    visible for the next frame
+ *
+ * The early phase's depth is last frame's visible set seen from the current
+ * camera, so occluders are never stale. Anything that was hidden and comes
+ * into view is caught by the late phase in the same frame, so disocclusion
+ * never shows a missing object.
+ *
+ * Each phase's draw is a single instanced vkCmdDrawIndexedIndirect. The cull
+ * shader appends the instances to draw to a list, which the vertex shader
+ * reads with gl_InstanceIndex, so neither multiDrawIndirect nor an indirect
+ * count is needed.
+ */
+class OcclusionCuller {
+public:
+    /** The phases of culling */
+    inline static const uint32_t PHASE_EARLY = 0;
+    inline static const uint32_t PHASE_LATE = 1;
+
+    /**
+     * Creates the buffers and descriptor sets, and gets the compute pipelines
+     *
+     * @param device The logical device
+     * @param allocator Allocates the memory of the buffers and the pyramid
+     * @param pipelineLibrary Builds the compute pipelines
+     * @param layoutCache Gives the descriptor set layouts
+     * @param instanceBuffer The storage buffer of the instances, laid out as
+     *                       Scene::Instance
+     * @param instanceCount The number of instances
+     * @param indexCount The number of indices drawn for each instance
+     * @param firstIndex The first of them in the bound index buffer
+     * @param vertexOffset Added to each index
+     */
+    void initialize(vk::Device device, MemoryAllocator* allocator, PipelineLibrary* pipelineLibrary,
+                    LayoutCache* layoutCache, vk::Buffer instanceBuffer, uint32_t instanceCount,
+                    uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset);
+
+    /**
+     * Destroys the buffers and descriptor sets
+     *
+     * Requires: The pyramid has been destroyed, and no frame using the
+     *           culler is still in use
+     */
+    void destroy();
+
+    /**
+     * @return The GLSL sources of the shaders, for the shader watcher
+     */
+    static std::vector<std::string> getShaderSources() { return { CULL_SOURCE_PATH, PYRAMID_SOURCE_PATH }; }
+
+    /**
+     * Gets the compute pipelines again, after the pipeline library replaced
+     * them
+     *
+     * @param pipelineLibrary The library initialize() got the pipelines from
+     */
+    void updatePipelines(PipelineLibrary* pipelineLibrary);
+
+    /**
+     * Creates the depth pyramid for a depth buffer. Level 0 is the depth
+     * buffer's size rounded down to a power of two
+     *
+     * @param depthView A view of the depth aspect of the depth buffer, which
+     *                  is in eShaderReadOnlyOptimal when the pyramid is built
+     * @param depthExtent The size of the depth buffer
+     */
+    void createPyramid(vk::ImageView depthView, vk::Extent2D depthExtent);
+
+    /**
+     * Destroys the depth pyramid, before the depth buffer is recreated.
+     * Does nothing if it is already destroyed
+     *
+     * Requires: No frame using the pyramid is still in use
+     */
+    void destroyPyramid();
+
+    /**
+     * Records a culling phase, and the barrier before its draw. Must be
+     * recorded outside a render pass
+     *
+     * @param commandBuffer The command buffer of the frame
+     * @param phase PHASE_EARLY, or PHASE_LATE after buildPyramid()
+     * @param viewProjection The view projection matrix, as 16 floats
+     */
+    void cull(vk::CommandBuffer commandBuffer, uint32_t phase, const float* viewProjection);
+
+    /**
+     * Records the build of the depth pyramid. Must be recorded after the
+     * early phase's render pass
+     */
+    void buildPyramid(vk::CommandBuffer commandBuffer);
+
+    /**
+     * @return The buffer holding a phase's vk::DrawIndexedIndirectCommand
+     */
+    vk::Buffer getDrawBuffer(uint32_t phase) const { return drawBuffers[phase]; }
+
+    /**
+     * @return The buffer of the indices of the instances a phase draws,
+     *         with room for every instance
+     */
+    vk::Buffer getVisibleBuffer(uint32_t phase) const { return visibleBuffers[phase]; }
+
+    /**
+     * @return The size of each phase's buffer of instances to draw
+     */
+    vk::DeviceSize getVisibleBufferSize() const { return (vk::DeviceSize)instanceCount * sizeof(uint32_t); }
+
+    /**
+     * @return The descriptor set with the instances and a phase's instances
+     *         to draw, for the vertex shader
+     */
+    vk::DescriptorSet getInstanceSet(uint32_t phase) const { return instanceSets[phase]; }
+
+private:
+    /** The paths to the shaders */
+    inline static const std::string CULL_SOURCE_PATH = "shaders/cull.comp";
+    inline static const std::string CULL_PATH = "shaders/cull_comp.spv";
+    inline static const std::string PYRAMID_SOURCE_PATH = "shaders/depth_pyramid.comp";
+    inline static const std::string PYRAMID_PATH = "shaders/depth_pyramid_comp.spv";
+    /** The local sizes of the shaders */
+    inline static const uint32_t CULL_GROUP_SIZE = 64;
+    inline static const uint32_t PYRAMID_GROUP_SIZE = 8;
+
+    /** The push constants of the cull shader */
+    struct CullConstants {
+        float viewProjection[16];
+        float pyramidSize[2];
+        uint32_t instanceCount;
+        uint32_t late;
+    };
+
+    /** The push constants of the pyramid shader */
+    struct PyramidConstants {
+        uint32_t sourceSize[2];
+        uint32_t destinationSize[2];
+    };
+
+    vk::Device device;
+    MemoryAllocator* allocator = nullptr;
+    LayoutCache* layoutCache = nullptr;
+    uint32_t instanceCount = 0;
+    /** Where the draws' indices are */
+    uint32_t indexCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+
+    vk::Pipeline cullPipeline;
+    vk::PipelineLayout cullLayout;
+    vk::Pipeline pyramidPipeline;
+    vk::PipelineLayout pyramidLayout;
+
+    /** Whether each instance was visible at the end of the last frame */
+    vk::Buffer visibilityBuffer;
+    Allocation visibilityAllocation;
+    /** Whether the visibility has been cleared, which the first frame does */
+    bool visibilityCleared = false;
+    /** The indirect draw of each phase */
+    vk::Buffer drawBuffers[2];
+    Allocation drawAllocations[2];
+    /** The instances each phase draws */
+    vk::Buffer visibleBuffers[2];
+    Allocation visibleAllocations[2];
+
+    vk::DescriptorPool descriptorPool;
+    vk::DescriptorSet cullSets[2];
+    vk::DescriptorSet instanceSets[2];
+    /** Nearest filtering, so each texel is a region's exact farthest depth */
+    vk::Sampler pyramidSampler;
+
+    // Recreated with the depth buffer
+    vk::Image pyramidImage;
+    Allocation pyramidAllocation;
+    /** A view of every level, which the cull shader samples */
+    vk::ImageView pyramidView;
+    /** A view of each level, which the pyramid shader writes */
+    std::vector<vk::ImageView> pyramidLevelViews;
+    vk::Extent2D pyramidExtent;
+    vk::Extent2D depthExtent;
+    vk::DescriptorPool pyramidPool;
+    /** The descriptor set building each level */
+    std::vector<vk::DescriptorSet> pyramidSets;
+
+    /**
+     * Creates a device local buffer for the culling passes
+     */
+    vk::Buffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation* allocation);
+
+    /**
+     * @return The size of a level of the pyramid
+     */
+    vk::Extent2D getLevelExtent(uint32_t level) const;
+};
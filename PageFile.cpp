@@ -0,0 +1,187 @@
+// October 18, 2026
+
+#include "PageFile.hpp"
+
+#include <stdexcept>
+#include <cstring>
+
+// Helpers for reading and writing the header
+
+static void writeU32(std::ofstream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static uint32_t readU32(std::ifstream& in) {
+    uint32_t value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+// ***** Public methods *****
+
+void PageFile::open(const std::string& path) {
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to open ") + path);
+    }
+
+    uint32_t magic = readU32(file);
+    uint32_t version = readU32(file);
+    width = readU32(file);
+    height = readU32(file);
+    uint32_t pageSize = readU32(file);
+    uint32_t mipCount = readU32(file);
+    if (!file || magic != MAGIC) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is not a page file");
+    }
+    if (version != VERSION || pageSize != PAGE_SIZE) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " is from an unsupported version");
+    }
+
+    computeLayout();
+    if (mipCount != getMipCount()) {
+        throw std::runtime_error(std::string("ERROR: ") + path + " has the wrong number of mip levels");
+    }
+    pagesStart = file.tellg();
+}
+
+void PageFile::close() {
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+void PageFile::getPageLocation(uint32_t id, uint32_t* mip, uint32_t* x, uint32_t* y) const {
+    // Levels only get smaller, so the search is short
+    uint32_t level = 0;
+    while (id >= mipOffsets[level + 1]) {
+        level++;
+    }
+
+    uint32_t index = id - mipOffsets[level];
+    *mip = level;
+    *x = index % getPagesX(level);
+    *y = index / getPagesX(level);
+}
+
+uint32_t PageFile::getParent(uint32_t id) const {
+    uint32_t mip, x, y;
+    getPageLocation(id, &mip, &x, &y);
+
+    // Pages are half the texels of their level, except at the edges of odd
+    // sized levels, where the last page can cover texels past the parent's
+    // last page
+    uint32_t parentX = std::min(x / 2, getPagesX(mip + 1) - 1);
+    uint32_t parentY = std::min(y / 2, getPagesY(mip + 1) - 1);
+    return getPageId(mip + 1, parentX, parentY);
+}
+
+void PageFile::readPage(uint32_t id, uint8_t* texels) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    file.seekg(pagesStart + (std::streamoff)id * PAGE_BYTES);
+    file.read(reinterpret_cast<char*>(texels), PAGE_BYTES);
+    if (!file) {
+        file.clear();
+        throw std::runtime_error("ERROR: Failed to read page " + std::to_string(id));
+    }
+}
+
+void PageFile::write(const std::string& path, uint32_t width, uint32_t height,
+                     const std::vector<std::vector<uint8_t> >& mips) {
+    PageFile layout;
+    layout.width = width;
+    layout.height = height;
+    layout.computeLayout();
+    if (mips.size() != layout.getMipCount()) {
+        throw std::runtime_error("ERROR: Page file needs " + std::to_string(layout.getMipCount()) + " mip levels");
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to create ") + path);
+    }
+
+    writeU32(out, MAGIC);
+    writeU32(out, VERSION);
+    writeU32(out, width);
+    writeU32(out, height);
+    writeU32(out, PAGE_SIZE);
+    writeU32(out, layout.getMipCount());
+
+    std::vector<uint8_t> page(PAGE_BYTES);
+    for (uint32_t mip = 0; mip < mips.size(); mip++) {
+        uint32_t mipWidth = layout.getMipWidth(mip);
+        uint32_t mipHeight = layout.getMipHeight(mip);
+
+        for (uint32_t pageY = 0; pageY < layout.getPagesY(mip); pageY++) {
+            for (uint32_t pageX = 0; pageX < layout.getPagesX(mip); pageX++) {
+                // Texels past the edge of the level repeat the edge, so
+                // filtering at the edge doesn't blend in garbage
+                for (uint32_t y = 0; y < PAGE_SIZE; y++) {
+                    uint32_t sourceY = std::min(pageY * PAGE_SIZE + y, mipHeight - 1);
+                    for (uint32_t x = 0; x < PAGE_SIZE; x++) {
+                        uint32_t sourceX = std::min(pageX * PAGE_SIZE + x, mipWidth - 1);
+                        memcpy(&page[(y * PAGE_SIZE + x) * 4], &mips[mip][((size_t)sourceY * mipWidth + sourceX) * 4], 4);
+                    }
+                }
+                out.write(reinterpret_cast<const char*>(page.data()), page.size());
+            }
+        }
+    }
+
+    out.close();
+    if (!out) {
+        throw std::runtime_error(std::string("ERROR: Failed to write ") + path);
+    }
+}
+
+std::vector<std::vector<uint8_t> > PageFile::buildMips(uint32_t width, uint32_t height, std::vector<uint8_t> texels) {
+    std::vector<std::vector<uint8_t> > mips;
+    mips.push_back(std::move(texels));
+
+    while (width > PAGE_SIZE || height > PAGE_SIZE) {
+        uint32_t mipWidth = std::max(1u, width / 2);
+        uint32_t mipHeight = std::max(1u, height / 2);
+        const std::vector<uint8_t>& source = mips.back();
+        std::vector<uint8_t> mip((size_t)mipWidth * mipHeight * 4);
+
+        // A box filter over each 2x2 block, clamped at the edges of odd sizes
+        for (uint32_t y = 0; y < mipHeight; y++) {
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < mipWidth; x++) {
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                const uint8_t* t00 = &source[((size_t)y0 * width + x0) * 4];
+                const uint8_t* t01 = &source[((size_t)y0 * width + x1) * 4];
+                const uint8_t* t10 = &source[((size_t)y1 * width + x0) * 4];
+                const uint8_t* t11 = &source[((size_t)y1 * width + x1) * 4];
+                uint8_t* texel = &mip[((size_t)y * mipWidth + x) * 4];
+                for (uint32_t channel = 0; channel < 4; channel++) {
+                    uint32_t sum = t00[channel] + t01[channel] + t10[channel] + t11[channel];
+                    texel[channel] = (uint8_t)((sum + 2) / 4);
+                }
+            }
+        }
+
+        mips.push_back(std::move(mip));
+        width = mipWidth;
+        height = mipHeight;
+    }
+
+    return mips;
+}
+
+// ***** Private methods *****
+
+void PageFile::computeLayout() {
+    mipOffsets = { 0 };
+
+    // Levels continue until one fits in a single page
+    uint32_t mip = 0;
+    do {
+        mipOffsets.push_back(mipOffsets.back() + getPagesX(mip) * getPagesY(mip));
+        mip++;
+    } while (getPagesX(mip - 1) > 1 || getPagesY(mip - 1) > 1);
+}
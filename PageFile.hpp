@@ -0,0 +1,157 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <algorithm>
+
+/**
+ * A very large texture split into fixed size pages, for virtual texturing.
+ * Each mip level is cut into PAGE_SIZE x PAGE_SIZE pages of RGBA8 texels,
+ * and pages on the right and bottom edges are padded out to the full size by
+ * repeating the edge texels. Mips go down until a level fits in one page.
+ *
+ * Every page has an id, its index in the file. Pages are ordered by mip level,
+ * and row by row within a level, so the id of a page and its location can be
+ * computed from one another. The ids are also how the shaders report pages in
+ * their feedback.
+ *
+ * The parent of a page is the page of the next coarser level that covers it.
+ * The texture_pack tool writes page files from images.
+ *
+ * File layout (all integers little endian):
+ *     Header      "VTEX", version, width, height, page size, mip count
+ *     Pages       PAGE_SIZE * PAGE_SIZE * 4 bytes for each page, by id
+ */
+class PageFile {
+public:
+    /** The width and height of a page in texels, which is also the standard
+     *  sparse block shape of 4 byte texels */
+    inline static const uint32_t PAGE_SIZE = 128;
+    /** The size of a page in bytes */
+    inline static const uint32_t PAGE_BYTES = PAGE_SIZE * PAGE_SIZE * 4;
+    /** The format of the texels */
+    inline static const vk::Format FORMAT = vk::Format::eR8G8B8A8Srgb;
+
+    /**
+     * Opens a page file, reading only the header
+     *
+     * @param path The path to the page file
+     *
+     * @throw std::runtime_error if the file is missing or isn't a page file
+     */
+    void open(const std::string& path);
+
+    /**
+     * Closes the file, if it is open
+     */
+    void close();
+
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+    uint32_t getMipCount() const { return (uint32_t)mipOffsets.size() - 1; }
+    uint32_t getPageCount() const { return mipOffsets.back(); }
+
+    /**
+     * @return The width of a mip level in texels
+     */
+    uint32_t getMipWidth(uint32_t mip) const { return std::max(1u, width >> mip); }
+
+    /**
+     * @return The height of a mip level in texels
+     */
+    uint32_t getMipHeight(uint32_t mip) const { return std::max(1u, height >> mip); }
+
+    /**
+     * @return The number of columns of pages in a mip level
+     */
+    uint32_t getPagesX(uint32_t mip) const { return (getMipWidth(mip) + PAGE_SIZE - 1) / PAGE_SIZE; }
+
+    /**
+     * @return The number of rows of pages in a mip level
+     */
+    uint32_t getPagesY(uint32_t mip) const { return (getMipHeight(mip) + PAGE_SIZE - 1) / PAGE_SIZE; }
+
+    /**
+     * @return The id of a page
+     */
+    uint32_t getPageId(uint32_t mip, uint32_t x, uint32_t y) const { return mipOffsets[mip] + y * getPagesX(mip) + x; }
+
+    /**
+     * Gets the location of a page
+     *
+     * @param id The id of the page
+     * @param mip Set to the mip level of the page
+     * @param x Set to the column of the page in its level
+     * @param y Set to the row of the page in its level
+     */
+    void getPageLocation(uint32_t id, uint32_t* mip, uint32_t* x, uint32_t* y) const;
+
+    /**
+     * @return The id of the parent of a page
+     *
+     * Requires: The page isn't in the last mip level
+     */
+    uint32_t getParent(uint32_t id) const;
+
+    /**
+     * Reads the texels of a page. Safe to call from several threads
+     *
+     * @param id The id of the page
+     * @param texels Set to the PAGE_BYTES bytes of the page
+     *
+     * @throw std::runtime_error if the page couldn't be read
+     */
+    void readPage(uint32_t id, uint8_t* texels);
+
+    /**
+     * Writes a page file
+     *
+     * @param path The file to write
+     * @param width The width of the texture
+     * @param height The height of the texture
+     * @param mips The RGBA8 texels of every mip level, as made by buildMips()
+     *
+     * @throw std::runtime_error if the file couldn't be written
+     */
+    static void write(const std::string& path, uint32_t width, uint32_t height,
+                      const std::vector<std::vector<uint8_t> >& mips);
+
+    /**
+     * Builds the mip levels of an image down to a level that fits in one
+     * page, averaging each 2x2 block of texels
+     *
+     * @param width The width of the image
+     * @param height The height of the image
+     * @param texels The RGBA8 texels of the image
+     *
+     * @return The texels of every mip level, starting with the image
+     */
+    static std::vector<std::vector<uint8_t> > buildMips(uint32_t width, uint32_t height, std::vector<uint8_t> texels);
+
+private:
+    /** The first bytes of a page file */
+    inline static const uint32_t MAGIC = 0x58455456; // "VTEX"
+    /** Increased whenever the format changes */
+    inline static const uint32_t VERSION = 1;
+
+    std::mutex mutex;
+    std::ifstream file;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /** The id of the first page of each mip level, followed by the page
+     *  count */
+    std::vector<uint32_t> mipOffsets = { 0 };
+    /** The byte offset of the first page */
+    std::streamoff pagesStart = 0;
+
+    /**
+     * Sets the mip offsets from the width and height
+     */
+    void computeLayout();
+};
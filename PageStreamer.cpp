@@ -0,0 +1,113 @@
+// October 18, 2026
+
+#include "PageStreamer.hpp"
+
+#include <iostream>
+
+// ***** Public methods *****
+
+void PageStreamer::start(PageFile* file, size_t maxLoadedPages) {
+    this->file = file;
+    this->maxLoadedPages = maxLoadedPages;
+    stopping = false;
+
+    worker = std::thread(&PageStreamer::run, this);
+}
+
+void PageStreamer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    queue.clear();
+    busy.clear();
+    loaded.clear();
+}
+
+void PageStreamer::request(const std::vector<uint32_t>& pages) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.clear();
+        for (uint32_t page : pages) {
+            if (busy.count(page) == 0) {
+                queue.push_back(page);
+            }
+        }
+    }
+    wake.notify_one();
+}
+
+bool PageStreamer::takeLoaded(LoadedPage* page) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (loaded.empty()) {
+            return false;
+        }
+
+        *page = std::move(loaded.front());
+        loaded.pop_front();
+        busy.erase(page->id);
+    }
+    // There is room for another page now
+    wake.notify_one();
+    return true;
+}
+
+void PageStreamer::recycle(std::vector<uint8_t>&& texels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    freeTexels.push_back(std::move(texels));
+}
+
+// ***** Private methods *****
+
+void PageStreamer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wake.wait(lock, [this]() {
+            return stopping || (!queue.empty() && loaded.size() < maxLoadedPages);
+        });
+        if (stopping) {
+            return;
+        }
+
+        uint32_t id = queue.front();
+        queue.pop_front();
+        busy.insert(id);
+
+        std::vector<uint8_t> texels;
+        if (freeTexels.empty()) {
+            texels.resize(PageFile::PAGE_BYTES);
+        } else {
+            texels = std::move(freeTexels.back());
+            freeTexels.pop_back();
+        }
+
+        // The disk is only read without the lock, so the frame can request
+        // and take pages meanwhile
+        lock.unlock();
+        bool success = true;
+        try {
+            file->readPage(id, texels.data());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            success = false;
+        }
+        lock.lock();
+
+        if (success) {
+            loaded.push_back({ id, std::move(texels) });
+        } else {
+            // It may be requested again, but a broken file shouldn't stop the
+            // other pages from streaming
+            busy.erase(id);
+            freeTexels.push_back(std::move(texels));
+        }
+    }
+}
@@ -0,0 +1,91 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "PageFile.hpp"
+
+/**
+ * Reads the pages of a page file on a background thread, so the frame never
+ * waits on the disk.
+ *
+ * The requested pages are replaced each frame with the latest feedback, in
+ * the order they should be read. Pages that were requested before but not any
+ * more are dropped without being read. Read pages wait in a bounded queue until
+ * they are taken, so the streamer never holds more than a fixed number of
+ * pages in memory, however far the uploads fall behind.
+ */
+class PageStreamer {
+public:
+    /** A page that has been read */
+    struct LoadedPage {
+        uint32_t id;
+        std::vector<uint8_t> texels;
+    };
+
+    /**
+     * Starts the background thread
+     *
+     * @param file The page file to read, which must outlive the streamer
+     * @param maxLoadedPages The most pages to hold that haven't been taken
+     */
+    void start(PageFile* file, size_t maxLoadedPages);
+
+    /**
+     * Stops the background thread. Should be called before this object leaves
+     * scope
+     */
+    void stop();
+
+    /**
+     * Replaces the requested pages. Pages that are being read or are waiting
+     * to be taken are skipped
+     *
+     * @param pages The ids of the pages to read, most important first
+     */
+    void request(const std::vector<uint32_t>& pages);
+
+    /**
+     * Takes a page that has been read, without waiting
+     *
+     * @param page Set to the page, whose texels can be given back with
+     *             recycle() once they've been used
+     *
+     * @return Whether a page was ready
+     */
+    bool takeLoaded(LoadedPage* page);
+
+    /**
+     * Gives back the texels of a taken page, so their memory is reused
+     */
+    void recycle(std::vector<uint8_t>&& texels);
+
+private:
+    PageFile* file = nullptr;
+    size_t maxLoadedPages = 0;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    /** The pages to read, in order */
+    std::deque<uint32_t> queue;
+    /** The pages being read or waiting to be taken */
+    std::unordered_set<uint32_t> busy;
+    /** The pages read, in the order they were read */
+    std::deque<LoadedPage> loaded;
+    /** Texel buffers to reuse */
+    std::vector<std::vector<uint8_t> > freeTexels;
+
+    /**
+     * The loop run by the worker thread
+     */
+    void run();
+};
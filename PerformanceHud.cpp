@@ -0,0 +1,341 @@
+// October 18, 2026
+
+#include "PerformanceHud.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+// RGBA8, with red in the lowest byte as unpackUnorm4x8() reads it
+static const uint32_t PANEL_COLOR = 0xff181818;
+static const uint32_t TEXT_COLOR = 0xffe0e0e0;
+static const uint32_t MARK_COLOR = 0xff808080;
+static const uint32_t FAST_COLOR = 0xff40c040;
+static const uint32_t SLOW_COLOR = 0xff40c0e0;
+static const uint32_t HITCH_COLOR = 0xff4040e0;
+
+// The layout of the overlay, in pixels
+static const float MARGIN = 8.f;
+static const float PADDING = 6.f;
+static const float GRAPH_HEIGHT = 60.f;
+
+// Milliseconds since a time
+static float millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ***** Public methods *****
+
+void PerformanceHud::initialize(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t queueFamilyIndex,
+                                MemoryAllocator* allocator, LayoutCache* layoutCache, uint32_t frameCount) {
+    this->device = device;
+    this->allocator = allocator;
+    this->frameCount = frameCount;
+
+    uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    timestampsSupported = validBits > 0;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+    timestampsPending.assign(frameCount, false);
+    if (timestampsSupported) {
+        vk::QueryPoolCreateInfo queryInfo{};
+        queryInfo.queryType = vk::QueryType::eTimestamp;
+        queryInfo.queryCount = (GPU_STAGE_COUNT + 1) * frameCount;
+        queryPool = device.createQueryPool(queryInfo);
+    }
+
+    // Rewritten every frame, so host visible rather than staged, and cached
+    // since the CPU only writes them
+    quadBuffers.resize(frameCount);
+    quadAllocations.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.size = MAX_QUADS * sizeof(Quad);
+        bufferInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        quadBuffers[i] = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible,
+                                                 vk::MemoryPropertyFlagBits::eHostCached, &quadAllocations[i]);
+    }
+
+    // The same binding the shader's reflection gives
+    vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eStorageBuffer, 1,
+                                           vk::ShaderStageFlagBits::eVertex);
+    vk::DescriptorSetLayout setLayout = layoutCache->getDescriptorSetLayout({ binding });
+
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, frameCount);
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = frameCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    descriptorPool = device.createDescriptorPool(poolInfo);
+
+    std::vector<vk::DescriptorSetLayout> setLayouts(frameCount, setLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.descriptorPool = descriptorPool;
+    allocateInfo.descriptorSetCount = frameCount;
+    allocateInfo.pSetLayouts = setLayouts.data();
+    descriptorSets = device.allocateDescriptorSets(allocateInfo);
+
+    for (uint32_t i = 0; i < frameCount; i++) {
+        vk::DescriptorBufferInfo bufferInfo(quadBuffers[i], 0, VK_WHOLE_SIZE);
+        vk::WriteDescriptorSet write(descriptorSets[i], 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr,
+                                     &bufferInfo);
+        device.updateDescriptorSets(write, nullptr);
+    }
+
+    frameTimes.assign(HISTORY_LENGTH, 0.f);
+    textQuads.reserve(MAX_QUADS);
+}
+
+void PerformanceHud::destroy() {
+    device.destroyDescriptorPool(descriptorPool);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        allocator->destroyBuffer(quadBuffers[i], quadAllocations[i]);
+    }
+    dirtyRanges.clear();
+    if (timestampsSupported) {
+        device.destroyQueryPool(queryPool);
+    }
+}
+
+PipelineKey PerformanceHud::getPipelineKey() const {
+    PipelineKey key;
+    key.vertexShader = ShaderVariant{ VERT_SOURCE_PATH, VERT_PATH, {} };
+    key.fragmentShader = ShaderVariant{ FRAG_SOURCE_PATH, FRAG_PATH, {} };
+    key.cullMode = vk::CullModeFlagBits::eNone;
+    return key;
+}
+
+void PerformanceHud::beginFrame(vk::CommandBuffer commandBuffer, uint32_t frame) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (started) {
+        float frameTime = std::chrono::duration<float, std::milli>(now - lastFrameStart).count();
+        frameTimes[historyStart] = frameTime;
+        historyStart = (historyStart + 1) % HISTORY_LENGTH;
+        frameTimeSum += frameTime;
+        textAge += frameTime / 1000.f;
+        cpuSamples++;
+    }
+    lastFrameStart = now;
+    started = true;
+
+    lastDraws = draws;
+    lastPipelineBinds = pipelineBinds;
+    draws = 0;
+    pipelineBinds = 0;
+
+    if (timestampsPending[frame]) {
+        readTimestamps(frame);
+    }
+    if (timestampsSupported) {
+        uint32_t first = frame * (GPU_STAGE_COUNT + 1);
+        commandBuffer.resetQueryPool(queryPool, first, GPU_STAGE_COUNT + 1);
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, first);
+    }
+}
+
+void PerformanceHud::markGpuStage(vk::CommandBuffer commandBuffer, uint32_t frame, uint32_t stage) {
+    if (timestampsSupported) {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool,
+                                     frame * (GPU_STAGE_COUNT + 1) + stage + 1);
+    }
+}
+
+void PerformanceHud::addCpuTime(uint32_t stage, std::chrono::steady_clock::time_point start) {
+    cpuSums[stage] += millisecondsSince(start);
+}
+
+void PerformanceHud::count(uint32_t draws, uint32_t pipelineBinds) {
+    this->draws += draws;
+    this->pipelineBinds += pipelineBinds;
+}
+
+void PerformanceHud::draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout, uint32_t frame,
+                          vk::Extent2D extent) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (visible) {
+        if (textAge >= TEXT_INTERVAL_SECONDS) {
+            updateText();
+            textAge = 0.f;
+        }
+
+        Quad* quads = static_cast<Quad*>(quadAllocations[frame].mapped);
+        uint32_t quadCount = 0;
+        auto addQuad = [&](float left, float top, float right, float bottom, uint32_t color) {
+            if (quadCount < MAX_QUADS) {
+                quads[quadCount++] = Quad{ { left, top, right, bottom }, color, SOLID, {} };
+            }
+        };
+
+        // Quads are drawn in order without depth, so later ones cover the
+        // panel behind them
+        float graphTop = MARGIN + PADDING + textHeight + PADDING;
+        float graphBottom = graphTop + GRAPH_HEIGHT;
+        float width = std::max((float)HISTORY_LENGTH, textWidth);
+        addQuad(MARGIN, MARGIN, MARGIN + 2.f * PADDING + width, graphBottom + PADDING, PANEL_COLOR);
+
+        // Each bar is the slowest of its frames, so hitches aren't averaged
+        // away at less detail
+        float left = MARGIN + PADDING;
+        for (uint32_t i = 0; i + graphStep <= HISTORY_LENGTH; i += graphStep) {
+            float frameTime = 0.f;
+            for (uint32_t j = 0; j < graphStep; j++) {
+                frameTime = std::max(frameTime, frameTimes[(historyStart + i + j) % HISTORY_LENGTH]);
+            }
+            float height = std::min(frameTime / GRAPH_MAX_MS, 1.f) * GRAPH_HEIGHT;
+            uint32_t color = frameTime <= GRAPH_TARGET_MS ? FAST_COLOR
+                : frameTime <= 2.f * GRAPH_TARGET_MS ? SLOW_COLOR : HITCH_COLOR;
+            addQuad(left + i, graphBottom - height, left + i + graphStep, graphBottom, color);
+        }
+        float targetY = graphBottom - GRAPH_TARGET_MS / GRAPH_MAX_MS * GRAPH_HEIGHT;
+        addQuad(left, targetY, left + HISTORY_LENGTH, targetY + 1.f, MARK_COLOR);
+
+        uint32_t textCount = std::min((uint32_t)textQuads.size(), MAX_QUADS - quadCount);
+        std::copy(textQuads.begin(), textQuads.begin() + textCount, quads + quadCount);
+        quadCount += textCount;
+
+        allocator->addFlushRange(quadAllocations[frame], 0, quadCount * sizeof(Quad), &dirtyRanges);
+
+        float screenSize[2] = { (float)extent.width, (float)extent.height };
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, descriptorSets[frame], nullptr);
+        commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(screenSize), screenSize);
+        // Six vertices for each quad, made by the vertex shader
+        commandBuffer.draw(quadCount * 6, 1, 0, 0);
+    }
+
+    if (timestampsSupported) {
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool,
+                                     frame * (GPU_STAGE_COUNT + 1) + GPU_HUD + 1);
+        timestampsPending[frame] = true;
+    }
+    hudCpuSum += millisecondsSince(start);
+}
+
+void PerformanceHud::collectFlushRanges(std::vector<vk::MappedMemoryRange>* ranges) {
+    ranges->insert(ranges->end(), dirtyRanges.begin(), dirtyRanges.end());
+    dirtyRanges.clear();
+}
+
+// ***** Private methods *****
+
+void PerformanceHud::readTimestamps(uint32_t frame) {
+    timestampsPending[frame] = false;
+
+    uint64_t timestamps[GPU_STAGE_COUNT + 1];
+    VkResult result = vkGetQueryPoolResults(static_cast<VkDevice>(device), static_cast<VkQueryPool>(queryPool),
+                                            frame * (GPU_STAGE_COUNT + 1), GPU_STAGE_COUNT + 1, sizeof(timestamps),
+                                            timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+    for (uint32_t stage = 0; stage < GPU_STAGE_COUNT; stage++) {
+        uint64_t ticks = (timestamps[stage + 1] - timestamps[stage]) & timestampMask;
+        gpuSums[stage] += (float)(ticks * timestampPeriod / 1e6);
+    }
+    uint64_t frameTicks = (timestamps[GPU_STAGE_COUNT] - timestamps[0]) & timestampMask;
+    gpuFrameTime = (float)(frameTicks * timestampPeriod / 1e6);
+    gpuSamples++;
+}
+
+void PerformanceHud::updateText() {
+    if (cpuSamples > 0) {
+        frameTimeAverage = frameTimeSum / cpuSamples;
+        hudCpuAverage = hudCpuSum / cpuSamples;
+        for (uint32_t stage = 0; stage < CPU_STAGE_COUNT; stage++) {
+            cpuAverages[stage] = cpuSums[stage] / cpuSamples;
+            cpuSums[stage] = 0.f;
+        }
+    }
+    if (gpuSamples > 0) {
+        for (uint32_t stage = 0; stage < GPU_STAGE_COUNT; stage++) {
+            gpuAverages[stage] = gpuSums[stage] / gpuSamples;
+            gpuSums[stage] = 0.f;
+        }
+    }
+    frameTimeSum = 0.f;
+    hudCpuSum = 0.f;
+    cpuSamples = 0;
+    gpuSamples = 0;
+
+    // Fewer bars while over budget, and more again once well under it
+    float cost = hudCpuAverage + gpuAverages[GPU_HUD];
+    if (cost > BUDGET_MS && graphStep < MAX_GRAPH_STEP) {
+        graphStep *= 2;
+    } else if (cost < BUDGET_MS / 2.f && graphStep > 1) {
+        graphStep /= 2;
+    }
+
+    char lines[6][80];
+    int lineCount = 0;
+    std::snprintf(lines[lineCount++], sizeof(lines[0]), "FRAME %.2f MS  %.0f FPS", frameTimeAverage,
+                  frameTimeAverage > 0.f ? 1000.f / frameTimeAverage : 0.f);
+    std::snprintf(lines[lineCount++], sizeof(lines[0]), "CPU WAIT %.2f  RECORD %.2f  SUBMIT %.2f",
+                  cpuAverages[CPU_WAIT], cpuAverages[CPU_RECORD], cpuAverages[CPU_SUBMIT]);
+    if (timestampsSupported) {
+        std::snprintf(lines[lineCount++], sizeof(lines[0]), "GPU EARLY %.2f  CULL %.2f  LATE %.2f",
+                      gpuAverages[GPU_EARLY], gpuAverages[GPU_CULL], gpuAverages[GPU_LATE]);
+    } else {
+        std::snprintf(lines[lineCount++], sizeof(lines[0]), "GPU NO TIMESTAMPS");
+    }
+    std::snprintf(lines[lineCount++], sizeof(lines[0]), "MEMORY %.1f OF %.1f MB",
+                  allocator->getUsedBytes() / (1024.0 * 1024.0), allocator->getAllocatedBytes() / (1024.0 * 1024.0));
+    std::snprintf(lines[lineCount++], sizeof(lines[0]), "DRAWS %u  PIPELINES %u", lastDraws, lastPipelineBinds);
+    std::snprintf(lines[lineCount++], sizeof(lines[0]), "HUD CPU %.2f  GPU %.2f%s", hudCpuAverage,
+                  gpuAverages[GPU_HUD], graphStep > 1 ? "  OVER BUDGET" : "");
+
+    textQuads.clear();
+    textWidth = 0.f;
+    // Two blank rows of font pixels between lines
+    float lineHeight = 7.f * FONT_SCALE;
+    textHeight = lineCount * lineHeight;
+    for (int i = 0; i < lineCount; i++) {
+        addText(&textQuads, MARGIN + PADDING, MARGIN + PADDING + i * lineHeight, lines[i], TEXT_COLOR);
+        textWidth = std::max(textWidth, std::strlen(lines[i]) * 4.f * FONT_SCALE);
+    }
+}
+
+void PerformanceHud::addText(std::vector<Quad>* quads, float x, float y, const char* text, uint32_t color) const {
+    // Glyphs are 3 pixels wide with a pixel between them
+    for (const char* character = text; *character != '\0'; character++, x += 4.f * FONT_SCALE) {
+        uint32_t glyph = getGlyph(*character);
+        if (glyph != 0) {
+            quads->push_back(Quad{ { x, y, x + 3.f * FONT_SCALE, y + 5.f * FONT_SCALE }, color, glyph, {} });
+        }
+    }
+}
+
+// ***** Static methods *****
+
+uint32_t PerformanceHud::getGlyph(char character) {
+    // Each row of 3 bits is a row of the glyph, from the top
+    static const struct {
+        char character;
+        uint32_t glyph;
+    } FONT[] = {
+        { '0', 0b111'101'101'101'111 }, { '1', 0b010'110'010'010'111 }, { '2', 0b111'001'111'100'111 },
+        { '3', 0b111'001'111'001'111 }, { '4', 0b101'101'111'001'001 }, { '5', 0b111'100'111'001'111 },
+        { '6', 0b111'100'111'101'111 }, { '7', 0b111'001'001'001'001 }, { '8', 0b111'101'111'101'111 },
+        { '9', 0b111'101'111'001'111 }, { 'A', 0b010'101'111'101'101 }, { 'B', 0b110'101'110'101'110 },
+        { 'C', 0b011'100'100'100'011 }, { 'D', 0b110'101'101'101'110 }, { 'E', 0b111'100'110'100'111 },
+        { 'F', 0b111'100'110'100'100 }, { 'G', 0b011'100'101'101'011 }, { 'H', 0b101'101'111'101'101 },
+        { 'I', 0b111'010'010'010'111 }, { 'J', 0b001'001'001'101'010 }, { 'K', 0b101'101'110'101'101 },
+        { 'L', 0b100'100'100'100'111 }, { 'M', 0b101'111'111'101'101 }, { 'N', 0b110'101'101'101'101 },
+        { 'O', 0b010'101'101'101'010 }, { 'P', 0b110'101'110'100'100 }, { 'Q', 0b010'101'101'110'011 },
+        { 'R', 0b110'101'110'101'101 }, { 'S', 0b011'100'010'001'110 }, { 'T', 0b111'010'010'010'010 },
+        { 'U', 0b101'101'101'101'111 }, { 'V', 0b101'101'101'101'010 }, { 'W', 0b101'101'111'111'101 },
+        { 'X', 0b101'101'010'101'101 }, { 'Y', 0b101'101'010'010'010 }, { 'Z', 0b111'001'010'100'111 },
+        { '.', 0b000'000'000'000'010 }, { ':', 0b000'010'000'010'000 }, { '/', 0b001'001'010'100'100 },
+        { '%', 0b101'001'010'100'101 }, { '-', 0b000'000'111'000'000 }, { '(', 0b001'010'010'010'001 },
+        { ')', 0b100'010'010'010'100 },
+    };
+
+    char upper = (char)std::toupper((unsigned char)character);
+    for (const auto& entry : FONT) {
+        if (entry.character == upper) {
+            return entry.glyph;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,263 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "MemoryAllocator.hpp"
+#include "PipelineLibrary.hpp"
+#include "LayoutCache.hpp"
+
+/**
+ * An overlay of the app's performance, drawn over the end of each frame: a
+ * graph of recent frame times, the time of each CPU and GPU stage, the device
+ * memory in use, and the draws and pipeline binds recorded.
+ *
+ * Everything on it is a quad, either solid or a glyph of a 3x5 pixel font,
+ * and every quad is drawn by one draw call from a host visible buffer, so the
+ * overlay needs no vertex buffers, textures or blending.
+ *
+ * The GPU stages are timed with timestamps the app writes between its
+ * passes. The overlay times itself too, on both the CPU and GPU, and draws
+ * its graph at less detail while it costs more than BUDGET_MS.
+ */
+class PerformanceHud {
+public:
+    /** The stages of a frame on the CPU, timed by the app */
+    inline static const uint32_t CPU_WAIT = 0;
+    inline static const uint32_t CPU_RECORD = 1;
+    inline static const uint32_t CPU_SUBMIT = 2;
+    inline static const uint32_t CPU_STAGE_COUNT = 3;
+
+    /** The stages of a frame on the GPU, each ended by markGpuStage() except
+     *  GPU_HUD, which draw() ends */
+    inline static const uint32_t GPU_EARLY = 0;
+    inline static const uint32_t GPU_CULL = 1;
+    inline static const uint32_t GPU_LATE = 2;
+    inline static const uint32_t GPU_HUD = 3;
+    inline static const uint32_t GPU_STAGE_COUNT = 4;
+
+    /** The most the overlay should cost a frame, on the CPU and GPU together */
+    inline static const float BUDGET_MS = 0.5f;
+
+    /**
+     * Creates the query pool and the buffers of the quads
+     *
+     * @param physicalDevice The physical device, for its timestamp support
+     * @param device The logical device
+     * @param queueFamilyIndex The family of the queue the frames are drawn on
+     * @param allocator Allocates the memory of the buffers
+     * @param layoutCache Gives the descriptor set layout
+     * @param frameCount The number of frames that can be in flight at once
+     */
+    void initialize(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t queueFamilyIndex,
+                    MemoryAllocator* allocator, LayoutCache* layoutCache, uint32_t frameCount);
+
+    /**
+     * Destroys the query pool, buffers and descriptor sets
+     *
+     * Requires: No frame using the overlay is still in use
+     */
+    void destroy();
+
+    /**
+     * Shows the overlay if it is hidden, or hides it. It is hidden at first.
+     * The stages are timed either way, so the numbers are ready once shown
+     */
+    void toggle() { visible = !visible; }
+
+    /**
+     * @return The shaders and state of the pipeline that draws the overlay
+     */
+    PipelineKey getPipelineKey() const;
+
+    /**
+     * @return The GLSL sources of the shaders, for the shader watcher
+     */
+    static std::vector<std::string> getShaderSources() { return { VERT_SOURCE_PATH, FRAG_SOURCE_PATH }; }
+
+    /**
+     * Reads the GPU times of the last frame that used this frame's slot, and
+     * starts timing this frame. Must be recorded outside a render pass, before
+     * anything else in the frame
+     *
+     * Requires: The last frame that used the slot has completed
+     *
+     * @param commandBuffer The command buffer of the frame
+     * @param frame The index of the frame in flight
+     */
+    void beginFrame(vk::CommandBuffer commandBuffer, uint32_t frame);
+
+    /**
+     * Ends a GPU stage once the commands recorded before it are done
+     *
+     * @param commandBuffer The command buffer of the frame
+     * @param frame The index of the frame in flight
+     * @param stage The stage to end, before GPU_HUD
+     */
+    void markGpuStage(vk::CommandBuffer commandBuffer, uint32_t frame, uint32_t stage);
+
+    /**
+     * Adds the time a CPU stage took this frame
+     *
+     * @param stage The stage
+     * @param start When it started
+     */
+    void addCpuTime(uint32_t stage, std::chrono::steady_clock::time_point start);
+
+    /**
+     * Counts the draw calls and pipeline binds recorded this frame
+     */
+    void count(uint32_t draws, uint32_t pipelineBinds);
+
+    /**
+     * Draws the overlay if it is shown, and ends GPU_HUD
+     *
+     * Requires: The pipeline of getPipelineKey() is bound, if the overlay is
+     *           shown
+     *
+     * @param commandBuffer The command buffer, in a render pass
+     * @param layout The layout of the pipeline
+     * @param frame The index of the frame in flight
+     * @param extent The size of the framebuffer
+     */
+    void draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout, uint32_t frame, vk::Extent2D extent);
+
+    /**
+     * Adds the quads written by draw() to a batch for
+     * MemoryAllocator::flush(), which must be flushed before the frame is
+     * submitted
+     *
+     * @param ranges The batch
+     */
+    void collectFlushRanges(std::vector<vk::MappedMemoryRange>* ranges);
+
+    /**
+     * @return Whether the overlay is shown, so its pipeline needs binding
+     */
+    bool isVisible() const { return visible; }
+
+    /**
+     * @return The milliseconds the GPU took for the last frame it timed, or 0
+     *         without timestamps
+     */
+    float getGpuFrameTime() const { return gpuFrameTime; }
+
+private:
+    /** The paths to the shaders */
+    inline static const std::string VERT_SOURCE_PATH = "shaders/hud.vert";
+    inline static const std::string VERT_PATH = "shaders/hud_vert.spv";
+    inline static const std::string FRAG_SOURCE_PATH = "shaders/hud.frag";
+    inline static const std::string FRAG_PATH = "shaders/hud_frag.spv";
+    /** The most quads drawn in a frame */
+    inline static const uint32_t MAX_QUADS = 2048;
+    /** The frames of history in the graph */
+    inline static const uint32_t HISTORY_LENGTH = 240;
+    /** How often the numbers are updated, so they can be read */
+    inline static const float TEXT_INTERVAL_SECONDS = 0.25f;
+    /** The frame time at the top of the graph, and the one it marks */
+    inline static const float GRAPH_MAX_MS = 50.f;
+    inline static const float GRAPH_TARGET_MS = 1000.f / 60.f;
+    /** The size in pixels of a pixel of the font */
+    inline static const float FONT_SCALE = 2.f;
+    /** The most frames of history each bar of the graph covers */
+    inline static const uint32_t MAX_GRAPH_STEP = 8;
+    /** The glyph of a solid quad, every pixel of the 3x5 font */
+    inline static const uint32_t SOLID = 0x7fff;
+
+    /** A quad, as read by the shaders */
+    struct Quad {
+        /** The corners in pixels, from the top left */
+        float rect[4];
+        /** RGBA8 */
+        uint32_t color;
+        /** The font pixels that are drawn, from the top left, the highest
+         *  bit first */
+        uint32_t glyph;
+        uint32_t padding[2];
+    };
+
+    vk::Device device;
+    MemoryAllocator* allocator = nullptr;
+    uint32_t frameCount = 0;
+    bool visible = false;
+
+    vk::QueryPool queryPool;
+    bool timestampsSupported = false;
+    /** The bits of a timestamp that count, so wrapping can be handled */
+    uint64_t timestampMask = 0;
+    /** Nanoseconds per tick */
+    double timestampPeriod = 1.0;
+    /** Whether each frame in flight has timestamps to read */
+    std::vector<bool> timestampsPending;
+
+    /** The quads of each frame in flight, which stay mapped */
+    std::vector<vk::Buffer> quadBuffers;
+    std::vector<Allocation> quadAllocations;
+    /** The quads written but not yet flushed. Empty for host coherent
+     *  memory */
+    std::vector<vk::MappedMemoryRange> dirtyRanges;
+    vk::DescriptorPool descriptorPool;
+    std::vector<vk::DescriptorSet> descriptorSets;
+
+    /** The frame times of the graph, oldest first from historyStart */
+    std::vector<float> frameTimes;
+    uint32_t historyStart = 0;
+    std::chrono::steady_clock::time_point lastFrameStart;
+    bool started = false;
+
+    /** The stage times summed since the numbers were last updated, and the
+     *  averages shown */
+    float cpuSums[CPU_STAGE_COUNT] = {};
+    float gpuSums[GPU_STAGE_COUNT] = {};
+    float hudCpuSum = 0.f;
+    float frameTimeSum = 0.f;
+    uint32_t cpuSamples = 0;
+    uint32_t gpuSamples = 0;
+    float cpuAverages[CPU_STAGE_COUNT] = {};
+    float gpuAverages[GPU_STAGE_COUNT] = {};
+    float hudCpuAverage = 0.f;
+    float frameTimeAverage = 0.f;
+    float gpuFrameTime = 0.f;
+    /** The counts of the frame being recorded, and of the last one */
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t lastDraws = 0;
+    uint32_t lastPipelineBinds = 0;
+    float textAge = TEXT_INTERVAL_SECONDS;
+    /** The quads of the numbers, rebuilt each TEXT_INTERVAL_SECONDS */
+    std::vector<Quad> textQuads;
+    /** The size of the text, in pixels */
+    float textWidth = 0.f;
+    float textHeight = 0.f;
+    /** The frames of history each bar of the graph covers, raised while the
+     *  overlay is over budget */
+    uint32_t graphStep = 1;
+
+    /**
+     * Reads the timestamps the last use of a frame's slot wrote
+     */
+    void readTimestamps(uint32_t frame);
+
+    /**
+     * Averages the sums into the numbers shown, and rebuilds their quads
+     */
+    void updateText();
+
+    /**
+     * Adds the quads of a line of text. Characters outside the font are blank
+     *
+     * @param x The left of the text, in pixels
+     * @param y The top of the text, in pixels
+     */
+    void addText(std::vector<Quad>* quads, float x, float y, const char* text, uint32_t color) const;
+
+    /**
+     * @return The 3x5 glyph of a character, or 0 if the font doesn't have it
+     */
+    static uint32_t getGlyph(char character);
+};
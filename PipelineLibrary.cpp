@@ -0,0 +1,951 @@
+// October 18, 2026
+
+#include "PipelineLibrary.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+
+// Appends the bytes of a value to a key
+template <typename T>
+static void appendKey(std::string* key, const T& value) {
+    key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Appends a string to a key, prefixed by its length so keys stay unambiguous
+static void appendKey(std::string* key, const std::string& string) {
+    appendKey(key, (uint64_t)string.size());
+    key->append(string);
+}
+
+static void appendKey(std::string* key, const ShaderVariant& variant) {
+    appendKey(key, variant.sourcePath);
+    appendKey(key, variant.spirvPath);
+    for (const auto& define : variant.defines) {
+        appendKey(key, define.first);
+        appendKey(key, define.second);
+    }
+    appendKey(key, (uint64_t)variant.defines.size());
+}
+
+// FNV-1a of SPIR-V code, so libraries can be keyed by their shaders without
+// copying the code into the key
+static uint64_t hashCode(const std::vector<uint32_t>& code) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(code.data());
+    for (size_t i = 0; i < code.size() * sizeof(uint32_t); i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+namespace {
+
+/**
+ * The fixed function state of a pipeline. The create infos point at each
+ * other, so this can't be copied
+ */
+struct FixedState {
+    vk::VertexInputBindingDescription vertexBinding{};
+    std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
+    vk::PipelineViewportStateCreateInfo viewportStateInfo{};
+    vk::PipelineRasterizationStateCreateInfo rasterizationStateInfo{};
+    vk::PipelineMultisampleStateCreateInfo multisamplingInfo{};
+    vk::PipelineDepthStencilStateCreateInfo depthStencilInfo{};
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+    vk::PipelineColorBlendStateCreateInfo colorBlendInfo{};
+    std::vector<vk::DynamicState> dynamicStates;
+    vk::PipelineDynamicStateCreateInfo dynamicStateInfo{};
+
+    FixedState(const PipelineKey& key, const ShaderReflection& reflection,
+               const std::vector<vk::DynamicState>& extendedDynamicStates);
+    FixedState(const FixedState&) = delete;
+    FixedState& operator=(const FixedState&) = delete;
+};
+
+FixedState::FixedState(const PipelineKey& key, const ShaderReflection& reflection,
+                       const std::vector<vk::DynamicState>& extendedDynamicStates) {
+    // Set up Vertex Input State
+
+    // The vertex inputs come from the vertex shader's reflection, interleaved
+    // in one buffer. If there are none, the points are defined in the shader,
+    // as they always are with mesh shaders
+    bool hasVertexInputs = reflection.getVertexInputState(&vertexBinding, &vertexAttributes);
+
+    // Specifies spacing between data (and whether per vertex or per instance)
+    vertexInputInfo.vertexBindingDescriptionCount = hasVertexInputs ? 1 : 0;
+    vertexInputInfo.pVertexBindingDescriptions = hasVertexInputs ? &vertexBinding : nullptr;
+    // Types of data, which binding, and offset for each attribute
+    vertexInputInfo.vertexAttributeDescriptionCount = (uint32_t)vertexAttributes.size();
+    vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+
+    // Set up Input Assembler State
+
+    // Describes the kind of geometry and whether to use primitive restart
+    // ePointList draws points from vertices
+    // eLineList draws lines from every 2 vertices (without reusing them)
+    // eLineStrip draws linesbetween each pair of vertices (with reusing them)
+    // eTriangleList draws triangles without reuse
+    // eTriangleStrip draws triangles with 2nd, 3rd verts as 1st, 2nd of next
+    inputAssemblyInfo.topology = key.topology;
+    // Primitive restart is for strip modes, allows to restart the strip
+    inputAssemblyInfo.primitiveRestartEnable = key.primitiveRestartEnable;
+
+    // Set up Viewport and Scissor
+
+    // The viewport (the region that is drawn to) and the scissor (the region
+    // of the image that is used) are both dynamic state, set when recording
+    // the command buffer. That way the pipeline doesn't depend on the window
+    // size, and can be rebuilt on another thread while the window is resized
+    viewportStateInfo.viewportCount = 1;
+    viewportStateInfo.pViewports = nullptr;
+    viewportStateInfo.scissorCount = 1;
+    viewportStateInfo.pScissors = nullptr;
+
+    // Set up Rasterizer
+
+    // Rasterizer turns vertices into fragments
+    // Whether to crop fragments that are beyond near/far frames or clamp to
+    // edges. Useful for shadowmapping, but requires enabling a GPU feature
+    rasterizationStateInfo.depthClampEnable = VK_FALSE;
+    // If true, rasterizer stage discards geometry that would go to framebuffer
+    rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
+    // How polygons are drawn, fill (eFill), lines (eLine), or points (ePoint)
+    // Modes other than fill require enabling a GPU feature
+    rasterizationStateInfo.polygonMode = vk::PolygonMode::eFill;
+    // How thick to draw lines. Wider than 1.f requires enabling GPU feature
+    // "wideLines", and the max width depends on hardware
+    rasterizationStateInfo.lineWidth = 1.f;
+    // Which faces to cull (eNone, eFront, eBack, eFrontAndBack)
+    rasterizationStateInfo.cullMode = key.cullMode;
+    // Specifies the order for front facing sides
+    rasterizationStateInfo.frontFace = key.frontFace;
+    // For altering the depth with constant or based on slope. Not wanted here
+    rasterizationStateInfo.depthBiasEnable = VK_FALSE;
+    rasterizationStateInfo.depthBiasConstantFactor = 0.f; // Optional
+    rasterizationStateInfo.depthBiasClamp = 0.f; // Optional
+    rasterizationStateInfo.depthBiasSlopeFactor = 0.f; // Optional
+
+    // Set up Multisampling
+
+    // Multisampling combines the results of multiple fragments that render to
+    // the same pixel, and allows for anti-aliasing. Requires enabling GPU a
+    // GPU feature
+    // For now, disabled
+    multisamplingInfo.sampleShadingEnable = VK_FALSE;
+    multisamplingInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
+    multisamplingInfo.minSampleShading = 1.f; // Optional
+    multisamplingInfo.pSampleMask = nullptr; // Optional
+    multisamplingInfo.alphaToCoverageEnable = VK_FALSE; // Optional
+    multisamplingInfo.alphaToOneEnable = VK_FALSE; // Optional
+
+    // Set up Depth and Stencil testing
+
+    // Ignored if the render pass has no depth attachment
+    depthStencilInfo.depthTestEnable = key.depthTestEnable;
+    depthStencilInfo.depthWriteEnable = key.depthWriteEnable;
+    depthStencilInfo.depthCompareOp = vk::CompareOp::eLess;
+    depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
+    depthStencilInfo.stencilTestEnable = VK_FALSE;
+
+    // Set up Color Blending
+
+    // Defines color blending for this framebuffer specifically
+    colorBlendAttachment.colorWriteMask =
+        vk::ColorComponentFlagBits::eR |
+        vk::ColorComponentFlagBits::eG |
+        vk::ColorComponentFlagBits::eB |
+        vk::ColorComponentFlagBits::eA;
+    // No need for blending specific to this framebuffer, so pass in fragment
+    // unmodified
+    colorBlendAttachment.blendEnable = VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eOne; // Optional
+    colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eZero; // Optional
+    colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd; // Optional
+    colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne; // Optional
+    colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero; // Optional
+    colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd; // Optional
+
+    // For alpha blending:
+    // colorBlendAttachment.blendEnable = VK_TRUE;
+    // colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha; // Optional
+    // colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha; // Optional
+    // colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd; // Optional
+    // colorBlendAttachment.stcAlphaBlendFactor = vk::BlendFactor::eOne; // Optional
+    // colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero; // Optional
+    // colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd; // Optional
+
+    // Sets up color blending for all framebuffers
+    // Setting this to true disables attachment specific blending (as if each
+    // was VK_FALSE)
+    colorBlendInfo.logicOpEnable = VK_FALSE;
+    colorBlendInfo.logicOp = vk::LogicOp::eCopy; // Optional
+    colorBlendInfo.attachmentCount = 1;
+    colorBlendInfo.pAttachments = &colorBlendAttachment;
+    colorBlendInfo.blendConstants[0] = 0.f; // Optional
+    colorBlendInfo.blendConstants[1] = 0.f; // Optional
+    colorBlendInfo.blendConstants[2] = 0.f; // Optional
+    colorBlendInfo.blendConstants[3] = 0.f; // Optional
+
+    // Set up Dynamic State
+
+    // Dynamic state allows for changing a handful of aspects of the pipeline
+    // dynamically (ex: viewport size, line width, blend constants). This tells
+    // Vulkan to ignore the configured state, and it must be specified
+    // dynamically instead
+    dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor,
+    };
+    // The state from the key that is dynamic on this device, which the key
+    // holds defaults for. Mesh shader pipelines have no input assembly, so
+    // can't have its state dynamic
+    for (vk::DynamicState state : extendedDynamicStates) {
+        bool isInputAssembly = state == vk::DynamicState::ePrimitiveTopologyEXT ||
+                               state == vk::DynamicState::ePrimitiveRestartEnableEXT;
+        if (!key.usesMeshShader() || !isInputAssembly) {
+            dynamicStates.push_back(state);
+        }
+    }
+    dynamicStateInfo.dynamicStateCount = (uint32_t)dynamicStates.size();
+    dynamicStateInfo.pDynamicStates = dynamicStates.data();
+}
+
+} // namespace
+
+// ***** PipelineKey *****
+
+std::string PipelineKey::serialize() const {
+    std::string key;
+    appendKey(&key, vertexShader);
+    appendKey(&key, fragmentShader);
+    appendKey(&key, taskShader);
+    appendKey(&key, meshShader);
+    appendKey(&key, static_cast<VkPrimitiveTopology>(topology));
+    appendKey(&key, primitiveRestartEnable);
+    appendKey(&key, static_cast<VkCullModeFlags>(cullMode));
+    appendKey(&key, static_cast<VkFrontFace>(frontFace));
+    appendKey(&key, depthTestEnable);
+    appendKey(&key, depthWriteEnable);
+    return key;
+}
+
+// ***** Public methods *****
+
+void PipelineLibrary::initialize(vk::Device device, const DeviceFeatures& features, LayoutCache* layoutCache,
+                                 ShaderLoader shaderLoader, RetireCallback retireCallback,
+                                 const std::string& cachePath) {
+    this->device = device;
+#ifdef VK_EXT_graphics_pipeline_library
+    // Without fast linking, a link can take as long as compiling a whole
+    // pipeline, so there's nothing to gain
+    useLibraries = features.graphicsPipelineLibrary && features.graphicsPipelineLibraryFastLinking;
+#endif
+
+    // The features are only enabled if the headers know about them
+    dynamicRasterization = features.extendedDynamicState;
+    dynamicPrimitiveRestart = features.extendedDynamicState2;
+    dynamicTopologyUnrestricted = features.dynamicPrimitiveTopologyUnrestricted;
+    extendedDynamicStates.clear();
+#ifdef VK_EXT_extended_dynamic_state
+    if (dynamicRasterization) {
+        extendedDynamicStates.push_back(vk::DynamicState::eCullModeEXT);
+        extendedDynamicStates.push_back(vk::DynamicState::eFrontFaceEXT);
+        extendedDynamicStates.push_back(vk::DynamicState::ePrimitiveTopologyEXT);
+        extendedDynamicStates.push_back(vk::DynamicState::eDepthTestEnableEXT);
+        extendedDynamicStates.push_back(vk::DynamicState::eDepthWriteEnableEXT);
+
+        cmdSetCullMode = (PFN_vkCmdSetCullModeEXT) device.getProcAddr("vkCmdSetCullModeEXT");
+        cmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT) device.getProcAddr("vkCmdSetFrontFaceEXT");
+        cmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT) device.getProcAddr("vkCmdSetPrimitiveTopologyEXT");
+        cmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT) device.getProcAddr("vkCmdSetDepthTestEnableEXT");
+        cmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT) device.getProcAddr("vkCmdSetDepthWriteEnableEXT");
+        if (cmdSetCullMode == nullptr || cmdSetFrontFace == nullptr || cmdSetPrimitiveTopology == nullptr ||
+            cmdSetDepthTestEnable == nullptr || cmdSetDepthWriteEnable == nullptr) {
+            throw std::runtime_error("ERROR: Could not load extended dynamic state functions.");
+        }
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    if (dynamicPrimitiveRestart) {
+        extendedDynamicStates.push_back(vk::DynamicState::ePrimitiveRestartEnableEXT);
+
+        cmdSetPrimitiveRestartEnable = (PFN_vkCmdSetPrimitiveRestartEnableEXT) device.getProcAddr("vkCmdSetPrimitiveRestartEnableEXT");
+        if (cmdSetPrimitiveRestartEnable == nullptr) {
+            throw std::runtime_error("ERROR: Could not load extended dynamic state 2 functions.");
+        }
+    }
+#endif
+
+    this->layoutCache = layoutCache;
+    this->shaderLoader = shaderLoader;
+    this->retireCallback = retireCallback;
+    this->cachePath = cachePath;
+
+    // Load the pipeline cache saved by the last run, if there is one
+    std::vector<char> cacheData;
+    if (!cachePath.empty()) {
+        std::ifstream cacheFile(cachePath, std::ios::ate | std::ios::binary);
+        if (cacheFile.is_open()) {
+            cacheData.resize(cacheFile.tellg());
+            cacheFile.seekg(0);
+            cacheFile.read(cacheData.data(), cacheData.size());
+            if (!cacheFile) {
+                cacheData.clear();
+            }
+        }
+    }
+
+    // The driver ignores data saved by another driver or device, but start
+    // from an empty cache if the data is rejected outright
+    vk::PipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.initialDataSize = cacheData.size();
+    cacheInfo.pInitialData = cacheData.data();
+    try {
+        pipelineCache = device.createPipelineCache(cacheInfo);
+    } catch (const vk::SystemError&) {
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        pipelineCache = device.createPipelineCache(cacheInfo);
+    }
+
+    stopping = false;
+    worker = std::thread(&PipelineLibrary::runWorker, this);
+}
+
+void PipelineLibrary::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobAdded.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        destroyPipelinesLocked();
+        for (const auto& entry : computePipelines) {
+            device.destroyPipeline(entry.second.pipeline);
+        }
+        computePipelines.clear();
+    }
+
+    savePipelineCache();
+    device.destroyPipelineCache(pipelineCache);
+}
+
+void PipelineLibrary::setRenderPass(vk::RenderPass renderPass) {
+    this->renderPass = renderPass;
+}
+
+void PipelineLibrary::clear() {
+    std::unique_lock<std::mutex> lock(mutex);
+    // Only optimized links are built against the old render pass. Reloads
+    // and cache saves were asked for, and still run
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const Job& job) { return job.type == JOB_OPTIMIZE; }),
+               jobs.end());
+    workerIdle.wait(lock, [this]() { return !workerBusy; });
+    destroyPipelinesLocked();
+
+    // A pending reload finds no pipelines left to rebuild, so the shaders
+    // are dropped instead, and the pipelines built next load them again
+    bool reloadPending = std::any_of(jobs.begin(), jobs.end(), [](const Job& job) { return job.type == JOB_RELOAD; });
+    if (reloadPending) {
+        shaderCode.clear();
+    }
+}
+
+vk::Pipeline PipelineLibrary::getPipeline(const PipelineKey& fullKey, vk::PipelineLayout* layout) {
+    // Only the state baked into the pipeline tells pipelines apart
+    PipelineKey key = reduceKey(fullKey);
+    std::string serialized = key.serialize();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pipelines.find(serialized);
+        if (it != pipelines.end()) {
+            *layout = it->second.layout;
+            return it->second.pipeline;
+        }
+    }
+
+    // Libraries are fast linked without optimization, since this is likely
+    // in the middle of a frame
+    Shaders shaders = loadShaders(key, false);
+    vk::Pipeline pipeline = buildPipeline(key, shaders, false);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pipelines[serialized] = Entry{ key, pipeline, shaders.layout };
+    if (useLibraries && !key.usesMeshShader()) {
+        jobs.push_back(Job{ JOB_OPTIMIZE, key });
+        jobAdded.notify_one();
+    }
+
+    *layout = shaders.layout;
+    return pipeline;
+}
+
+vk::Pipeline PipelineLibrary::getComputePipeline(const ShaderVariant& shader, vk::PipelineLayout* layout) {
+    std::string serialized;
+    appendKey(&serialized, shader);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = computePipelines.find(serialized);
+        if (it != computePipelines.end()) {
+            *layout = it->second.layout;
+            return it->second.pipeline;
+        }
+    }
+
+    vk::PipelineLayout pipelineLayout;
+    vk::Pipeline pipeline = buildCompute(shader, false, &pipelineLayout);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    computePipelines[serialized] = Entry{ PipelineKey{}, pipeline, pipelineLayout, shader };
+
+    *layout = pipelineLayout;
+    return pipeline;
+}
+
+void PipelineLibrary::setDynamicState(vk::CommandBuffer commandBuffer, const PipelineKey& key) {
+    VkCommandBuffer handle = static_cast<VkCommandBuffer>(commandBuffer);
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (dynamicRasterization) {
+        cmdSetCullMode(handle, static_cast<VkCullModeFlags>(key.cullMode));
+        cmdSetFrontFace(handle, static_cast<VkFrontFace>(key.frontFace));
+        if (!key.usesMeshShader()) {
+            cmdSetPrimitiveTopology(handle, static_cast<VkPrimitiveTopology>(key.topology));
+        }
+        cmdSetDepthTestEnable(handle, key.depthTestEnable);
+        cmdSetDepthWriteEnable(handle, key.depthWriteEnable);
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    if (dynamicPrimitiveRestart && !key.usesMeshShader()) {
+        cmdSetPrimitiveRestartEnable(handle, key.primitiveRestartEnable);
+    }
+#endif
+    (void)handle;
+}
+
+void PipelineLibrary::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    workerIdle.wait(lock, [this]() { return jobs.empty() && !workerBusy; });
+}
+
+void PipelineLibrary::reloadShaders() {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(Job{ JOB_RELOAD, PipelineKey() });
+    jobAdded.notify_one();
+}
+
+void PipelineLibrary::saveCache() {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(Job{ JOB_SAVE_CACHE, PipelineKey() });
+    jobAdded.notify_one();
+}
+
+bool PipelineLibrary::update() {
+    std::vector<vk::Pipeline> retired;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Replacement& replacement : replacements) {
+            auto& replaced = replacement.compute ? computePipelines : pipelines;
+            auto it = replaced.find(replacement.key);
+            if (it == replaced.end()) {
+                device.destroyPipeline(replacement.pipeline);
+                continue;
+            }
+            retired.push_back(it->second.pipeline);
+            it->second.pipeline = replacement.pipeline;
+            it->second.layout = replacement.layout;
+        }
+        replacements.clear();
+    }
+
+    // Frames in flight may still use the replaced pipelines
+    for (vk::Pipeline pipeline : retired) {
+        retireCallback(pipeline);
+    }
+    return !retired.empty();
+}
+
+// ***** Static methods *****
+
+vk::PrimitiveTopology PipelineLibrary::topologyClass(vk::PrimitiveTopology topology) {
+    switch (topology) {
+    case vk::PrimitiveTopology::ePointList:
+        return vk::PrimitiveTopology::ePointList;
+    case vk::PrimitiveTopology::eLineList:
+    case vk::PrimitiveTopology::eLineStrip:
+    case vk::PrimitiveTopology::eLineListWithAdjacency:
+    case vk::PrimitiveTopology::eLineStripWithAdjacency:
+        return vk::PrimitiveTopology::eLineList;
+    case vk::PrimitiveTopology::ePatchList:
+        return vk::PrimitiveTopology::ePatchList;
+    default:
+        return vk::PrimitiveTopology::eTriangleList;
+    }
+}
+
+// ***** Private methods *****
+
+PipelineKey PipelineLibrary::reduceKey(const PipelineKey& key) const {
+    PipelineKey reduced = key;
+    PipelineKey defaults;
+
+    if (dynamicRasterization) {
+        reduced.cullMode = defaults.cullMode;
+        reduced.frontFace = defaults.frontFace;
+        reduced.depthTestEnable = defaults.depthTestEnable;
+        reduced.depthWriteEnable = defaults.depthWriteEnable;
+        // The pipeline's topology must still be of the same class as the
+        // dynamic one, unless the device allows any topology
+        reduced.topology = dynamicTopologyUnrestricted ? defaults.topology : topologyClass(key.topology);
+    }
+    if (dynamicPrimitiveRestart) {
+        reduced.primitiveRestartEnable = defaults.primitiveRestartEnable;
+    }
+    return reduced;
+}
+
+void PipelineLibrary::runWorker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        jobAdded.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (stopping) {
+            break;
+        }
+
+        Job job = jobs.front();
+        jobs.pop_front();
+        workerBusy = true;
+
+        // Build without holding the lock, so getPipeline() isn't blocked
+        lock.unlock();
+        try {
+            runJob(job);
+        } catch (const std::exception& e) {
+            // The pipeline being drawn with is kept
+            std::cerr << "ERROR: Failed to build pipeline in the background. " << e.what() << std::endl;
+        }
+        lock.lock();
+
+        workerBusy = false;
+        workerIdle.notify_all();
+    }
+}
+
+void PipelineLibrary::runJob(const Job& job) {
+    if (job.type == JOB_OPTIMIZE) {
+        Shaders shaders = loadShaders(job.key, false);
+        vk::Pipeline pipeline = buildPipeline(job.key, shaders, true);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        replacements.push_back(Replacement{ job.key.serialize(), pipeline, shaders.layout });
+        return;
+    }
+    if (job.type == JOB_SAVE_CACHE) {
+        savePipelineCache();
+        return;
+    }
+
+    // Rebuild every pipeline handed out so far. This is already off the main
+    // thread, so the rebuilds are optimized straight away
+    std::vector<PipelineKey> keys;
+    std::vector<std::pair<std::string, ShaderVariant> > computeShaders;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : pipelines) {
+            keys.push_back(entry.second.key);
+        }
+        for (const auto& entry : computePipelines) {
+            computeShaders.emplace_back(entry.first, entry.second.computeShader);
+        }
+    }
+
+    for (const PipelineKey& key : keys) {
+        try {
+            Shaders shaders = loadShaders(key, true);
+            vk::Pipeline pipeline = buildPipeline(key, shaders, true);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            replacements.push_back(Replacement{ key.serialize(), pipeline, shaders.layout });
+        } catch (const std::exception& e) {
+            // Keep drawing with the old pipeline
+            std::cerr << "ERROR: Failed to rebuild pipeline. " << e.what() << std::endl;
+        }
+    }
+
+    for (const auto& computeShader : computeShaders) {
+        try {
+            vk::PipelineLayout layout;
+            vk::Pipeline pipeline = buildCompute(computeShader.second, true, &layout);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            replacements.push_back(Replacement{ computeShader.first, pipeline, layout, true });
+        } catch (const std::exception& e) {
+            std::cerr << "ERROR: Failed to rebuild compute pipeline. " << e.what() << std::endl;
+        }
+    }
+}
+
+PipelineLibrary::Shaders PipelineLibrary::loadShaders(const PipelineKey& key, bool reload) {
+    Shaders shaders;
+    shaders.fragmentCode = getShaderCode(key.fragmentShader, reload);
+
+    // Reflect the interface of the shaders, which gives the pipeline layout
+    // and vertex input state
+    if (key.usesMeshShader()) {
+        shaders.meshCode = getShaderCode(key.meshShader, reload);
+        shaders.reflection = ShaderReflection::reflect(*shaders.meshCode);
+        if (!key.taskShader.sourcePath.empty() || !key.taskShader.spirvPath.empty()) {
+            shaders.taskCode = getShaderCode(key.taskShader, reload);
+            shaders.reflection.merge(ShaderReflection::reflect(*shaders.taskCode));
+        }
+    } else {
+        shaders.vertexCode = getShaderCode(key.vertexShader, reload);
+        shaders.reflection = ShaderReflection::reflect(*shaders.vertexCode);
+    }
+    shaders.reflection.merge(ShaderReflection::reflect(*shaders.fragmentCode));
+    shaders.layout = layoutCache->getPipelineLayout(shaders.reflection);
+    return shaders;
+}
+
+std::shared_ptr<const std::vector<uint32_t> > PipelineLibrary::getShaderCode(const ShaderVariant& variant, bool reload) {
+    std::string key;
+    appendKey(&key, variant);
+
+    if (!reload) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = shaderCode.find(key);
+        if (it != shaderCode.end()) {
+            return it->second;
+        }
+    }
+
+    // Loading may compile the shader, so it is done without the lock
+    auto code = std::make_shared<const std::vector<uint32_t> >(shaderLoader(variant));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    shaderCode[key] = code;
+    return code;
+}
+
+vk::Pipeline PipelineLibrary::buildPipeline(const PipelineKey& key, const Shaders& shaders, bool optimize) {
+#ifdef VK_EXT_graphics_pipeline_library
+    if (useLibraries && !key.usesMeshShader()) {
+        return buildLinked(key, shaders, optimize);
+    }
+#endif
+    return buildMonolithic(key, shaders);
+}
+
+vk::Pipeline PipelineLibrary::buildCompute(const ShaderVariant& shader, bool reload, vk::PipelineLayout* layout) {
+    std::shared_ptr<const std::vector<uint32_t> > code = getShaderCode(shader, reload);
+    vk::PipelineLayout pipelineLayout = layoutCache->getPipelineLayout(ShaderReflection::reflect(*code));
+    vk::ShaderModule module = createShaderModule(*code);
+
+    vk::ComputePipelineCreateInfo createInfo{};
+    createInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    createInfo.stage.module = module;
+    createInfo.stage.pName = SHADER_MAIN.c_str();
+    createInfo.layout = pipelineLayout;
+
+    // Through the C function, for the same reason as createPipeline()
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(static_cast<VkDevice>(device), static_cast<VkPipelineCache>(pipelineCache), 1,
+                                               reinterpret_cast<const VkComputePipelineCreateInfo*>(&createInfo), nullptr, &pipeline);
+    device.destroyShaderModule(module);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("ERROR: Failed to create compute pipeline. " + vk::to_string(vk::Result(result)));
+    }
+
+    *layout = pipelineLayout;
+    return vk::Pipeline(pipeline);
+}
+
+vk::Pipeline PipelineLibrary::buildMonolithic(const PipelineKey& key, const Shaders& shaders) {
+    FixedState state(key, shaders.reflection, extendedDynamicStates);
+
+    // Modules are only needed until the pipeline is created
+    std::vector<vk::PipelineShaderStageCreateInfo> stages;
+    auto destroyModules = [this, &stages]() {
+        for (const auto& stage : stages) {
+            device.destroyShaderModule(stage.module);
+        }
+    };
+    auto addStage = [this, &stages, &destroyModules](vk::ShaderStageFlagBits stage,
+                                                      const std::vector<uint32_t>& code) {
+        vk::PipelineShaderStageCreateInfo stageInfo{};
+        stageInfo.stage = stage;
+        try {
+            stageInfo.module = createShaderModule(code);
+        } catch (...) {
+            destroyModules();
+            throw;
+        }
+        stageInfo.pName = SHADER_MAIN.c_str();
+        stages.push_back(stageInfo);
+    };
+
+#ifdef VK_EXT_mesh_shader
+    if (key.usesMeshShader()) {
+        if (shaders.taskCode) {
+            addStage(vk::ShaderStageFlagBits::eTaskEXT, *shaders.taskCode);
+        }
+        addStage(vk::ShaderStageFlagBits::eMeshEXT, *shaders.meshCode);
+    }
+#endif
+    if (!key.usesMeshShader()) {
+        addStage(vk::ShaderStageFlagBits::eVertex, *shaders.vertexCode);
+    }
+    addStage(vk::ShaderStageFlagBits::eFragment, *shaders.fragmentCode);
+
+    vk::GraphicsPipelineCreateInfo pipelineInfo{};
+    // Set the shader stage
+    pipelineInfo.stageCount = (uint32_t)stages.size();
+    pipelineInfo.pStages = stages.data();
+    // Set the fixed function stages. Mesh shaders make their own primitives,
+    // so have no vertex input or input assembly
+    if (!key.usesMeshShader()) {
+        pipelineInfo.pVertexInputState = &state.vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &state.inputAssemblyInfo;
+    }
+    pipelineInfo.pViewportState = &state.viewportStateInfo;
+    pipelineInfo.pRasterizationState = &state.rasterizationStateInfo;
+    pipelineInfo.pMultisampleState = &state.multisamplingInfo;
+    pipelineInfo.pDepthStencilState = &state.depthStencilInfo;
+    pipelineInfo.pColorBlendState = &state.colorBlendInfo;
+    pipelineInfo.pDynamicState = &state.dynamicStateInfo;
+    // Layouts are shared between every pipeline with the same interface
+    pipelineInfo.layout = shaders.layout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+
+    vk::Pipeline pipeline;
+    try {
+        pipeline = createPipeline(pipelineInfo);
+    } catch (...) {
+        destroyModules();
+        throw;
+    }
+
+    destroyModules();
+    return pipeline;
+}
+
+#ifdef VK_EXT_graphics_pipeline_library
+vk::Pipeline PipelineLibrary::buildLinked(const PipelineKey& key, const Shaders& shaders, bool optimize) {
+    FixedState state(key, shaders.reflection, extendedDynamicStates);
+
+    // Libraries keep what link time optimization needs, so the optimized link
+    // can reuse them
+    vk::PipelineCreateFlags partFlags =
+        vk::PipelineCreateFlagBits::eLibraryKHR |
+        vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+
+    // Builds a library of one part of the pipeline, with an optional shader
+    auto buildPart = [this, partFlags](vk::GraphicsPipelineCreateInfo createInfo,
+                                       vk::GraphicsPipelineLibraryFlagsEXT partType,
+                                       vk::ShaderStageFlagBits stage,
+                                       const std::vector<uint32_t>* code) {
+        vk::GraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+        libraryInfo.flags = partType;
+        createInfo.pNext = &libraryInfo;
+        createInfo.flags = partFlags;
+
+        vk::PipelineShaderStageCreateInfo stageInfo{};
+        if (code != nullptr) {
+            stageInfo.stage = stage;
+            stageInfo.module = createShaderModule(*code);
+            stageInfo.pName = SHADER_MAIN.c_str();
+            createInfo.stageCount = 1;
+            createInfo.pStages = &stageInfo;
+        }
+
+        vk::Pipeline library;
+        try {
+            library = createPipeline(createInfo);
+        } catch (...) {
+            device.destroyShaderModule(stageInfo.module);
+            throw;
+        }
+        device.destroyShaderModule(stageInfo.module);
+        return library;
+    };
+
+    // The vertex input interface depends on the vertex layout and topology
+    std::string vertexInputKey = "VI";
+    appendKey(&vertexInputKey, static_cast<VkPrimitiveTopology>(key.topology));
+    appendKey(&vertexInputKey, key.primitiveRestartEnable);
+    for (const auto& attribute : state.vertexAttributes) {
+        appendKey(&vertexInputKey, attribute.location);
+        appendKey(&vertexInputKey, static_cast<VkFormat>(attribute.format));
+        appendKey(&vertexInputKey, attribute.offset);
+    }
+    appendKey(&vertexInputKey, state.vertexBinding.stride);
+    vk::Pipeline vertexInput = getPart(vertexInputKey, [&]() {
+        vk::GraphicsPipelineCreateInfo createInfo{};
+        createInfo.pVertexInputState = &state.vertexInputInfo;
+        createInfo.pInputAssemblyState = &state.inputAssemblyInfo;
+        createInfo.pDynamicState = &state.dynamicStateInfo;
+        return buildPart(createInfo, vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+                         vk::ShaderStageFlagBits::eVertex, nullptr);
+    });
+
+    // The pre-rasterization shaders depend on the vertex shader and the
+    // rasterization state
+    std::string preRasterizationKey = "PR";
+    appendKey(&preRasterizationKey, hashCode(*shaders.vertexCode));
+    appendKey(&preRasterizationKey, static_cast<VkPipelineLayout>(shaders.layout));
+    appendKey(&preRasterizationKey, static_cast<VkCullModeFlags>(key.cullMode));
+    appendKey(&preRasterizationKey, static_cast<VkFrontFace>(key.frontFace));
+    vk::Pipeline preRasterization = getPart(preRasterizationKey, [&]() {
+        vk::GraphicsPipelineCreateInfo createInfo{};
+        createInfo.pViewportState = &state.viewportStateInfo;
+        createInfo.pRasterizationState = &state.rasterizationStateInfo;
+        createInfo.pDynamicState = &state.dynamicStateInfo;
+        createInfo.layout = shaders.layout;
+        createInfo.renderPass = renderPass;
+        createInfo.subpass = 0;
+        return buildPart(createInfo, vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+                         vk::ShaderStageFlagBits::eVertex, shaders.vertexCode.get());
+    });
+
+    // The fragment shader depends on the fragment shader and depth testing
+    std::string fragmentShaderKey = "FS";
+    appendKey(&fragmentShaderKey, hashCode(*shaders.fragmentCode));
+    appendKey(&fragmentShaderKey, static_cast<VkPipelineLayout>(shaders.layout));
+    appendKey(&fragmentShaderKey, key.depthTestEnable);
+    appendKey(&fragmentShaderKey, key.depthWriteEnable);
+    vk::Pipeline fragmentShader = getPart(fragmentShaderKey, [&]() {
+        vk::GraphicsPipelineCreateInfo createInfo{};
+        createInfo.pDepthStencilState = &state.depthStencilInfo;
+        createInfo.pMultisampleState = &state.multisamplingInfo;
+        createInfo.pDynamicState = &state.dynamicStateInfo;
+        createInfo.layout = shaders.layout;
+        createInfo.renderPass = renderPass;
+        createInfo.subpass = 0;
+        return buildPart(createInfo, vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+                         vk::ShaderStageFlagBits::eFragment, shaders.fragmentCode.get());
+    });
+
+    // The fragment output interface only depends on the render pass, which
+    // every pipeline shares
+    vk::Pipeline fragmentOutput = getPart("FO", [&]() {
+        vk::GraphicsPipelineCreateInfo createInfo{};
+        createInfo.pColorBlendState = &state.colorBlendInfo;
+        createInfo.pMultisampleState = &state.multisamplingInfo;
+        createInfo.pDynamicState = &state.dynamicStateInfo;
+        createInfo.renderPass = renderPass;
+        createInfo.subpass = 0;
+        return buildPart(createInfo, vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface,
+                         vk::ShaderStageFlagBits::eFragment, nullptr);
+    });
+
+    // Link the parts into a complete pipeline
+    vk::Pipeline libraries[] = { vertexInput, preRasterization, fragmentShader, fragmentOutput };
+    vk::PipelineLibraryCreateInfoKHR linkInfo{};
+    linkInfo.libraryCount = 4;
+    linkInfo.pLibraries = libraries;
+
+    vk::GraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.pNext = &linkInfo;
+    if (optimize) {
+        pipelineInfo.flags = vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+    }
+    pipelineInfo.layout = shaders.layout;
+
+    return createPipeline(pipelineInfo);
+}
+#endif
+
+vk::Pipeline PipelineLibrary::getPart(const std::string& partKey, const std::function<vk::Pipeline()>& build) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = parts.find(partKey);
+        if (it != parts.end()) {
+            return it->second;
+        }
+    }
+
+    vk::Pipeline part = build();
+
+    // Both threads may have built the same part, in which case one is thrown
+    // away
+    std::lock_guard<std::mutex> lock(mutex);
+    auto inserted = parts.emplace(partKey, part);
+    if (!inserted.second) {
+        device.destroyPipeline(part);
+    }
+    return inserted.first->second;
+}
+
+vk::ShaderModule PipelineLibrary::createShaderModule(const std::vector<uint32_t>& code) {
+    vk::ShaderModuleCreateInfo createInfo{};
+    createInfo.codeSize = code.size() * sizeof(uint32_t);
+    createInfo.pCode = code.data();
+
+    return device.createShaderModule(createInfo);
+}
+
+vk::Pipeline PipelineLibrary::createPipeline(const vk::GraphicsPipelineCreateInfo& createInfo) {
+    // Through the C function, since the return type of
+    // vk::Device::createGraphicsPipeline() differs between header versions
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(static_cast<VkDevice>(device), static_cast<VkPipelineCache>(pipelineCache), 1,
+                                                reinterpret_cast<const VkGraphicsPipelineCreateInfo*>(&createInfo), nullptr, &pipeline);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("ERROR: Failed to create graphics pipeline. " + vk::to_string(vk::Result(result)));
+    }
+    return vk::Pipeline(pipeline);
+}
+
+void PipelineLibrary::destroyPipelinesLocked() {
+    for (const auto& entry : pipelines) {
+        device.destroyPipeline(entry.second.pipeline);
+    }
+    pipelines.clear();
+
+    for (const auto& replacement : replacements) {
+        device.destroyPipeline(replacement.pipeline);
+    }
+    replacements.clear();
+
+    // Linked pipelines don't depend on their libraries once created
+    for (const auto& part : parts) {
+        device.destroyPipeline(part.second);
+    }
+    parts.clear();
+}
+
+void PipelineLibrary::savePipelineCache() {
+    if (cachePath.empty()) {
+        return;
+    }
+
+    std::vector<uint8_t> data = device.getPipelineCacheData(pipelineCache);
+
+    // The cache is only an optimization, so failing to write it is not fatal
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream outFile(tempPath, std::ios::binary);
+    outFile.write(reinterpret_cast<const char*>(data.data()), data.size());
+    outFile.close();
+
+    std::error_code error;
+    if (outFile) {
+        std::filesystem::rename(tempPath, cachePath, error);
+    }
+    if (!outFile || error) {
+        std::filesystem::remove(tempPath, error);
+    }
+}
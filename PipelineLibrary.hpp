@@ -0,0 +1,413 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ShaderArchive.hpp"
+#include "ShaderReflection.hpp"
+#include "LayoutCache.hpp"
+#include "DeviceFeatures.hpp"
+
+/** A permutation of a shader, which the shader loader turns into SPIR-V */
+struct ShaderVariant {
+    /** The path to the GLSL source */
+    std::string sourcePath;
+    /** The path to the precompiled SPIR-V, used if the source isn't shipped */
+    std::string spirvPath;
+    /** The values of the permutations of the shader */
+    ShaderArchive::Defines defines;
+};
+
+/**
+ * Everything that tells graphics pipelines apart. The render pass is not
+ * included, since every pipeline of the library shares one. The state after
+ * the shaders may be dynamic on the device, in which case it is set while
+ * recording by PipelineLibrary::setDynamicState() instead
+ */
+struct PipelineKey {
+    ShaderVariant vertexShader;
+    ShaderVariant fragmentShader;
+    /** A mesh shader pipeline sets these instead of the vertex shader, and
+     *  ignores the topology and primitive restart */
+    ShaderVariant taskShader;
+    ShaderVariant meshShader;
+
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+    bool primitiveRestartEnable = false;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+    bool depthTestEnable = false;
+    bool depthWriteEnable = false;
+
+    /**
+     * @return Whether the pipeline draws with task and mesh shaders
+     */
+    bool usesMeshShader() const { return !meshShader.sourcePath.empty() || !meshShader.spirvPath.empty(); }
+
+    /**
+     * @return The key as a string of bytes, for looking it up in maps
+     */
+    std::string serialize() const;
+};
+
+/**
+ * Creates and owns the graphics pipelines, so each distinct pipeline is only
+ * ever compiled once.
+ *
+ * With VK_EXT_graphics_pipeline_library, a pipeline is split into its four
+ * parts (the vertex input interface, the pre-rasterization shaders, the
+ * fragment shader, and the fragment output interface), which are compiled
+ * separately and cached by their contents. A new combination of parts is then
+ * only a fast link, so a new permutation doesn't stall the frame. Fast linked
+ * pipelines skip link time optimization, so an optimized link of the same
+ * parts is built on a worker thread, and swapped in by update() once ready.
+ *
+ * Devices without the extension (or without fast linking) get complete
+ * pipelines compiled the usual way, as do mesh shader pipelines, which are
+ * few and built once at startup.
+ *
+ * With VK_EXT_extended_dynamic_state (and 2 and 3), the cull mode, front
+ * face, topology, primitive restart and depth test state are dynamic, and are
+ * dropped from the keys pipelines are cached by. Keys differing only in that
+ * state then share one pipeline.
+ *
+ * All pipelines are built through one pipeline cache, which is saved to disk
+ * so later runs skip most of the compiling.
+ */
+class PipelineLibrary {
+public:
+    /** Loads the SPIR-V of a shader variant. Called from both the thread
+     *  calling getPipeline() and the worker thread */
+    using ShaderLoader = std::function<std::vector<uint32_t>(const ShaderVariant&)>;
+    /** Destroys a replaced pipeline once the frames using it have completed.
+     *  Called on the thread calling update() */
+    using RetireCallback = std::function<void(vk::Pipeline)>;
+
+    /**
+     * Loads the pipeline cache and starts the worker thread
+     *
+     * @param device The logical device to create pipelines with
+     * @param features The enabled device features, which decide whether
+     *                 pipeline libraries and dynamic state are used
+     * @param layoutCache Gives the pipeline layouts, which it keeps ownership
+     *                    of
+     * @param shaderLoader Loads the code of the shaders
+     * @param retireCallback Destroys pipelines replaced by update()
+     * @param cachePath The file the pipeline cache is loaded from and saved
+     *                  to, or empty to not keep the cache between runs
+     */
+    void initialize(vk::Device device, const DeviceFeatures& features, LayoutCache* layoutCache,
+                    ShaderLoader shaderLoader, RetireCallback retireCallback,
+                    const std::string& cachePath);
+
+    /**
+     * Stops the worker thread, destroys every pipeline, and saves the pipeline
+     * cache
+     *
+     * Requires: No pipeline of the library is still in use
+     */
+    void destroy();
+
+    /**
+     * Sets the render pass that pipelines are built against
+     *
+     * Requires: There are no pipelines, because initialize() or clear() was
+     *           just called
+     */
+    void setRenderPass(vk::RenderPass renderPass);
+
+    /**
+     * Waits for the worker thread to finish its current job, drops the
+     * optimized links still queued, and destroys every pipeline. Queued
+     * shader reloads and cache saves are kept. Used before the render pass
+     * is destroyed
+     *
+     * Requires: No pipeline of the library is still in use
+     */
+    void clear();
+
+    /**
+     * Gets the pipeline for a key, building it if it doesn't exist yet. A new
+     * pipeline is fast linked from pipeline libraries if they are used, and an
+     * optimized link is queued on the worker thread
+     *
+     * Requires: The render pass has been set
+     *
+     * @param key The pipeline to get
+     * @param layout Set to the layout of the pipeline, owned by the layout
+     *               cache
+     *
+     * @return The pipeline, owned by the library
+     *
+     * @throw std::runtime_error if the shaders failed to load or the pipeline
+     *        failed to build
+     */
+    vk::Pipeline getPipeline(const PipelineKey& key, vk::PipelineLayout* layout);
+
+    /**
+     * Gets the compute pipeline of a shader, building it if it doesn't exist
+     * yet. Compute pipelines don't depend on the render pass, so clear()
+     * keeps them. They are rebuilt by reloadShaders() along with the graphics
+     * pipelines, so should also be looked up again when update() returns true
+     *
+     * @param shader The compute shader
+     * @param layout Set to the layout of the pipeline, owned by the layout
+     *               cache
+     *
+     * @return The pipeline, owned by the library
+     *
+     * @throw std::runtime_error if the shader failed to load or the pipeline
+     *        failed to build
+     */
+    vk::Pipeline getComputePipeline(const ShaderVariant& shader, vk::PipelineLayout* layout);
+
+    /**
+     * Sets the state of a key that is dynamic on this device. Should be called
+     * after binding the pipeline of the key
+     *
+     * @param commandBuffer The command buffer being recorded
+     * @param key The key whose pipeline was bound
+     */
+    void setDynamicState(vk::CommandBuffer commandBuffer, const PipelineKey& key);
+
+    /**
+     * Reloads the code of every shader, and rebuilds every pipeline on the
+     * worker thread. The rebuilt pipelines are swapped in by update(). A
+     * pipeline that fails to rebuild is kept as it is
+     */
+    void reloadShaders();
+
+    /**
+     * Saves the pipeline cache to the cache path on the worker thread, so the
+     * pipelines built so far aren't lost if the app doesn't exit cleanly.
+     * Never waits on the disk
+     */
+    void saveCache();
+
+    /**
+     * Waits for the worker thread to finish every queued job, such as the
+     * optimized links. For when pipelines shouldn't change partway through,
+     * like when benchmarking
+     */
+    void waitIdle();
+
+    /**
+     * Swaps in the pipelines finished by the worker thread, passing the ones
+     * they replace to the retire callback. Pipelines returned by getPipeline()
+     * or getComputePipeline() before this call may have been replaced, so
+     * they should be looked up again if this returns true. Never waits on the
+     * worker thread
+     *
+     * @return Whether any pipelines were replaced
+     */
+    bool update();
+
+private:
+    /** A linked (or complete) pipeline, or a compute pipeline */
+    struct Entry {
+        PipelineKey key;
+        vk::Pipeline pipeline;
+        vk::PipelineLayout layout;
+        /** The shader of a compute pipeline, which has no key */
+        ShaderVariant computeShader;
+    };
+
+    /** A pipeline built by the worker thread, waiting for update() */
+    struct Replacement {
+        std::string key;
+        vk::Pipeline pipeline;
+        vk::PipelineLayout layout;
+        /** Whether it replaces a compute pipeline rather than a graphics one */
+        bool compute = false;
+    };
+
+    /** The kinds of job run by the worker thread */
+    enum JobType {
+        JOB_OPTIMIZE,   // Build an optimized link of a fast linked pipeline
+        JOB_RELOAD,     // Reload the shaders and rebuild every pipeline,
+                        // compute pipelines included
+        JOB_SAVE_CACHE, // Save the pipeline cache
+    };
+
+    struct Job {
+        JobType type;
+        PipelineKey key;
+    };
+
+    /** The shaders of a pipeline, after loading */
+    struct Shaders {
+        std::shared_ptr<const std::vector<uint32_t> > vertexCode;
+        std::shared_ptr<const std::vector<uint32_t> > fragmentCode;
+        /** Only loaded for mesh shader pipelines, which have no vertex code */
+        std::shared_ptr<const std::vector<uint32_t> > taskCode;
+        std::shared_ptr<const std::vector<uint32_t> > meshCode;
+        ShaderReflection reflection;
+        vk::PipelineLayout layout;
+    };
+
+    /** The name of the main function within the shaders */
+    inline static const std::string SHADER_MAIN = "main";
+
+    /**
+     * @return The first topology of the same class (points, lines, triangles
+     *         or patches) as the given one
+     */
+    static vk::PrimitiveTopology topologyClass(vk::PrimitiveTopology topology);
+
+    vk::Device device;
+    bool useLibraries = false;
+    /** Whether the cull mode, front face, topology, and depth test and write
+     *  are dynamic */
+    bool dynamicRasterization = false;
+    /** Whether primitive restart is dynamic */
+    bool dynamicPrimitiveRestart = false;
+    /** Whether a dynamic topology can change class */
+    bool dynamicTopologyUnrestricted = false;
+    /** The states made dynamic, besides the viewport and scissor */
+    std::vector<vk::DynamicState> extendedDynamicStates;
+#ifdef VK_EXT_extended_dynamic_state
+    // Loaded from the device, since they are from extensions
+    PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+    PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace = nullptr;
+    PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology = nullptr;
+    PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable = nullptr;
+    PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    PFN_vkCmdSetPrimitiveRestartEnableEXT cmdSetPrimitiveRestartEnable = nullptr;
+#endif
+    LayoutCache* layoutCache = nullptr;
+    ShaderLoader shaderLoader;
+    RetireCallback retireCallback;
+    std::string cachePath;
+    vk::PipelineCache pipelineCache;
+    vk::RenderPass renderPass;
+
+    // Guards everything below, which the worker thread shares
+    std::mutex mutex;
+    /** The loaded shader code, by the serialized variant. Shared so that a
+     *  reload can replace the code while a build still reads the old code */
+    std::unordered_map<std::string, std::shared_ptr<const std::vector<uint32_t> > > shaderCode;
+    /** The pipeline libraries, by their serialized contents */
+    std::unordered_map<std::string, vk::Pipeline> parts;
+    /** The pipelines handed out, by their serialized keys */
+    std::unordered_map<std::string, Entry> pipelines;
+    /** The compute pipelines, by their serialized shader variants */
+    std::unordered_map<std::string, Entry> computePipelines;
+    /** Pipelines finished by the worker thread, in the order they finished */
+    std::vector<Replacement> replacements;
+
+    std::thread worker;
+    std::condition_variable jobAdded;
+    std::condition_variable workerIdle;
+    std::deque<Job> jobs;
+    bool workerBusy = false;
+    bool stopping = false;
+
+    /**
+     * Drops the dynamic state from a key, so keys differing only in that
+     * state map to the same pipeline
+     */
+    PipelineKey reduceKey(const PipelineKey& key) const;
+
+    /**
+     * The loop run by the worker thread
+     */
+    void runWorker();
+
+    /**
+     * Runs a job from the worker thread
+     */
+    void runJob(const Job& job);
+
+    /**
+     * Loads the shaders of a key, and gets the pipeline layout from them
+     *
+     * @param key The key whose shaders are loaded
+     * @param reload Whether to load the code again, even if it was loaded
+     *               already
+     */
+    Shaders loadShaders(const PipelineKey& key, bool reload);
+
+    /**
+     * Gets the code of a shader variant, loading it if needed
+     */
+    std::shared_ptr<const std::vector<uint32_t> > getShaderCode(const ShaderVariant& variant, bool reload);
+
+    /**
+     * Builds a pipeline, from pipeline libraries if they are used
+     *
+     * @param optimize Whether to apply link time optimization to the link
+     */
+    vk::Pipeline buildPipeline(const PipelineKey& key, const Shaders& shaders, bool optimize);
+
+    /**
+     * Builds a compute pipeline
+     *
+     * @param shader The compute shader
+     * @param reload Whether to load the code again, even if it was loaded
+     *               already
+     * @param layout Set to the layout of the pipeline
+     *
+     * @throw std::runtime_error if the shader failed to load or the pipeline
+     *        failed to build
+     */
+    vk::Pipeline buildCompute(const ShaderVariant& shader, bool reload, vk::PipelineLayout* layout);
+
+    /**
+     * Builds a complete pipeline, without pipeline libraries
+     */
+    vk::Pipeline buildMonolithic(const PipelineKey& key, const Shaders& shaders);
+
+    /**
+     * Links the pipeline libraries of a key, building any that are missing
+     *
+     * @param optimize Whether to apply link time optimization, which makes
+     *                 the link much slower but the pipeline faster
+     */
+    vk::Pipeline buildLinked(const PipelineKey& key, const Shaders& shaders, bool optimize);
+
+    /**
+     * Gets a pipeline library, building it if needed
+     *
+     * @param partKey The serialized contents of the library
+     * @param build Builds the library, if it isn't in the map
+     */
+    vk::Pipeline getPart(const std::string& partKey, const std::function<vk::Pipeline()>& build);
+
+    /**
+     * Creates a shader module from SPIR-V code
+     */
+    vk::ShaderModule createShaderModule(const std::vector<uint32_t>& code);
+
+    /**
+     * Creates a graphics pipeline in the pipeline cache
+     *
+     * @throw std::runtime_error if the pipeline failed to be created
+     */
+    vk::Pipeline createPipeline(const vk::GraphicsPipelineCreateInfo& createInfo);
+
+    /**
+     * Destroys every pipeline and library, and drops the finished
+     * replacements
+     *
+     * Requires: The mutex is held, and the worker thread is idle
+     */
+    void destroyPipelinesLocked();
+
+    /**
+     * Saves the contents of the pipeline cache to the cache path
+     */
+    void savePipelineCache();
+};
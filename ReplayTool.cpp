@@ -0,0 +1,1013 @@
+// October 18, 2026
+
+// Replays a capture made with "VulkanApp --capture <file> <frames>" without a
+// window, as fast as the GPU allows, and reports how long the frames took.
+// Every shader and pipeline is built before the timing starts, including the
+// optimized pipeline links, so each run does exactly the same work. Frames
+// are drawn to an offscreen image and depth buffer in the formats the capture
+// was drawn in. What the GPU wrote during a captured frame, like the culled
+// draws, is uploaded at the start of the frame, so culling isn't replayed.
+//
+// Usage: replay <capture> [iterations]
+
+#include <vulkan/vulkan.hpp>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <array>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "FrameCapture.hpp"
+#include "LayoutCache.hpp"
+#include "DeviceFeatures.hpp"
+#include "ShaderReflection.hpp"
+#include "PipelineLibrary.hpp"
+
+namespace {
+
+/** The number of frames that can be replayed at the same time */
+const int MAX_CONCURRENT_FRAMES = 2;
+
+/** The optional device extensions, which should match the app's so the same
+ *  pipelines are built */
+const std::vector<const char*> OPTIONAL_DEVICE_EXTENSIONS = {
+#ifdef VK_EXT_graphics_pipeline_library
+    VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+    VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state
+    VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+    VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME,
+#endif
+#ifdef VK_KHR_buffer_device_address
+    VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+#endif
+};
+
+/** The largest upload recorded into a frame's command buffer at once */
+const vk::DeviceSize MAX_UPDATE_SIZE = 65536;
+
+/** A buffer created by the capture, kept mapped for uploads */
+struct ReplayBuffer {
+    vk::Buffer buffer;
+    vk::DeviceMemory memory;
+    void* mapped;
+    /** The address of the buffer, if it was created for one */
+    vk::DeviceAddress address;
+};
+
+/**
+ * Executes a capture on a device without a window
+ */
+class Replayer {
+public:
+    /**
+     * Creates the device and everything the capture needs, and builds every
+     * pipeline
+     */
+    void initialize(CaptureReader* reader);
+
+    /**
+     * Replays every frame of the capture once
+     *
+     * @return The number of frames replayed
+     */
+    uint32_t replay();
+
+    /**
+     * Waits for the device, and destroys everything
+     */
+    void destroy();
+
+    /** The GPU time of each frame replayed, in milliseconds, if the queue
+     *  supports timestamps */
+    std::vector<double> gpuFrameTimes;
+
+private:
+    CaptureReader* reader;
+
+    vk::Instance instance;
+    uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+    vk::PhysicalDevice physicalDevice;
+    vk::Device device;
+    vk::Queue queue;
+    uint32_t queueFamily;
+    DeviceFeatures features;
+
+    vk::Image image;
+    vk::DeviceMemory imageMemory;
+    vk::ImageView imageView;
+    vk::Image depthImage;
+    vk::DeviceMemory depthImageMemory;
+    vk::ImageView depthImageView;
+    vk::RenderPass renderPass;
+    vk::Framebuffer framebuffer;
+    vk::Extent2D maxExtent;
+
+    vk::CommandPool commandPool;
+    std::vector<vk::CommandBuffer> commandBuffers;
+    std::vector<vk::Fence> fences;
+    /** Two timestamps for each concurrent frame */
+    vk::QueryPool queryPool;
+    bool timestampsSupported = false;
+    double timestampPeriod = 1.0;
+    /** Whether each concurrent frame has timestamps waiting to be read */
+    std::vector<bool> timestampsPending;
+    int currentFrame = 0;
+
+    LayoutCache layoutCache;
+    PipelineLibrary pipelineLibrary;
+    /** The code of the shaders, by their names in the pipeline keys */
+    std::unordered_map<std::string, std::vector<uint32_t> > shaders;
+    /** The captured pipelines, by id */
+    std::vector<PipelineKey> pipelineKeys;
+    std::vector<vk::Pipeline> pipelines;
+    std::vector<vk::PipelineLayout> pipelineLayouts;
+    std::unordered_map<uint64_t, ReplayBuffer> buffers;
+#ifdef VK_KHR_buffer_device_address
+    // Loaded from the device, since it comes from an extension
+    PFN_vkGetBufferDeviceAddressKHR getBufferDeviceAddress = nullptr;
+#endif
+
+    /** Holds every descriptor set the capture binds */
+    vk::DescriptorPool descriptorPool;
+    /** The descriptor sets, by getDescriptorSetKey() */
+    std::unordered_map<std::string, vk::DescriptorSet> descriptorSets;
+
+    // State while replaying a frame
+    vk::CommandBuffer commandBuffer;
+    vk::Extent2D frameExtent;
+    bool inRenderPass = false;
+    /** Whether the frame has uploaded what its GPU wrote */
+    bool frameUploaded = false;
+    uint32_t currentPipeline = 0;
+
+    void createDevice();
+    void createTarget(vk::Format format, vk::Format depthFormat);
+    void createResources();
+    uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties);
+
+    /**
+     * Creates a host visible buffer, mapped, with an address if its usage
+     * asks for one
+     */
+    ReplayBuffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage);
+
+    /**
+     * Creates the descriptor sets of the storage buffers the capture binds,
+     * with the set layouts of the pipelines they are bound with
+     */
+    void createDescriptorSets();
+
+    /**
+     * @return The key of the descriptor set bound by a
+     *         CAPTURE_BIND_STORAGE_BUFFERS record with a pipeline
+     */
+    static std::string getDescriptorSetKey(uint32_t pipeline, const CaptureRecord& record);
+
+    /**
+     * Begins the frame's render pass, if it hasn't begun. Everything the
+     * frame uploaded is made visible to the draws first
+     */
+    void beginRenderPass();
+
+    /**
+     * Waits for a concurrent frame to finish, and reads its timestamps
+     */
+    void waitForFrame(int frame);
+};
+
+// ***** Replayer *****
+
+void Replayer::initialize(CaptureReader* reader) {
+    this->reader = reader;
+
+    createDevice();
+    createTarget(reader->getColorFormat(), reader->getDepthFormat());
+
+    vk::CommandPoolCreateInfo poolInfo{};
+    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    commandPool = device.createCommandPool(poolInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocateInfo.commandBufferCount = MAX_CONCURRENT_FRAMES;
+    commandBuffers = device.allocateCommandBuffers(allocateInfo);
+
+    for (int i = 0; i < MAX_CONCURRENT_FRAMES; i++) {
+        vk::FenceCreateInfo fenceInfo{};
+        fenceInfo.flags = vk::FenceCreateFlagBits::eSignaled;
+        fences.push_back(device.createFence(fenceInfo));
+    }
+    timestampsPending.assign(MAX_CONCURRENT_FRAMES, false);
+
+    if (timestampsSupported) {
+        vk::QueryPoolCreateInfo queryInfo{};
+        queryInfo.queryType = vk::QueryType::eTimestamp;
+        queryInfo.queryCount = 2 * MAX_CONCURRENT_FRAMES;
+        queryPool = device.createQueryPool(queryInfo);
+    }
+
+    layoutCache.initialize(device);
+    // The shaders come from the capture. There's nothing in flight while
+    // pipelines are replaced, so they are destroyed straight away
+    pipelineLibrary.initialize(device, features, &layoutCache,
+        [this](const ShaderVariant& variant) {
+            auto it = shaders.find(variant.sourcePath);
+            if (it == shaders.end()) {
+                throw std::runtime_error("ERROR: Capture uses a shader before defining it");
+            }
+            return it->second;
+        },
+        [this](vk::Pipeline pipeline) {
+            device.destroyPipeline(pipeline);
+        },
+        "");
+    pipelineLibrary.setRenderPass(renderPass);
+
+    createResources();
+}
+
+uint32_t Replayer::replay() {
+    uint32_t frames = 0;
+
+    reader->rewind();
+    CaptureRecord record;
+    while (reader->next(&record)) {
+        switch (record.opcode) {
+        case CAPTURE_UPLOAD_BUFFER: {
+            uint64_t id = record.read<uint64_t>();
+            uint64_t offset = record.read<uint64_t>();
+            size_t size = record.remaining();
+            const uint8_t* data = record.readBytes(size);
+
+            // Uploads at the start of a frame are what the GPU wrote during
+            // it, which changes every frame, so they are recorded into the
+            // frame after the frames in flight are done reading
+            if (commandBuffer && !inRenderPass) {
+                if (!frameUploaded) {
+                    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect |
+                                                  vk::PipelineStageFlagBits::eVertexInput |
+                                                  vk::PipelineStageFlagBits::eVertexShader,
+                                                  vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr,
+                                                  nullptr);
+                    frameUploaded = true;
+                }
+                for (size_t start = 0; start < size; start += MAX_UPDATE_SIZE) {
+                    size_t chunk = std::min<size_t>(size - start, MAX_UPDATE_SIZE);
+                    commandBuffer.updateBuffer(buffers.at(id).buffer, offset + start, chunk, data + start);
+                }
+                break;
+            }
+
+            // Frames in flight may read the buffer, and other uploads are rare
+            for (int i = 0; i < MAX_CONCURRENT_FRAMES; i++) {
+                waitForFrame(i);
+            }
+            memcpy(static_cast<uint8_t*>(buffers.at(id).mapped) + offset, data, size);
+            break;
+        }
+        case CAPTURE_COPY_BUFFER: {
+            for (int i = 0; i < MAX_CONCURRENT_FRAMES; i++) {
+                waitForFrame(i);
+            }
+            uint64_t sourceId = record.read<uint64_t>();
+            uint64_t destinationId = record.read<uint64_t>();
+            size_t size = (size_t)record.read<uint64_t>();
+            memcpy(buffers.at(destinationId).mapped, buffers.at(sourceId).mapped, size);
+            break;
+        }
+        case CAPTURE_BEGIN_FRAME: {
+            frameExtent.width = record.read<uint32_t>();
+            frameExtent.height = record.read<uint32_t>();
+
+            waitForFrame(currentFrame);
+            commandBuffer = commandBuffers[currentFrame];
+
+            vk::CommandBufferBeginInfo beginInfo{};
+            beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+            commandBuffer.begin(beginInfo);
+            if (timestampsSupported) {
+                commandBuffer.resetQueryPool(queryPool, 2 * currentFrame, 2);
+                commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 2 * currentFrame);
+            }
+
+            vk::Viewport viewport{};
+            viewport.width = (float)frameExtent.width;
+            viewport.height = (float)frameExtent.height;
+            viewport.minDepth = 0.f;
+            viewport.maxDepth = 1.f;
+            commandBuffer.setViewport(0, viewport);
+            vk::Rect2D scissor{};
+            scissor.extent = frameExtent;
+            commandBuffer.setScissor(0, scissor);
+
+            // Begun by the first draw, after the frame's uploads
+            inRenderPass = false;
+            frameUploaded = false;
+            break;
+        }
+        case CAPTURE_BIND_PIPELINE: {
+            currentPipeline = record.read<uint32_t>();
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines.at(currentPipeline));
+            pipelineLibrary.setDynamicState(commandBuffer, pipelineKeys.at(currentPipeline));
+            break;
+        }
+        case CAPTURE_BIND_STORAGE_BUFFERS: {
+            uint32_t set = record.read<uint32_t>();
+            vk::DescriptorSet descriptorSet = descriptorSets.at(getDescriptorSetKey(currentPipeline, record));
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayouts.at(currentPipeline),
+                                             set, descriptorSet, nullptr);
+            break;
+        }
+        case CAPTURE_PUSH_CONSTANTS: {
+            vk::ShaderStageFlags stages = static_cast<vk::ShaderStageFlags>(record.read<VkShaderStageFlags>());
+            uint32_t offset = record.read<uint32_t>();
+            uint32_t size = (uint32_t)record.remaining();
+            commandBuffer.pushConstants(pipelineLayouts.at(currentPipeline), stages, offset, size,
+                                        record.readBytes(size));
+            break;
+        }
+        case CAPTURE_PUSH_BUFFER_ADDRESS: {
+            vk::ShaderStageFlags stages = static_cast<vk::ShaderStageFlags>(record.read<VkShaderStageFlags>());
+            uint32_t offset = record.read<uint32_t>();
+            vk::DeviceAddress address = buffers.at(record.read<uint64_t>()).address;
+            if (address == 0) {
+                throw std::runtime_error("ERROR: The capture pulls vertices through buffer device addresses, which "
+                                         "the device doesn't support");
+            }
+            commandBuffer.pushConstants(pipelineLayouts.at(currentPipeline), stages, offset, sizeof(address),
+                                        &address);
+            break;
+        }
+        case CAPTURE_BIND_VERTEX_BUFFER: {
+            uint32_t binding = record.read<uint32_t>();
+            uint64_t id = record.read<uint64_t>();
+            vk::DeviceSize offset = record.read<uint64_t>();
+            commandBuffer.bindVertexBuffers(binding, buffers.at(id).buffer, offset);
+            break;
+        }
+        case CAPTURE_BIND_INDEX_BUFFER: {
+            uint64_t id = record.read<uint64_t>();
+            vk::DeviceSize offset = record.read<uint64_t>();
+            vk::IndexType indexType = static_cast<vk::IndexType>(record.read<uint32_t>());
+            commandBuffer.bindIndexBuffer(buffers.at(id).buffer, offset, indexType);
+            break;
+        }
+        case CAPTURE_DRAW: {
+            uint32_t vertexCount = record.read<uint32_t>();
+            uint32_t instanceCount = record.read<uint32_t>();
+            uint32_t firstVertex = record.read<uint32_t>();
+            uint32_t firstInstance = record.read<uint32_t>();
+            beginRenderPass();
+            commandBuffer.draw(vertexCount, instanceCount, firstVertex, firstInstance);
+            break;
+        }
+        case CAPTURE_DRAW_INDEXED: {
+            uint32_t indexCount = record.read<uint32_t>();
+            uint32_t instanceCount = record.read<uint32_t>();
+            uint32_t firstIndex = record.read<uint32_t>();
+            int32_t vertexOffset = record.read<int32_t>();
+            uint32_t firstInstance = record.read<uint32_t>();
+            beginRenderPass();
+            commandBuffer.drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+            break;
+        }
+        case CAPTURE_DRAW_INDEXED_INDIRECT: {
+            uint64_t id = record.read<uint64_t>();
+            vk::DeviceSize offset = record.read<uint64_t>();
+            uint32_t drawCount = record.read<uint32_t>();
+            uint32_t stride = record.read<uint32_t>();
+            beginRenderPass();
+            commandBuffer.drawIndexedIndirect(buffers.at(id).buffer, offset, drawCount, stride);
+            break;
+        }
+        case CAPTURE_END_FRAME: {
+            // Still cleared if nothing was drawn
+            beginRenderPass();
+            commandBuffer.endRenderPass();
+            if (timestampsSupported) {
+                commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 2 * currentFrame + 1);
+            }
+            commandBuffer.end();
+
+            vk::SubmitInfo submitInfo{};
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+            device.resetFences(fences[currentFrame]);
+            queue.submit(submitInfo, fences[currentFrame]);
+            timestampsPending[currentFrame] = timestampsSupported;
+
+            commandBuffer = nullptr;
+            currentFrame = (currentFrame + 1) % MAX_CONCURRENT_FRAMES;
+            frames++;
+            break;
+        }
+        default:
+            // Shaders, pipelines and buffers were created up front, and
+            // anything unknown is skipped
+            break;
+        }
+    }
+
+    for (int i = 0; i < MAX_CONCURRENT_FRAMES; i++) {
+        waitForFrame(i);
+    }
+    return frames;
+}
+
+void Replayer::destroy() {
+    device.waitIdle();
+
+    device.destroyDescriptorPool(descriptorPool);
+    pipelineLibrary.destroy();
+    layoutCache.destroy();
+
+    for (const auto& entry : buffers) {
+        device.destroyBuffer(entry.second.buffer);
+        device.freeMemory(entry.second.memory);
+    }
+
+    if (timestampsSupported) {
+        device.destroyQueryPool(queryPool);
+    }
+    for (vk::Fence fence : fences) {
+        device.destroyFence(fence);
+    }
+    device.destroyCommandPool(commandPool);
+
+    device.destroyFramebuffer(framebuffer);
+    device.destroyRenderPass(renderPass);
+    device.destroyImageView(imageView);
+    device.destroyImage(image);
+    device.freeMemory(imageMemory);
+    device.destroyImageView(depthImageView);
+    device.destroyImage(depthImage);
+    device.freeMemory(depthImageMemory);
+
+    device.destroy();
+    instance.destroy();
+}
+
+void Replayer::createDevice() {
+    vk::ApplicationInfo appInfo{};
+    appInfo.pApplicationName = "Replay";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    // Vulkan 1.1 if the loader has it, like the app, which buffer device
+    // addresses need
+    instanceApiVersion = VK_API_VERSION_1_0;
+#ifdef VK_VERSION_1_1
+    auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr && enumerateInstanceVersion(&loaderVersion) == VK_SUCCESS &&
+        loaderVersion >= VK_API_VERSION_1_1) {
+        instanceApiVersion = VK_API_VERSION_1_1;
+    }
+#endif
+    appInfo.apiVersion = instanceApiVersion;
+
+    // The optional device extensions depend on this one
+    std::vector<const char*> instanceExtensions;
+    bool instanceSupportsProperties2 = false;
+    for (const auto& extension : vk::enumerateInstanceExtensionProperties()) {
+        if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+            instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            instanceSupportsProperties2 = true;
+        }
+    }
+
+    vk::InstanceCreateInfo instanceInfo{};
+    instanceInfo.pApplicationInfo = &appInfo;
+    instanceInfo.enabledExtensionCount = (uint32_t)instanceExtensions.size();
+    instanceInfo.ppEnabledExtensionNames = instanceExtensions.data();
+    instance = vk::createInstance(instanceInfo);
+
+    // Use the first device with a graphics queue. There is no surface, so
+    // presenting doesn't matter
+    bool found = false;
+    for (vk::PhysicalDevice candidate : instance.enumeratePhysicalDevices()) {
+        auto queueFamilies = candidate.getQueueFamilyProperties();
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics) {
+                physicalDevice = candidate;
+                queueFamily = i;
+                timestampsSupported = queueFamilies[i].timestampValidBits > 0;
+                found = true;
+                break;
+            }
+        }
+        if (found) {
+            break;
+        }
+    }
+    if (!found) {
+        throw std::runtime_error("ERROR: Failed to find suitable graphics card.");
+    }
+    timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+
+    // Memory is allocated for addresses with a flag from device groups, which
+    // are core in Vulkan 1.1
+    bool hasVulkan11 = instanceApiVersion >= VK_API_VERSION_1_1 &&
+        physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_1;
+
+    std::unordered_set<std::string> enabledExtensions;
+    std::vector<const char*> extensionNames;
+    if (instanceSupportsProperties2) {
+        auto supported = physicalDevice.enumerateDeviceExtensionProperties();
+        for (const char* extensionName : OPTIONAL_DEVICE_EXTENSIONS) {
+#ifdef VK_KHR_buffer_device_address
+            if (!hasVulkan11 && strcmp(extensionName, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME) == 0) {
+                continue;
+            }
+#endif
+            for (const auto& extension : supported) {
+                if (strcmp(extensionName, extension.extensionName) == 0) {
+                    enabledExtensions.insert(extensionName);
+                    extensionNames.push_back(extensionName);
+                    break;
+                }
+            }
+        }
+    }
+
+    float queuePriority = 1.f;
+    vk::DeviceQueueCreateInfo queueInfo{};
+    queueInfo.queueFamilyIndex = queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &queuePriority;
+
+    vk::PhysicalDeviceFeatures deviceFeatures{};
+    vk::DeviceCreateInfo deviceInfo{};
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.pEnabledFeatures = &deviceFeatures;
+    deviceInfo.enabledExtensionCount = (uint32_t)extensionNames.size();
+    deviceInfo.ppEnabledExtensionNames = extensionNames.data();
+
+    features.query(instance, physicalDevice, enabledExtensions);
+    features.chainEnabledFeatures(&deviceInfo);
+
+    device = physicalDevice.createDevice(deviceInfo);
+    queue = device.getQueue(queueFamily, 0);
+
+#ifdef VK_KHR_buffer_device_address
+    getBufferDeviceAddress = nullptr;
+    if (features.bufferDeviceAddress) {
+        getBufferDeviceAddress = (PFN_vkGetBufferDeviceAddressKHR) device.getProcAddr("vkGetBufferDeviceAddressKHR");
+        if (getBufferDeviceAddress == nullptr) {
+            throw std::runtime_error("ERROR: Could not load vkGetBufferDeviceAddressKHR.");
+        }
+    }
+#endif
+}
+
+void Replayer::createTarget(vk::Format format, vk::Format depthFormat) {
+    // One image as large as the largest frame, which every frame draws to
+    maxExtent = vk::Extent2D(1, 1);
+    CaptureRecord record;
+    while (reader->next(&record)) {
+        if (record.opcode == CAPTURE_BEGIN_FRAME) {
+            uint32_t width = record.read<uint32_t>();
+            uint32_t height = record.read<uint32_t>();
+            maxExtent.width = std::max(maxExtent.width, width);
+            maxExtent.height = std::max(maxExtent.height, height);
+        }
+    }
+
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = format;
+    imageInfo.extent = vk::Extent3D(maxExtent.width, maxExtent.height, 1);
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    image = device.createImage(imageInfo);
+
+    vk::MemoryRequirements requirements = device.getImageMemoryRequirements(image);
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.allocationSize = requirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    imageMemory = device.allocateMemory(allocateInfo);
+    device.bindImageMemory(image, imageMemory, 0);
+
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = image;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+    imageView = device.createImageView(viewInfo);
+
+    imageInfo.format = depthFormat;
+    imageInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    depthImage = device.createImage(imageInfo);
+
+    requirements = device.getImageMemoryRequirements(depthImage);
+    allocateInfo.allocationSize = requirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    depthImageMemory = device.allocateMemory(allocateInfo);
+    device.bindImageMemory(depthImage, depthImageMemory, 0);
+
+    viewInfo.image = depthImage;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
+    depthImageView = device.createImageView(viewInfo);
+
+    // The same as the app's render pass, except that the image isn't
+    // presented. Every frame draws to the one image and depth buffer, so
+    // frames in flight must also wait for the previous frame's writes
+    vk::AttachmentDescription colorAttachment{};
+    colorAttachment.format = format;
+    colorAttachment.samples = vk::SampleCountFlagBits::e1;
+    colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+    colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+    colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
+    colorAttachment.finalLayout = vk::ImageLayout::eTransferSrcOptimal;
+
+    vk::AttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
+
+    vk::AttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = vk::SampleCountFlagBits::e1;
+    depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+    depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+    depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
+    depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    vk::AttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    vk::SubpassDescription subpassDescription{};
+    subpassDescription.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+    subpassDescription.colorAttachmentCount = 1;
+    subpassDescription.pColorAttachments = &colorAttachmentRef;
+    subpassDescription.pDepthStencilAttachment = &depthAttachmentRef;
+
+    vk::SubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                              vk::PipelineStageFlagBits::eLateFragmentTests;
+    dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite |
+                               vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                              vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite |
+                               vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+    std::array<vk::AttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+    vk::RenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.attachmentCount = (uint32_t)attachments.size();
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpassDescription;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+    renderPass = device.createRenderPass(renderPassInfo);
+
+    vk::FramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.renderPass = renderPass;
+    std::array<vk::ImageView, 2> framebufferAttachments = { imageView, depthImageView };
+    framebufferInfo.attachmentCount = (uint32_t)framebufferAttachments.size();
+    framebufferInfo.pAttachments = framebufferAttachments.data();
+    framebufferInfo.width = maxExtent.width;
+    framebufferInfo.height = maxExtent.height;
+    framebufferInfo.layers = 1;
+    framebuffer = device.createFramebuffer(framebufferInfo);
+}
+
+void Replayer::createResources() {
+    // The app may reuse a destroyed buffer's handle for a new buffer, so each
+    // id gets one buffer large enough for every buffer it names
+    std::unordered_map<uint64_t, vk::BufferCreateInfo> bufferInfos;
+
+    reader->rewind();
+    CaptureRecord record;
+    while (reader->next(&record)) {
+        if (record.opcode == CAPTURE_SHADER) {
+            uint32_t id = record.read<uint32_t>();
+            size_t size = record.remaining();
+            std::vector<uint32_t> code(size / sizeof(uint32_t));
+            memcpy(code.data(), record.readBytes(size), code.size() * sizeof(uint32_t));
+            shaders["capture/" + std::to_string(id)] = code;
+        } else if (record.opcode == CAPTURE_PIPELINE) {
+            uint32_t id = record.read<uint32_t>();
+            if (id != pipelineKeys.size()) {
+                throw std::runtime_error("ERROR: Capture pipelines are out of order");
+            }
+
+            PipelineKey key;
+            key.vertexShader.sourcePath = "capture/" + std::to_string(record.read<uint32_t>());
+            key.fragmentShader.sourcePath = "capture/" + std::to_string(record.read<uint32_t>());
+            key.topology = static_cast<vk::PrimitiveTopology>(record.read<uint32_t>());
+            key.primitiveRestartEnable = record.read<uint8_t>();
+            key.cullMode = static_cast<vk::CullModeFlags>(record.read<VkCullModeFlags>());
+            key.frontFace = static_cast<vk::FrontFace>(record.read<uint32_t>());
+            key.depthTestEnable = record.read<uint8_t>();
+            key.depthWriteEnable = record.read<uint8_t>();
+            pipelineKeys.push_back(key);
+
+            vk::PipelineLayout layout;
+            pipelineLibrary.getPipeline(key, &layout);
+        } else if (record.opcode == CAPTURE_CREATE_BUFFER) {
+            uint64_t id = record.read<uint64_t>();
+            vk::DeviceSize size = record.read<uint64_t>();
+            vk::BufferUsageFlags usage = static_cast<vk::BufferUsageFlags>(record.read<VkBufferUsageFlags>());
+            vk::BufferCreateInfo& bufferInfo = bufferInfos[id];
+            bufferInfo.size = std::max(bufferInfo.size, size);
+            bufferInfo.usage |= usage;
+        }
+    }
+
+    for (auto& entry : bufferInfos) {
+        // Uploads into a frame are recorded as transfers
+        buffers[entry.first] = createBuffer(entry.second.size,
+                                            entry.second.usage | vk::BufferUsageFlagBits::eTransferDst);
+    }
+
+    // Let the optimized links finish and swap them in, so no pipeline
+    // changes while timing
+    pipelineLibrary.waitIdle();
+    pipelineLibrary.update();
+    for (const PipelineKey& key : pipelineKeys) {
+        vk::PipelineLayout layout;
+        pipelines.push_back(pipelineLibrary.getPipeline(key, &layout));
+        pipelineLayouts.push_back(layout);
+    }
+
+    createDescriptorSets();
+}
+
+ReplayBuffer Replayer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage) {
+    // Host visible, so uploads are a copy into mapped memory
+    ReplayBuffer replayBuffer;
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+#ifdef VK_KHR_buffer_device_address
+    if (getBufferDeviceAddress == nullptr) {
+        bufferInfo.usage &= ~vk::BufferUsageFlags(vk::BufferUsageFlagBits::eShaderDeviceAddressKHR);
+    }
+#endif
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    replayBuffer.buffer = device.createBuffer(bufferInfo);
+
+    vk::MemoryRequirements requirements = device.getBufferMemoryRequirements(replayBuffer.buffer);
+    vk::MemoryAllocateInfo allocateInfo{};
+    allocateInfo.allocationSize = requirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    // Vertex pulling reads the buffer through its address. Without
+    // addresses, only captures that don't pull vertices can be replayed
+    bool needsAddress = false;
+#ifdef VK_KHR_buffer_device_address
+    vk::MemoryAllocateFlagsInfo flagsInfo{};
+    if ((usage & vk::BufferUsageFlagBits::eShaderDeviceAddressKHR) && getBufferDeviceAddress != nullptr) {
+        flagsInfo.flags = vk::MemoryAllocateFlagBits::eDeviceAddressKHR;
+        allocateInfo.pNext = &flagsInfo;
+        needsAddress = true;
+    }
+#endif
+
+    replayBuffer.memory = device.allocateMemory(allocateInfo);
+    device.bindBufferMemory(replayBuffer.buffer, replayBuffer.memory, 0);
+    replayBuffer.mapped = device.mapMemory(replayBuffer.memory, 0, size);
+
+    replayBuffer.address = 0;
+#ifdef VK_KHR_buffer_device_address
+    if (needsAddress) {
+        VkBufferDeviceAddressInfoKHR addressInfo{};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+        addressInfo.buffer = static_cast<VkBuffer>(replayBuffer.buffer);
+        replayBuffer.address = getBufferDeviceAddress(static_cast<VkDevice>(device), &addressInfo);
+    }
+#endif
+    return replayBuffer;
+}
+
+void Replayer::createDescriptorSets() {
+    // The sets are found by following which pipeline is bound, since a set's
+    // layout comes from the pipeline's shaders
+    std::unordered_map<uint32_t, ShaderReflection> reflections;
+    std::vector<std::string> keys;
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    std::vector<std::vector<std::pair<uint32_t, uint64_t> > > setBuffers;
+    uint32_t descriptorCount = 0;
+
+    uint32_t pipeline = 0;
+    reader->rewind();
+    CaptureRecord record;
+    while (reader->next(&record)) {
+        if (record.opcode == CAPTURE_BIND_PIPELINE) {
+            pipeline = record.read<uint32_t>();
+        } else if (record.opcode == CAPTURE_BIND_STORAGE_BUFFERS) {
+            // Filled in once every set is allocated
+            std::string key = getDescriptorSetKey(pipeline, record);
+            if (!descriptorSets.emplace(key, vk::DescriptorSet()).second) {
+                continue;
+            }
+
+            auto it = reflections.find(pipeline);
+            if (it == reflections.end()) {
+                const PipelineKey& pipelineKey = pipelineKeys.at(pipeline);
+                ShaderReflection reflection = ShaderReflection::reflect(shaders.at(pipelineKey.vertexShader.sourcePath));
+                reflection.merge(ShaderReflection::reflect(shaders.at(pipelineKey.fragmentShader.sourcePath)));
+                it = reflections.emplace(pipeline, reflection).first;
+            }
+
+            uint32_t set = record.read<uint32_t>();
+            uint32_t count = record.read<uint32_t>();
+            std::vector<std::pair<uint32_t, uint64_t> > bindings;
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t binding = record.read<uint32_t>();
+                bindings.push_back(std::make_pair(binding, record.read<uint64_t>()));
+            }
+
+            keys.push_back(key);
+            setLayouts.push_back(layoutCache.getDescriptorSetLayout(it->second.descriptorSets[set]));
+            setBuffers.push_back(bindings);
+            descriptorCount += count;
+        }
+    }
+
+    // A pool can't be empty
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, std::max(descriptorCount, 1u));
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = std::max((uint32_t)keys.size(), 1u);
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    descriptorPool = device.createDescriptorPool(poolInfo);
+    if (keys.empty()) {
+        return;
+    }
+
+    vk::DescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.descriptorPool = descriptorPool;
+    allocateInfo.descriptorSetCount = (uint32_t)setLayouts.size();
+    allocateInfo.pSetLayouts = setLayouts.data();
+    std::vector<vk::DescriptorSet> sets = device.allocateDescriptorSets(allocateInfo);
+
+    std::vector<vk::DescriptorBufferInfo> bufferInfos;
+    bufferInfos.reserve(descriptorCount);
+    std::vector<vk::WriteDescriptorSet> writes;
+    for (size_t i = 0; i < sets.size(); i++) {
+        descriptorSets[keys[i]] = sets[i];
+        for (const auto& binding : setBuffers[i]) {
+            bufferInfos.push_back(vk::DescriptorBufferInfo(buffers.at(binding.second).buffer, 0, VK_WHOLE_SIZE));
+            writes.push_back(vk::WriteDescriptorSet(sets[i], binding.first, 0, 1, vk::DescriptorType::eStorageBuffer,
+                                                    nullptr, &bufferInfos.back()));
+        }
+    }
+    device.updateDescriptorSets(writes, nullptr);
+}
+
+std::string Replayer::getDescriptorSetKey(uint32_t pipeline, const CaptureRecord& record) {
+    // The payload is the set and its buffers, read from the start
+    std::string key(reinterpret_cast<const char*>(&pipeline), sizeof(pipeline));
+    key.append(reinterpret_cast<const char*>(record.payload), record.size);
+    return key;
+}
+
+void Replayer::beginRenderPass() {
+    if (inRenderPass) {
+        return;
+    }
+    inRenderPass = true;
+
+    // The uploads are draws, instances and geometry
+    if (frameUploaded) {
+        vk::MemoryBarrier uploadBarrier(vk::AccessFlagBits::eTransferWrite,
+                                        vk::AccessFlagBits::eIndirectCommandRead |
+                                        vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead |
+                                        vk::AccessFlagBits::eShaderRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eDrawIndirect |
+                                      vk::PipelineStageFlagBits::eVertexInput |
+                                      vk::PipelineStageFlagBits::eVertexShader,
+                                      {}, uploadBarrier, nullptr, nullptr);
+    }
+
+    std::array<float, 4> color = { 0.f, 0.f, 0.f, 1.f };
+    std::array<vk::ClearValue, 2> clearValues = {
+        vk::ClearColorValue(color),
+        vk::ClearDepthStencilValue(1.f, 0)
+    };
+    vk::RenderPassBeginInfo renderPassBeginInfo{};
+    renderPassBeginInfo.renderPass = renderPass;
+    renderPassBeginInfo.framebuffer = framebuffer;
+    renderPassBeginInfo.renderArea.extent = frameExtent;
+    renderPassBeginInfo.clearValueCount = (uint32_t)clearValues.size();
+    renderPassBeginInfo.pClearValues = clearValues.data();
+    commandBuffer.beginRenderPass(&renderPassBeginInfo, vk::SubpassContents::eInline);
+}
+
+uint32_t Replayer::findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) {
+    vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("ERROR: Failed to find a suitable memory type.");
+}
+
+void Replayer::waitForFrame(int frame) {
+    device.waitForFences(fences[frame], VK_TRUE, UINT64_MAX);
+    if (!timestampsPending[frame]) {
+        return;
+    }
+    timestampsPending[frame] = false;
+
+    uint64_t timestamps[2];
+    VkResult result = vkGetQueryPoolResults(static_cast<VkDevice>(device), static_cast<VkQueryPool>(queryPool),
+                                            2 * frame, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+        gpuFrameTimes.push_back((timestamps[1] - timestamps[0]) * timestampPeriod / 1e6);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // The iteration count must be a whole number of at least 1
+    int iterations = 1;
+    if (argc == 3) {
+        char* end = nullptr;
+        long count = std::strtol(argv[2], &end, 10);
+        iterations = argv[2][0] >= '0' && argv[2][0] <= '9' && *end == '\0' && count > 0 && count <= INT32_MAX
+            ? (int)count : 0;
+    }
+    if ((argc != 2 && argc != 3) || iterations == 0) {
+        std::cerr << "Usage: " << argv[0] << " <capture> [iterations]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        CaptureReader reader;
+        reader.open(argv[1]);
+
+        Replayer replayer;
+        replayer.initialize(&reader);
+
+        for (int i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            uint32_t frames = replayer.replay();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            std::cout << "Iteration " << i << ": " << frames << " frames in " << elapsed.count() << " ms ("
+                      << (frames > 0 ? elapsed.count() / frames : 0.0) << " ms per frame)" << std::endl;
+        }
+
+        std::vector<double>& gpuTimes = replayer.gpuFrameTimes;
+        if (!gpuTimes.empty()) {
+            std::sort(gpuTimes.begin(), gpuTimes.end());
+            double total = 0.0;
+            for (double time : gpuTimes) {
+                total += time;
+            }
+            std::cout << "GPU time per frame: mean " << total / gpuTimes.size()
+                      << " ms, median " << gpuTimes[gpuTimes.size() / 2]
+                      << " ms, min " << gpuTimes.front()
+                      << " ms, max " << gpuTimes.back() << " ms" << std::endl;
+        }
+
+        replayer.destroy();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
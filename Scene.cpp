@@ -0,0 +1,204 @@
+// October 18, 2026
+
+#include "Scene.hpp"
+
+#include <cstring>
+
+// A repeatable random number in [0, 1) for each seed, so the city is the
+// same every run
+static float random(uint32_t seed) {
+    seed ^= seed >> 16;
+    seed *= 0x7feb352d;
+    seed ^= seed >> 15;
+    seed *= 0x846ca68b;
+    seed ^= seed >> 16;
+    return (float)(seed >> 8) / (float)(1 << 24);
+}
+
+// Packs a color into RGBA8
+static uint32_t packColor(float r, float g, float b) {
+    return (uint32_t)(r * 255.f) | ((uint32_t)(g * 255.f) << 8) | ((uint32_t)(b * 255.f) << 16) | (255u << 24);
+}
+
+// ***** Public methods *****
+
+void Scene::initialize(vk::Device device, vk::Queue queue, uint32_t queueFamilyIndex, MemoryAllocator* allocator,
+                       CompletionService* completionService, GeometryArena* geometryArena) {
+    this->device = device;
+    this->allocator = allocator;
+    this->completionService = completionService;
+    this->geometryArena = geometryArena;
+    vertexPulling = false;
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    buildCube(&vertices, &indices);
+    std::vector<Instance> instances = buildCity();
+    instanceCount = (uint32_t)instances.size();
+
+    mesh = geometryArena->add(queue, queueFamilyIndex, vertices.data(), (uint32_t)vertices.size(), sizeof(Vertex),
+                              indices);
+    // The instances aren't moved, since they are in the culler's descriptor
+    // sets. Frame captures read them back
+    instanceBuffer = createBuffer(queue, queueFamilyIndex,
+                                  vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+                                  instances.data(), instances.size() * sizeof(Instance), &instanceAllocation);
+}
+
+void Scene::destroy() {
+    geometryArena->remove(mesh);
+    allocator->destroyBuffer(instanceBuffer, instanceAllocation);
+}
+
+PipelineKey Scene::getPipelineKey() const {
+    PipelineKey key;
+    if (vertexPulling) {
+        // Without vertex inputs, the reflection gives the pipeline no vertex
+        // input state
+        key.vertexShader = ShaderVariant{ VERT_SOURCE_PATH, VERT_PULLING_PATH, { { "VERTEX_PULLING", "1" } } };
+    } else {
+        key.vertexShader = ShaderVariant{ VERT_SOURCE_PATH, VERT_PATH, {} };
+    }
+    key.fragmentShader = ShaderVariant{ FRAG_SOURCE_PATH, FRAG_PATH, {} };
+    key.cullMode = vk::CullModeFlagBits::eBack;
+    // The projection flips y, which keeps counterclockwise faces
+    // counterclockwise on screen
+    key.frontFace = vk::FrontFace::eCounterClockwise;
+    key.depthTestEnable = true;
+    key.depthWriteEnable = true;
+    return key;
+}
+
+void Scene::draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout, vk::DescriptorSet instanceSet,
+                 vk::Buffer drawBuffer, const float* viewProjection) {
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, instanceSet, nullptr);
+    commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, 16 * sizeof(float), viewProjection);
+    if (vertexPulling) {
+        // The vertex shader reads the vertex at each index itself. The index
+        // already has the mesh's vertex offset added, so the address is the
+        // arena's, which moves with the arena
+        vk::DeviceAddress vertexAddress = geometryArena->getVertexAddress();
+        commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 16 * sizeof(float),
+                                    sizeof(vertexAddress), &vertexAddress);
+    }
+    commandBuffer.drawIndexedIndirect(drawBuffer, 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+// ***** Private methods *****
+
+void Scene::buildCube(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices) {
+    // Each face is its normal, and two axes along it whose cross product is
+    // the normal, so the corners go counterclockwise seen from outside
+    const float faces[6][3][3] = {
+        { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+        { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+        { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+        { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+        { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+        { { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+    };
+    const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+    for (const auto& face : faces) {
+        uint32_t first = (uint32_t)vertices->size();
+        for (const auto& corner : corners) {
+            Vertex vertex;
+            for (int axis = 0; axis < 3; axis++) {
+                vertex.position[axis] = face[0][axis] + corner[0] * face[1][axis] + corner[1] * face[2][axis];
+                vertex.normal[axis] = face[0][axis];
+            }
+            vertices->push_back(vertex);
+        }
+        for (uint32_t index : { 0, 1, 2, 0, 2, 3 }) {
+            indices->push_back(first + index);
+        }
+    }
+}
+
+std::vector<Scene::Instance> Scene::buildCity() {
+    std::vector<Instance> instances;
+    float size = BLOCKS * BLOCK_SIZE;
+
+    // The ground is a flat box under the whole city
+    Instance ground{};
+    ground.center[1] = -0.5f;
+    ground.extent[0] = size / 2.f;
+    ground.extent[1] = 0.5f;
+    ground.extent[2] = size / 2.f;
+    ground.color = packColor(0.25f, 0.25f, 0.27f);
+    instances.push_back(ground);
+
+    // Mostly mid-rise buildings, with the odd tower
+    for (uint32_t z = 0; z < BLOCKS; z++) {
+        for (uint32_t x = 0; x < BLOCKS; x++) {
+            uint32_t seed = (z * BLOCKS + x) * 4;
+            float height = 6.f + 14.f * random(seed);
+            if (random(seed + 1) > 0.9f) {
+                height += 40.f * random(seed + 2);
+            }
+            float shade = 0.5f + 0.4f * random(seed + 3);
+
+            Instance building{};
+            building.extent[0] = 3.f + 1.5f * random(seed + 4 * BLOCKS * BLOCKS);
+            building.extent[1] = height / 2.f;
+            building.extent[2] = 3.f + 1.5f * random(seed + 4 * BLOCKS * BLOCKS + 1);
+            building.center[0] = ((float)x + 0.5f) * BLOCK_SIZE - size / 2.f;
+            building.center[1] = height / 2.f;
+            building.center[2] = ((float)z + 0.5f) * BLOCK_SIZE - size / 2.f;
+            building.color = packColor(shade, shade * 0.95f, shade * 0.9f);
+            instances.push_back(building);
+        }
+    }
+
+    return instances;
+}
+
+vk::Buffer Scene::createBuffer(vk::Queue queue, uint32_t queueFamilyIndex, vk::BufferUsageFlags usage,
+                               const void* data, vk::DeviceSize size, Allocation* allocation) {
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = size;
+    bufferInfo.usage = usage | vk::BufferUsageFlagBits::eTransferDst;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    vk::Buffer buffer = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {}, allocation);
+
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    Allocation stagingAllocation;
+    vk::Buffer stagingBuffer = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible, {},
+                                                       &stagingAllocation);
+    memcpy(stagingAllocation.mapped, data, size);
+    allocator->flush(stagingAllocation, 0, size);
+
+    vk::CommandPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    vk::CommandPool commandPool = device.createCommandPool(poolInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocateInfo.commandBufferCount = 1;
+    vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(allocateInfo)[0];
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+    commandBuffer.copyBuffer(stagingBuffer, buffer, vk::BufferCopy(0, 0, size));
+
+    // The instances are read by the culling pass of later frames
+    vk::MemoryBarrier uploadBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexShader,
+                                  {}, uploadBarrier, nullptr, nullptr);
+    commandBuffer.end();
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    queue.submit(submitInfo, nullptr);
+
+    completionService->onQueueComplete(queue, [this, commandPool, stagingBuffer, stagingAllocation]() {
+        device.destroyCommandPool(commandPool);
+        allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+    });
+    return buffer;
+}
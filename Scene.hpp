@@ -0,0 +1,178 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <string>
+
+#include "MemoryAllocator.hpp"
+#include "CompletionService.hpp"
+#include "GeometryArena.hpp"
+#include "PipelineLibrary.hpp"
+
+/**
+ * A dense city of boxes, for scenes where most of what is in view is hidden
+ * behind something closer.
+ *
+ * Every building is an instance of one unit cube, scaled and moved by its
+ * instance data. The cube is a mesh in the geometry arena. The instances are
+ * read by the culling pass, which writes the instances to draw and the
+ * indirect draw that draws them, so the scene is drawn without the CPU
+ * knowing what is visible.
+ *
+ * With buffer device addresses, the vertex shader can instead pull its
+ * vertices through the arena's vertex buffer address, given in a push
+ * constant, rather than through fixed function vertex input. The two paths
+ * draw the same, so they can be compared by switching between them while
+ * running.
+ */
+class Scene {
+public:
+    /** An instance of the cube, as read by the shaders */
+    struct Instance {
+        float center[3];
+        /** RGBA8 */
+        uint32_t color;
+        /** Half the size of the box */
+        float extent[3];
+        float padding;
+    };
+
+    /** The number of blocks along each side of the city */
+    inline static const uint32_t BLOCKS = 64;
+    /** The width of a block, including the streets around it */
+    inline static const float BLOCK_SIZE = 12.f;
+
+    /**
+     * Builds the city and uploads it, without waiting for the uploads. Work
+     * submitted to the queue afterwards sees the scene
+     *
+     * Requires: The queue is not being used by another thread
+     *
+     * @param device The logical device
+     * @param queue The queue to upload with
+     * @param queueFamilyIndex The family of the queue
+     * @param allocator Allocates the memory of the instance buffer
+     * @param completionService Frees the staging once the upload is done
+     * @param geometryArena Holds the cube
+     */
+    void initialize(vk::Device device, vk::Queue queue, uint32_t queueFamilyIndex, MemoryAllocator* allocator,
+                    CompletionService* completionService, GeometryArena* geometryArena);
+
+    /**
+     * Destroys the instance buffer, and frees the cube in the arena
+     *
+     * Requires: No frame drawing the scene is still in use
+     */
+    void destroy();
+
+    /**
+     * @return The shaders and state of the pipeline that draws the scene,
+     *         which depends on whether vertices are pulled
+     */
+    PipelineKey getPipelineKey() const;
+
+    /**
+     * @return The GLSL sources of the shaders, for the shader watcher
+     */
+    static std::vector<std::string> getShaderSources() { return { VERT_SOURCE_PATH, FRAG_SOURCE_PATH }; }
+
+    /**
+     * @return Whether the vertex shader can pull the vertices through the
+     *         vertex buffer's address
+     */
+    bool supportsVertexPulling() const { return geometryArena->getVertexAddress() != 0; }
+
+    /**
+     * Switches between pulling the vertices in the vertex shader and fixed
+     * function vertex input. The pipeline has to be got again after
+     *
+     * Requires: Vertex pulling is supported, if enabling it
+     */
+    void setVertexPulling(bool enabled) { vertexPulling = enabled; }
+
+    bool isVertexPulling() const { return vertexPulling; }
+
+    /**
+     * @return The storage buffer of the instances
+     */
+    vk::Buffer getInstanceBuffer() const { return instanceBuffer; }
+
+    uint32_t getInstanceCount() const { return instanceCount; }
+
+    /**
+     * @return Where the cube is in the geometry arena, which the indirect
+     *         draws draw from
+     */
+    const GeometryArena::Mesh& getMesh() const { return mesh; }
+
+    /**
+     * @return The width of the city, which is square and centered on the
+     *         origin
+     */
+    float getSize() const { return BLOCKS * BLOCK_SIZE; }
+
+    /**
+     * Draws the instances chosen by an indirect draw
+     *
+     * Requires: The pipeline of getPipelineKey() and the geometry arena are
+     *           bound
+     *
+     * @param commandBuffer The command buffer, in a render pass
+     * @param layout The layout of the pipeline
+     * @param instanceSet The descriptor set with the instances and the
+     *                    instances to draw
+     * @param drawBuffer Holds the vk::DrawIndexedIndirectCommand at offset 0,
+     *                   with the first index and vertex offset of getMesh()
+     * @param viewProjection The view projection matrix, as 16 floats
+     */
+    void draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout, vk::DescriptorSet instanceSet,
+              vk::Buffer drawBuffer, const float* viewProjection);
+
+private:
+    /** The paths to the shaders */
+    inline static const std::string VERT_SOURCE_PATH = "shaders/scene.vert";
+    inline static const std::string VERT_PATH = "shaders/scene_vert.spv";
+    inline static const std::string VERT_PULLING_PATH = "shaders/scene_pulling_vert.spv";
+    inline static const std::string FRAG_SOURCE_PATH = "shaders/scene.frag";
+    inline static const std::string FRAG_PATH = "shaders/scene_frag.spv";
+
+    /** A vertex of the cube */
+    struct Vertex {
+        float position[3];
+        float normal[3];
+    };
+
+    vk::Device device;
+    MemoryAllocator* allocator = nullptr;
+    CompletionService* completionService = nullptr;
+    GeometryArena* geometryArena = nullptr;
+
+    GeometryArena::Mesh mesh;
+    vk::Buffer instanceBuffer;
+    Allocation instanceAllocation;
+    uint32_t instanceCount = 0;
+
+    /** Whether the vertex shader pulls the vertices */
+    bool vertexPulling = false;
+
+    /**
+     * Builds the cube from -1 to 1 on each axis, with counterclockwise front
+     * faces
+     */
+    static void buildCube(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+
+    /**
+     * Builds the ground and a building on each block, of random heights
+     */
+    static std::vector<Instance> buildCity();
+
+    /**
+     * Creates a device local buffer, and copies data into it through a
+     * staging buffer, which is freed once the copy is done
+     */
+    vk::Buffer createBuffer(vk::Queue queue, uint32_t queueFamilyIndex, vk::BufferUsageFlags usage,
+                            const void* data, vk::DeviceSize size, Allocation* allocation);
+};
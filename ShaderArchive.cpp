@@ -0,0 +1,345 @@
+// October 18, 2026
+
+#include "ShaderArchive.hpp"
+
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+// The marker at the start of every archive
+static const char ARCHIVE_MAGIC[4] = { 'S', 'P', 'A', 'K' };
+
+// The marker that starts a permutation declaration in shader source
+static const std::string PERMUTATION_MARKER = "@permutation";
+
+// Helpers for reading and writing the archive
+
+static void writeU32(std::ofstream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void writeU64(std::ofstream& out, uint64_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void writeString(std::ofstream& out, const std::string& string) {
+    writeU32(out, (uint32_t)string.size());
+    out.write(string.data(), string.size());
+}
+
+static uint32_t readU32(std::ifstream& in) {
+    uint32_t value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+static uint64_t readU64(std::ifstream& in) {
+    uint64_t value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+}
+
+static std::string readString(std::ifstream& in) {
+    std::string string(readU32(in), '\0');
+    in.read(&string[0], string.size());
+    return string;
+}
+
+// FNV-1a over a string followed by its length
+static void hashString(uint64_t* hash, const std::string& string) {
+    uint64_t length = string.size();
+    std::string bytes = string + std::string(reinterpret_cast<const char*>(&length), sizeof(length));
+    for (unsigned char byte : bytes) {
+        *hash ^= byte;
+        *hash *= 0x100000001b3ull;
+    }
+}
+
+// ***** Public methods *****
+
+bool ShaderArchive::open(const std::string& path) {
+    close();
+
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    char magic[4];
+    file.read(magic, sizeof(magic));
+    if (!file || !std::equal(magic, magic + 4, ARCHIVE_MAGIC)) {
+        file.close();
+        throw std::runtime_error(std::string("ERROR: Not a valid shader archive: ") + path);
+    }
+    // An archive from before the format changed is rebuilt by "make
+    // shaders", and until then the shaders are compiled
+    if (readU32(file) != ARCHIVE_VERSION) {
+        file.close();
+        return false;
+    }
+
+    uint32_t shaderCount = readU32(file);
+    readU32(file); // The entry count, which is only informational
+    uint32_t tableSize = readU32(file);
+
+    for (uint32_t i = 0; i < shaderCount && file; i++) {
+        std::string shaderName = readString(file);
+        std::vector<Permutation>& permutations = declarations[shaderName];
+
+        permutations.resize(readU32(file));
+        for (auto& permutation : permutations) {
+            permutation.name = readString(file);
+            permutation.values.resize(readU32(file));
+            for (auto& value : permutation.values) {
+                value = readString(file);
+            }
+        }
+    }
+
+    // The table size must be a power of two, for masking instead of modulo
+    if (tableSize == 0 || (tableSize & (tableSize - 1)) != 0) {
+        file.close();
+        throw std::runtime_error(std::string("ERROR: Corrupt shader archive index: ") + path);
+    }
+
+    table.resize(tableSize);
+    for (auto& slot : table) {
+        slot.key = readU64(file);
+        slot.sourceHash = readU64(file);
+        slot.offset = readU32(file);
+        slot.size = readU32(file);
+    }
+
+    if (!file) {
+        file.close();
+        table.clear();
+        throw std::runtime_error(std::string("ERROR: Truncated shader archive: ") + path);
+    }
+
+    // Probing for a missing key stops at an empty slot, which a full table
+    // doesn't have
+    if (std::none_of(table.begin(), table.end(), [](const Slot& slot) { return slot.key == 0; })) {
+        file.close();
+        table.clear();
+        throw std::runtime_error(std::string("ERROR: Corrupt shader archive index: ") + path);
+    }
+
+    return true;
+}
+
+void ShaderArchive::close() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (file.is_open()) {
+        file.close();
+    }
+    declarations.clear();
+    table.clear();
+}
+
+bool ShaderArchive::lookup(const std::string& shaderName, const Defines& defines, uint64_t sourceHash,
+                           std::vector<uint32_t>* code) {
+    const std::vector<Permutation>* declared = findDeclarations(shaderName);
+    if (declared == nullptr) {
+        return false;
+    }
+
+    return lookup(makeKey(shaderName, *declared, defines), sourceHash, code);
+}
+
+bool ShaderArchive::lookup(uint64_t key, uint64_t sourceHash, std::vector<uint32_t>* code) {
+    if (table.empty()) {
+        return false;
+    }
+
+    // Linear probing from the home slot, until the key or an empty slot. No
+    // key is more than a table away from its home
+    size_t mask = table.size() - 1;
+    size_t i = key & mask;
+    for (size_t probes = 0; probes < table.size(); probes++, i = (i + 1) & mask) {
+        const Slot& slot = table[i];
+        if (slot.key == 0) {
+            return false;
+        }
+        if (slot.key != key) {
+            continue;
+        }
+        // Built from other source, such as an archive older than the shaders
+        if (sourceHash != 0 && slot.sourceHash != sourceHash) {
+            return false;
+        }
+
+        // Only now is the SPIR-V itself read
+        std::lock_guard<std::mutex> lock(fileMutex);
+        code->resize(slot.size / sizeof(uint32_t));
+        file.clear();
+        file.seekg(slot.offset);
+        file.read(reinterpret_cast<char*>(code->data()), slot.size);
+        if (!file) {
+            throw std::runtime_error("ERROR: Failed to read shader from archive.");
+        }
+        return true;
+    }
+    return false;
+}
+
+const std::vector<ShaderArchive::Permutation>* ShaderArchive::findDeclarations(const std::string& shaderName) const {
+    auto it = declarations.find(shaderName);
+    if (it == declarations.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+// ***** Static methods *****
+
+std::vector<ShaderArchive::Permutation> ShaderArchive::parsePermutations(const std::string& source) {
+    std::vector<Permutation> permutations;
+
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line)) {
+        // Declarations are comments, so the compiler ignores them
+        size_t commentStart = line.find("//");
+        if (commentStart == std::string::npos) {
+            continue;
+        }
+
+        std::istringstream words(line.substr(commentStart + 2));
+        std::string marker;
+        if (!(words >> marker) || marker != PERMUTATION_MARKER) {
+            continue;
+        }
+
+        Permutation permutation;
+        words >> permutation.name;
+        std::string value;
+        while (words >> value) {
+            permutation.values.push_back(value);
+        }
+
+        if (permutation.name.empty() || permutation.values.empty()) {
+            throw std::runtime_error(std::string("ERROR: Permutation declared without values: ") + line);
+        }
+        permutations.push_back(permutation);
+    }
+
+    return permutations;
+}
+
+uint64_t ShaderArchive::makeKey(const std::string& shaderName, const std::vector<Permutation>& declared, const Defines& defines) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hashString(&hash, shaderName);
+
+    for (const auto& define : completeDefines(declared, defines)) {
+        hashString(&hash, define.first);
+        hashString(&hash, define.second);
+    }
+
+    // 0 marks an empty slot in the index
+    return hash == 0 ? 1 : hash;
+}
+
+ShaderArchive::Defines ShaderArchive::completeDefines(const std::vector<Permutation>& declared, const Defines& defines) {
+    // Every define must be a declared permutation, or else it would silently
+    // be left out of the key
+    for (const auto& define : defines) {
+        auto permutation = std::find_if(declared.begin(), declared.end(), [&define](const Permutation& p) {
+            return p.name == define.first;
+        });
+        if (permutation == declared.end()) {
+            throw std::runtime_error(std::string("ERROR: Undeclared permutation ") + define.first);
+        }
+        if (std::find(permutation->values.begin(), permutation->values.end(), define.second) == permutation->values.end()) {
+            throw std::runtime_error(std::string("ERROR: Undeclared value ") + define.second + " for permutation " + define.first);
+        }
+    }
+
+    Defines complete;
+    for (const auto& permutation : declared) {
+        std::string value = permutation.values[0];
+        for (const auto& define : defines) {
+            if (define.first == permutation.name) {
+                value = define.second;
+            }
+        }
+        complete.push_back({ permutation.name, value });
+    }
+    return complete;
+}
+
+void ShaderArchive::write(const std::string& path, const Declarations& declarations, const std::vector<Entry>& entries) {
+    // Keep the table at most half full, so probes stay short
+    uint32_t tableSize = 1;
+    while (tableSize < entries.size() * 2) {
+        tableSize *= 2;
+    }
+
+    // Compute where the blobs start, so the table can hold absolute offsets
+    size_t headerSize = sizeof(ARCHIVE_MAGIC) + 4 * sizeof(uint32_t);
+    size_t declarationsSize = 0;
+    for (const auto& shader : declarations) {
+        declarationsSize += sizeof(uint32_t) + shader.first.size() + sizeof(uint32_t);
+        for (const auto& permutation : shader.second) {
+            declarationsSize += sizeof(uint32_t) + permutation.name.size() + sizeof(uint32_t);
+            for (const auto& value : permutation.values) {
+                declarationsSize += sizeof(uint32_t) + value.size();
+            }
+        }
+    }
+    size_t tableBytes = tableSize * (2 * sizeof(uint64_t) + 2 * sizeof(uint32_t));
+    size_t offset = headerSize + declarationsSize + tableBytes;
+
+    std::vector<Slot> table(tableSize, Slot{ 0, 0, 0, 0 });
+    for (const auto& entry : entries) {
+        size_t size = entry.code.size() * sizeof(uint32_t);
+        for (size_t i = entry.key & (tableSize - 1);; i = (i + 1) & (tableSize - 1)) {
+            if (table[i].key == entry.key) {
+                throw std::runtime_error("ERROR: Duplicate shader archive key.");
+            }
+            if (table[i].key == 0) {
+                table[i] = { entry.key, entry.sourceHash, (uint32_t)offset, (uint32_t)size };
+                break;
+            }
+        }
+        offset += size;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to open ") + path);
+    }
+
+    out.write(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    writeU32(out, ARCHIVE_VERSION);
+    writeU32(out, (uint32_t)declarations.size());
+    writeU32(out, (uint32_t)entries.size());
+    writeU32(out, tableSize);
+
+    for (const auto& shader : declarations) {
+        writeString(out, shader.first);
+        writeU32(out, (uint32_t)shader.second.size());
+        for (const auto& permutation : shader.second) {
+            writeString(out, permutation.name);
+            writeU32(out, (uint32_t)permutation.values.size());
+            for (const auto& value : permutation.values) {
+                writeString(out, value);
+            }
+        }
+    }
+
+    for (const auto& slot : table) {
+        writeU64(out, slot.key);
+        writeU64(out, slot.sourceHash);
+        writeU32(out, slot.offset);
+        writeU32(out, slot.size);
+    }
+
+    // In the same order as the offsets were assigned
+    for (const auto& entry : entries) {
+        out.write(reinterpret_cast<const char*>(entry.code.data()), entry.code.size() * sizeof(uint32_t));
+    }
+
+    if (!out) {
+        throw std::runtime_error(std::string("ERROR: Failed to write ") + path);
+    }
+}
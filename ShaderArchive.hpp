@@ -0,0 +1,186 @@
+// October 18, 2026
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <fstream>
+#include <mutex>
+
+/**
+ * An indexed archive of prebuilt shader permutations.
+ *
+ * Shaders declare their permutations in their source with lines like
+ *
+ *     // @permutation DESATURATE 0 1
+ *
+ * where the first value is the default. The shader_pack tool compiles only the
+ * permutations listed in a manifest, and packs them into one archive. At
+ * runtime only the header, the declarations and the index are read, so unused
+ * permutations cost nothing at startup. Looking up a permutation is a single
+ * probe into an open addressed hash table, and its SPIR-V is read from the
+ * archive on first use.
+ *
+ * Each entry also keeps the ShaderCompiler key of the source it was built
+ * from, so an archive older than the shaders is noticed and the shaders are
+ * compiled instead.
+ *
+ * Archive layout (all integers little endian):
+ *     Header      "SPAK", version, shader count, entry count, table size
+ *     Shaders     For each shader: name, permutation count, and for each
+ *                 permutation its name, value count and values
+ *     Table       table size slots of (key, source hash, byte offset, byte
+ *                 size), where a key of 0 is an empty slot. There is always
+ *                 an empty slot
+ *     Blobs       The SPIR-V of every entry
+ */
+class ShaderArchive {
+public:
+    /** Preprocessor defines given to the shader, as (name, value) pairs */
+    using Defines = std::vector<std::pair<std::string, std::string> >;
+
+    /** A permutation declared in a shader, and the values it can take */
+    struct Permutation {
+        std::string name;
+        /** The possible values, with the default first */
+        std::vector<std::string> values;
+    };
+
+    /** The permutations declared by each shader, by shader name */
+    using Declarations = std::map<std::string, std::vector<Permutation> >;
+
+    /** A compiled permutation, for writing an archive */
+    struct Entry {
+        uint64_t key;
+        /** The ShaderCompiler::hashShader() of the source and complete
+         *  defines it was compiled from */
+        uint64_t sourceHash;
+        std::vector<uint32_t> code;
+    };
+
+    /**
+     * Opens an archive, reading only the declarations and the index
+     *
+     * @param path The path to the archive
+     *
+     * @return Whether the archive could be opened. A missing archive, or one
+     *         written by another version, is not an error, since the shaders
+     *         can be compiled instead
+     *
+     * @throw std::runtime_error if the file exists but is not a valid archive
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Closes the archive, if it is open
+     */
+    void close();
+
+    /**
+     * @return Whether an archive is open
+     */
+    bool isOpen() const { return file.is_open(); }
+
+    /**
+     * Looks up the SPIR-V of a permutation. Permutations not given in the
+     * defines take their default value. Safe to call from several threads
+     *
+     * @param shaderName The name of the shader source (such as "shader.frag")
+     * @param defines The values of the permutations
+     * @param sourceHash The hash the entry must have been built from, or 0 to
+     *                   take the entry whatever it was built from
+     * @param code Set to the SPIR-V if the permutation is in the archive
+     *
+     * @return Whether the permutation is in the archive, built from the
+     *         source
+     */
+    bool lookup(const std::string& shaderName, const Defines& defines, uint64_t sourceHash,
+                std::vector<uint32_t>* code);
+
+    /**
+     * Looks up the SPIR-V of a permutation by its precomputed key. Safe to call
+     * from several threads
+     *
+     * @param key The key from makeKey()
+     * @param sourceHash The hash the entry must have been built from, or 0 to
+     *                   take the entry whatever it was built from
+     * @param code Set to the SPIR-V if the permutation is in the archive
+     *
+     * @return Whether the permutation is in the archive, built from the
+     *         source
+     */
+    bool lookup(uint64_t key, uint64_t sourceHash, std::vector<uint32_t>* code);
+
+    /**
+     * @return The permutations declared by a shader in the open archive, or
+     *         nullptr if the shader isn't in the archive
+     */
+    const std::vector<Permutation>* findDeclarations(const std::string& shaderName) const;
+
+    /**
+     * Reads the permutation declarations from shader source
+     *
+     * @param source The GLSL source code
+     *
+     * @return The declared permutations, in the order they are declared
+     *
+     * @throw std::runtime_error if a declaration has no values
+     */
+    static std::vector<Permutation> parsePermutations(const std::string& source);
+
+    /**
+     * Computes the key of a permutation. Every declared permutation is part of
+     * the key, with its default if not given, so the key doesn't depend on
+     * which defines are listed or their order
+     *
+     * @param shaderName The name of the shader source
+     * @param declared The permutations declared by the shader
+     * @param defines The values of the permutations
+     *
+     * @return The key, which is never 0
+     *
+     * @throw std::runtime_error if a define isn't a declared permutation, or
+     *        its value isn't one of the declared values
+     */
+    static uint64_t makeKey(const std::string& shaderName, const std::vector<Permutation>& declared, const Defines& defines);
+
+    /**
+     * Fills in the default value of every declared permutation that isn't
+     * given, so the result can be passed to the compiler
+     *
+     * @return The complete defines, in declaration order
+     */
+    static Defines completeDefines(const std::vector<Permutation>& declared, const Defines& defines);
+
+    /**
+     * Writes an archive
+     *
+     * @param path The path to write the archive to
+     * @param declarations The permutations declared by each shader
+     * @param entries The compiled permutations. Keys must be unique
+     *
+     * @throw std::runtime_error if the file could not be written
+     */
+    static void write(const std::string& path, const Declarations& declarations, const std::vector<Entry>& entries);
+
+private:
+    static const uint32_t ARCHIVE_VERSION = 2;
+
+    /** A slot in the index */
+    struct Slot {
+        uint64_t key;
+        uint64_t sourceHash;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    /** Guards reading from the file, which is shared between threads */
+    std::mutex fileMutex;
+    std::ifstream file;
+
+    Declarations declarations;
+    /** The index, with a power of two size */
+    std::vector<Slot> table;
+};
@@ -0,0 +1,159 @@
+// October 18, 2026
+
+#include "ShaderCompiler.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <stdexcept>
+
+// The first word of every SPIR-V module
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+
+// ***** Public methods *****
+
+void ShaderCompiler::initialize(const std::string& cacheDirectory) {
+    this->cacheDirectory = cacheDirectory;
+    std::filesystem::create_directories(cacheDirectory);
+}
+
+std::vector<uint32_t> ShaderCompiler::compileFile(const std::string& sourcePath, const Defines& defines) {
+    std::ifstream sourceFile(sourcePath);
+    if (!sourceFile.is_open()) {
+        throw std::runtime_error(std::string("ERROR: Failed to open ") + sourcePath);
+    }
+
+    std::stringstream source;
+    source << sourceFile.rdbuf();
+
+    return compile(source.str(), sourcePath, kindFromPath(sourcePath), defines);
+}
+
+std::vector<uint32_t> ShaderCompiler::compile(const std::string& source, const std::string& name,
+                                              shaderc_shader_kind kind, const Defines& defines) {
+    uint64_t key = hashShader(source, kind, defines);
+    std::string path = cachePath(key);
+
+    // Look in the cache first. Anything that isn't valid SPIR-V is ignored and
+    // overwritten below
+    std::ifstream cacheFile(path, std::ios::ate | std::ios::binary);
+    if (cacheFile.is_open()) {
+        size_t fileSize = cacheFile.tellg();
+        if (fileSize >= sizeof(uint32_t) && fileSize % sizeof(uint32_t) == 0) {
+            std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+            cacheFile.seekg(0);
+            cacheFile.read(reinterpret_cast<char*>(code.data()), fileSize);
+
+            if (cacheFile && code[0] == SPIRV_MAGIC) {
+                cacheHits++;
+                return code;
+            }
+        }
+    }
+    cacheFile.close();
+
+    cacheMisses++;
+
+    shaderc::CompileOptions options;
+    for (const auto& define : defines) {
+        options.AddMacroDefinition(define.first, define.second);
+    }
+    // Mesh shaders need SPIR-V 1.4, which needs Vulkan 1.1. Everything else
+    // stays on 1.0 so it runs anywhere
+    if (kind == shaderc_task_shader || kind == shaderc_mesh_shader) {
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+        options.SetTargetSpirv(shaderc_spirv_version_1_4);
+    } else {
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    }
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, kind, name.c_str(), options);
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+        throw std::runtime_error(std::string("ERROR: Failed to compile ") + name + "\n" + result.GetErrorMessage());
+    }
+
+    std::vector<uint32_t> code(result.cbegin(), result.cend());
+
+    // Write to a file unique to this thread and then rename it, so that two
+    // threads compiling the same shader never leave a partial cache entry
+    std::stringstream tempPath;
+    tempPath << path << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+
+    std::ofstream outFile(tempPath.str(), std::ios::binary);
+    outFile.write(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+    outFile.close();
+
+    // The cache is only an optimization, so failing to write it is not fatal
+    std::error_code error;
+    if (outFile) {
+        std::filesystem::rename(tempPath.str(), path, error);
+    }
+    if (!outFile || error) {
+        std::filesystem::remove(tempPath.str(), error);
+    }
+
+    return code;
+}
+
+// ***** Static methods *****
+
+shaderc_shader_kind ShaderCompiler::kindFromPath(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+
+    if (extension == ".vert") return shaderc_vertex_shader;
+    if (extension == ".frag") return shaderc_fragment_shader;
+    if (extension == ".comp") return shaderc_compute_shader;
+    if (extension == ".geom") return shaderc_geometry_shader;
+    if (extension == ".tesc") return shaderc_tess_control_shader;
+    if (extension == ".tese") return shaderc_tess_evaluation_shader;
+    if (extension == ".task") return shaderc_task_shader;
+    if (extension == ".mesh") return shaderc_mesh_shader;
+
+    throw std::runtime_error(std::string("ERROR: Unknown shader stage for ") + path);
+}
+
+uint64_t ShaderCompiler::hashShader(const std::string& source, shaderc_shader_kind kind, Defines defines) {
+    // FNV-1a, which is simple and plenty for telling sources apart
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto addBytes = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+    };
+    // Strings are followed by their length, so ("ab", "c") and ("a", "bc")
+    // hash differently
+    auto addString = [&addBytes](const std::string& string) {
+        addBytes(string.data(), string.size());
+        uint64_t length = string.size();
+        addBytes(&length, sizeof(length));
+    };
+
+    uint32_t version = CACHE_VERSION;
+    addBytes(&version, sizeof(version));
+    uint32_t kindValue = (uint32_t)kind;
+    addBytes(&kindValue, sizeof(kindValue));
+    addString(source);
+
+    std::sort(defines.begin(), defines.end());
+    for (const auto& define : defines) {
+        addString(define.first);
+        addString(define.second);
+    }
+
+    return hash;
+}
+
+// ***** Private methods *****
+
+std::string ShaderCompiler::cachePath(uint64_t key) const {
+    std::stringstream path;
+    path << cacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".spv";
+    return path.str();
+}
@@ -0,0 +1,107 @@
+// October 18, 2026
+
+#pragma once
+
+#include <shaderc/shaderc.hpp>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <atomic>
+
+/**
+ * Compiles GLSL to SPIR-V in process with shaderc, and stores the results in a
+ * content-addressed cache on disk. The cache key is a hash of the source, the
+ * shader stage and the defines, so a cold start compiles each shader once and
+ * every later load with unchanged source is a cache hit.
+ *
+ * Compiling is thread safe, so shaders can be compiled on background threads.
+ */
+class ShaderCompiler {
+public:
+    /** Preprocessor defines given to the shader, as (name, value) pairs */
+    using Defines = std::vector<std::pair<std::string, std::string> >;
+
+    /**
+     * Sets up the compiler, creating the cache directory if needed
+     *
+     * @param cacheDirectory The directory to store compiled SPIR-V in
+     */
+    void initialize(const std::string& cacheDirectory);
+
+    /**
+     * Compiles a GLSL file, or loads it from the cache if it has already been
+     * compiled with the same source and defines. The stage is taken from the
+     * file extension (.vert, .frag, .comp, etc.)
+     *
+     * @param sourcePath The path to the GLSL source
+     * @param defines The preprocessor defines to compile with
+     *
+     * @return The SPIR-V code
+     *
+     * @throw std::runtime_error if the file could not be read, the stage is
+     *        unknown, or compilation failed (with the compiler errors)
+     */
+    std::vector<uint32_t> compileFile(const std::string& sourcePath, const Defines& defines = {});
+
+    /**
+     * Compiles GLSL source, or loads it from the cache if it has already been
+     * compiled with the same source and defines
+     *
+     * @param source The GLSL source code
+     * @param name The name of the source, used for error messages
+     * @param kind The shader stage
+     * @param defines The preprocessor defines to compile with
+     *
+     * @return The SPIR-V code
+     *
+     * @throw std::runtime_error if compilation failed
+     */
+    std::vector<uint32_t> compile(const std::string& source, const std::string& name,
+                                  shaderc_shader_kind kind, const Defines& defines = {});
+
+    /**
+     * Gets the shader stage from the extension of a file
+     *
+     * @param path The path of the shader source
+     *
+     * @return The shader kind
+     *
+     * @throw std::runtime_error if the extension is not a known stage
+     */
+    static shaderc_shader_kind kindFromPath(const std::string& path);
+
+    /**
+     * Computes the cache key of a shader. The defines are sorted first, so the
+     * order they are given in doesn't matter
+     *
+     * @return A 64 bit FNV-1a hash of everything that affects the SPIR-V
+     */
+    static uint64_t hashShader(const std::string& source, shaderc_shader_kind kind, Defines defines);
+
+    /**
+     * @return The number of shaders loaded from the cache so far
+     */
+    size_t getCacheHits() const { return cacheHits; }
+
+    /**
+     * @return The number of shaders compiled so far
+     */
+    size_t getCacheMisses() const { return cacheMisses; }
+
+private:
+    /** Bumped whenever the compile options change, to invalidate the cache */
+    static const uint32_t CACHE_VERSION = 1;
+
+    std::string cacheDirectory;
+    shaderc::Compiler compiler;
+
+    // Atomic because shaders can be compiled from several threads
+    std::atomic<size_t> cacheHits{0};
+    std::atomic<size_t> cacheMisses{0};
+
+    /**
+     * @return The path of the cache entry for a key
+     */
+    std::string cachePath(uint64_t key) const;
+};
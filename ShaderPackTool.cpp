@@ -0,0 +1,100 @@
+// October 18, 2026
+
+// The offline step that builds the shader archive. Each line of the manifest
+// names a shader source and the permutation values of one variant that is
+// used, and only those variants are compiled:
+//
+//     shader.frag DESATURATE=1
+//
+// Usage: shader_pack <shader directory> <manifest> <output archive>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include <exception>
+
+#include "ShaderArchive.hpp"
+#include "ShaderCompiler.hpp"
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " <shader directory> <manifest> <output archive>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string shaderDirectory = argv[1];
+    std::string manifestPath = argv[2];
+    std::string outputPath = argv[3];
+
+    try {
+        std::ifstream manifest(manifestPath);
+        if (!manifest.is_open()) {
+            throw std::runtime_error(std::string("ERROR: Failed to open ") + manifestPath);
+        }
+
+        // Share the runtime cache, so unchanged variants aren't recompiled
+        ShaderCompiler compiler;
+        compiler.initialize(shaderDirectory + "/cache");
+
+        ShaderArchive::Declarations declarations;
+        std::vector<ShaderArchive::Entry> entries;
+        std::unordered_set<uint64_t> keys;
+
+        std::string line;
+        while (std::getline(manifest, line)) {
+            std::istringstream words(line);
+            std::string shaderName;
+            if (!(words >> shaderName) || shaderName[0] == '#') {
+                continue;
+            }
+
+            ShaderArchive::Defines defines;
+            std::string define;
+            while (words >> define) {
+                size_t equals = define.find('=');
+                if (equals == std::string::npos) {
+                    throw std::runtime_error(std::string("ERROR: Expected NAME=VALUE, got ") + define);
+                }
+                defines.push_back({ define.substr(0, equals), define.substr(equals + 1) });
+            }
+
+            std::string sourcePath = shaderDirectory + "/" + shaderName;
+            std::ifstream sourceFile(sourcePath);
+            if (!sourceFile.is_open()) {
+                throw std::runtime_error(std::string("ERROR: Failed to open ") + sourcePath);
+            }
+            std::stringstream source;
+            source << sourceFile.rdbuf();
+
+            if (declarations.count(shaderName) == 0) {
+                declarations[shaderName] = ShaderArchive::parsePermutations(source.str());
+            }
+            const auto& declared = declarations[shaderName];
+
+            // The same variant may be listed more than once
+            uint64_t key = ShaderArchive::makeKey(shaderName, declared, defines);
+            if (!keys.insert(key).second) {
+                continue;
+            }
+
+            // The runtime compares the hash with its own source, to notice an
+            // archive older than the shaders
+            ShaderArchive::Defines complete = ShaderArchive::completeDefines(declared, defines);
+            shaderc_shader_kind kind = ShaderCompiler::kindFromPath(sourcePath);
+            uint64_t sourceHash = ShaderCompiler::hashShader(source.str(), kind, complete);
+            entries.push_back({ key, sourceHash, compiler.compile(source.str(), sourcePath, kind, complete) });
+        }
+
+        ShaderArchive::write(outputPath, declarations, entries);
+
+        std::cout << "Packed " << entries.size() << " shader variants into " << outputPath
+                  << " (" << compiler.getCacheMisses() << " compiled, "
+                  << compiler.getCacheHits() << " from cache)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -0,0 +1,446 @@
+// October 18, 2026
+
+#include "ShaderReflection.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+
+// The subset of the SPIR-V specification needed to read shader interfaces
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+static const size_t SPIRV_HEADER_WORDS = 5;
+
+enum SpirvOp {
+    OP_ENTRY_POINT = 15,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_IMAGE = 25,
+    OP_TYPE_SAMPLER = 26,
+    OP_TYPE_SAMPLED_IMAGE = 27,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72,
+};
+
+enum SpirvDecoration {
+    DECORATION_BLOCK = 2,
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BUILT_IN = 11,
+    DECORATION_LOCATION = 30,
+    DECORATION_BINDING = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET = 35,
+};
+
+enum SpirvStorageClass {
+    STORAGE_UNIFORM_CONSTANT = 0,
+    STORAGE_INPUT = 1,
+    STORAGE_UNIFORM = 2,
+    STORAGE_PUSH_CONSTANT = 9,
+    STORAGE_STORAGE_BUFFER = 12,
+};
+
+// The dimensionality of an image that is a texel buffer
+static const uint32_t DIM_BUFFER = 5;
+
+/** Everything read from a module that is needed to reflect it */
+struct SpirvModule {
+    /** The operands (after the result id) of every type, by result id */
+    std::unordered_map<uint32_t, std::pair<uint32_t, std::vector<uint32_t> > > types;
+    /** The value of every 32 bit integer constant, by result id */
+    std::unordered_map<uint32_t, uint32_t> constants;
+    /** The decorations of each id, by id and then decoration */
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t> > decorations;
+    /** The decorations of struct members, by struct id, member and decoration */
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t> > > memberDecorations;
+    /** The (pointer type, storage class) of every variable, by result id */
+    std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t> > > variables;
+    /** The execution model of the first entry point */
+    uint32_t executionModel = ~0u;
+
+    bool hasDecoration(uint32_t id, uint32_t decoration) const {
+        auto it = decorations.find(id);
+        return it != decorations.end() && it->second.count(decoration) > 0;
+    }
+
+    uint32_t getDecoration(uint32_t id, uint32_t decoration) const {
+        auto it = decorations.find(id);
+        if (it == decorations.end() || it->second.count(decoration) == 0) {
+            return 0;
+        }
+        return it->second.at(decoration);
+    }
+
+    uint32_t getMemberDecoration(uint32_t id, uint32_t member, uint32_t decoration) const {
+        auto structIt = memberDecorations.find(id);
+        if (structIt == memberDecorations.end()) return 0;
+        auto memberIt = structIt->second.find(member);
+        if (memberIt == structIt->second.end()) return 0;
+        auto decorationIt = memberIt->second.find(decoration);
+        return decorationIt == memberIt->second.end() ? 0 : decorationIt->second;
+    }
+
+    const std::pair<uint32_t, std::vector<uint32_t> >& getType(uint32_t id) const {
+        auto it = types.find(id);
+        if (it == types.end()) {
+            throw std::runtime_error("ERROR: SPIR-V references an unknown type.");
+        }
+        return it->second;
+    }
+
+    /**
+     * Gets the size of a type in bytes, with the layout given by its Offset,
+     * ArrayStride and MatrixStride decorations
+     */
+    uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0) const {
+        const auto& type = getType(typeId);
+        const std::vector<uint32_t>& operands = type.second;
+
+        switch (type.first) {
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+                return operands[0] / 8;
+            case OP_TYPE_VECTOR:
+                return operands[1] * sizeOf(operands[0]);
+            case OP_TYPE_MATRIX:
+                if (matrixStride != 0) {
+                    return operands[1] * matrixStride;
+                }
+                return operands[1] * sizeOf(operands[0]);
+            case OP_TYPE_ARRAY: {
+                uint32_t length = constants.at(operands[1]);
+                uint32_t stride = getDecoration(typeId, DECORATION_ARRAY_STRIDE);
+                return length * (stride != 0 ? stride : sizeOf(operands[0]));
+            }
+            case OP_TYPE_RUNTIME_ARRAY:
+                // Sized by the buffer bound at runtime
+                return 0;
+            case OP_TYPE_POINTER:
+                // The only pointers in blocks are buffer device addresses
+                return 8;
+            case OP_TYPE_STRUCT: {
+                uint32_t size = 0;
+                for (uint32_t member = 0; member < operands.size(); member++) {
+                    uint32_t offset = getMemberDecoration(typeId, member, DECORATION_OFFSET);
+                    uint32_t stride = getMemberDecoration(typeId, member, DECORATION_MATRIX_STRIDE);
+                    size = std::max(size, offset + sizeOf(operands[member], stride));
+                }
+                return size;
+            }
+            default:
+                throw std::runtime_error("ERROR: Can't compute the size of a SPIR-V type.");
+        }
+    }
+};
+
+/**
+ * Reads every instruction of interest from the module
+ */
+static SpirvModule parseModule(const std::vector<uint32_t>& code) {
+    if (code.size() < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+        throw std::runtime_error("ERROR: Not a valid SPIR-V module.");
+    }
+
+    SpirvModule module;
+
+    for (size_t i = SPIRV_HEADER_WORDS; i < code.size();) {
+        uint32_t opcode = code[i] & 0xffff;
+        uint32_t wordCount = code[i] >> 16;
+        if (wordCount == 0 || i + wordCount > code.size()) {
+            throw std::runtime_error("ERROR: Truncated SPIR-V instruction.");
+        }
+        const uint32_t* words = &code[i];
+
+        switch (opcode) {
+            case OP_ENTRY_POINT:
+                if (module.executionModel == ~0u) {
+                    module.executionModel = words[1];
+                }
+                break;
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+            case OP_TYPE_VECTOR:
+            case OP_TYPE_MATRIX:
+            case OP_TYPE_IMAGE:
+            case OP_TYPE_SAMPLER:
+            case OP_TYPE_SAMPLED_IMAGE:
+            case OP_TYPE_ARRAY:
+            case OP_TYPE_RUNTIME_ARRAY:
+            case OP_TYPE_STRUCT:
+            case OP_TYPE_POINTER:
+                module.types[words[1]] = { opcode, std::vector<uint32_t>(words + 2, words + wordCount) };
+                break;
+            case OP_CONSTANT:
+                module.constants[words[2]] = words[3];
+                break;
+            case OP_VARIABLE:
+                module.variables.push_back({ words[2], { words[1], words[3] } });
+                break;
+            case OP_DECORATE:
+                module.decorations[words[1]][words[2]] = wordCount > 3 ? words[3] : 0;
+                break;
+            case OP_MEMBER_DECORATE:
+                module.memberDecorations[words[1]][words[2]][words[3]] = wordCount > 4 ? words[4] : 0;
+                break;
+        }
+
+        i += wordCount;
+    }
+
+    return module;
+}
+
+/**
+ * Converts a SPIR-V execution model into a Vulkan shader stage
+ */
+static vk::ShaderStageFlagBits stageFromExecutionModel(uint32_t executionModel) {
+    switch (executionModel) {
+        case 0: return vk::ShaderStageFlagBits::eVertex;
+        case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+        case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+        case 3: return vk::ShaderStageFlagBits::eGeometry;
+        case 4: return vk::ShaderStageFlagBits::eFragment;
+        case 5: return vk::ShaderStageFlagBits::eCompute;
+#ifdef VK_EXT_mesh_shader
+        case 5364: return vk::ShaderStageFlagBits::eTaskEXT;
+        case 5365: return vk::ShaderStageFlagBits::eMeshEXT;
+#endif
+        default:
+            throw std::runtime_error("ERROR: Unsupported SPIR-V execution model.");
+    }
+}
+
+/**
+ * Gets the vertex attribute format of a scalar or vector type
+ */
+static vk::Format vertexFormat(const SpirvModule& module, uint32_t typeId) {
+    const auto& type = module.getType(typeId);
+
+    uint32_t componentCount = 1;
+    const auto* scalar = &type;
+    if (type.first == OP_TYPE_VECTOR) {
+        componentCount = type.second[1];
+        scalar = &module.getType(type.second[0]);
+    }
+
+    uint32_t width = scalar->second[0];
+    if (width != 32) {
+        throw std::runtime_error("ERROR: Only 32 bit vertex inputs can be reflected.");
+    }
+
+    if (scalar->first == OP_TYPE_FLOAT) {
+        const vk::Format formats[] = {
+            vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+            vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat,
+        };
+        return formats[componentCount - 1];
+    }
+
+    // Ints have a signedness operand after their width
+    bool isSigned = scalar->second[1] != 0;
+    if (isSigned) {
+        const vk::Format formats[] = {
+            vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+            vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint,
+        };
+        return formats[componentCount - 1];
+    } else {
+        const vk::Format formats[] = {
+            vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+            vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint,
+        };
+        return formats[componentCount - 1];
+    }
+}
+
+// ***** Static methods *****
+
+ShaderReflection ShaderReflection::reflect(const std::vector<uint32_t>& code) {
+    SpirvModule module = parseModule(code);
+
+    ShaderReflection reflection;
+    vk::ShaderStageFlagBits stage = stageFromExecutionModel(module.executionModel);
+    reflection.stages = stage;
+
+    for (const auto& variable : module.variables) {
+        uint32_t variableId = variable.first;
+        uint32_t storageClass = variable.second.second;
+
+        // Variables are always pointers, so look through to what they point to
+        const auto& pointerType = module.getType(variable.second.first);
+        uint32_t typeId = pointerType.second[1];
+
+        if (storageClass == STORAGE_PUSH_CONSTANT) {
+            vk::PushConstantRange range{};
+            range.stageFlags = stage;
+            range.offset = 0;
+            range.size = module.sizeOf(typeId);
+            reflection.pushConstantRanges.push_back(range);
+            continue;
+        }
+
+        if (storageClass == STORAGE_INPUT) {
+            // Built in inputs like gl_VertexIndex aren't vertex attributes
+            if (stage != vk::ShaderStageFlagBits::eVertex || module.hasDecoration(variableId, DECORATION_BUILT_IN)) {
+                continue;
+            }
+
+            uint32_t location = module.getDecoration(variableId, DECORATION_LOCATION);
+            const auto& type = module.getType(typeId);
+            if (type.first == OP_TYPE_MATRIX) {
+                // Matrices take one location for each column
+                uint32_t columnSize = module.sizeOf(type.second[0]);
+                for (uint32_t column = 0; column < type.second[1]; column++) {
+                    reflection.vertexInputs.push_back({ location + column, vertexFormat(module, type.second[0]), columnSize });
+                }
+            } else {
+                reflection.vertexInputs.push_back({ location, vertexFormat(module, typeId), module.sizeOf(typeId) });
+            }
+            continue;
+        }
+
+        if (storageClass != STORAGE_UNIFORM_CONSTANT && storageClass != STORAGE_UNIFORM &&
+            storageClass != STORAGE_STORAGE_BUFFER) {
+            continue;
+        }
+
+        // Arrays of descriptors are bound as one binding with several
+        // descriptors
+        uint32_t descriptorCount = 1;
+        const auto* type = &module.getType(typeId);
+        if (type->first == OP_TYPE_ARRAY) {
+            descriptorCount = module.constants.at(type->second[1]);
+            typeId = type->second[0];
+            type = &module.getType(typeId);
+        } else if (type->first == OP_TYPE_RUNTIME_ARRAY) {
+            typeId = type->second[0];
+            type = &module.getType(typeId);
+        }
+
+        vk::DescriptorType descriptorType;
+        if (storageClass == STORAGE_STORAGE_BUFFER) {
+            descriptorType = vk::DescriptorType::eStorageBuffer;
+        } else if (storageClass == STORAGE_UNIFORM) {
+            // Older SPIR-V marks storage buffers as uniform BufferBlocks
+            descriptorType = module.hasDecoration(typeId, DECORATION_BUFFER_BLOCK)
+                ? vk::DescriptorType::eStorageBuffer
+                : vk::DescriptorType::eUniformBuffer;
+        } else if (type->first == OP_TYPE_SAMPLED_IMAGE) {
+            descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        } else if (type->first == OP_TYPE_SAMPLER) {
+            descriptorType = vk::DescriptorType::eSampler;
+        } else if (type->first == OP_TYPE_IMAGE) {
+            // OpTypeImage operands: sampled type, dim, depth, arrayed, MS,
+            // sampled (1 for sampling, 2 for storage), format
+            bool isStorage = type->second[5] == 2;
+            if (type->second[1] == DIM_BUFFER) {
+                descriptorType = isStorage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+            } else {
+                descriptorType = isStorage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+            }
+        } else {
+            // Something this reflection doesn't handle, such as acceleration
+            // structures
+            continue;
+        }
+
+        vk::DescriptorSetLayoutBinding binding{};
+        binding.binding = module.getDecoration(variableId, DECORATION_BINDING);
+        binding.descriptorType = descriptorType;
+        binding.descriptorCount = descriptorCount;
+        binding.stageFlags = stage;
+        binding.pImmutableSamplers = nullptr;
+
+        uint32_t set = module.getDecoration(variableId, DECORATION_DESCRIPTOR_SET);
+        reflection.descriptorSets[set].push_back(binding);
+    }
+
+    std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const VertexInput& a, const VertexInput& b) {
+        return a.location < b.location;
+    });
+    for (auto& set : reflection.descriptorSets) {
+        std::sort(set.second.begin(), set.second.end(), [](const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b) {
+            return a.binding < b.binding;
+        });
+    }
+
+    return reflection;
+}
+
+// ***** Public methods *****
+
+void ShaderReflection::merge(const ShaderReflection& other) {
+    stages |= other.stages;
+
+    for (const auto& otherSet : other.descriptorSets) {
+        std::vector<vk::DescriptorSetLayoutBinding>& bindings = descriptorSets[otherSet.first];
+
+        for (const auto& otherBinding : otherSet.second) {
+            auto binding = std::find_if(bindings.begin(), bindings.end(), [&otherBinding](const vk::DescriptorSetLayoutBinding& b) {
+                return b.binding == otherBinding.binding;
+            });
+
+            if (binding == bindings.end()) {
+                bindings.push_back(otherBinding);
+            } else if (binding->descriptorType != otherBinding.descriptorType) {
+                throw std::runtime_error("ERROR: Shader stages disagree on the type of descriptor binding "
+                    + std::to_string(otherBinding.binding));
+            } else {
+                binding->stageFlags |= otherBinding.stageFlags;
+                binding->descriptorCount = std::max(binding->descriptorCount, otherBinding.descriptorCount);
+            }
+        }
+
+        std::sort(bindings.begin(), bindings.end(), [](const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b) {
+            return a.binding < b.binding;
+        });
+    }
+
+    // Use a single range visible to every stage that has push constants,
+    // which is always valid and keeps the layouts simple to share
+    if (!other.pushConstantRanges.empty()) {
+        if (pushConstantRanges.empty()) {
+            pushConstantRanges = other.pushConstantRanges;
+        } else {
+            pushConstantRanges[0].stageFlags |= other.pushConstantRanges[0].stageFlags;
+            pushConstantRanges[0].size = std::max(pushConstantRanges[0].size, other.pushConstantRanges[0].size);
+        }
+    }
+
+    vertexInputs.insert(vertexInputs.end(), other.vertexInputs.begin(), other.vertexInputs.end());
+}
+
+bool ShaderReflection::getVertexInputState(vk::VertexInputBindingDescription* binding,
+                                           std::vector<vk::VertexInputAttributeDescription>* attributes) const {
+    attributes->clear();
+    if (vertexInputs.empty()) {
+        return false;
+    }
+
+    uint32_t offset = 0;
+    for (const auto& input : vertexInputs) {
+        vk::VertexInputAttributeDescription attribute{};
+        attribute.location = input.location;
+        attribute.binding = 0;
+        attribute.format = input.format;
+        attribute.offset = offset;
+        attributes->push_back(attribute);
+
+        offset += input.size;
+    }
+
+    binding->binding = 0;
+    binding->stride = offset;
+    binding->inputRate = vk::VertexInputRate::eVertex;
+    return true;
+}
@@ -0,0 +1,77 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <map>
+#include <utility>
+
+/**
+ * Reads the interface of SPIR-V shaders: the descriptor bindings, push
+ * constant ranges and vertex inputs. This lets pipeline layouts and vertex
+ * input state be derived from the shaders, instead of being kept in sync with
+ * them by hand.
+ *
+ * Reflections of several stages are combined with merge(), after which the
+ * bindings used by more than one stage have all of those stages set.
+ */
+class ShaderReflection {
+public:
+    /** A vertex shader input */
+    struct VertexInput {
+        uint32_t location;
+        vk::Format format;
+        /** The size of the attribute in bytes */
+        uint32_t size;
+    };
+
+    /** The stage of the shader (or stages, after merging) */
+    vk::ShaderStageFlags stages;
+
+    /** The descriptor bindings of each descriptor set, by set index */
+    std::map<uint32_t, std::vector<vk::DescriptorSetLayoutBinding> > descriptorSets;
+
+    /** The push constant range, if the shaders use push constants */
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+
+    /** The vertex inputs, sorted by location. Only set for vertex shaders */
+    std::vector<VertexInput> vertexInputs;
+
+    /**
+     * Reflects a SPIR-V module
+     *
+     * @param code The SPIR-V words
+     *
+     * @return The reflection of the shader
+     *
+     * @throw std::runtime_error if the code is not valid SPIR-V, or uses a
+     *        type in its interface that can't be reflected
+     */
+    static ShaderReflection reflect(const std::vector<uint32_t>& code);
+
+    /**
+     * Combines the reflection of another stage into this one
+     *
+     * @param other The reflection of another shader stage in the same pipeline
+     *
+     * @throw std::runtime_error if both stages use the same binding for
+     *        different descriptor types
+     */
+    void merge(const ShaderReflection& other);
+
+    /**
+     * Builds the vertex input state for the vertex inputs, assuming that they
+     * are interleaved in a single per-vertex buffer at binding 0, in the
+     * order of their locations
+     *
+     * @param binding Set to the binding description
+     * @param attributes Set to the attribute descriptions
+     *
+     * @return Whether there are any vertex inputs. If not, there should be no
+     *         binding description
+     */
+    bool getVertexInputState(vk::VertexInputBindingDescription* binding,
+                             std::vector<vk::VertexInputAttributeDescription>* attributes) const;
+};
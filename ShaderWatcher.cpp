@@ -0,0 +1,133 @@
+// October 18, 2026
+
+#include "ShaderWatcher.hpp"
+
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// ***** Public methods *****
+
+void ShaderWatcher::start(const std::string& directory, const std::vector<std::string>& sourcePaths) {
+    this->directory = directory;
+    this->sourcePaths = sourcePaths;
+
+    running = true;
+#ifdef __linux__
+    worker = std::thread(&ShaderWatcher::watchWithInotify, this);
+#else
+    worker = std::thread(&ShaderWatcher::watchByPolling, this);
+#endif
+}
+
+void ShaderWatcher::stop() {
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool ShaderWatcher::takeChanges() {
+    return changed.exchange(false);
+}
+
+// ***** Private methods *****
+
+void ShaderWatcher::watchWithInotify() {
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK);
+    if (fd < 0) {
+        watchByPolling();
+        return;
+    }
+
+    // Editors either write the file in place (IN_CLOSE_WRITE) or write a new
+    // file and rename it over the old one (IN_MOVED_TO)
+    int watch = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch < 0) {
+        close(fd);
+        watchByPolling();
+        return;
+    }
+
+    // Large enough for many events at once, aligned as inotify requires
+    alignas(struct inotify_event) char buffer[4096];
+
+    while (running) {
+        pollfd pollInfo{};
+        pollInfo.fd = fd;
+        pollInfo.events = POLLIN;
+        if (poll(&pollInfo, 1, POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+
+        // Gather every pending event first, so that a save that touches the
+        // file several times only counts once
+        std::vector<std::string> changedNames;
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(p);
+                if (event->len > 0) {
+                    changedNames.push_back(event->name);
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+
+        markChanged(changedNames);
+    }
+
+    inotify_rm_watch(fd, watch);
+    close(fd);
+#else
+    watchByPolling();
+#endif
+}
+
+void ShaderWatcher::watchByPolling() {
+    namespace fs = std::filesystem;
+
+    std::unordered_map<std::string, fs::file_time_type> lastWriteTimes;
+    for (const auto& sourcePath : sourcePaths) {
+        std::error_code error;
+        lastWriteTimes[sourcePath] = fs::last_write_time(sourcePath, error);
+    }
+
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+
+        std::vector<std::string> changedNames;
+        for (const auto& sourcePath : sourcePaths) {
+            std::error_code error;
+            fs::file_time_type writeTime = fs::last_write_time(sourcePath, error);
+            if (!error && writeTime != lastWriteTimes[sourcePath]) {
+                lastWriteTimes[sourcePath] = writeTime;
+                changedNames.push_back(fs::path(sourcePath).filename().string());
+            }
+        }
+
+        markChanged(changedNames);
+    }
+}
+
+void ShaderWatcher::markChanged(const std::vector<std::string>& changedNames) {
+    for (const auto& sourcePath : sourcePaths) {
+        std::string name = std::filesystem::path(sourcePath).filename().string();
+
+        for (const auto& changedName : changedNames) {
+            if (changedName == name) {
+                std::cout << "Reloading " << sourcePath << std::endl;
+                changed = true;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,75 @@
+// October 18, 2026
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+/**
+ * Watches GLSL shader sources in a directory on a background thread, and
+ * reports when they change. On Linux the directory is watched with inotify,
+ * and elsewhere the modification times are polled.
+ *
+ * The main thread checks for changes with takeChanges(), and never waits on
+ * the watcher. Recompiling is left to the ShaderCompiler, on whichever thread
+ * rebuilds the pipelines.
+ */
+class ShaderWatcher {
+public:
+    /**
+     * Starts watching the directory on a background thread
+     *
+     * @param directory The directory containing the shader sources
+     * @param sourcePaths The shader sources to watch, which should all be
+     *                    within the directory
+     */
+    void start(const std::string& directory, const std::vector<std::string>& sourcePaths);
+
+    /**
+     * Stops the background thread. Should be called before this object leaves
+     * scope.
+     */
+    void stop();
+
+    /**
+     * Checks whether any watched source has changed since the last call, and
+     * clears that state
+     *
+     * @return Whether a shader source has changed
+     */
+    bool takeChanges();
+
+private:
+    /** How often the background thread checks whether it should stop, and how
+     *  often modification times are polled when inotify is unavailable */
+    static const int POLL_INTERVAL_MS = 100;
+
+    std::string directory;
+    std::vector<std::string> sourcePaths;
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    /** Set by the worker when a watched source has changed */
+    std::atomic<bool> changed{false};
+
+    /**
+     * The main loop of the worker thread, using inotify
+     */
+    void watchWithInotify();
+
+    /**
+     * The main loop of the worker thread, polling modification times. Used
+     * when inotify is unavailable
+     */
+    void watchByPolling();
+
+    /**
+     * Sets the changed flag if any of the given file names is a watched source
+     *
+     * @param changedNames The file names (without directory) of the changed
+     *                     files
+     */
+    void markChanged(const std::vector<std::string>& changedNames);
+};
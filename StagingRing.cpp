@@ -0,0 +1,59 @@
+// October 18, 2026
+
+#include "StagingRing.hpp"
+
+// ***** Public methods *****
+
+void StagingRing::initialize(MemoryAllocator* allocator, vk::DeviceSize frameSize, uint32_t frameCount) {
+    this->allocator = allocator;
+    this->frameSize = frameSize;
+
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = frameSize * frameCount;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+    // Only written by the CPU, which is fastest through its cache. Without
+    // coherence, the writes are flushed in batches
+    buffer = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible,
+                                     vk::MemoryPropertyFlagBits::eHostCached, &allocation);
+
+    frameStart = 0;
+    frameUsed = 0;
+    dirtyRanges.clear();
+}
+
+void StagingRing::destroy() {
+    if (!buffer) {
+        return;
+    }
+    allocator->destroyBuffer(buffer, allocation);
+    buffer = nullptr;
+    dirtyRanges.clear();
+}
+
+void StagingRing::beginFrame(uint32_t frameIndex) {
+    frameStart = frameSize * frameIndex;
+    frameUsed = 0;
+}
+
+bool StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize* offset, void** data) {
+    vk::DeviceSize start = (frameUsed + alignment - 1) / alignment * alignment;
+    if (start + size > frameSize) {
+        return false;
+    }
+
+    frameUsed = start + size;
+    *offset = frameStart + start;
+    *data = static_cast<char*>(allocation.mapped) + frameStart + start;
+    return true;
+}
+
+void StagingRing::markWritten(vk::DeviceSize offset, vk::DeviceSize size) {
+    allocator->addFlushRange(allocation, offset, size, &dirtyRanges);
+}
+
+void StagingRing::collectFlushRanges(std::vector<vk::MappedMemoryRange>* ranges) {
+    ranges->insert(ranges->end(), dirtyRanges.begin(), dirtyRanges.end());
+    dirtyRanges.clear();
+}
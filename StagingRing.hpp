@@ -0,0 +1,100 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+#include "MemoryAllocator.hpp"
+
+/**
+ * A host visible buffer that data is written into before being copied to
+ * device local resources. The buffer is split into one region per concurrent
+ * frame, and each frame's writes go linearly through its own region. A region
+ * is only written again once the fence of the frame that last used it has
+ * been waited on, so the copies reading it are known to have finished.
+ *
+ * The buffer prefers host cached memory, which is faster to write on many
+ * devices but often not host coherent. Written space is tracked as dirty
+ * ranges instead of being flushed as it is written, so a frame's writes are
+ * flushed together in one call before it is submitted.
+ */
+class StagingRing {
+public:
+    /**
+     * Creates the buffer
+     *
+     * @param allocator The allocator to create the buffer with
+     * @param frameSize The size of each frame's region
+     * @param frameCount The number of concurrent frames
+     */
+    void initialize(MemoryAllocator* allocator, vk::DeviceSize frameSize, uint32_t frameCount);
+
+    /**
+     * Destroys the buffer, if it hasn't been already
+     *
+     * Requires: No copy from the buffer is still in use
+     */
+    void destroy();
+
+    /**
+     * Starts writing to a frame's region, discarding what was written there
+     *
+     * Requires: The work of the frame's previous use has completed
+     *
+     * @param frameIndex The index of the concurrent frame
+     */
+    void beginFrame(uint32_t frameIndex);
+
+    /**
+     * Takes space from the current frame's region
+     *
+     * @param size The number of bytes needed
+     * @param alignment The alignment of the space, such as 4 for buffer copies
+     *                  or the texel size for image copies
+     * @param offset Set to the offset of the space in the buffer
+     * @param data Set to the address to write to
+     *
+     * @return Whether there was room. If not, the data should be written in a
+     *         later frame
+     */
+    bool allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize* offset, void** data);
+
+    /**
+     * Marks some space as written, so collectFlushRanges() gives it to be
+     * made visible to the device
+     *
+     * @param offset The offset of the space in the buffer
+     * @param size The number of bytes written
+     */
+    void markWritten(vk::DeviceSize offset, vk::DeviceSize size);
+
+    /**
+     * Adds the space written since the last call to a batch for
+     * MemoryAllocator::flush(), which must be flushed before the copies
+     * reading it are submitted
+     *
+     * @param ranges The batch
+     */
+    void collectFlushRanges(std::vector<vk::MappedMemoryRange>* ranges);
+
+    /**
+     * @return The buffer, to copy from
+     */
+    vk::Buffer getBuffer() const { return buffer; }
+
+private:
+    MemoryAllocator* allocator = nullptr;
+    vk::Buffer buffer;
+    Allocation allocation;
+    vk::DeviceSize frameSize = 0;
+
+    /** The start of the current frame's region */
+    vk::DeviceSize frameStart = 0;
+    /** The bytes of the current frame's region that have been taken */
+    vk::DeviceSize frameUsed = 0;
+    /** The written space not yet flushed, in whole atoms. Empty for host
+     *  coherent memory */
+    std::vector<vk::MappedMemoryRange> dirtyRanges;
+};
@@ -0,0 +1,99 @@
+// October 18, 2026
+
+// The offline step that builds a virtual texture. The image is read from a
+// binary PPM (P6) file, since the project has no image loading library, and
+// is written as a page file with every mip level cut into pages.
+//
+// Usage: texture_pack <input.ppm> <output.vtex>
+
+#include <iostream>
+#include <fstream>
+#include <exception>
+#include <stdexcept>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "PageFile.hpp"
+
+// Reads the next number of a PPM header, skipping whitespace and comments
+static uint32_t readHeaderValue(std::ifstream& in) {
+    int c = in.get();
+    while (c == '#' || std::isspace(c)) {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = in.get();
+            }
+        }
+        c = in.get();
+    }
+
+    if (!std::isdigit(c)) {
+        throw std::runtime_error("ERROR: Malformed PPM header");
+    }
+    uint32_t value = 0;
+    while (std::isdigit(c)) {
+        value = value * 10 + (c - '0');
+        c = in.get();
+    }
+    // The single whitespace character after the value is consumed, which
+    // after the last value is where the texels start
+    return value;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input.ppm> <output.vtex>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string inputPath = argv[1];
+    std::string outputPath = argv[2];
+
+    try {
+        std::ifstream in(inputPath, std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error(std::string("ERROR: Failed to open ") + inputPath);
+        }
+
+        char magic[2];
+        in.read(magic, sizeof(magic));
+        if (!in || magic[0] != 'P' || magic[1] != '6') {
+            throw std::runtime_error(std::string("ERROR: ") + inputPath + " is not a binary PPM");
+        }
+        uint32_t width = readHeaderValue(in);
+        uint32_t height = readHeaderValue(in);
+        uint32_t maxValue = readHeaderValue(in);
+        if (width == 0 || height == 0 || maxValue != 255) {
+            throw std::runtime_error(std::string("ERROR: ") + inputPath + " must be a non-empty 8 bit PPM");
+        }
+
+        // Expand RGB to RGBA, one row at a time
+        std::vector<uint8_t> texels((size_t)width * height * 4);
+        std::vector<uint8_t> row((size_t)width * 3);
+        for (uint32_t y = 0; y < height; y++) {
+            in.read(reinterpret_cast<char*>(row.data()), row.size());
+            if (!in) {
+                throw std::runtime_error(std::string("ERROR: ") + inputPath + " is truncated");
+            }
+            for (uint32_t x = 0; x < width; x++) {
+                uint8_t* texel = &texels[((size_t)y * width + x) * 4];
+                texel[0] = row[x * 3];
+                texel[1] = row[x * 3 + 1];
+                texel[2] = row[x * 3 + 2];
+                texel[3] = 255;
+            }
+        }
+
+        std::vector<std::vector<uint8_t> > mips = PageFile::buildMips(width, height, std::move(texels));
+        PageFile::write(outputPath, width, height, mips);
+
+        std::cout << "Packed " << width << "x" << height << " texture into " << mips.size()
+                  << " mip levels in " << outputPath << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
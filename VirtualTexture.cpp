@@ -0,0 +1,867 @@
+// October 18, 2026
+
+#include "VirtualTexture.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <functional>
+
+// ***** Public methods *****
+
+void VirtualTexture::initialize(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue queue,
+                                uint32_t queueFamilyIndex, const DeviceFeatures& features,
+                                MemoryAllocator* allocator, LayoutCache* layoutCache, const std::string& path,
+                                vk::DeviceSize budget, uint32_t frameCount) {
+    this->device = device;
+    this->queue = queue;
+    this->allocator = allocator;
+    this->frameCount = frameCount;
+
+    file.open(path);
+    uint32_t mipCount = file.getMipCount();
+    uint32_t pageCount = file.getPageCount();
+
+    // Every slot could be uploaded and evicted over two frames, so there
+    // must be a few frames' worth of them
+    uint32_t slotCount = std::max((uint32_t)(budget / PageFile::PAGE_BYTES), 4 * MAX_UPLOADS_PER_FRAME);
+
+    sparse = canUseSparse(physicalDevice, features, queueFamilyIndex);
+    if (sparse) {
+        createSparseResources(slotCount);
+    } else {
+        tailFirstLevel = mipCount;
+        createCacheResources(slotCount, physicalDevice.getProperties().limits.maxImageDimension2D);
+    }
+    firstPinnedLevel = std::min(tailFirstLevel, mipCount - 1);
+    tailFirstPage = tailFirstLevel < mipCount ? file.getPageId(tailFirstLevel, 0, 0) : pageCount;
+    firstPinnedPage = file.getPageId(firstPinnedLevel, 0, 0);
+
+    mapping.assign(pageCount, 0);
+    pageSlots.assign(pageCount, NONE);
+    residentChildren.assign(pageCount, 0);
+    lastUsed.assign(pageCount, 0);
+    // Handed out from the back, so the first slots are used first
+    freeSlots.clear();
+    for (uint32_t slot = (uint32_t)slotPages.size(); slot > 0; slot--) {
+        freeSlots.push_back(slot - 1);
+    }
+
+    createSharedResources(layoutCache);
+
+    stagingRing.initialize(allocator, getStagingFrameSize(), frameCount);
+
+    uploadPinnedPages(queueFamilyIndex);
+
+    pushConstants.size[0] = file.getWidth();
+    pushConstants.size[1] = file.getHeight();
+    pushConstants.mipCount = mipCount;
+    setView(0.f, 0.f, 1.f);
+
+    // Pages read ahead of the uploads are held in host memory, which is
+    // bounded to a couple of frames of uploads
+    streamer.start(&file, 2 * MAX_UPLOADS_PER_FRAME);
+}
+
+void VirtualTexture::destroy() {
+    streamer.stop();
+    file.close();
+    stagingRing.destroy();
+
+    device.destroyDescriptorPool(descriptorPool);
+    device.destroySampler(sampler);
+    device.destroySampler(minMipSampler);
+    for (vk::Semaphore semaphore : bindSemaphores) {
+        device.destroySemaphore(semaphore);
+    }
+    for (uint32_t i = 0; i < feedbackBuffers.size(); i++) {
+        allocator->destroyBuffer(feedbackBuffers[i], feedbackAllocations[i]);
+    }
+
+    device.destroyImageView(imageView);
+    if (sparse) {
+        // Destroying the image unbinds its memory
+        device.destroyImage(image);
+        allocator->free(pageMemory);
+        allocator->free(tailMemory);
+        device.destroyImageView(minMipView);
+        allocator->destroyImage(minMipImage, minMipAllocation);
+    } else {
+        allocator->destroyImage(image, imageAllocation);
+        allocator->destroyBuffer(indirectionBuffer, indirectionAllocation);
+    }
+
+    bindSemaphores.clear();
+    feedbackBuffers.clear();
+    feedbackAllocations.clear();
+    descriptorSets.clear();
+    quarantinedSlots.clear();
+}
+
+PipelineKey VirtualTexture::getPipelineKey() const {
+    PipelineKey key;
+    key.vertexShader = ShaderVariant{ VERT_SOURCE_PATH, VERT_PATH, {} };
+    if (sparse) {
+        key.fragmentShader = ShaderVariant{ FRAG_SOURCE_PATH, FRAG_SPARSE_PATH, { { "VT_SPARSE", "1" } } };
+    } else {
+        key.fragmentShader = ShaderVariant{ FRAG_SOURCE_PATH, FRAG_PATH, {} };
+    }
+    // A quad over the whole screen, which is never back facing
+    key.topology = vk::PrimitiveTopology::eTriangleStrip;
+    key.cullMode = vk::CullModeFlagBits::eNone;
+    return key;
+}
+
+void VirtualTexture::setView(float x, float y, float scale) {
+    pushConstants.view[0] = x;
+    pushConstants.view[1] = y;
+    pushConstants.view[2] = scale;
+    pushConstants.view[3] = scale;
+}
+
+void VirtualTexture::beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex) {
+    frameNumber++;
+    pushConstants.frame = (uint32_t)frameNumber;
+    bindPending[frameIndex] = false;
+    stagingRing.beginFrame(frameIndex);
+    pageCopies.clear();
+    pageBinds.clear();
+
+    // Every frame that could sample an evicted page has completed by now,
+    // since the mapping stopped pointing at it frameCount frames ago
+    while (!quarantinedSlots.empty() && quarantinedSlots.front().first + frameCount <= frameNumber) {
+        freeSlots.push_back(quarantinedSlots.front().second);
+        quarantinedSlots.pop_front();
+    }
+
+    if (feedbackWritten[frameIndex]) {
+        processFeedback(frameIndex);
+    }
+    uploadLoadedPages();
+    evictPages();
+
+    // The staging ring is sized so the mapping always fits after the pages
+    vk::DeviceSize mappingOffset = 0;
+    bool uploadMapping = false;
+    void* mappingData;
+    if (mappingDirty && stagingRing.allocate(getMappingSize(), 4, &mappingOffset, &mappingData)) {
+        writeMapping(mappingData);
+        stagingRing.markWritten(mappingOffset, getMappingSize());
+        mappingDirty = false;
+        uploadMapping = true;
+    }
+
+    recordUploads(commandBuffer, stagingRing.getBuffer(), uploadMapping, mappingOffset, false);
+
+    // The feedback was read above, so it can be cleared for this frame
+    commandBuffer.fillBuffer(feedbackBuffers[frameIndex], 0, VK_WHOLE_SIZE, 0);
+
+    vk::BufferMemoryBarrier clearBarrier{};
+    clearBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    clearBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    clearBarrier.buffer = feedbackBuffers[frameIndex];
+    clearBarrier.offset = 0;
+    clearBarrier.size = VK_WHOLE_SIZE;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                  {}, nullptr, clearBarrier, nullptr);
+
+    // Binds aren't ordered with command buffers, so the frame's submission
+    // waits on the semaphore before its copies
+    if (!pageBinds.empty()) {
+        vk::SparseImageMemoryBindInfo imageBindInfo{};
+        imageBindInfo.image = image;
+        imageBindInfo.bindCount = (uint32_t)pageBinds.size();
+        imageBindInfo.pBinds = pageBinds.data();
+
+        vk::BindSparseInfo bindInfo{};
+        bindInfo.imageBindCount = 1;
+        bindInfo.pImageBinds = &imageBindInfo;
+        bindInfo.signalSemaphoreCount = 1;
+        bindInfo.pSignalSemaphores = &bindSemaphores[frameIndex];
+        queue.bindSparse(bindInfo, nullptr);
+
+        bindPending[frameIndex] = true;
+    }
+}
+
+vk::Semaphore VirtualTexture::getBindSemaphore(uint32_t frameIndex) const {
+    return bindPending[frameIndex] ? bindSemaphores[frameIndex] : vk::Semaphore();
+}
+
+void VirtualTexture::draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout, uint32_t frameIndex) {
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, descriptorSets[frameIndex], nullptr);
+    commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+                                0, sizeof(PushConstants), &pushConstants);
+    commandBuffer.draw(4, 1, 0, 0);
+}
+
+void VirtualTexture::endFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex) {
+    vk::BufferMemoryBarrier feedbackBarrier{};
+    feedbackBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    feedbackBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+    feedbackBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    feedbackBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    feedbackBarrier.buffer = feedbackBuffers[frameIndex];
+    feedbackBarrier.offset = 0;
+    feedbackBarrier.size = VK_WHOLE_SIZE;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eHost,
+                                  {}, nullptr, feedbackBarrier, nullptr);
+
+    feedbackWritten[frameIndex] = true;
+}
+
+void VirtualTexture::suspend() {
+    stagingRing.destroy();
+}
+
+void VirtualTexture::resume() {
+    stagingRing.initialize(allocator, getStagingFrameSize(), frameCount);
+}
+
+// ***** Private methods *****
+
+bool VirtualTexture::canUseSparse(vk::PhysicalDevice physicalDevice, const DeviceFeatures& features,
+                                  uint32_t queueFamilyIndex) {
+    if (!features.sparseResidencyImage2D) {
+        return false;
+    }
+
+    // Pages are bound on the graphics queue, so the binds are ordered with
+    // the frames through a semaphore
+    std::vector<vk::QueueFamilyProperties> families = physicalDevice.getQueueFamilyProperties();
+    if (!(families[queueFamilyIndex].queueFlags & vk::QueueFlagBits::eSparseBinding)) {
+        return false;
+    }
+
+    // Pages must be exactly one sparse block, which is the standard shape
+    // for 4 byte texels
+    std::vector<vk::SparseImageFormatProperties> formatProperties = physicalDevice.getSparseImageFormatProperties(
+        PageFile::FORMAT, vk::ImageType::e2D, vk::SampleCountFlagBits::e1,
+        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst, vk::ImageTiling::eOptimal);
+    for (const auto& properties : formatProperties) {
+        if ((properties.aspectMask & vk::ImageAspectFlagBits::eColor) &&
+            properties.imageGranularity == vk::Extent3D(PageFile::PAGE_SIZE, PageFile::PAGE_SIZE, 1)) {
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void VirtualTexture::createSparseResources(uint32_t slotCount) {
+    uint32_t mipCount = file.getMipCount();
+
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.flags = vk::ImageCreateFlagBits::eSparseBinding | vk::ImageCreateFlagBits::eSparseResidency;
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = PageFile::FORMAT;
+    imageInfo.extent = vk::Extent3D(file.getWidth(), file.getHeight(), 1);
+    imageInfo.mipLevels = mipCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+    // Sparse images are created without memory, which is bound page by page
+    image = device.createImage(imageInfo);
+
+    vk::MemoryRequirements requirements = device.getImageMemoryRequirements(image);
+    tailFirstLevel = mipCount;
+    vk::SparseImageMemoryRequirements tailRequirements{};
+    for (const auto& sparseRequirements : device.getImageSparseMemoryRequirements(image)) {
+        if (sparseRequirements.formatProperties.aspectMask & vk::ImageAspectFlagBits::eColor) {
+            tailRequirements = sparseRequirements;
+            tailFirstLevel = std::min(sparseRequirements.imageMipTailFirstLod, mipCount);
+        }
+    }
+
+    // One pool holds every slot, where each slot is one sparse block
+    vk::MemoryRequirements poolRequirements = requirements;
+    poolRequirements.size = (vk::DeviceSize)slotCount * PageFile::PAGE_BYTES;
+    pageMemory = allocator->allocate(poolRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // The mip tail can't be bound page by page, so it is always resident
+    if (tailFirstLevel < mipCount) {
+        vk::MemoryRequirements tailMemoryRequirements = requirements;
+        tailMemoryRequirements.size = tailRequirements.imageMipTailSize;
+        tailMemory = allocator->allocate(tailMemoryRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        tailOffset = tailRequirements.imageMipTailOffset;
+        tailSize = tailRequirements.imageMipTailSize;
+    }
+
+    slotPages.assign(slotCount, NONE);
+    boundPages.assign(slotCount, NONE);
+
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = image;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = PageFile::FORMAT;
+    viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipCount, 0, 1);
+    imageView = device.createImageView(viewInfo);
+
+    // One texel for each page of mip 0
+    vk::ImageCreateInfo minMipInfo = imageInfo;
+    minMipInfo.flags = {};
+    minMipInfo.format = vk::Format::eR8Uint;
+    minMipInfo.extent = vk::Extent3D(file.getPagesX(0), file.getPagesY(0), 1);
+    minMipInfo.mipLevels = 1;
+    minMipImage = allocator->createImage(minMipInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {}, &minMipAllocation);
+
+    viewInfo.image = minMipImage;
+    viewInfo.format = vk::Format::eR8Uint;
+    viewInfo.subresourceRange.levelCount = 1;
+    minMipView = device.createImageView(viewInfo);
+}
+
+void VirtualTexture::createCacheResources(uint32_t slotCount, uint32_t maxImageDimension) {
+    // A roughly square grid of slots, within the largest image allowed
+    uint32_t maxSlotsPerSide = maxImageDimension / PageFile::PAGE_SIZE;
+    slotsPerRow = std::min((uint32_t)std::ceil(std::sqrt((double)slotCount)), maxSlotsPerSide);
+    uint32_t rows = std::min((slotCount + slotsPerRow - 1) / slotsPerRow, maxSlotsPerSide);
+    slotPages.assign(slotsPerRow * rows, NONE);
+
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = PageFile::FORMAT;
+    imageInfo.extent = vk::Extent3D(slotsPerRow * PageFile::PAGE_SIZE, rows * PageFile::PAGE_SIZE, 1);
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    image = allocator->createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {}, &imageAllocation);
+
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = image;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = PageFile::FORMAT;
+    viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    imageView = device.createImageView(viewInfo);
+
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = getMappingSize();
+    bufferInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    indirectionBuffer = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {},
+                                                &indirectionAllocation);
+}
+
+void VirtualTexture::createSharedResources(LayoutCache* layoutCache) {
+    // The feedback is read by the host every frame, so it is best cached
+    feedbackSize = (file.getPageCount() + 31) / 32 * sizeof(uint32_t);
+    feedbackBuffers.resize(frameCount);
+    feedbackAllocations.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.size = feedbackSize;
+        bufferInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        feedbackBuffers[i] = allocator->createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible,
+                                                     vk::MemoryPropertyFlagBits::eHostCached, &feedbackAllocations[i]);
+    }
+    feedbackWritten.assign(frameCount, false);
+
+    bindSemaphores.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        bindSemaphores[i] = device.createSemaphore(vk::SemaphoreCreateInfo{});
+    }
+    bindPending.assign(frameCount, false);
+
+    // Trilinear for the sparse image. The cache texture only has one level,
+    // and the min mip map holds integers, which can't be filtered
+    vk::SamplerCreateInfo samplerInfo{};
+    samplerInfo.magFilter = vk::Filter::eLinear;
+    samplerInfo.minFilter = vk::Filter::eLinear;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.minLod = 0.f;
+    samplerInfo.maxLod = sparse ? (float)file.getMipCount() : 0.f;
+    sampler = device.createSampler(samplerInfo);
+
+    samplerInfo.magFilter = vk::Filter::eNearest;
+    samplerInfo.minFilter = vk::Filter::eNearest;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    samplerInfo.maxLod = 0.f;
+    minMipSampler = device.createSampler(samplerInfo);
+
+    // The same bindings the shader's reflection gives, so the layout cache
+    // hands back the pipeline's own set layout
+    std::vector<vk::DescriptorSetLayoutBinding> bindings(3);
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = vk::ShaderStageFlagBits::eFragment;
+    }
+    bindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    bindings[1].descriptorType = sparse ? vk::DescriptorType::eCombinedImageSampler : vk::DescriptorType::eStorageBuffer;
+    bindings[2].descriptorType = vk::DescriptorType::eStorageBuffer;
+    vk::DescriptorSetLayout setLayout = layoutCache->getDescriptorSetLayout(bindings);
+
+    std::vector<vk::DescriptorPoolSize> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2 * frameCount),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 2 * frameCount),
+    };
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = frameCount;
+    poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    descriptorPool = device.createDescriptorPool(poolInfo);
+
+    std::vector<vk::DescriptorSetLayout> setLayouts(frameCount, setLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.descriptorPool = descriptorPool;
+    allocateInfo.descriptorSetCount = frameCount;
+    allocateInfo.pSetLayouts = setLayouts.data();
+    descriptorSets = device.allocateDescriptorSets(allocateInfo);
+
+    // Only the feedback differs between frames
+    vk::DescriptorImageInfo textureInfo(sampler, imageView, vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorImageInfo minMipInfo(minMipSampler, minMipView, vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorBufferInfo indirectionInfo(indirectionBuffer, 0, VK_WHOLE_SIZE);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        vk::DescriptorBufferInfo feedbackInfo(feedbackBuffers[i], 0, VK_WHOLE_SIZE);
+
+        std::vector<vk::WriteDescriptorSet> writes(3);
+        for (uint32_t binding = 0; binding < writes.size(); binding++) {
+            writes[binding].dstSet = descriptorSets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].descriptorType = bindings[binding].descriptorType;
+        }
+        writes[0].pImageInfo = &textureInfo;
+        if (sparse) {
+            writes[1].pImageInfo = &minMipInfo;
+        } else {
+            writes[1].pBufferInfo = &indirectionInfo;
+        }
+        writes[2].pBufferInfo = &feedbackInfo;
+
+        device.updateDescriptorSets(writes, nullptr);
+    }
+}
+
+void VirtualTexture::uploadPinnedPages(uint32_t queueFamilyIndex) {
+    uint32_t mipCount = file.getMipCount();
+
+    // The pinned pages are the mip tail, and the coarsest page if it isn't
+    // in the tail. Coarser levels go first, so finer ones overwrite their
+    // part of the mapping
+    std::vector<uint32_t> pinnedPages;
+    for (uint32_t mip = mipCount; mip > firstPinnedLevel; mip--) {
+        for (uint32_t y = 0; y < file.getPagesY(mip - 1); y++) {
+            for (uint32_t x = 0; x < file.getPagesX(mip - 1); x++) {
+                pinnedPages.push_back(file.getPageId(mip - 1, x, y));
+            }
+        }
+    }
+
+    // There may be more pinned pages than a frame's uploads, so they get
+    // their own staging buffer
+    vk::BufferCreateInfo stagingInfo{};
+    stagingInfo.size = pinnedPages.size() * PageFile::PAGE_BYTES + getMappingSize();
+    stagingInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    stagingInfo.sharingMode = vk::SharingMode::eExclusive;
+    Allocation stagingAllocation;
+    vk::Buffer stagingBuffer = allocator->createBuffer(stagingInfo, vk::MemoryPropertyFlagBits::eHostVisible, {},
+                                                       &stagingAllocation);
+    uint8_t* stagingData = static_cast<uint8_t*>(stagingAllocation.mapped);
+
+    pageCopies.clear();
+    pageBinds.clear();
+    for (uint32_t i = 0; i < pinnedPages.size(); i++) {
+        uint32_t page = pinnedPages[i];
+        vk::DeviceSize offset = (vk::DeviceSize)i * PageFile::PAGE_BYTES;
+        file.readPage(page, stagingData + offset);
+
+        uint32_t mip, x, y;
+        file.getPageLocation(page, &mip, &x, &y);
+        if (page >= tailFirstPage) {
+            addPageCopy(page, NONE, offset);
+            fillMapping(mip, x, y, mip);
+        } else {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            addPageCopy(page, slot, offset);
+            makeResident(page, slot);
+        }
+    }
+
+    vk::DeviceSize mappingOffset = pinnedPages.size() * PageFile::PAGE_BYTES;
+    writeMapping(stagingData + mappingOffset);
+    allocator->flush(stagingAllocation, 0, stagingInfo.size);
+    mappingDirty = false;
+
+    // The binds have to be done before the copies, so they are waited for
+    if (sparse) {
+        vk::SparseMemoryBind tailBind{};
+        tailBind.resourceOffset = tailOffset;
+        tailBind.size = tailSize;
+        tailBind.memory = tailMemory.memory;
+        tailBind.memoryOffset = tailMemory.offset;
+        vk::SparseImageOpaqueMemoryBindInfo tailBindInfo(image, 1, &tailBind);
+
+        vk::SparseImageMemoryBindInfo imageBindInfo(image, (uint32_t)pageBinds.size(), pageBinds.data());
+
+        vk::BindSparseInfo bindInfo{};
+        if (tailMemory.memory) {
+            bindInfo.imageOpaqueBindCount = 1;
+            bindInfo.pImageOpaqueBinds = &tailBindInfo;
+        }
+        if (!pageBinds.empty()) {
+            bindInfo.imageBindCount = 1;
+            bindInfo.pImageBinds = &imageBindInfo;
+        }
+
+        vk::Fence fence = device.createFence(vk::FenceCreateInfo{});
+        queue.bindSparse(bindInfo, fence);
+        device.waitForFences(fence, VK_TRUE, UINT64_MAX);
+        device.destroyFence(fence);
+    }
+
+    vk::CommandPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    vk::CommandPool commandPool = device.createCommandPool(poolInfo);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocateInfo.commandBufferCount = 1;
+    vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(allocateInfo)[0];
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+
+    recordUploads(commandBuffer, stagingBuffer, true, mappingOffset, true);
+    for (vk::Buffer feedbackBuffer : feedbackBuffers) {
+        commandBuffer.fillBuffer(feedbackBuffer, 0, VK_WHOLE_SIZE, 0);
+    }
+
+    commandBuffer.end();
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    queue.submit(submitInfo, nullptr);
+    queue.waitIdle();
+
+    device.destroyCommandPool(commandPool);
+    allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+    pageCopies.clear();
+    pageBinds.clear();
+}
+
+void VirtualTexture::processFeedback(uint32_t frameIndex) {
+    const Allocation& feedback = feedbackAllocations[frameIndex];
+    allocator->invalidate(feedback, 0, feedbackSize);
+    const uint32_t* bits = static_cast<const uint32_t*>(feedback.mapped);
+
+    std::vector<uint32_t> requests;
+    uint32_t pageCount = file.getPageCount();
+    for (uint32_t word = 0; word < feedbackSize / sizeof(uint32_t); word++) {
+        for (uint32_t remaining = bits[word]; remaining != 0; remaining &= remaining - 1) {
+            uint32_t page = word * 32 + __builtin_ctz(remaining);
+            if (page >= pageCount) {
+                continue;
+            }
+
+            // The pages above a needed page are needed too, since they are
+            // loaded first and are what is shown meanwhile. Stop at a page
+            // already seen this frame, since the rest were seen with it
+            while (page < firstPinnedPage && lastUsed[page] != frameNumber) {
+                lastUsed[page] = frameNumber;
+                if (!isResident(page)) {
+                    requests.push_back(page);
+                }
+                page = file.getParent(page);
+            }
+        }
+    }
+
+    // Coarser levels have higher ids, and go first so a child never waits on
+    // its parent
+    std::sort(requests.begin(), requests.end(), std::greater<uint32_t>());
+    requestedCount = requests.size();
+    streamer.request(requests);
+}
+
+void VirtualTexture::uploadLoadedPages() {
+    PageStreamer::LoadedPage loaded;
+    uint32_t uploads = 0;
+
+    while (uploads < MAX_UPLOADS_PER_FRAME && !freeSlots.empty() && streamer.takeLoaded(&loaded)) {
+        // While the page was being read, it may have been made resident, or
+        // its parent evicted. It is requested again if it is still needed
+        if (isResident(loaded.id) || !isResident(file.getParent(loaded.id))) {
+            streamer.recycle(std::move(loaded.texels));
+            continue;
+        }
+
+        vk::DeviceSize offset;
+        void* data;
+        if (!stagingRing.allocate(PageFile::PAGE_BYTES, 16, &offset, &data)) {
+            streamer.recycle(std::move(loaded.texels));
+            break;
+        }
+        memcpy(data, loaded.texels.data(), PageFile::PAGE_BYTES);
+        stagingRing.markWritten(offset, PageFile::PAGE_BYTES);
+        streamer.recycle(std::move(loaded.texels));
+
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        addPageCopy(loaded.id, slot, offset);
+        makeResident(loaded.id, slot);
+        uploads++;
+    }
+}
+
+void VirtualTexture::evictPages() {
+    // Evicted slots can't be reused for a few frames, so slots are freed
+    // ahead of when they are needed, and only while pages are missing
+    size_t available = freeSlots.size() + quarantinedSlots.size();
+    if (requestedCount == 0 || available >= MAX_UPLOADS_PER_FRAME) {
+        return;
+    }
+    size_t wanted = MAX_UPLOADS_PER_FRAME - available;
+
+    // Only pages without resident children can go, and not ones needed by
+    // the latest feedback
+    std::vector<std::pair<uint64_t, uint32_t> > candidates;
+    for (uint32_t page : slotPages) {
+        if (page != NONE && page < firstPinnedPage && residentChildren[page] == 0 && lastUsed[page] < frameNumber) {
+            candidates.push_back({ lastUsed[page], page });
+        }
+    }
+
+    if (candidates.size() > wanted) {
+        std::nth_element(candidates.begin(), candidates.begin() + wanted, candidates.end());
+        candidates.resize(wanted);
+    }
+    for (const auto& candidate : candidates) {
+        evict(candidate.second);
+    }
+}
+
+void VirtualTexture::recordUploads(vk::CommandBuffer commandBuffer, vk::Buffer source, bool uploadMapping,
+                                   vk::DeviceSize mappingOffset, bool initial) {
+    if (pageCopies.empty() && !uploadMapping) {
+        return;
+    }
+
+    // Frames already submitted may still be sampling, so the copies wait on
+    // their fragment shaders. At first there is nothing to keep
+    vk::PipelineStageFlags srcStage = initial ? vk::PipelineStageFlagBits::eTopOfPipe
+                                              : vk::PipelineStageFlagBits::eFragmentShader;
+    vk::ImageLayout oldLayout = initial ? vk::ImageLayout::eUndefined : vk::ImageLayout::eShaderReadOnlyOptimal;
+
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+
+    vk::ImageMemoryBarrier imageBarrier{};
+    imageBarrier.srcAccessMask = {};
+    imageBarrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    imageBarrier.oldLayout = oldLayout;
+    imageBarrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, 1);
+
+    if (!pageCopies.empty() || initial) {
+        imageBarrier.image = image;
+        imageBarriers.push_back(imageBarrier);
+    }
+    if (uploadMapping) {
+        if (sparse) {
+            imageBarrier.image = minMipImage;
+            imageBarriers.push_back(imageBarrier);
+        } else {
+            vk::BufferMemoryBarrier bufferBarrier{};
+            bufferBarrier.srcAccessMask = {};
+            bufferBarrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = indirectionBuffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(bufferBarrier);
+        }
+    }
+    commandBuffer.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eTransfer, {},
+                                  nullptr, bufferBarriers, imageBarriers);
+
+    if (!pageCopies.empty()) {
+        commandBuffer.copyBufferToImage(source, image, vk::ImageLayout::eTransferDstOptimal, pageCopies);
+    }
+    if (uploadMapping) {
+        if (sparse) {
+            vk::BufferImageCopy copy{};
+            copy.bufferOffset = mappingOffset;
+            copy.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+            copy.imageExtent = vk::Extent3D(file.getPagesX(0), file.getPagesY(0), 1);
+            commandBuffer.copyBufferToImage(source, minMipImage, vk::ImageLayout::eTransferDstOptimal, copy);
+        } else {
+            commandBuffer.copyBuffer(source, indirectionBuffer, vk::BufferCopy(mappingOffset, 0, getMappingSize()));
+        }
+    }
+
+    // Then everything goes back to being read by the fragment shader
+    for (auto& barrier : imageBarriers) {
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    }
+    for (auto& barrier : bufferBarriers) {
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {},
+                                  nullptr, bufferBarriers, imageBarriers);
+}
+
+void VirtualTexture::addPageCopy(uint32_t page, uint32_t slot, vk::DeviceSize bufferOffset) {
+    uint32_t mip, x, y;
+    file.getPageLocation(page, &mip, &x, &y);
+
+    // Pages are stored padded to the full size, even where the copy is
+    // clamped to the edge of the level
+    vk::BufferImageCopy copy{};
+    copy.bufferOffset = bufferOffset;
+    copy.bufferRowLength = PageFile::PAGE_SIZE;
+    copy.bufferImageHeight = PageFile::PAGE_SIZE;
+
+    if (sparse) {
+        copy.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, 0, 1);
+        copy.imageOffset = vk::Offset3D(x * PageFile::PAGE_SIZE, y * PageFile::PAGE_SIZE, 0);
+        copy.imageExtent = getPageExtent(mip, x, y);
+
+        // Pages in the mip tail are already bound
+        if (slot != NONE) {
+            // The slot's memory is still bound to the page last evicted from
+            // it, and memory can't be bound to two places at once
+            if (boundPages[slot] != NONE) {
+                uint32_t oldMip, oldX, oldY;
+                file.getPageLocation(boundPages[slot], &oldMip, &oldX, &oldY);
+
+                vk::SparseImageMemoryBind unbind{};
+                unbind.subresource = vk::ImageSubresource(vk::ImageAspectFlagBits::eColor, oldMip, 0);
+                unbind.offset = vk::Offset3D(oldX * PageFile::PAGE_SIZE, oldY * PageFile::PAGE_SIZE, 0);
+                unbind.extent = getPageExtent(oldMip, oldX, oldY);
+                pageBinds.push_back(unbind);
+            }
+
+            vk::SparseImageMemoryBind bind{};
+            bind.subresource = vk::ImageSubresource(vk::ImageAspectFlagBits::eColor, mip, 0);
+            bind.offset = copy.imageOffset;
+            bind.extent = copy.imageExtent;
+            bind.memory = pageMemory.memory;
+            bind.memoryOffset = pageMemory.offset + (vk::DeviceSize)slot * PageFile::PAGE_BYTES;
+            pageBinds.push_back(bind);
+            boundPages[slot] = page;
+        }
+    } else {
+        copy.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+        copy.imageOffset = vk::Offset3D((slot % slotsPerRow) * PageFile::PAGE_SIZE,
+                                        (slot / slotsPerRow) * PageFile::PAGE_SIZE, 0);
+        copy.imageExtent = vk::Extent3D(PageFile::PAGE_SIZE, PageFile::PAGE_SIZE, 1);
+    }
+
+    pageCopies.push_back(copy);
+}
+
+void VirtualTexture::makeResident(uint32_t page, uint32_t slot) {
+    pageSlots[page] = slot;
+    slotPages[slot] = page;
+
+    uint32_t mip, x, y;
+    file.getPageLocation(page, &mip, &x, &y);
+    if (mip + 1 < file.getMipCount()) {
+        residentChildren[file.getParent(page)]++;
+    }
+
+    // Nothing under the page was resident, so all of it now uses the page
+    fillMapping(mip, x, y, (slot << 8) | mip);
+    mappingDirty = true;
+}
+
+void VirtualTexture::evict(uint32_t page) {
+    uint32_t slot = pageSlots[page];
+    pageSlots[page] = NONE;
+    slotPages[slot] = NONE;
+
+    uint32_t parent = file.getParent(page);
+    residentChildren[parent]--;
+
+    // Nothing under the page is resident either, so all of it goes back to
+    // using the parent
+    uint32_t mip, x, y;
+    file.getPageLocation(page, &mip, &x, &y);
+    fillMapping(mip, x, y, mapping[parent]);
+    mappingDirty = true;
+
+    quarantinedSlots.push_back({ frameNumber, slot });
+}
+
+bool VirtualTexture::isResident(uint32_t page) const {
+    return page >= tailFirstPage || pageSlots[page] != NONE;
+}
+
+void VirtualTexture::fillMapping(uint32_t mip, uint32_t x, uint32_t y, uint32_t value) {
+    mapping[file.getPageId(mip, x, y)] = value;
+    if (mip == 0) {
+        return;
+    }
+
+    // The children are the 2x2 pages below, except that the last page of a
+    // row or column also covers any left over past them
+    uint32_t childMip = mip - 1;
+    uint32_t lastX = x == file.getPagesX(mip) - 1 ? file.getPagesX(childMip) - 1
+                                                  : std::min(2 * x + 1, file.getPagesX(childMip) - 1);
+    uint32_t lastY = y == file.getPagesY(mip) - 1 ? file.getPagesY(childMip) - 1
+                                                  : std::min(2 * y + 1, file.getPagesY(childMip) - 1);
+    for (uint32_t childY = 2 * y; childY <= lastY; childY++) {
+        for (uint32_t childX = 2 * x; childX <= lastX; childX++) {
+            fillMapping(childMip, childX, childY, value);
+        }
+    }
+}
+
+vk::DeviceSize VirtualTexture::getMappingSize() const {
+    // The min mip map only needs the mip level of each page of mip 0
+    if (sparse) {
+        return (vk::DeviceSize)file.getPagesX(0) * file.getPagesY(0);
+    }
+    return (vk::DeviceSize)file.getPageCount() * sizeof(uint32_t);
+}
+
+vk::DeviceSize VirtualTexture::getStagingFrameSize() const {
+    return MAX_UPLOADS_PER_FRAME * PageFile::PAGE_BYTES + getMappingSize() + 256;
+}
+
+void VirtualTexture::writeMapping(void* data) const {
+    if (sparse) {
+        // The pages of mip 0 come first, in the same order as the texels
+        uint8_t* minMips = static_cast<uint8_t*>(data);
+        for (uint32_t page = 0; page < getMappingSize(); page++) {
+            minMips[page] = (uint8_t)(mapping[page] & 0xff);
+        }
+    } else {
+        memcpy(data, mapping.data(), getMappingSize());
+    }
+}
+
+vk::Extent3D VirtualTexture::getPageExtent(uint32_t mip, uint32_t x, uint32_t y) const {
+    return vk::Extent3D(std::min(PageFile::PAGE_SIZE, file.getMipWidth(mip) - x * PageFile::PAGE_SIZE),
+                        std::min(PageFile::PAGE_SIZE, file.getMipHeight(mip) - y * PageFile::PAGE_SIZE), 1);
+}
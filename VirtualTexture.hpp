@@ -0,0 +1,383 @@
+// October 18, 2026
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "PageFile.hpp"
+#include "PageStreamer.hpp"
+#include "MemoryAllocator.hpp"
+#include "StagingRing.hpp"
+#include "LayoutCache.hpp"
+#include "DeviceFeatures.hpp"
+#include "PipelineLibrary.hpp"
+
+/**
+ * A texture far larger than device memory, of which only the pages that are
+ * being looked at are resident.
+ *
+ * The fragment shader reports the page each pixel needs into a feedback
+ * bitmask. Once the frame completes the bitmask is read back, and the pages
+ * that are missing are requested from a PageStreamer, which reads them from
+ * the page file on a background thread. Read pages are uploaded at the start
+ * of a later frame, a few each frame. A fixed number of slots holds the
+ * resident pages, which is the memory budget, and the least recently used
+ * pages are evicted to make room.
+ *
+ * With sparseResidencyImage2D, the texture is a sparse image as large as the
+ * whole virtual texture, and pages are bound to slots of a memory pool with
+ * vkQueueBindSparse. The shader never samples finer than the min mip map says
+ * is resident. The mip tail is bound and uploaded up front.
+ *
+ * Otherwise pages are copied into the slots of an ordinary cache texture, and
+ * an indirection table gives the slot of the finest resident page covering
+ * every page. The shader looks up its page there and samples the slot.
+ * Filtering doesn't cross pages, and trilinear filtering isn't possible.
+ *
+ * A page is only made resident once its parent is, and only pages without
+ * resident children are evicted, so the pages covering any point are always
+ * resident from the coarsest level down to some level. The coarsest page (or
+ * the mip tail) is always resident, so there is always something to sample.
+ */
+class VirtualTexture {
+public:
+    /** The default memory budget for resident pages */
+    inline static const vk::DeviceSize DEFAULT_BUDGET = 64ull * 1024 * 1024;
+    /** The most pages uploaded in one frame, so streaming doesn't cause
+     *  hitches */
+    inline static const uint32_t MAX_UPLOADS_PER_FRAME = 16;
+
+    /**
+     * Opens the page file, creates the resources, starts the streamer, and
+     * uploads the pages that are always resident. Waits for the queue to be
+     * idle
+     *
+     * Requires: The device has fragmentStoresAndAtomics enabled, for the
+     *           feedback
+     *
+     * @param physicalDevice The physical device, to check sparse support
+     * @param device The logical device
+     * @param queue The graphics queue, which is also used for sparse binding
+     * @param queueFamilyIndex The family of the queue
+     * @param features The enabled device features
+     * @param allocator Allocates the memory of the resources
+     * @param layoutCache Gives the descriptor set layout
+     * @param path The path to the page file
+     * @param budget The bytes of device memory for resident pages
+     * @param frameCount The number of concurrent frames
+     *
+     * @throw std::runtime_error if the page file couldn't be read
+     */
+    void initialize(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue queue, uint32_t queueFamilyIndex,
+                    const DeviceFeatures& features, MemoryAllocator* allocator, LayoutCache* layoutCache,
+                    const std::string& path, vk::DeviceSize budget, uint32_t frameCount);
+
+    /**
+     * Stops the streamer and destroys every resource
+     *
+     * Requires: No frame using the texture is still in use
+     */
+    void destroy();
+
+    /**
+     * @return Whether pages are bound into a sparse image, rather than copied
+     *         into a cache texture
+     */
+    bool isSparse() const { return sparse; }
+
+    /**
+     * @return The shaders and state of the pipeline that draws the texture
+     */
+    PipelineKey getPipelineKey() const;
+
+    /**
+     * @return The GLSL sources of the shaders, for the shader watcher
+     */
+    static std::vector<std::string> getShaderSources() { return { VERT_SOURCE_PATH, FRAG_SOURCE_PATH }; }
+
+    /**
+     * Sets the part of the texture shown
+     *
+     * @param x The left edge, in texture coordinates
+     * @param y The top edge, in texture coordinates
+     * @param scale The width and height shown, in texture coordinates
+     */
+    void setView(float x, float y, float scale);
+
+    /**
+     * Reads the feedback of the frame's last use, requests the missing pages,
+     * evicts old pages, and records the uploads of the pages that have been
+     * read. With a sparse image, the page binds are submitted to the queue.
+     * Must be recorded outside a render pass
+     *
+     * Requires: The work of the frame's last use has completed
+     *
+     * @param commandBuffer The command buffer of the frame
+     * @param frameIndex The index of the concurrent frame
+     */
+    void beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+    /**
+     * @return A semaphore the frame's submission must wait on, since it
+     *         signals when the page binds are done, or null if no pages were
+     *         bound this frame
+     */
+    vk::Semaphore getBindSemaphore(uint32_t frameIndex) const;
+
+    /**
+     * Draws the texture over the whole screen
+     *
+     * Requires: The pipeline of getPipelineKey() is bound
+     *
+     * @param commandBuffer The command buffer of the frame, in a render pass
+     * @param layout The layout of the pipeline
+     * @param frameIndex The index of the concurrent frame
+     */
+    void draw(vk::CommandBuffer commandBuffer, vk::PipelineLayout layout, uint32_t frameIndex);
+
+    /**
+     * Makes the frame's feedback readable by the host once the frame
+     * completes. Must be recorded after the render pass
+     *
+     * @param commandBuffer The command buffer of the frame
+     * @param frameIndex The index of the concurrent frame
+     */
+    void endFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+    /**
+     * Adds the staging written by beginFrame() to a batch for
+     * MemoryAllocator::flush(), which must be flushed before the frame is
+     * submitted
+     *
+     * @param ranges The batch
+     */
+    void collectFlushRanges(std::vector<vk::MappedMemoryRange>* ranges) { stagingRing.collectFlushRanges(ranges); }
+
+    /**
+     * Gives back the staging buffer while nothing is drawn, such as while the
+     * window is minimized. The resident pages are kept
+     *
+     * Requires: No frame is in flight
+     */
+    void suspend();
+
+    /**
+     * Recreates the staging buffer given back by suspend()
+     */
+    void resume();
+
+private:
+    /** Marks a page without a slot, or a slot without a page */
+    inline static const uint32_t NONE = UINT32_MAX;
+    /** The paths to the shaders */
+    inline static const std::string VERT_SOURCE_PATH = "shaders/virtual_texture.vert";
+    inline static const std::string VERT_PATH = "shaders/virtual_texture_vert.spv";
+    inline static const std::string FRAG_SOURCE_PATH = "shaders/virtual_texture.frag";
+    inline static const std::string FRAG_PATH = "shaders/virtual_texture_frag.spv";
+    inline static const std::string FRAG_SPARSE_PATH = "shaders/virtual_texture_sparse_frag.spv";
+
+    /** The push constants of the shaders */
+    struct PushConstants {
+        float view[4];
+        uint32_t size[2];
+        uint32_t mipCount;
+        uint32_t frame;
+    };
+
+    vk::Device device;
+    vk::Queue queue;
+    MemoryAllocator* allocator = nullptr;
+    uint32_t frameCount = 0;
+    bool sparse = false;
+
+    PageFile file;
+    PageStreamer streamer;
+    StagingRing stagingRing;
+
+    // Residency
+    /** Levels from this one down are in the sparse mip tail, or the mip count
+     *  if there is no tail */
+    uint32_t tailFirstLevel = 0;
+    /** Levels from this one down are always resident */
+    uint32_t firstPinnedLevel = 0;
+    /** The first page of those levels. Coarser levels have higher ids */
+    uint32_t tailFirstPage = 0;
+    uint32_t firstPinnedPage = 0;
+    /** For every page, the slot (high 24 bits) and level (low 8 bits) of the
+     *  finest resident page covering it. The indirection table */
+    std::vector<uint32_t> mapping;
+    /** The slot of every page, or NONE if it isn't in a slot */
+    std::vector<uint32_t> pageSlots;
+    /** The number of resident children of every page */
+    std::vector<uint8_t> residentChildren;
+    /** The last frame every page was needed */
+    std::vector<uint64_t> lastUsed;
+    /** The page in every slot, or NONE */
+    std::vector<uint32_t> slotPages;
+    /** The page bound to the memory of every slot, which stays bound after
+     *  the page is evicted until the slot is reused. Only for sparse images */
+    std::vector<uint32_t> boundPages;
+    /** The slots that can be used */
+    std::vector<uint32_t> freeSlots;
+    /** Slots of evicted pages, with the frame they were evicted in. Frames
+     *  still in flight may sample them, so they wait before being reused */
+    std::deque<std::pair<uint64_t, uint32_t> > quarantinedSlots;
+    /** Whether the mapping changed since it was last uploaded */
+    bool mappingDirty = false;
+    /** The number of pages missing in the latest feedback */
+    size_t requestedCount = 0;
+    /** The frames started */
+    uint64_t frameNumber = 0;
+
+    // Resources
+    /** The sparse image, or the cache texture */
+    vk::Image image;
+    Allocation imageAllocation;
+    vk::ImageView imageView;
+    /** The columns of slots in the cache texture */
+    uint32_t slotsPerRow = 0;
+    /** The memory pool of the slots, and of the mip tail. Sparse only */
+    Allocation pageMemory;
+    Allocation tailMemory;
+    /** The range of the image's memory that is the mip tail */
+    vk::DeviceSize tailOffset = 0;
+    vk::DeviceSize tailSize = 0;
+    /** The min mip map, sparse only */
+    vk::Image minMipImage;
+    Allocation minMipAllocation;
+    vk::ImageView minMipView;
+    /** The indirection table, without sparse images */
+    vk::Buffer indirectionBuffer;
+    Allocation indirectionAllocation;
+    /** The feedback bitmask of each concurrent frame */
+    std::vector<vk::Buffer> feedbackBuffers;
+    std::vector<Allocation> feedbackAllocations;
+    /** Whether each frame's feedback has been written by a frame */
+    std::vector<bool> feedbackWritten;
+    vk::DeviceSize feedbackSize = 0;
+    /** Signaled by each frame's page binds */
+    std::vector<vk::Semaphore> bindSemaphores;
+    std::vector<bool> bindPending;
+    vk::Sampler sampler;
+    vk::Sampler minMipSampler;
+    vk::DescriptorPool descriptorPool;
+    std::vector<vk::DescriptorSet> descriptorSets;
+    PushConstants pushConstants{};
+
+    // Built up by beginFrame()
+    std::vector<vk::BufferImageCopy> pageCopies;
+    std::vector<vk::SparseImageMemoryBind> pageBinds;
+
+    /**
+     * Decides between a sparse image and a cache texture
+     */
+    bool canUseSparse(vk::PhysicalDevice physicalDevice, const DeviceFeatures& features, uint32_t queueFamilyIndex);
+
+    /**
+     * Creates the sparse image, its memory pool, and the min mip map
+     */
+    void createSparseResources(uint32_t slotCount);
+
+    /**
+     * Creates the cache texture and the indirection table
+     */
+    void createCacheResources(uint32_t slotCount, uint32_t maxImageDimension);
+
+    /**
+     * Creates the feedback buffers, the samplers and the descriptor sets
+     */
+    void createSharedResources(LayoutCache* layoutCache);
+
+    /**
+     * Binds and uploads the pages that are always resident, and clears the
+     * feedback. Waits for the queue to be idle
+     */
+    void uploadPinnedPages(uint32_t queueFamilyIndex);
+
+    /**
+     * Turns the frame's feedback into page requests, and updates when pages
+     * were last used
+     */
+    void processFeedback(uint32_t frameIndex);
+
+    /**
+     * Takes pages from the streamer into free slots, adding their copies (and
+     * binds) to pageCopies (and pageBinds)
+     */
+    void uploadLoadedPages();
+
+    /**
+     * Evicts the least recently used pages until enough slots are free or
+     * waiting to be
+     */
+    void evictPages();
+
+    /**
+     * Records the copies in pageCopies, and the upload of the mapping, with
+     * the layout transitions around them
+     *
+     * @param source The buffer holding the texels and the mapping
+     * @param uploadMapping Whether to upload the mapping
+     * @param mappingOffset The offset of the mapping in the buffer
+     * @param initial Whether the resources haven't been used yet
+     */
+    void recordUploads(vk::CommandBuffer commandBuffer, vk::Buffer source, bool uploadMapping,
+                       vk::DeviceSize mappingOffset, bool initial);
+
+    /**
+     * Adds the copy of a page to pageCopies, and to pageBinds if sparse
+     *
+     * @param page The id of the page
+     * @param slot The slot the page is put in
+     * @param bufferOffset The offset of the page's texels in the staging buffer
+     */
+    void addPageCopy(uint32_t page, uint32_t slot, vk::DeviceSize bufferOffset);
+
+    /**
+     * Records a page as resident in a slot, and updates the mapping
+     */
+    void makeResident(uint32_t page, uint32_t slot);
+
+    /**
+     * Evicts a page without resident children from its slot
+     */
+    void evict(uint32_t page);
+
+    /**
+     * @return Whether a page is resident
+     */
+    bool isResident(uint32_t page) const;
+
+    /**
+     * Sets the mapping of a page and every page under it
+     */
+    void fillMapping(uint32_t mip, uint32_t x, uint32_t y, uint32_t value);
+
+    /**
+     * @return The bytes of the mapping as uploaded, which is the min mip map
+     *         or the indirection table
+     */
+    vk::DeviceSize getMappingSize() const;
+
+    /**
+     * @return The size of each frame's staging region. A frame never uploads
+     *         more than this, so the mapping always fits
+     */
+    vk::DeviceSize getStagingFrameSize() const;
+
+    /**
+     * Writes the mapping as uploaded
+     */
+    void writeMapping(void* data) const;
+
+    /**
+     * @return The region of the texture covered by a page, in the sparse
+     *         image. Pages on the edges are clamped to the size of their level
+     */
+    vk::Extent3D getPageExtent(uint32_t mip, uint32_t x, uint32_t y) const;
+};
@@ -10,7 +10,11 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <stdexcept>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 
 #include "VulkanApp.hpp"
 
@@ -23,6 +27,11 @@ void VulkanApp::run() {
     cleanup();
 }
 
+void VulkanApp::setCapture(const std::string& path, uint32_t frameCount) {
+    capturePath = path;
+    captureFrameCount = frameCount;
+}
+
 // ***** Private methods *****
 
 // Static
@@ -53,7 +62,18 @@ void VulkanApp::framebufferResizeCallback(GLFWwindow* window, int width, int hei
     // Get the app reference that was given to the window
     VulkanApp* app = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
 
+    // The swapchain is recreated once resizing stops, rather than for every
+    // step of a drag
     app->framebufferResized = true;
+    app->lastResizeTime = glfwGetTime();
+}
+
+void VulkanApp::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    VulkanApp* app = reinterpret_cast<VulkanApp*>(glfwGetWindowUserPointer(window));
+
+    if (key == HUD_KEY && action == GLFW_PRESS) {
+        app->hud.toggle();
+    }
 }
 
 
@@ -69,6 +89,7 @@ void VulkanApp::initWindow() {
     // Give the window a pointer to this app so that it can set the resize flag
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+    glfwSetKeyCallback(window, keyCallback);
 }
 
 void VulkanApp::initVulkan() {
@@ -78,21 +99,107 @@ void VulkanApp::initVulkan() {
     }
     createSurface();
     pickPhysicalDevice();
+    // Outlive the device, so they carry over if it is recreated
+    if (metricsExport.initialize(MetricsFile::DEFAULT_PATH, &memoryAllocator)) {
+        std::cout << "Publishing metrics to " << MetricsFile::DEFAULT_PATH << std::endl;
+    }
+    shaderCompiler.initialize(SHADER_CACHE_DIR);
+    // The archive is optional, built with "make shaders"
+    shaderArchive.open(SHADER_ARCHIVE_PATH);
+    shaderLoader = [this](const ShaderVariant& variant) {
+        return loadShaderCode(variant.sourcePath, variant.spirvPath, variant.defines);
+    };
+    pipelineKey.vertexShader = ShaderVariant{ VERT_SOURCE_PATH, VERT_PATH, {} };
+    pipelineKey.fragmentShader = ShaderVariant{ FRAG_SOURCE_PATH, FRAG_PATH, {} };
+
+    createDeviceObjects();
+    // Started once. A capture ends with the device it was made on, so it
+    // isn't started again on a recreated device
+    if (!capturePath.empty()) {
+        startCapture(capturePath, captureFrameCount);
+    }
+
+    if (enableShaderHotReload) {
+        // Each subsystem names the sources of its own shaders
+        std::vector<std::string> sourcePaths = { VERT_SOURCE_PATH, FRAG_SOURCE_PATH };
+        for (const auto& sources : { Scene::getShaderSources(), PerformanceHud::getShaderSources(),
+                                     VirtualTexture::getShaderSources(), OcclusionCuller::getShaderSources(),
+                                     MeshletRenderer::getShaderSources() }) {
+            sourcePaths.insert(sourcePaths.end(), sources.begin(), sources.end());
+        }
+        shaderWatcher.start(SHADER_DIR, sourcePaths);
+    }
+
+    // Started last, since its commands apply to everything above
+    if (controlServer.start(ControlServer::DEFAULT_PATH, metricsExport.getFile(), MAX_CONCURRENT_FRAMES)) {
+        std::cout << "Listening for commands on " << ControlServer::DEFAULT_PATH << std::endl;
+    }
+}
+
+void VulkanApp::createDeviceObjects() {
     createLogicalDevice();
+    completionService.initialize(device, features.timelineSemaphore);
+    memoryAllocator.initialize(physicalDevice, device, features.bufferDeviceAddress);
+    uint32_t graphicsFamilyIndex = queueFamilyIndices[QUEUE_FAMILY_GRAPHICS].value();
+    defragmenter.initialize(device, &memoryAllocator, &completionService, graphicsQueue);
+    geometryArena.initialize(device, &memoryAllocator, &completionService, features.bufferDeviceAddress,
+                             &frameCapture);
+    scene.initialize(device, graphicsQueue, graphicsFamilyIndex, &memoryAllocator, &completionService,
+                     &geometryArena);
+    // Created here in the same order as createSwapchainObjects(), and
+    // destroyed by cleanupSwapchain() the same way
+    swapchainObjectsCreated = true;
     createSwapchain();
     createImageViews();
+    createDepthResources();
+    createSceneColorResources();
     createRenderPass();
+    layoutCache.initialize(device);
+    // Replaced pipelines are destroyed once their frames complete
+    pipelineLibrary.initialize(device, features, &layoutCache, shaderLoader,
+        [this](vk::Pipeline pipeline) {
+            completionService.onQueueComplete(graphicsQueue, [this, pipeline]() {
+                device.destroyPipeline(pipeline);
+            });
+        },
+        PIPELINE_CACHE_PATH);
+    pipelineLibrary.setRenderPass(renderPass);
+    const GeometryArena::Mesh& sceneMesh = scene.getMesh();
+    culler.initialize(device, &memoryAllocator, &pipelineLibrary, &layoutCache, scene.getInstanceBuffer(),
+                      scene.getInstanceCount(), sceneMesh.indexCount, sceneMesh.firstIndex, sceneMesh.vertexOffset);
+    culler.createPyramid(depthImageView, renderExtent);
+    createVirtualTexture();
+    createMeshletRenderer();
+    hud.initialize(physicalDevice, device, graphicsFamilyIndex, &memoryAllocator, &layoutCache,
+                   MAX_CONCURRENT_FRAMES);
+    std::cout << "Press F1 to show the performance overlay" << std::endl;
     createGraphicsPipeline();
     createFramebuffers();
     createCommandPool();
     createCommandBuffers();
     createSyncObjects();
+    currentFrame = 0;
 }
 
 void VulkanApp::mainLoop() {
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
-        drawFrame();
+        try {
+            // Nothing is drawn while the window can't be seen, so the GPU
+            // memory for drawing is given back until it can
+            if (isWindowHidden()) {
+                suspend();
+                glfwWaitEvents();
+                continue;
+            }
+            if (suspended) {
+                resume();
+            }
+            drawFrame();
+        } catch (const vk::DeviceLostError& e) {
+            std::cerr << "ERROR: " << e.what() << std::endl;
+            recoverDevice();
+        }
     }
 
     // Let all of the asynchronous processes finish, so they are done for 
@@ -101,18 +208,17 @@ void VulkanApp::mainLoop() {
 }
 
 void VulkanApp::cleanup() {
-    cleanupSwapchain();
-
-    for (int i = 0; i < MAX_CONCURRENT_FRAMES; i++) { 
-        device.destroySemaphore(imageAvailableSemaphores[i]);
-        device.destroySemaphore(renderFinishedSemaphores[i]);
-        device.destroyFence(inFlightFences[i]);
+    // Stopped first, since it reads the metrics file
+    controlServer.stop();
+    if (enableShaderHotReload) {
+        shaderWatcher.stop();
     }
 
-    device.destroyCommandPool(commandPool);
-
-    // Queues are destroyed with the logical device
-    device.destroy();
+    // The device is idle, so every captured frame can be written
+    finishCapturedFrames();
+    destroyDeviceObjects();
+    metricsExport.destroy();
+    shaderArchive.close();
 
     // Physical device is implicitly destroyed with the instance
 
@@ -129,6 +235,92 @@ void VulkanApp::cleanup() {
     glfwTerminate();
 }
 
+void VulkanApp::destroyDeviceObjects() {
+    // Saves the pipeline cache for the next run, or for the recreated device
+    pipelineLibrary.destroy();
+
+    // Already destroyed if the window was hidden when it closed, but not if
+    // the device was lost partway through suspending or resuming
+    if (swapchainObjectsCreated) {
+        cleanupSwapchain(false);
+    }
+
+    for (int i = 0; i < MAX_CONCURRENT_FRAMES; i++) { 
+        device.destroySemaphore(imageAvailableSemaphores[i]);
+        device.destroySemaphore(renderFinishedSemaphores[i]);
+        device.destroyFence(inFlightFences[i]);
+    }
+
+    device.destroyCommandPool(commandPool);
+
+    // Runs any remaining callbacks, which is safe after waiting for the device
+    completionService.destroy();
+
+    // Cleared so a recreated device only uses them if they can be created
+    // again
+    if (useVirtualTexture) {
+        virtualTexture.destroy();
+        useVirtualTexture = false;
+    }
+    if (useMeshlets) {
+        meshletRenderer.destroy();
+        useMeshlets = false;
+    }
+    hud.destroy();
+    // Its buffers go with the device, so the frames not yet written are
+    // dropped
+    frameCapture.stop();
+    for (size_t i = 0; i < captureReadbackBuffers.size(); i++) {
+        memoryAllocator.destroyBuffer(captureReadbackBuffers[i], captureReadbackAllocations[i]);
+    }
+    captureReadbackBuffers.clear();
+    captureReadbackAllocations.clear();
+    culler.destroy();
+    scene.destroy();
+    geometryArena.destroy();
+    defragmenter.destroy();
+    // Everything allocated from it has been destroyed by now
+    memoryAllocator.destroy();
+
+    layoutCache.destroy();
+
+    // Queues are destroyed with the logical device
+    device.destroy();
+}
+
+void VulkanApp::recoverDevice() {
+    double now = glfwGetTime();
+    if (lastRecoveryTime >= 0.0 && now - lastRecoveryTime < MIN_SECONDS_BETWEEN_RECOVERIES) {
+        throw std::runtime_error("ERROR: The device was lost again right after being recreated.");
+    }
+    lastRecoveryTime = now;
+    std::chrono::steady_clock::time_point recoveryStart = std::chrono::steady_clock::now();
+
+    // Waiting on a lost device returns right away, but either way nothing is
+    // running on it once this returns
+    try {
+        device.waitIdle();
+    } catch (const vk::DeviceLostError&) {
+    }
+    destroyDeviceObjects();
+
+    // The swapchain can't be created without a size, so it is recreated once
+    // the window can be seen again
+    while (isWindowHidden()) {
+        if (glfwWindowShouldClose(window)) {
+            throw std::runtime_error("ERROR: The window was closed before the device could be recreated.");
+        }
+        glfwWaitEvents();
+    }
+    suspended = false;
+    framebufferResized = false;
+    createDeviceObjects();
+    metricsExport.restartFrameTimer();
+
+    std::cout << "Recreated the device in " << std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - recoveryStart).count() << " ms" << std::endl;
+}
+
 // Helper methods for initVulkan()
 
 void VulkanApp::createInstance() {
@@ -147,7 +339,18 @@ void VulkanApp::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Vulkan 1.1 if the loader has it, which mesh shaders need. Its version
+    // query is looked up, since a 1.0 loader doesn't have it at all
+    instanceApiVersion = VK_API_VERSION_1_0;
+#ifdef VK_VERSION_1_1
+    auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr && enumerateInstanceVersion(&loaderVersion) == VK_SUCCESS &&
+        loaderVersion >= VK_API_VERSION_1_1) {
+        instanceApiVersion = VK_API_VERSION_1_1;
+    }
+#endif
+    appInfo.apiVersion = instanceApiVersion;
     appInfo.pNext = nullptr; // Can point to extension information
 
     // This struct tells the Vulkan driver which extensions and validation
@@ -199,15 +402,21 @@ void VulkanApp::pickPhysicalDevice() {
     if (!found) {
         throw std::runtime_error("ERROR: Failed to find suitable graphics card.");
     }
+
+    // Neither changes for the surface, so they are only queried again for
+    // the capabilities when the swapchain is recreated
+    queueFamilyIndices = findQueueFamilies(physicalDevice);
+    getSwapchainProperties(physicalDevice, &surfaceProperties);
+
+    canTrimCommandPools = instanceApiVersion >= VK_API_VERSION_1_1 &&
+        physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_1;
 }
 
 void VulkanApp::createLogicalDevice() {
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-
     // The queues need the priority that helps select which one to use during
     // threading, even when there is just one
     float queuePriority = 1.f;
-    auto uniqueIndices = indices.getUniqueIndices();
+    auto uniqueIndices = queueFamilyIndices.getUniqueIndices();
 
     // We add the queue families to this vector, but because there are few to
     // add, the loss in efficiency will be negligible
@@ -225,7 +434,8 @@ void VulkanApp::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    // Specify device features to be using (none currently)
+    // Specify device features to be using, which are the core features the
+    // optional paths use, if supported
     vk::PhysicalDeviceFeatures deviceFeatures{};
 
     vk::DeviceCreateInfo deviceCreateInfo{};
@@ -234,9 +444,27 @@ void VulkanApp::createLogicalDevice() {
 
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
-    // Enable the device specific extensions
-    deviceCreateInfo.enabledExtensionCount = (uint32_t)deviceExtensions.size();
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    // Enable the device specific extensions, along with the optional ones that
+    // are supported. Optional extensions all depend on
+    // VK_KHR_get_physical_device_properties2 from the instance
+    std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    if (instanceSupportsProperties2) {
+        enabledOptionalExtensions = findOptionalExtensions(physicalDevice);
+    }
+    for (const char* extensionName : optionalDeviceExtensions) {
+        if (isExtensionEnabled(extensionName)) {
+            enabledExtensions.push_back(extensionName);
+        }
+    }
+
+    deviceCreateInfo.enabledExtensionCount = (uint32_t)enabledExtensions.size();
+    deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
+
+    // Features of optional extensions are enabled by chaining their structs
+    // onto pNext, once they are known to be supported
+    features.query(instance, physicalDevice, enabledOptionalExtensions);
+    features.chainEnabledFeatures(&deviceCreateInfo);
+    features.enableCoreFeatures(&deviceFeatures);
 
     // Modern versions of Vulkan don't use device specific validation layers,
     // but this is done in case there is an old version
@@ -252,12 +480,15 @@ void VulkanApp::createLogicalDevice() {
 
     // Finally, fill in the queue handles with the first queue from the
     // respective queue families in the device
-    device.getQueue(indices[QUEUE_FAMILY_GRAPHICS].value(), 0, &graphicsQueue);
-    device.getQueue(indices[QUEUE_FAMILY_PRESENT].value(), 0, &presentQueue);
+    device.getQueue(queueFamilyIndices[QUEUE_FAMILY_GRAPHICS].value(), 0, &graphicsQueue);
+    device.getQueue(queueFamilyIndices[QUEUE_FAMILY_PRESENT].value(), 0, &presentQueue);
 }
 
 void VulkanApp::createSwapchain() {
-    SwapchainProperties properties = getSwapchainProperties(physicalDevice);
+    // The capabilities hold the current extent, so they are all that can
+    // change
+    surfaceProperties.surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
+    const SwapchainProperties& properties = surfaceProperties;
 
     vk::SurfaceFormatKHR surfaceFormat = chooseSwapchainSurfaceFormat(properties);
     vk::PresentModeKHR presentMode = chooseSwapchainPresentMode(properties);
@@ -267,6 +498,23 @@ void VulkanApp::createSwapchain() {
     swapchainImageFormat = surfaceFormat.format;
     swapchainExtent = extent;
 
+    // A scaled scene is blitted to the swapchain, so it can only be scaled if
+    // the format can be blitted with filtering
+    vk::FormatFeatureFlags blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst |
+                                          vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    scaledRendering = false;
+    if (resolutionScale != 1.f) {
+        vk::FormatFeatureFlags formatFeatures = physicalDevice.getFormatProperties(surfaceFormat.format).optimalTilingFeatures;
+        scaledRendering = (formatFeatures & blitFeatures) == blitFeatures &&
+                          (properties.surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst);
+    }
+    renderExtent = extent;
+    if (scaledRendering) {
+        vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+        renderExtent.width = std::clamp((uint32_t)(extent.width * resolutionScale), 1u, limits.maxFramebufferWidth);
+        renderExtent.height = std::clamp((uint32_t)(extent.height * resolutionScale), 1u, limits.maxFramebufferHeight);
+    }
+
     // The number of images we want to be in the swapchain. The minimum would
     // mean that there might not always be an available target, so we add one
     uint32_t imageCount = properties.surfaceCapabilities.minImageCount + 1;
@@ -296,9 +544,13 @@ void VulkanApp::createSwapchain() {
     // Use eTransferDstBit or other values if writing somewhere else first for
     // postprocessing and then copying to an image
     createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    // A scaled scene is blitted to the images instead
+    if (scaledRendering) {
+        createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
 
     // Specify the queue families for the swapchain
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    QueueFamilyIndices& indices = queueFamilyIndices;
     uint32_t indicesArray[] = {
         indices[QUEUE_FAMILY_GRAPHICS].value(),
         indices[QUEUE_FAMILY_PRESENT].value()
@@ -331,17 +583,26 @@ void VulkanApp::createSwapchain() {
     createInfo.clipped = VK_TRUE;
 
     // When the swapchain is recreated (like with a window resizing) the old
-    // swapchain is needed. Assume it is never recreated... for now!
-    // createInfo.oldSwapchain = VK_NULL_HANDLE;
-    createInfo.oldSwapchain = nullptr;
+    // one is handed over, so the presentation engine can reuse its resources.
+    // It is null when there is none, such as after suspending
+    vk::SwapchainKHR oldSwapchain = swapchain;
+    createInfo.oldSwapchain = oldSwapchain;
 
     swapchain = device.createSwapchainKHR(createInfo);
-
-    // Get the handles for the images from the swapchain
-    // device.getSwapchainImagesKHR(swapchain, &imageCount, nullptr);
-    // swapchainImages.resize(imageCount);
-    // device.getSwapchainImagesKHR(swapchain, &imageCount, swapchainImages.data());
-    swapchainImages = device.getSwapchainImagesKHR(swapchain);
+    // Retired by the creation whether or not any of its images are presented
+    // again, and nothing uses them since the device is idle
+    device.destroySwapchainKHR(oldSwapchain);
+
+    // Get the handles for the images from the swapchain. Read into the
+    // vector from the last swapchain, which has room unless the count grew
+    vk::Result result = device.getSwapchainImagesKHR(swapchain, &imageCount, nullptr);
+    if (result == vk::Result::eSuccess) {
+        swapchainImages.resize(imageCount);
+        result = device.getSwapchainImagesKHR(swapchain, &imageCount, swapchainImages.data());
+    }
+    if (result != vk::Result::eSuccess) {
+        vk::throwResultException(result, "vk::Device::getSwapchainImagesKHR");
+    }
 }
 
 void VulkanApp::createImageViews() {
@@ -384,250 +645,118 @@ void VulkanApp::createImageViews() {
     }
 }
 
-void VulkanApp::createGraphicsPipeline() {
-    // Pipeline:
-    // - Input assembler
-    // - Vertex shader (programmable)
-    // - Tesselation (programmable)
-    // - Geometry shader (programmable)
-    // - Rasterization
-    // - Fragment shader (programmable)
-    // - Color blending
-
-    // ***** Set up the programmed aspects of the pipeline *****
-
-    // Set up vertex shader
-
-    // Local variables because they are not needed after making the pipeline
-    vk::ShaderModule vertShader = createShaderModule(readFile(VERT_PATH));
-
-    vk::PipelineShaderStageCreateInfo vertShaderInfo{};
-    vertShaderInfo.stage = vk::ShaderStageFlagBits::eVertex;
-    vertShaderInfo.module = vertShader;
-    // Theoretically can combine multiple fragment shaders into one module and
-    // use different entry point
-    vertShaderInfo.pName = SHADER_MAIN.c_str();
-    // For specifying values for shader constants (to optimize before runtime)
-    // Optional: by default is nullptr
-    vertShaderInfo.pSpecializationInfo = nullptr; // Optional
-
-    // Set up fragment shader
-
-    vk::ShaderModule fragShader = createShaderModule(readFile(FRAG_PATH));
-
-    vk::PipelineShaderStageCreateInfo fragShaderInfo{};
-    fragShaderInfo.stage = vk::ShaderStageFlagBits::eFragment;
-    fragShaderInfo.module = fragShader;
-    fragShaderInfo.pName = SHADER_MAIN.c_str();
-    fragShaderInfo.pSpecializationInfo = nullptr; // Optional
-
-    // An array of the shader stage create infos to use
-    vk::PipelineShaderStageCreateInfo shaderStageCreateInfos[] = {
-        vertShaderInfo,
-        fragShaderInfo,
-    };
+void VulkanApp::createDepthResources() {
+    // Depth only formats, so one view is both the attachment and what the
+    // pyramid samples. D16 is always supported for both
+    depthFormat = vk::Format::eUndefined;
+    for (vk::Format format : { vk::Format::eD32Sfloat, vk::Format::eD16Unorm }) {
+        vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eDepthStencilAttachment |
+                                          vk::FormatFeatureFlagBits::eSampledImage;
+        if ((physicalDevice.getFormatProperties(format).optimalTilingFeatures & required) == required) {
+            depthFormat = format;
+            break;
+        }
+    }
+    if (depthFormat == vk::Format::eUndefined) {
+        throw std::runtime_error("ERROR: Failed to find a depth format that can be sampled.");
+    }
 
-    // ***** Set up the fixed aspects of the pipeline *****
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = depthFormat;
+    imageInfo.extent = vk::Extent3D(renderExtent.width, renderExtent.height, 1);
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    depthImage = memoryAllocator.createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {},
+                                             &depthAllocation);
+
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = depthImage;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1);
+    depthImageView = device.createImageView(viewInfo);
+}
 
-    // Set up Vertex Input State
+void VulkanApp::createSceneColorResources() {
+    if (!scaledRendering) {
+        return;
+    }
 
-    // For now, specify no vertex inputs (points defined in shader)
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
-    // Specifies spacing between data (and whether per vertex or per instance)
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-    // Types of data, which binding, and offset for each attribute
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
+    // Drawn to in the render passes, then blitted to the swapchain image
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = swapchainImageFormat;
+    imageInfo.extent = vk::Extent3D(renderExtent.width, renderExtent.height, 1);
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    sceneColorImage = memoryAllocator.createImage(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, {},
+                                                  &sceneColorAllocation);
+
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = sceneColorImage;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = swapchainImageFormat;
+    viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    sceneColorImageView = device.createImageView(viewInfo);
+}
 
-    // Set up Input Assembler State
+void VulkanApp::createGraphicsPipeline() {
+    // The library reflects the shaders for the pipeline layout, so it is got
+    // along with the pipeline
+    graphicsPipeline = pipelineLibrary.getPipeline(pipelineKey, &pipelineLayout);
+    scenePipeline = pipelineLibrary.getPipeline(scene.getPipelineKey(), &sceneLayout);
+    if (useVirtualTexture) {
+        virtualTexturePipeline = pipelineLibrary.getPipeline(virtualTexture.getPipelineKey(), &virtualTextureLayout);
+    }
+    if (useMeshlets) {
+        meshletPipeline = pipelineLibrary.getPipeline(meshletRenderer.getPipelineKey(), &meshletLayout);
+    }
+    hudPipeline = pipelineLibrary.getPipeline(hud.getPipelineKey(), &hudLayout);
+}
 
-    // Describes the kind of geometry and whether to use primitive restart
-    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
-    // ePointList draws points from vertices
-    // eLineList draws lines from every 2 vertices (without reusing them)
-    // eLineStrip draws linesbetween each pair of vertices (with reusing them)
-    // eTriangleList draws triangles without reuse
-    // eTriangleStrip draws triangles with 2nd, 3rd verts as 1st, 2nd of next
-    inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleList;
-    // Primitive restart is for strip modes, allows to restart the strip
-    inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+void VulkanApp::createVirtualTexture() {
+    if (!std::ifstream(VIRTUAL_TEXTURE_PATH).good()) {
+        return;
+    }
+    if (!features.fragmentStoresAndAtomics) {
+        std::cout << "Skipping the virtual texture, since fragment shaders can't write its feedback" << std::endl;
+        return;
+    }
 
-    // Set up Viewport and Scissor
+    uint32_t queueFamilyIndex = queueFamilyIndices[QUEUE_FAMILY_GRAPHICS].value();
+    virtualTexture.initialize(physicalDevice, device, graphicsQueue, queueFamilyIndex, features, &memoryAllocator,
+                              &layoutCache, VIRTUAL_TEXTURE_PATH, VirtualTexture::DEFAULT_BUDGET,
+                              MAX_CONCURRENT_FRAMES);
+    useVirtualTexture = true;
 
-    // Viewport defines the region that is drawn to
-    vk::Viewport viewport{};
-    viewport.x = 0.f;
-    viewport.y = 0.f;
-    viewport.width = (float)swapchainExtent.width;
-    viewport.height = (float)swapchainExtent.height;
-    // Always must be within [0, 1]. Usually stick to defaults
-    viewport.minDepth = 0.f;
-    viewport.maxDepth = 1.f;
+    std::cout << "Streaming the virtual texture " << VIRTUAL_TEXTURE_PATH
+              << (virtualTexture.isSparse() ? " into a sparse image" : " into a page cache") << std::endl;
+}
 
-    // Scissor defines the region of the image that is used
-    vk::Rect2D scissor{};
-    scissor.offset.setX(0);
-    scissor.offset.setY(0);
-    scissor.extent = swapchainExtent;
-
-    vk::PipelineViewportStateCreateInfo viewportStateInfo{};
-    viewportStateInfo.viewportCount = 1;
-    viewportStateInfo.pViewports = &viewport;
-    viewportStateInfo.scissorCount = 1;
-    viewportStateInfo.pScissors = &scissor;
-
-    // Set up Rasterizer 
-
-    // Rasterizer turns vertices into fragments
-    vk::PipelineRasterizationStateCreateInfo rasterizationStateInfo{};
-    // Whether to crop fragments that are beyond near/far frames or clamp to
-    // edges. Useful for shadowmapping, but requires enabling a GPU feature
-    rasterizationStateInfo.depthClampEnable = VK_FALSE;
-    // If true, rasterizer stage discards geometry that would go to framebuffer
-    rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
-    // How polygons are drawn, fill (eFill), lines (eLine), or points (ePoint)
-    // Modes other than fill require enabling a GPU feature
-    rasterizationStateInfo.polygonMode = vk::PolygonMode::eFill;
-    // How thick to draw lines. Wider than 1.f requires enabling GPU feature
-    // "wideLines", and the max width depends on hardware
-    rasterizationStateInfo.lineWidth = 1.f;
-    // Which faces to cull (eNone, eFront, eBack, eFrontAndBack)
-    rasterizationStateInfo.cullMode = vk::CullModeFlagBits::eBack;
-    // Specifies the order for front facing sides
-    rasterizationStateInfo.frontFace = vk::FrontFace::eClockwise;
-    // For altering the depth with constant or based on slope. Not wanted here
-    rasterizationStateInfo.depthBiasEnable = VK_FALSE;
-    rasterizationStateInfo.depthBiasConstantFactor = 0.f; // Optional
-    rasterizationStateInfo.depthBiasClamp = 0.f; // Optional
-    rasterizationStateInfo.depthBiasSlopeFactor = 0.f; // Optional
-
-    // Set up Multisampling
-
-    // Multisampling combines the results of multiple fragments that render to
-    // the same pixel, and allows for anti-aliasing. Requires enabling GPU a
-    // GPU feature
-    // For now, disabled
-    vk::PipelineMultisampleStateCreateInfo multisamplingInfo{};
-    multisamplingInfo.sampleShadingEnable = VK_FALSE;
-    multisamplingInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
-    multisamplingInfo.minSampleShading = 1.f; // Optional
-    multisamplingInfo.pSampleMask = nullptr; // Optional
-    multisamplingInfo.alphaToCoverageEnable = VK_FALSE; // Optional
-    multisamplingInfo.alphaToOneEnable = VK_FALSE; // Optional
-
-    // Depth and stencil testing set up would also be needed here, if used
-
-    // Set up Color Blending
-
-    // Defines color blending for this framebuffer specifically
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask =
-        vk::ColorComponentFlagBits::eR | 
-        vk::ColorComponentFlagBits::eG | 
-        vk::ColorComponentFlagBits::eB | 
-        vk::ColorComponentFlagBits::eA;
-    // No need for blending specific to this framebuffer, so pass in fragment
-    // unmodified
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eOne; // Optional
-    colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eZero; // Optional
-    colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd; // Optional
-    colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne; // Optional
-    colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero; // Optional
-    colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd; // Optional
-
-    // For alpha blending:
-    // colorBlendAttachment.blendEnable = VK_TRUE;
-    // colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha; // Optional
-    // colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha; // Optional
-    // colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd; // Optional
-    // colorBlendAttachment.stcAlphaBlendFactor = vk::BlendFactor::eOne; // Optional
-    // colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero; // Optional
-    // colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd; // Optional
-
-    // Sets up color blending for all framebuffers
-    vk::PipelineColorBlendStateCreateInfo colorBlendInfo{};
-    // Setting this to true disables attachment specific blending (as if each
-    // was VK_FALSE)
-    colorBlendInfo.logicOpEnable = VK_FALSE;
-    colorBlendInfo.logicOp = vk::LogicOp::eCopy; // Optional
-    colorBlendInfo.attachmentCount = 1;
-    colorBlendInfo.pAttachments = &colorBlendAttachment;
-    colorBlendInfo.blendConstants[0] = 0.f; // Optional
-    colorBlendInfo.blendConstants[1] = 0.f; // Optional
-    colorBlendInfo.blendConstants[2] = 0.f; // Optional
-    colorBlendInfo.blendConstants[3] = 0.f; // Optional
-
-    // Set up Dynamic State
-
-    // Dynamic state allows for changing a handful of aspects of the pipeline
-    // dynamically (ex: viewport size, line width, blend constants). This tells
-    // Vulkan to ignore the configured state, and it must be specified
-    // dynamically instead. Can be substituted with a nullptr to ignore
-    vk::DynamicState dynamicStates[] = {
-        vk::DynamicState::eViewport,
-        // vk::DynamicState::eLineWidth,
-    };
-    vk::PipelineDynamicStateCreateInfo dynamicStateInfo{};
-    dynamicStateInfo.dynamicStateCount = 1; // 2;
-    dynamicStateInfo.pDynamicStates = dynamicStates;
-
-    // ***** Set up Pipeline Layout ***
-
-    // Set up Uniform Layout
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.setLayoutCount = 0; // Optional
-    pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-    
-    pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
-
-    // ***** Initialize the pipeline *****
-
-    vk::GraphicsPipelineCreateInfo pipelineInfo{};
-    // Set the shader stage
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStageCreateInfos;
-    // Set the fixed function stages
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-    pipelineInfo.pViewportState = &viewportStateInfo;
-    pipelineInfo.pRasterizationState = &rasterizationStateInfo;
-    pipelineInfo.pMultisampleState = &multisamplingInfo;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
-    pipelineInfo.pColorBlendState = &colorBlendInfo;
-    pipelineInfo.pDynamicState = nullptr; // Optional
-    // Set the pipeline layout (Vulkan handle, not a pointer to a struct)
-    pipelineInfo.layout = pipelineLayout;
-    // Set the render pass
-    pipelineInfo.renderPass = renderPass;
-    // Set the index of the subpass where this graphics pipeline will be used
-    pipelineInfo.subpass = 0;
-    // When creating a pipeline, it can be derived from an existing one with
-    // which it may share features, and switching between them will be faster.
-    // This is only done if vk::PipelineCreateFlagBits::eDerivative is set in
-    // the flag bits of this create info is set. We only have one pipeline, so
-    // we do not need to do any pipeline deriving
-    pipelineInfo.basePipelineHandle = nullptr; // Optional
-    pipelineInfo.basePipelineIndex = -1; // Optional
-
-    // The pipeline cache allows for storing and reusing data about pipelines
-    // between separate calls for pipeline creation. But it can be set to
-    // VK_NULL_HANDLE (or nullptr in c++) if not desired. Additionally, often
-    // when creating pipelines, multiple pipelines can be made together. We 
-    // must extract the first pipeline from the vector, because although we
-    // only make one, it can be used to make multiple
-    auto vector = device.createGraphicsPipelines(nullptr, pipelineInfo);
-    if (vector.size() == 0) {
-        throw std::runtime_error("ERROR: VulkanApp::createGraphicsPipeline() created 0 pipelines");
-    }
-    graphicsPipeline = vector[0];
-
-    // Destroy the shaders that are no longer needed
-    device.destroyShaderModule(vertShader);
-    device.destroyShaderModule(fragShader);
+void VulkanApp::createMeshletRenderer() {
+    if (!std::ifstream(MESHLET_MESH_PATH).good()) {
+        return;
+    }
+
+    uint32_t queueFamilyIndex = queueFamilyIndices[QUEUE_FAMILY_GRAPHICS].value();
+    meshletRenderer.initialize(device, graphicsQueue, queueFamilyIndex, features, &memoryAllocator,
+                               &completionService, &pipelineLibrary, &layoutCache, MESHLET_MESH_PATH,
+                               scene.getSize());
+    useMeshlets = true;
+
+    std::cout << "Drawing the meshlets of " << MESHLET_MESH_PATH
+              << (meshletRenderer.usesMeshShader() ? " with mesh shaders" : " with compute culling") << std::endl;
 }
 
 void VulkanApp::createFramebuffers() {
@@ -635,8 +764,11 @@ void VulkanApp::createFramebuffers() {
     swapchainFramebuffers.resize(swapchainImageViews.size());
 
     for (int i = 0; i < swapchainFramebuffers.size(); i++) {
-        vk::ImageView attachments = {
-            swapchainImageViews[i]
+        // The depth buffer is shared, since only one frame draws at a time.
+        // So is the scene color, if the scene is scaled
+        std::array<vk::ImageView, 2> attachments = {
+            scaledRendering ? sceneColorImageView : swapchainImageViews[i],
+            depthImageView
         };
 
         vk::FramebufferCreateInfo framebufferInfo{};
@@ -645,11 +777,12 @@ void VulkanApp::createFramebuffers() {
         framebufferInfo.renderPass = renderPass;
         // Specify the image view object to be bound to the correct attachment
         // for the render pass
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = &attachments;
-        // Set the correct size for the framebuffer based on the swapchain
-        framebufferInfo.width = swapchainExtent.width;
-        framebufferInfo.height = swapchainExtent.height;
+        framebufferInfo.attachmentCount = (uint32_t)attachments.size();
+        framebufferInfo.pAttachments = attachments.data();
+        // Set the correct size for the framebuffer based on the size the
+        // scene is drawn at
+        framebufferInfo.width = renderExtent.width;
+        framebufferInfo.height = renderExtent.height;
         // 1 because the swapchain images are single images
         framebufferInfo.layers = 1;
 
@@ -658,21 +791,22 @@ void VulkanApp::createFramebuffers() {
 }
 
 void VulkanApp::createCommandPool() {
-    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
-
     vk::CommandPoolCreateInfo commandPoolInfo{};
     commandPoolInfo.queueFamilyIndex = queueFamilyIndices[QUEUE_FAMILY_GRAPHICS].value();
     // vk::CommandPoolCreateFlagBits::eTransient allows for optimizing if
     // command buffers are rerecorded very often, or with eResetCommandBuffer
-    // for buffers to be rerecorded without resetting them all. For now, the 
-    // command buffers are only going to be recorded once
-    commandPoolInfo.flags = {}; // Optional
+    // for buffers to be rerecorded without resetting them all. The command
+    // buffers are rerecorded every frame, so that the pipeline can be swapped
+    // out when the shaders are reloaded
+    commandPoolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
 
     commandPool = device.createCommandPool(commandPoolInfo);
 }
 
 void VulkanApp::createCommandBuffers() {
-    commandBuffers.resize(swapchainFramebuffers.size());
+    // One command buffer for each concurrent frame, rerecorded every time that
+    // frame is drawn
+    commandBuffers.resize(MAX_CONCURRENT_FRAMES);
     vk::CommandBufferAllocateInfo bufferAllocateInfo{};
     bufferAllocateInfo.commandPool = commandPool;
     // Primary level buffers can be submitted to a queue for execution, but
@@ -681,76 +815,11 @@ void VulkanApp::createCommandBuffers() {
     bufferAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
     bufferAllocateInfo.commandBufferCount = (uint32_t)commandBuffers.size();
 
-    commandBuffers = device.allocateCommandBuffers(bufferAllocateInfo);
-
-    // For each command buffer, set the correct commands to be run
-    for (int i = 0; i < commandBuffers.size(); i++) {
-        // Specify the usage of each command buffer
-        vk::CommandBufferBeginInfo bufferBeginInfo{};
-        // Flags indicate how the buffer wil be used. If it is rerecorded after
-        // being used once, then vk::CommandBufferUsage::eOneTimeSubmit. If it
-        // is a secondary command buffer to only be used within a single render
-        // pass, then eRenderPassContinue. If it can be rerecorded while
-        // waiting to be executed, then eSimultaneousUsage
-        bufferBeginInfo.flags = {}; // Optional
-        // For secondary buffers to specify which state to inherit from the
-        // calling primary buffer
-        bufferBeginInfo.pInheritanceInfo = nullptr; // Optional
-
-        // This also rerecords the command buffer if it's been recorded already
-        commandBuffers[i].begin(bufferBeginInfo);
-
-        // Begin the render pass, by configuring with render pass info
-
-        vk::RenderPassBeginInfo renderPassBeginInfo{};
-        // Set the render pass
-        renderPassBeginInfo.renderPass = renderPass;
-        // Set the framebuffer
-        renderPassBeginInfo.framebuffer = swapchainFramebuffers[i];
-        // Set the size of the render area. Outside the render area, values are
-        // undefined, so this should be the window size
-        renderPassBeginInfo.renderArea.offset.setX(0);
-        renderPassBeginInfo.renderArea.offset.setY(0);
-        renderPassBeginInfo.renderArea.extent = swapchainExtent;
-        // Set the clear parameters for vk::AttachmentLoadOp::eClear. Clear
-        // color is black
-        std::array<float, 4> color = { 0.f, 0.f, 0.f, 1.f };
-        vk::ClearValue clearColor = vk::ClearColorValue(color);
-        renderPassBeginInfo.clearValueCount = 1;
-        renderPassBeginInfo.pClearValues = &clearColor;
-
-        // Begin the render pass
-
-        // Specify how the commmand will be used. For just using a primary
-        // buffer, use vk::SubpassContents::eInline to say that the commands
-        // should be rolled in with the command buffer. This means no secondary
-        // ones will be run. eSecondaryCommandBuffers means the commands will
-        // be used with secondary command buffers
-        commandBuffers[i].beginRenderPass(&renderPassBeginInfo, vk::SubpassContents::eInline);
-
-        // Bind the graphics pipeline
-
-        // Specifythat this is a graphics pipeline, not a compute pipeline
-        commandBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
-
-        // Draw
-
-        /* draw(vertexCount, instanceCount, firstVertex, firstInstance)
-         *
-         * vertexCount: The number of vertices to draw
-         * instanceCount: The number of instances to use, or 1 if not using
-         * firstVertex: Offset for the vertex index (gl_VertexIndex starting
-         *              value)
-         * firstInstance: Offset for the instanced rendering (gl_InstanceIndex
-         *                starting value)
-         */
-        commandBuffers[i].draw(3, 1, 0, 0);
-
-        commandBuffers[i].endRenderPass();
-
-        // Once we finish recording the command buffer. Will throw an error if
-        // this fails to record
-        commandBuffers[i].end();
+    // Into the vector from before the swapchain was recreated, rather than
+    // a new one
+    vk::Result result = device.allocateCommandBuffers(&bufferAllocateInfo, commandBuffers.data());
+    if (result != vk::Result::eSuccess) {
+        vk::throwResultException(result, "vk::Device::allocateCommandBuffers");
     }
 }
 
@@ -758,7 +827,7 @@ void VulkanApp::createSyncObjects() {
     imageAvailableSemaphores.resize(MAX_CONCURRENT_FRAMES);
     renderFinishedSemaphores.resize(MAX_CONCURRENT_FRAMES);
     inFlightFences.resize(MAX_CONCURRENT_FRAMES);
-    imagesInFlight.resize(swapchainImages.size(), nullptr);
+    imagesInFlight.assign(swapchainImages.size(), nullptr);
 
     vk::SemaphoreCreateInfo semaphoreInfo{};
     // Currently, no need to set any values (like flags or pNext)
@@ -777,11 +846,257 @@ void VulkanApp::createSyncObjects() {
 
 // Helper methods for mainLoop()
 
+void VulkanApp::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex) {
+    // Specify the usage of each command buffer
+    vk::CommandBufferBeginInfo bufferBeginInfo{};
+    // Flags indicate how the buffer wil be used. If it is rerecorded after
+    // being used once, then vk::CommandBufferUsage::eOneTimeSubmit. If it
+    // is a secondary command buffer to only be used within a single render
+    // pass, then eRenderPassContinue. If it can be rerecorded while
+    // waiting to be executed, then eSimultaneousUsage
+    bufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    // For secondary buffers to specify which state to inherit from the
+    // calling primary buffer
+    bufferBeginInfo.pInheritanceInfo = nullptr; // Optional
+
+    // This also rerecords the command buffer if it's been recorded already,
+    // because the pool was created with eResetCommandBuffer
+    commandBuffer.begin(bufferBeginInfo);
+
+    // Before anything else, so the GPU stages are timed from the start
+    hud.beginFrame(commandBuffer, currentFrame);
+
+    // Moves are copies, which can't be in a render pass, and come before
+    // anything binds the resources moved
+    defragmenter.beginFrame(commandBuffer);
+
+    // The capture mirrors each command recorded, if capturing
+    frameCapture.beginFrame(renderExtent);
+
+    // Page uploads are transfers, which can't be in a render pass
+    if (useVirtualTexture) {
+        virtualTexture.beginFrame(commandBuffer, currentFrame);
+    }
+
+    // Viewport defines the region that is drawn to. Dynamic state lasts for
+    // the whole command buffer, so it is set once for both render passes
+    vk::Viewport viewport{};
+    viewport.x = 0.f;
+    viewport.y = 0.f;
+    viewport.width = (float)renderExtent.width;
+    viewport.height = (float)renderExtent.height;
+    // Always must be within [0, 1]. Usually stick to defaults
+    viewport.minDepth = 0.f;
+    viewport.maxDepth = 1.f;
+    commandBuffer.setViewport(0, viewport);
+
+    // Scissor defines the region of the image that is used
+    vk::Rect2D scissor{};
+    scissor.offset.setX(0);
+    scissor.offset.setY(0);
+    scissor.extent = renderExtent;
+    commandBuffer.setScissor(0, scissor);
+
+    // Choose what was visible last frame, which is drawn first as occluders
+    const float* viewProjection = camera.getViewProjection();
+    culler.cull(commandBuffer, OcclusionCuller::PHASE_EARLY, viewProjection);
+
+    // Begin the render pass, by configuring with render pass info
+
+    vk::RenderPassBeginInfo renderPassBeginInfo{};
+    // Set the render pass
+    renderPassBeginInfo.renderPass = renderPass;
+    // Set the framebuffer
+    renderPassBeginInfo.framebuffer = swapchainFramebuffers[imageIndex];
+    // Set the size of the render area. Outside the render area, values are
+    // undefined, so this should be the size the scene is drawn at
+    renderPassBeginInfo.renderArea.offset.setX(0);
+    renderPassBeginInfo.renderArea.offset.setY(0);
+    renderPassBeginInfo.renderArea.extent = renderExtent;
+    // Set the clear parameters for vk::AttachmentLoadOp::eClear. Clear
+    // color is black, and depth is cleared to the far plane
+    std::array<float, 4> color = { 0.f, 0.f, 0.f, 1.f };
+    std::array<vk::ClearValue, 2> clearValues = {
+        vk::ClearColorValue(color),
+        vk::ClearDepthStencilValue(1.f, 0)
+    };
+    renderPassBeginInfo.clearValueCount = (uint32_t)clearValues.size();
+    renderPassBeginInfo.pClearValues = clearValues.data();
+
+    // Begin the render pass
+
+    // Specify how the commmand will be used. For just using a primary
+    // buffer, use vk::SubpassContents::eInline to say that the commands
+    // should be rolled in with the command buffer. This means no secondary
+    // ones will be run. eSecondaryCommandBuffers means the commands will
+    // be used with secondary command buffers
+    commandBuffer.beginRenderPass(&renderPassBeginInfo, vk::SubpassContents::eInline);
+
+    // The virtual texture fills the background. It isn't captured, since the
+    // replay tool has no page file
+    if (useVirtualTexture) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, virtualTexturePipeline);
+        pipelineLibrary.setDynamicState(commandBuffer, virtualTexture.getPipelineKey());
+        virtualTexture.draw(commandBuffer, virtualTextureLayout, currentFrame);
+        hud.count(1, 1);
+    }
+
+    // Every mesh's geometry is in the arena, so it is bound once for the
+    // frame. Binds outlast pipeline changes and render passes
+    geometryArena.bind(commandBuffer);
+
+    // The scene's draws come from culling on the GPU, so the capture reads
+    // back what they drew
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, scenePipeline);
+    pipelineLibrary.setDynamicState(commandBuffer, scene.getPipelineKey());
+    scene.draw(commandBuffer, sceneLayout, culler.getInstanceSet(OcclusionCuller::PHASE_EARLY),
+               culler.getDrawBuffer(OcclusionCuller::PHASE_EARLY), viewProjection);
+    captureSceneDraw(OcclusionCuller::PHASE_EARLY, viewProjection);
+    hud.count(1, 1);
+
+    commandBuffer.endRenderPass();
+    hud.markGpuStage(commandBuffer, currentFrame, PerformanceHud::GPU_EARLY);
+
+    // Test everything against the depth the early phase drew, and draw what
+    // was hidden last frame but is visible now
+    culler.buildPyramid(commandBuffer);
+    culler.cull(commandBuffer, OcclusionCuller::PHASE_LATE, viewProjection);
+    if (useMeshlets) {
+        meshletRenderer.cull(commandBuffer, viewProjection, camera.getPosition(), renderExtent.height);
+    }
+    hud.markGpuStage(commandBuffer, currentFrame, PerformanceHud::GPU_CULL);
+
+    // The late render pass keeps what the early one drew
+    renderPassBeginInfo.renderPass = lateRenderPass;
+    renderPassBeginInfo.clearValueCount = 0;
+    renderPassBeginInfo.pClearValues = nullptr;
+    commandBuffer.beginRenderPass(&renderPassBeginInfo, vk::SubpassContents::eInline);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, scenePipeline);
+    pipelineLibrary.setDynamicState(commandBuffer, scene.getPipelineKey());
+    scene.draw(commandBuffer, sceneLayout, culler.getInstanceSet(OcclusionCuller::PHASE_LATE),
+               culler.getDrawBuffer(OcclusionCuller::PHASE_LATE), viewProjection);
+    captureSceneDraw(OcclusionCuller::PHASE_LATE, viewProjection);
+    hud.count(1, 1);
+
+    // The meshlets aren't captured, since the replay tool only builds vertex
+    // and fragment shader pipelines
+    if (useMeshlets) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, meshletPipeline);
+        pipelineLibrary.setDynamicState(commandBuffer, meshletRenderer.getPipelineKey());
+        meshletRenderer.draw(commandBuffer, meshletLayout);
+        hud.count(1, 1);
+    }
+
+    // Bind the graphics pipeline
+
+    // Specifythat this is a graphics pipeline, not a compute pipeline
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
+    frameCapture.bindPipeline(pipelineKey);
+
+    // Set the dynamic state
+
+    // The parts of the pipeline key that the device lets be dynamic
+    pipelineLibrary.setDynamicState(commandBuffer, pipelineKey);
+
+    // Draw
+
+    /* draw(vertexCount, instanceCount, firstVertex, firstInstance)
+     *
+     * vertexCount: The number of vertices to draw
+     * instanceCount: The number of instances to use, or 1 if not using
+     * firstVertex: Offset for the vertex index (gl_VertexIndex starting
+     *              value)
+     * firstInstance: Offset for the instanced rendering (gl_InstanceIndex
+     *                starting value)
+     */
+    commandBuffer.draw(3, 1, 0, 0);
+    frameCapture.draw(3, 1, 0, 0);
+    hud.count(1, 1);
+    hud.markGpuStage(commandBuffer, currentFrame, PerformanceHud::GPU_LATE);
+
+    // The overlay goes over everything, and isn't captured
+    if (hud.isVisible()) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, hudPipeline);
+        pipelineLibrary.setDynamicState(commandBuffer, hud.getPipelineKey());
+    }
+    hud.draw(commandBuffer, hudLayout, currentFrame, renderExtent);
+
+    commandBuffer.endRenderPass();
+
+    if (scaledRendering) {
+        blitToSwapchain(commandBuffer, imageIndex);
+    }
+
+    if (useVirtualTexture) {
+        virtualTexture.endFrame(commandBuffer, currentFrame);
+    }
+
+    recordCaptureReadback(commandBuffer);
+    frameCapture.endFrame(currentFrame);
+
+    // Once we finish recording the command buffer. Will throw an error if
+    // this fails to record
+    commandBuffer.end();
+}
+
+void VulkanApp::blitToSwapchain(vk::CommandBuffer commandBuffer, uint32_t imageIndex) {
+    // The image's old contents aren't needed. Waiting on the color attachment
+    // output stage chains onto the semaphore the image was acquired with
+    vk::ImageMemoryBarrier acquireBarrier{};
+    acquireBarrier.srcAccessMask = {};
+    acquireBarrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    acquireBarrier.oldLayout = vk::ImageLayout::eUndefined;
+    acquireBarrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    acquireBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    acquireBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    acquireBarrier.image = swapchainImages[imageIndex];
+    acquireBarrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                                  vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, acquireBarrier);
+
+    // Filtered, so scaling up is smooth and scaling down averages
+    vk::ImageBlit region{};
+    region.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    region.srcOffsets[1] = vk::Offset3D((int32_t)renderExtent.width, (int32_t)renderExtent.height, 1);
+    region.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    region.dstOffsets[1] = vk::Offset3D((int32_t)swapchainExtent.width, (int32_t)swapchainExtent.height, 1);
+    commandBuffer.blitImage(sceneColorImage, vk::ImageLayout::eTransferSrcOptimal, swapchainImages[imageIndex],
+                            vk::ImageLayout::eTransferDstOptimal, region, vk::Filter::eLinear);
+
+    // Presenting waits on the semaphore, so it needs no access mask
+    vk::ImageMemoryBarrier presentBarrier = acquireBarrier;
+    presentBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    presentBarrier.dstAccessMask = {};
+    presentBarrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    presentBarrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+                                  {}, nullptr, nullptr, presentBarrier);
+}
+
 void VulkanApp::drawFrame() {
+    // Run the callbacks of any GPU work that has finished. This never waits
+    completionService.dispatchCompleted();
+
+    // Between frames, so the commands can change what the frames use
+    applyControlCommands();
+
+    // The old swapchain is presented until the size settles
+    if (framebufferResized && !isResizing()) {
+        framebufferResized = false;
+        recreateSwapchain();
+    }
+
+    std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+
     // Wait for the previous frame to have been completed before starting the
     // next with the same index
     device.waitForFences(inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
+    // Including the frame that last used this frame's capture read back
+    // buffer, before it is recorded again
+    finishCapturedFrames();
+
     // We need to:
     // Get an image from the swapchain
     // Run the command buffer with that image as attachment in framebuffer
@@ -810,6 +1125,14 @@ void VulkanApp::drawFrame() {
     vk::Result result = device.acquireNextImageKHR(swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], nullptr, &imageIndex);
 
     if (result == vk::Result::eErrorOutOfDateKHR) {
+        // The old swapchain can't be drawn to, but the compositor still shows
+        // its last image. Rather than recreating for every step of a drag,
+        // skip frames until the size settles
+        if (framebufferResized && isResizing()) {
+            glfwWaitEventsTimeout(RESIZE_SETTLE_SECONDS - (glfwGetTime() - lastResizeTime));
+            return;
+        }
+        framebufferResized = false;
         recreateSwapchain();
         return;
     } else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
@@ -824,22 +1147,51 @@ void VulkanApp::drawFrame() {
         device.waitForFences(imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
     }
     imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+    hud.addCpuTime(PerformanceHud::CPU_WAIT, waitStart);
+
+    // This is the frame boundary, so any reloaded pipeline can be swapped in
+    // before recording
+    swapReloadedPipeline();
+
+    // The camera follows the same path every run
+    camera.update((float)glfwGetTime(), (float)swapchainExtent.width / (float)swapchainExtent.height,
+                  scene.getSize());
+
+    // The fence wait above means this frame's command buffer is done being
+    // used, so it can be rerecorded
+    std::chrono::steady_clock::time_point recordStart = std::chrono::steady_clock::now();
+    recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+    hud.addCpuTime(PerformanceHud::CPU_RECORD, recordStart);
+    std::chrono::steady_clock::time_point submitStart = std::chrono::steady_clock::now();
+
+    // Everything written to non-coherent memory for the frame is made
+    // visible to the device in one flush
+    virtualTexture.collectFlushRanges(&flushRanges);
+    hud.collectFlushRanges(&flushRanges);
+    memoryAllocator.flush(&flushRanges);
 
     // Submit the command buffer to the queue to be executed, with the provided
     // semaphores
 
     vk::SubmitInfo submitInfo{};
-    vk::Semaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
+    std::vector<vk::Semaphore> waitSemaphores = { imageAvailableSemaphores[currentFrame] };
     // This could also be eTopOfPipe
-    vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+    std::vector<vk::PipelineStageFlags> waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+    // The virtual texture's page binds must be done before its pages are
+    // copied to or sampled
+    vk::Semaphore bindSemaphore = useVirtualTexture ? virtualTexture.getBindSemaphore(currentFrame) : vk::Semaphore();
+    if (bindSemaphore) {
+        waitSemaphores.push_back(bindSemaphore);
+        waitStages.push_back(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader);
+    }
     // Which semaphore(s) to wait on, and where in the pipeline to wait
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    // Which command buffers to be executed. Use the one with the corresponding
-    // ready image
+    submitInfo.waitSemaphoreCount = (uint32_t)waitSemaphores.size();
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    // Which command buffers to be executed. Use the one recorded for this
+    // frame
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
     // Which semaphore to signal on completion
     vk::Semaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
     submitInfo.signalSemaphoreCount = 1;
@@ -850,6 +1202,7 @@ void VulkanApp::drawFrame() {
 
     // Takes (an array of) submit info(s), and a fence for synchronizing
     graphicsQueue.submit(submitInfo, inFlightFences[currentFrame]);
+    defragmenter.endFrame();
 
     // Resubmit the result back to the swapchain so it can be rendered
 
@@ -865,47 +1218,327 @@ void VulkanApp::drawFrame() {
     presentInfo.pImageIndices = &imageIndex;
 
     result = presentQueue.presentKHR(presentInfo);
+    hud.addCpuTime(PerformanceHud::CPU_SUBMIT, submitStart);
+    metricsExport.endFrame(hud.getGpuFrameTime());
     
-    // Doing this here so we don't miss out on waiting on a signaled semaphore
-    if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || framebufferResized) {
-        framebufferResized = false;
-        // Can recreate with eSuboptimalKHR here for best results
-        recreateSwapchain();
-        return;
+    // Doing this here so we don't miss out on waiting on a signaled semaphore.
+    // While the window is being resized, the swapchain is only recreated once
+    // the size settles, at the start of a frame
+    if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
+        if (!framebufferResized) {
+            recreateSwapchain();
+            return;
+        }
     } else if (result != vk::Result::eSuccess) {
         vk::throwResultException(result, "vk::Queue::presentKHR");
     }
 
     // Move to the next frame, so multiple frames can be worked on at once
-    currentFrame = (currentFrame + 1) % MAX_CONCURRENT_FRAMES;
+    currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+void VulkanApp::swapReloadedPipeline() {
+    // The library rebuilds its pipelines on its worker thread, recompiling
+    // the changed sources there
+    if (enableShaderHotReload && shaderWatcher.takeChanges()) {
+        pipelineLibrary.reloadShaders();
+    }
+
+    // Frames still in flight may use the old pipeline, so the library only
+    // retires it. The layout is owned by the layout cache, and the shaders
+    // may have changed it
+    if (pipelineLibrary.update()) {
+        createGraphicsPipeline();
+        culler.updatePipelines(&pipelineLibrary);
+        if (useMeshlets) {
+            meshletRenderer.updatePipelines(&pipelineLibrary);
+        }
+    }
+}
+
+void VulkanApp::applyControlCommands() {
+    bool recreate = false;
+
+    uint32_t value;
+    if (controlServer.presentMode.take(&value)) {
+        vk::PresentModeKHR presentMode = static_cast<vk::PresentModeKHR>(value);
+        const vk::PresentModeKHR* presentModes = surfaceProperties.presentModes.data();
+        const vk::PresentModeKHR* presentModesEnd = presentModes + surfaceProperties.presentModeCount;
+        if (std::find(presentModes, presentModesEnd, presentMode) != presentModesEnd) {
+            requestedPresentMode = presentMode;
+            recreate = true;
+        } else {
+            std::cerr << "ERROR: The surface doesn't support the present mode " << vk::to_string(presentMode)
+                      << std::endl;
+        }
+    }
+
+    float scale;
+    if (controlServer.resolutionScale.take(&scale) && scale != resolutionScale) {
+        resolutionScale = scale;
+        recreate = true;
+    }
+
+    // Frames are only added and dropped at the end of the ring. The next
+    // frame waits on the fence of the one it reuses, like any other
+    if (controlServer.framesInFlight.take(&value)) {
+        framesInFlight = (int)value;
+        currentFrame %= framesInFlight;
+    }
+
+    // Saved on the pipeline library's worker thread
+    bool dump;
+    if (controlServer.dumpPipelineCache.take(&dump)) {
+        pipelineLibrary.saveCache();
+    }
+
+    // The buffers are written as they are when the capture starts, and the
+    // pipelines when first bound, so a capture can start partway through a
+    // run
+    ControlServer::CaptureRequest capture;
+    if (controlServer.capture.take(&capture)) {
+        if (frameCapture.isCapturing()) {
+            std::cerr << "ERROR: Already capturing" << std::endl;
+        } else {
+            try {
+                startCapture(capture.path, capture.frameCount);
+                std::cout << "Capturing " << capture.frameCount << " frames to " << capture.path << std::endl;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+
+    // The pipelines of both paths stay in the library, so switching back and
+    // forth to compare them only builds each once
+    bool pulling;
+    if (controlServer.vertexPulling.take(&pulling)) {
+        if (!pulling || scene.supportsVertexPulling()) {
+            bool wasPulling = scene.isVertexPulling();
+            scene.setVertexPulling(pulling);
+            try {
+                scenePipeline = pipelineLibrary.getPipeline(scene.getPipelineKey(), &sceneLayout);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                scene.setVertexPulling(wasPulling);
+            }
+        } else {
+            std::cerr << "ERROR: Vertex pulling needs buffer device addresses, which the device doesn't support"
+                      << std::endl;
+        }
+    }
+
+    if (recreate) {
+        recreateSwapchain();
+        if (resolutionScale != 1.f && !scaledRendering) {
+            std::cerr << "ERROR: The swapchain can't be blitted to, so the scene is drawn at the window's resolution"
+                      << std::endl;
+        }
+    }
+}
+
+void VulkanApp::startCapture(const std::string& path, uint32_t frameCount) {
+    frameCapture.start(path, frameCount, swapchainImageFormat, depthFormat, shaderLoader);
+
+    // Later changes are written as they are made: meshes added by the arena,
+    // and what culling writes by each frame's read back
+    try {
+        graphicsQueue.waitIdle();
+        captureBuffer(geometryArena.getVertexBuffer(), geometryArena.getVertexCapacity(),
+                      geometryArena.getVertexUsage());
+        captureBuffer(geometryArena.getIndexBuffer(), geometryArena.getIndexCapacity(),
+                      geometryArena.getIndexUsage());
+        captureBuffer(scene.getInstanceBuffer(), scene.getInstanceCount() * sizeof(Scene::Instance),
+                      vk::BufferUsageFlagBits::eStorageBuffer);
+    } catch (...) {
+        frameCapture.stop();
+        throw;
+    }
+    for (uint32_t phase = 0; phase < 2; phase++) {
+        frameCapture.createBuffer(FrameCapture::getBufferId(culler.getDrawBuffer(phase)),
+                                  sizeof(vk::DrawIndexedIndirectCommand),
+                                  vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer);
+        frameCapture.createBuffer(FrameCapture::getBufferId(culler.getVisibleBuffer(phase)),
+                                  culler.getVisibleBufferSize(), vk::BufferUsageFlagBits::eStorageBuffer);
+    }
+
+    // Kept until the device is destroyed, for the next capture
+    if (captureReadbackBuffers.empty()) {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.size = 2 * sizeof(vk::DrawIndexedIndirectCommand) + 2 * culler.getVisibleBufferSize();
+        bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        captureReadbackAllocations.resize(MAX_CONCURRENT_FRAMES);
+        for (int i = 0; i < MAX_CONCURRENT_FRAMES; i++) {
+            captureReadbackBuffers.push_back(memoryAllocator.createBuffer(
+                bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible, {}, &captureReadbackAllocations[i]));
+        }
+    }
+}
+
+void VulkanApp::captureBuffer(vk::Buffer buffer, vk::DeviceSize size, vk::BufferUsageFlags usage) {
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.size = size;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    Allocation stagingAllocation;
+    vk::Buffer stagingBuffer = memoryAllocator.createBuffer(bufferInfo, vk::MemoryPropertyFlagBits::eHostVisible, {},
+                                                            &stagingAllocation);
+
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocateInfo.commandBufferCount = 1;
+    vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(allocateInfo)[0];
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+    commandBuffer.copyBuffer(buffer, stagingBuffer, vk::BufferCopy(0, 0, size));
+    vk::MemoryBarrier readbackBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                                  readbackBarrier, nullptr, nullptr);
+    commandBuffer.end();
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    graphicsQueue.submit(submitInfo, nullptr);
+    graphicsQueue.waitIdle();
+
+    memoryAllocator.invalidate(stagingAllocation, 0, size);
+    uint64_t id = FrameCapture::getBufferId(buffer);
+    frameCapture.createBuffer(id, size, usage);
+    frameCapture.uploadBuffer(id, 0, stagingAllocation.mapped, size);
+
+    device.freeCommandBuffers(commandPool, commandBuffer);
+    memoryAllocator.destroyBuffer(stagingBuffer, stagingAllocation);
+}
+
+void VulkanApp::captureSceneDraw(uint32_t phase, const float* viewProjection) {
+    if (!frameCapture.isRecordingFrame()) {
+        return;
+    }
+
+    uint64_t vertexId = FrameCapture::getBufferId(geometryArena.getVertexBuffer());
+    uint64_t drawId = FrameCapture::getBufferId(culler.getDrawBuffer(phase));
+    uint64_t visibleId = FrameCapture::getBufferId(culler.getVisibleBuffer(phase));
+    frameCapture.bindPipeline(scene.getPipelineKey());
+    frameCapture.bindVertexBuffer(0, vertexId, 0);
+    frameCapture.bindIndexBuffer(FrameCapture::getBufferId(geometryArena.getIndexBuffer()), 0,
+                                 GeometryArena::INDEX_TYPE);
+    frameCapture.bindStorageBuffers(0, { { 0, FrameCapture::getBufferId(scene.getInstanceBuffer()) },
+                                         { 1, visibleId } });
+    frameCapture.pushConstants(vk::ShaderStageFlagBits::eVertex, 0, viewProjection, 16 * sizeof(float));
+    if (scene.isVertexPulling()) {
+        frameCapture.pushBufferAddress(vk::ShaderStageFlagBits::eVertex, 16 * sizeof(float), vertexId);
+    }
+    frameCapture.drawIndexedIndirect(drawId, 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+
+    // Where recordCaptureReadback() copies them
+    vk::DeviceSize drawSize = sizeof(vk::DrawIndexedIndirectCommand);
+    vk::DeviceSize visibleSize = culler.getVisibleBufferSize();
+    frameCapture.uploadReadback(drawId, phase * drawSize, drawSize);
+    frameCapture.uploadReadback(visibleId, 2 * drawSize + phase * visibleSize, visibleSize);
+}
+
+void VulkanApp::recordCaptureReadback(vk::CommandBuffer commandBuffer) {
+    if (!frameCapture.isRecordingFrame()) {
+        return;
+    }
+
+    // Culling writes the buffers in compute, and the first frame resets the
+    // draws with transfers
+    vk::MemoryBarrier copyBarrier(vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+                                  vk::AccessFlagBits::eTransferRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eTransfer, {}, copyBarrier, nullptr, nullptr);
+
+    vk::Buffer readbackBuffer = captureReadbackBuffers[currentFrame];
+    vk::DeviceSize drawSize = sizeof(vk::DrawIndexedIndirectCommand);
+    vk::DeviceSize visibleSize = culler.getVisibleBufferSize();
+    for (uint32_t phase = 0; phase < 2; phase++) {
+        commandBuffer.copyBuffer(culler.getDrawBuffer(phase), readbackBuffer,
+                                 vk::BufferCopy(0, phase * drawSize, drawSize));
+        commandBuffer.copyBuffer(culler.getVisibleBuffer(phase), readbackBuffer,
+                                 vk::BufferCopy(0, 2 * drawSize + phase * visibleSize, visibleSize));
+    }
+
+    // The host reads the copies once the frame is done, and the next frame's
+    // culling must not write the buffers before they are copied
+    vk::MemoryBarrier hostBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eTransfer |
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, hostBarrier, nullptr, nullptr);
+}
+
+void VulkanApp::finishCapturedFrames() {
+    uint32_t slot;
+    while (frameCapture.getNextFinish(&slot) && device.getFenceStatus(inFlightFences[slot]) == vk::Result::eSuccess) {
+        const Allocation& readback = captureReadbackAllocations[slot];
+        memoryAllocator.invalidate(readback, 0, readback.size);
+        try {
+            frameCapture.finishFrame(readback.mapped);
+            if (!frameCapture.isCapturing()) {
+                std::cout << "Finished the capture" << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
 }
 
 
 // Swapchain helper methods
 
 void VulkanApp::recreateSwapchain() {
-    // Handle minimization by pausing until the window has a non-zero size
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(window, &width, &height);
-    while (width == 0 || height == 0) {
-        glfwGetFramebufferSize(window, &width, &height);
-        glfwWaitEvents();
+    // A hidden window can't have a swapchain. The main loop suspends drawing
+    // until it is shown again, which recreates everything anyway
+    if (isWindowHidden()) {
+        return;
     }
 
+    std::chrono::steady_clock::time_point recreateStart = std::chrono::steady_clock::now();
+
     // So we don't touch resources as they are being used
     device.waitIdle();
 
-    // Destroy the old swapchain
-    cleanupSwapchain();
+    // Pipelines are built against the render pass being destroyed, so the
+    // library waits for its worker and drops them. Their libraries are
+    // rebuilt from the pipeline cache
+    pipelineLibrary.clear();
+
+    // The swapchain itself is kept, so createSwapchain() can pass it on as
+    // the old one
+    cleanupSwapchain(true);
+    createSwapchainObjects();
+
+    metricsExport.recordSwapchainRecreate(std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - recreateStart).count());
+}
+
+void VulkanApp::createSwapchainObjects() {
+    // Set first, so whatever is created before a failure is still cleaned up
+    swapchainObjectsCreated = true;
 
     // Needs to be recreated... of course
     createSwapchain();
     // Recreated because directly based on swapchain images
     createImageViews();
+    // The image count may have changed, and no image is in use now
+    imagesInFlight.assign(swapchainImages.size(), nullptr);
+    // Recreated because it is the size of the swapchain, and the pyramid
+    // with it
+    createDepthResources();
+    culler.createPyramid(depthImageView, renderExtent);
+    // Recreated because it is the size the scene is drawn at
+    createSceneColorResources();
     // Recreated because depends on swapchain image format (even though that
     // usually won't change in these scenarios)
     createRenderPass();
-    // Recreated because viewport and scissor rectangle are defined
+    // Recreated because it is built against the render pass
+    pipelineLibrary.setRenderPass(renderPass);
     createGraphicsPipeline();
     // Recreated because also depends on swapchain image
     createFramebuffers();
@@ -913,33 +1546,110 @@ void VulkanApp::recreateSwapchain() {
     createCommandBuffers();
 }
 
-void VulkanApp::cleanupSwapchain() {
+void VulkanApp::suspend() {
+    if (suspended) {
+        return;
+    }
+    suspended = true;
+
+    device.waitIdle();
+    pipelineLibrary.clear();
+    cleanupSwapchain(false);
+
+    // Refilled from the page file when drawing continues
+    if (useVirtualTexture) {
+        virtualTexture.suspend();
+    }
+    // The pool keeps the memory of the command buffers it freed for reuse
+    if (canTrimCommandPools) {
+        device.trimCommandPool(commandPool, vk::CommandPoolTrimFlags());
+    }
+    // Last, so it gets the blocks everything above emptied
+    memoryAllocator.releaseEmptyBlocks();
+}
+
+void VulkanApp::resume() {
+    suspended = false;
+
+    if (useVirtualTexture) {
+        virtualTexture.resume();
+    }
+    createSwapchainObjects();
+
+    // The swapchain was just created at the current size
+    framebufferResized = false;
+    metricsExport.restartFrameTimer();
+}
+
+void VulkanApp::cleanupSwapchain(bool keepSwapchain) {
+    // Destroying a null handle does nothing, so what was never created is
+    // skipped
     for (auto framebuffer : swapchainFramebuffers) {
         device.destroyFramebuffer(framebuffer);
     }
+    swapchainFramebuffers.clear();
 
     // Remove all of the command buffers from the command pool, because the 
     // command pool doesn't need to be recreated then
-    device.freeCommandBuffers(commandPool, (uint32_t)commandBuffers.size(), commandBuffers.data());
+    if (!commandBuffers.empty()) {
+        device.freeCommandBuffers(commandPool, (uint32_t)commandBuffers.size(), commandBuffers.data());
+        commandBuffers.clear();
+    }
 
-    device.destroyPipeline(graphicsPipeline);
-    device.destroyPipelineLayout(pipelineLayout);
+    // The pipeline is owned by the pipeline library, and its layout by the
+    // layout cache
     device.destroyRenderPass(renderPass);
+    renderPass = nullptr;
+    device.destroyRenderPass(lateRenderPass);
+    lateRenderPass = nullptr;
+
+    culler.destroyPyramid();
+    device.destroyImageView(depthImageView);
+    depthImageView = nullptr;
+    memoryAllocator.destroyImage(depthImage, depthAllocation);
+    depthImage = nullptr;
+    depthAllocation = Allocation();
+    // Only created for scaled rendering, and null otherwise
+    device.destroyImageView(sceneColorImageView);
+    sceneColorImageView = nullptr;
+    memoryAllocator.destroyImage(sceneColorImage, sceneColorAllocation);
+    sceneColorImage = nullptr;
+    sceneColorAllocation = Allocation();
 
     for (auto imageView : swapchainImageViews) {
         device.destroyImageView(imageView);
     }
+    swapchainImageViews.clear();
+
+    if (!keepSwapchain) {
+        device.destroySwapchainKHR(swapchain);
+        swapchain = nullptr;
+    }
+    // Cleared rather than shrunk, so the next swapchain reads into the same
+    // storage
+    swapchainImages.clear();
 
-    device.destroySwapchainKHR(swapchain);
+    swapchainObjectsCreated = false;
 }
 
-SwapchainProperties VulkanApp::getSwapchainProperties(vk::PhysicalDevice physicalDevice) {
-    SwapchainProperties properties;
-    properties.surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
-    properties.surfaceFormats = physicalDevice.getSurfaceFormatsKHR(surface);
-    properties.presentModes = physicalDevice.getSurfacePresentModesKHR(surface);
+void VulkanApp::getSwapchainProperties(vk::PhysicalDevice physicalDevice, SwapchainProperties* properties) {
+    properties->surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
+
+    // Straight into the fixed storage. If there are ever more than fit, the
+    // rest are left out (eIncomplete), and the first are plenty to choose from
+    properties->surfaceFormatCount = SwapchainProperties::MAX_SURFACE_FORMATS;
+    vk::Result result = physicalDevice.getSurfaceFormatsKHR(surface, &properties->surfaceFormatCount,
+                                                            properties->surfaceFormats.data());
+    if (result != vk::Result::eSuccess && result != vk::Result::eIncomplete) {
+        vk::throwResultException(result, "vk::PhysicalDevice::getSurfaceFormatsKHR");
+    }
 
-    return properties;
+    properties->presentModeCount = SwapchainProperties::MAX_PRESENT_MODES;
+    result = physicalDevice.getSurfacePresentModesKHR(surface, &properties->presentModeCount,
+                                                      properties->presentModes.data());
+    if (result != vk::Result::eSuccess && result != vk::Result::eIncomplete) {
+        vk::throwResultException(result, "vk::PhysicalDevice::getSurfacePresentModesKHR");
+    }
 }
 
 vk::SurfaceFormatKHR VulkanApp::chooseSwapchainSurfaceFormat(const SwapchainProperties& properties) {
@@ -947,7 +1657,8 @@ vk::SurfaceFormatKHR VulkanApp::chooseSwapchainSurfaceFormat(const SwapchainProp
     // stored
 
     // Look for sRGB format
-    for (const auto& surfaceFormat : properties.surfaceFormats) {
+    for (uint32_t i = 0; i < properties.surfaceFormatCount; i++) {
+        const vk::SurfaceFormatKHR& surfaceFormat = properties.surfaceFormats[i];
         if (surfaceFormat.format == vk::Format::eB8G8R8A8Srgb &&
             surfaceFormat.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
 
@@ -965,11 +1676,15 @@ vk::PresentModeKHR VulkanApp::chooseSwapchainPresentMode(const SwapchainProperti
 
     // Four options, but VK_PRESENT_MODE_FIFO_KHR is guaranteed to be available.
     // We want VK_PRESENT_MODE_MAILBOX_KHR ideally, which is similar but doesn't
-    // block if the render queue is full
-    for (const auto& presentMode : properties.presentModes) {
-        if (presentMode == vk::PresentModeKHR::eMailbox) {
-            return presentMode;
-        }
+    // block if the render queue is full. A mode asked for over the control
+    // socket comes first
+    const vk::PresentModeKHR* presentModesEnd = properties.presentModes.data() + properties.presentModeCount;
+    if (requestedPresentMode && std::find(properties.presentModes.data(), presentModesEnd,
+                                          *requestedPresentMode) != presentModesEnd) {
+        return *requestedPresentMode;
+    }
+    if (std::find(properties.presentModes.data(), presentModesEnd, vk::PresentModeKHR::eMailbox) != presentModesEnd) {
+        return vk::PresentModeKHR::eMailbox;
     }
 
     // If VK_PRESENT_MODE_MAILBOX_KHR can't be found, simply use
@@ -1008,6 +1723,19 @@ vk::Extent2D VulkanApp::chooseSwapchainExtent(const SwapchainProperties& propert
     }
 }
 
+bool VulkanApp::isResizing() const {
+    return glfwGetTime() - lastResizeTime < RESIZE_SETTLE_SECONDS;
+}
+
+bool VulkanApp::isWindowHidden() const {
+    // GLFW can't tell whether other windows cover this one, so only a window
+    // that is minimized, invisible or empty counts as hidden
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    return width == 0 || height == 0 || glfwGetWindowAttrib(window, GLFW_ICONIFIED) ||
+        !glfwGetWindowAttrib(window, GLFW_VISIBLE);
+}
+
 
 // Graphics and Shaders helper methods
 
@@ -1021,6 +1749,49 @@ vk::ShaderModule VulkanApp::createShaderModule(const std::vector<char>& bytes) {
     return device.createShaderModule(createInfo);
 }
 
+std::vector<uint32_t> VulkanApp::loadShaderCode(const std::string& sourcePath, const std::string& spirvPath,
+                                                const ShaderArchive::Defines& defines) {
+    std::ifstream sourceFile(sourcePath);
+    std::stringstream source;
+    if (sourceFile.is_open()) {
+        source << sourceFile.rdbuf();
+    }
+
+    // The archive is built from the sources ahead of time, so it would be out
+    // of date while the sources are being edited
+    if (!enableShaderHotReload && shaderArchive.isOpen()) {
+        std::string shaderName = sourcePath.substr(sourcePath.find_last_of('/') + 1);
+
+        std::vector<uint32_t> code;
+        if (!sourceFile.is_open()) {
+            // With nothing to check the archive against, it is trusted
+            if (shaderArchive.lookup(shaderName, defines, 0, &code)) {
+                return code;
+            }
+        } else {
+            // Keyed with the source's own permutations, and checked against
+            // its hash, so an archive older than the source is passed over
+            std::vector<ShaderArchive::Permutation> declared = ShaderArchive::parsePermutations(source.str());
+            uint64_t sourceHash = ShaderCompiler::hashShader(source.str(), ShaderCompiler::kindFromPath(sourcePath),
+                                                             ShaderArchive::completeDefines(declared, defines));
+            if (shaderArchive.lookup(ShaderArchive::makeKey(shaderName, declared, defines), sourceHash, &code)) {
+                return code;
+            }
+        }
+    }
+
+    // Otherwise compile the source, which is a cache hit unless it changed.
+    // The precompiled SPIR-V is only for when the source isn't shipped
+    if (!sourceFile.is_open()) {
+        std::vector<char> bytes = readFile(spirvPath);
+        std::vector<uint32_t> code(bytes.size() / sizeof(uint32_t));
+        memcpy(code.data(), bytes.data(), code.size() * sizeof(uint32_t));
+        return code;
+    }
+
+    return shaderCompiler.compile(source.str(), sourcePath, ShaderCompiler::kindFromPath(sourcePath), defines);
+}
+
 void VulkanApp::createRenderPass() {
     // Set up the attachments for the render pass
 
@@ -1045,7 +1816,20 @@ void VulkanApp::createRenderPass() {
     // operation (eTransferDstOptimal). The initial layout is the layout of the
     // previous image, which we don't care about
     colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-    colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+    // The late render pass draws after this one and presents
+    colorAttachment.finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+    // The depth buffer is cleared, and kept so the depth pyramid can be built
+    // from it between the render passes
+    vk::AttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = vk::SampleCountFlagBits::e1;
+    depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+    depthAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+    depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
+    depthAttachment.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
     // During a rendering operation, there may be multiple subpasses in series,
     // like various post processing effects after each other. Each subpass uses
@@ -1057,6 +1841,10 @@ void VulkanApp::createRenderPass() {
     // subpass. This attachment we want as a color buffer
     colorAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
 
+    vk::AttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
     // Set up subpasses for the render pass
 
     // To describe the subpass
@@ -1072,6 +1860,7 @@ void VulkanApp::createRenderPass() {
     // pPreserveAttachments for attachments not used by this subpass, but must
     // be preserved
     subpassDescription.pColorAttachments = &colorAttachmentRef;
+    subpassDescription.pDepthStencilAttachment = &depthAttachmentRef;
 
     // In the render pass, each subpass automatically converts the image layout
     // but the desired layouts must be specified, including before and after
@@ -1086,24 +1875,93 @@ void VulkanApp::createRenderPass() {
     // Specify when we need the transition to occur. It can't occur before here
     // because we won't have the image yet, since the semaphore from
     // drawFrame() waits in that stage
-    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    dependency.srcAccessMask = {}; // ******************************************* OK?
+    // The depth buffer is shared between frames, so the last frame must also
+    // be done writing it, and done building the pyramid from it
+    dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                              vk::PipelineStageFlagBits::eLateFragmentTests |
+                              vk::PipelineStageFlagBits::eComputeShader;
+    // A scaled scene's color is shared too, and the last frame must be done
+    // blitting it
+    if (scaledRendering) {
+        dependency.srcStageMask |= vk::PipelineStageFlagBits::eTransfer;
+    }
+    dependency.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
     // The stage that must wait on this dependency is the part of the color
-    // attachment output stage in which the image is written to
-    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    // attachment output stage in which the image is written to, and the
+    // depth tests
+    dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                              vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite |
+                               vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+    // The depth pyramid is built from the depth buffer once the render pass
+    // is done, and the late render pass draws over the color
+    vk::SubpassDependency outDependency{};
+    outDependency.srcSubpass = 0;
+    outDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    outDependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                                 vk::PipelineStageFlagBits::eLateFragmentTests;
+    outDependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite |
+                                  vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    outDependency.dstStageMask = vk::PipelineStageFlagBits::eComputeShader |
+                                 vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    outDependency.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eColorAttachmentWrite;
 
     // Create the render pass itself
     
+    std::array<vk::AttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+    std::array<vk::SubpassDependency, 2> dependencies = { dependency, outDependency };
     vk::RenderPassCreateInfo createInfo{};
-    createInfo.attachmentCount = 1;
-    createInfo.pAttachments = &colorAttachment;
+    createInfo.attachmentCount = (uint32_t)attachments.size();
+    createInfo.pAttachments = attachments.data();
     createInfo.subpassCount = 1;
     createInfo.pSubpasses = &subpassDescription;
-    createInfo.dependencyCount = 1;
-    createInfo.pDependencies = &dependency;
+    createInfo.dependencyCount = (uint32_t)dependencies.size();
+    createInfo.pDependencies = dependencies.data();
 
     renderPass = device.createRenderPass(createInfo);
+
+    // The late render pass has the same attachments and subpass, so it is
+    // compatible, but keeps what the first one drew and then presents, or
+    // is blitted to the swapchain if scaled. The depth isn't needed after
+    // the frame
+    attachments[0].loadOp = vk::AttachmentLoadOp::eLoad;
+    attachments[0].initialLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    attachments[0].finalLayout = scaledRendering ? vk::ImageLayout::eTransferSrcOptimal
+                                                 : vk::ImageLayout::ePresentSrcKHR;
+    attachments[1].loadOp = vk::AttachmentLoadOp::eLoad;
+    attachments[1].storeOp = vk::AttachmentStoreOp::eDontCare;
+    attachments[1].initialLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    attachments[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    // The pyramid must be done reading the depth buffer before it is
+    // written again
+    vk::SubpassDependency lateDependency{};
+    lateDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    lateDependency.dstSubpass = 0;
+    lateDependency.srcStageMask = vk::PipelineStageFlagBits::eComputeShader |
+                                  vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    lateDependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    lateDependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                                  vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    lateDependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead |
+                                   vk::AccessFlagBits::eColorAttachmentWrite |
+                                   vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                                   vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    // The blit reads the scaled scene once it is drawn
+    vk::SubpassDependency blitDependency{};
+    blitDependency.srcSubpass = 0;
+    blitDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    blitDependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    blitDependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    blitDependency.dstStageMask = vk::PipelineStageFlagBits::eTransfer;
+    blitDependency.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+    std::array<vk::SubpassDependency, 2> lateDependencies = { lateDependency, blitDependency };
+    createInfo.dependencyCount = scaledRendering ? 2 : 1;
+    createInfo.pDependencies = lateDependencies.data();
+
+    lateRenderPass = device.createRenderPass(createInfo);
 }
 
 
@@ -1127,8 +1985,9 @@ bool VulkanApp::isDeviceSuitable(vk::PhysicalDevice physicalDevice) {
 
     bool swapchainSuitable = false;
     if (supportsExtensions) {
-        SwapchainProperties properties = getSwapchainProperties(physicalDevice);
-        swapchainSuitable = !properties.surfaceFormats.empty() && !properties.presentModes.empty();
+        SwapchainProperties properties;
+        getSwapchainProperties(physicalDevice, &properties);
+        swapchainSuitable = properties.surfaceFormatCount > 0 && properties.presentModeCount > 0;
     }
 
     return supportsExtensions && swapchainSuitable && indices.isComplete();
@@ -1156,6 +2015,46 @@ bool VulkanApp::deviceSupportsExtensions(vk::PhysicalDevice physicalDevice) {
     return false;
 }
 
+std::unordered_set<std::string> VulkanApp::findOptionalExtensions(vk::PhysicalDevice physicalDevice) {
+    std::vector<vk::ExtensionProperties> supportedExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+
+    std::unordered_set<std::string> found;
+    for (const char* extensionName : optionalDeviceExtensions) {
+        for (const auto& supportedExtension : supportedExtensions) {
+            if (strcmp(extensionName, supportedExtension.extensionName) == 0) {
+                found.insert(extensionName);
+                break;
+            }
+        }
+    }
+
+    uint32_t deviceApiVersion = physicalDevice.getProperties().apiVersion;
+    bool hasVulkan11 = instanceApiVersion >= VK_API_VERSION_1_1 && deviceApiVersion >= VK_API_VERSION_1_1;
+
+#ifdef VK_EXT_mesh_shader
+    // SPIR-V 1.4 needs Vulkan 1.1 from both the instance and the device, and
+    // mesh shaders need SPIR-V 1.4
+    if (!hasVulkan11 || found.count(VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME) == 0) {
+        found.erase(VK_KHR_SPIRV_1_4_EXTENSION_NAME);
+    }
+    if (found.count(VK_KHR_SPIRV_1_4_EXTENSION_NAME) == 0) {
+        found.erase(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    }
+#endif
+#ifdef VK_KHR_buffer_device_address
+    // Memory is allocated for addresses with a flag from device groups, which
+    // are core in Vulkan 1.1
+    if (!hasVulkan11) {
+        found.erase(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+    }
+#endif
+    return found;
+}
+
+bool VulkanApp::isExtensionEnabled(const char* extensionName) {
+    return enabledOptionalExtensions.count(extensionName) > 0;
+}
+
 QueueFamilyIndices VulkanApp::findQueueFamilies(vk::PhysicalDevice physicalDevice) {
     QueueFamilyIndices indices;
 
@@ -1188,20 +2087,22 @@ std::vector<const char*> VulkanApp::getRequiredExtensions() {
     
     glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    // If validation layers are enabled, make space for the additional extension
-    uint32_t numberExtensions = glfwExtensionCount;
-    if (enableValidationLayers) {
-        numberExtensions++;
-    }
-
-    std::vector<const char*> extensions(numberExtensions);
-    for (int i = 0; i < glfwExtensionCount; i++) {
-        extensions[i] = glfwExtensions[i];
-    }
+    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
 
     // If validation layers are enabled, add the debug extension
     if (enableValidationLayers) {
-        extensions[extensions.size() - 1] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+
+    // Optional device extensions need the extended physical device queries,
+    // so add them if the instance has them
+    instanceSupportsProperties2 = false;
+    for (const auto& extension : vk::enumerateInstanceExtensionProperties()) {
+        if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+            instanceSupportsProperties2 = true;
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            break;
+        }
     }
 
     return extensions;
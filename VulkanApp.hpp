@@ -16,10 +16,31 @@
 #include <vulkan/vulkan.hpp>
 
 #include <vector>
+#include <string>
 #include <unordered_set>
 #include <optional>
+#include <array>
 
 #include "DebugMessenger.hpp"
+#include "CompletionService.hpp"
+#include "ShaderWatcher.hpp"
+#include "ShaderCompiler.hpp"
+#include "ShaderArchive.hpp"
+#include "LayoutCache.hpp"
+#include "DeviceFeatures.hpp"
+#include "PipelineLibrary.hpp"
+#include "FrameCapture.hpp"
+#include "MemoryAllocator.hpp"
+#include "Defragmenter.hpp"
+#include "GeometryArena.hpp"
+#include "VirtualTexture.hpp"
+#include "Scene.hpp"
+#include "Camera.hpp"
+#include "OcclusionCuller.hpp"
+#include "MeshletRenderer.hpp"
+#include "PerformanceHud.hpp"
+#include "MetricsExport.hpp"
+#include "ControlServer.hpp"
 
 enum QueueFamilyTypes {
     QUEUE_FAMILY_GRAPHICS = 0,  // For graphics computation
@@ -60,11 +81,20 @@ struct QueueFamilyIndices {
     }
 };
 
-/** A struct holding information about the swapchain */
+/**
+ * A struct holding information about the swapchain. The formats and present
+ * modes are held in place, so querying them doesn't allocate
+ */
 struct SwapchainProperties {
+    /** The most formats and present modes kept. Surfaces report far fewer */
+    static const uint32_t MAX_SURFACE_FORMATS = 64;
+    static const uint32_t MAX_PRESENT_MODES = 16;
+
     vk::SurfaceCapabilitiesKHR surfaceCapabilities;
-    std::vector<vk::SurfaceFormatKHR> surfaceFormats;
-    std::vector<vk::PresentModeKHR> presentModes;
+    std::array<vk::SurfaceFormatKHR, MAX_SURFACE_FORMATS> surfaceFormats;
+    uint32_t surfaceFormatCount = 0;
+    std::array<vk::PresentModeKHR, MAX_PRESENT_MODES> presentModes;
+    uint32_t presentModeCount = 0;
 };
 
 class VulkanApp { 
@@ -75,20 +105,62 @@ public:
      */
     void run();
 
+    /**
+     * Captures the commands of the first frames into a file, which the replay
+     * tool can replay. Must be called before run()
+     * 
+     * @param path The file to write the capture to
+     * @param frameCount The number of frames to capture, at least 1
+     */
+    void setCapture(const std::string& path, uint32_t frameCount);
+
 private:
 
     // Static fields and methods
 
     // Inline so they can be initialized here
-    /** The path to the vertex shader byte code */
+    /** The path to the precompiled vertex shader byte code, used if the
+     *  source isn't available */
     inline static const std::string VERT_PATH = "shaders/vert.spv";
-    /** The path to the fragment shader byte code */
+    /** The path to the precompiled fragment shader byte code, used if the
+     *  source isn't available */
     inline static const std::string FRAG_PATH = "shaders/frag.spv";
-    /** The name of the main function within the shaders */
-    inline static const std::string SHADER_MAIN = "main";
-
-    /** The number of frames that can be computed at the same time */
-    static const int MAX_CONCURRENT_FRAMES = 2;
+    /** The directory containing the shader sources */
+    inline static const std::string SHADER_DIR = "shaders";
+    /** The path to the vertex shader source */
+    inline static const std::string VERT_SOURCE_PATH = "shaders/shader.vert";
+    /** The path to the fragment shader source */
+    inline static const std::string FRAG_SOURCE_PATH = "shaders/shader.frag";
+    /** The directory of the content-addressed cache of compiled shaders */
+    inline static const std::string SHADER_CACHE_DIR = "shaders/cache";
+    /** The path to the archive of prebuilt shader permutations */
+    inline static const std::string SHADER_ARCHIVE_PATH = "shaders/shaders.pack";
+    /** The path the pipeline cache is saved to between runs */
+    inline static const std::string PIPELINE_CACHE_PATH = "shaders/cache/pipelines.bin";
+    /** The path to the virtual texture's page file, built with texture_pack.
+     *  The texture is only drawn if the file exists */
+    inline static const std::string VIRTUAL_TEXTURE_PATH = "textures/terrain.vtex";
+    /** The path to the meshlets of the mesh drawn over the street, built with
+     *  meshlet_pack. The mesh is only drawn if the file exists */
+    inline static const std::string MESHLET_MESH_PATH = "meshes/model.meshlets";
+
+    /** The most frames that can be computed at the same time */
+    static const int MAX_CONCURRENT_FRAMES = 3;
+    /** The frames computed at the same time, unless changed over the control
+     *  socket */
+    static const int DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+    /** The key that shows and hides the performance overlay */
+    static const int HUD_KEY = GLFW_KEY_F1;
+
+    /** How long the window's size must stay the same before the swapchain is
+     *  recreated for it. Until then the old swapchain is presented, and the
+     *  compositor scales it */
+    inline static const double RESIZE_SETTLE_SECONDS = 0.1;
+
+    /** A device lost again this soon after being recreated is treated as
+     *  unrecoverable, rather than recreating it forever */
+    inline static const double MIN_SECONDS_BETWEEN_RECOVERIES = 5.0;
 
     /**
      * Reads a file into a vector of chars. Note that if the file is too large,
@@ -107,6 +179,12 @@ private:
      */
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
+    /**
+     * A callback function for GLFW to call on key presses, which toggles the
+     * performance overlay on HUD_KEY
+     */
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
 
     // Non static fields and methods
 
@@ -122,10 +200,45 @@ private:
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
+    const std::vector<const char*> optionalDeviceExtensions = {
+        // Timeline semaphores, so GPU progress can be tracked by value
+        VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+#ifdef VK_EXT_graphics_pipeline_library
+        // Pipelines built from separately compiled parts, for fast linking
+        VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+        VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state
+        // Rasterization and depth state set while recording, so pipelines
+        // that only differ in that state are the same pipeline
+        VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+        VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+        VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_mesh_shader
+        // Task and mesh shaders, for culling and drawing meshlets. They need
+        // SPIR-V 1.4, and so Vulkan 1.1
+        VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME,
+        VK_KHR_SPIRV_1_4_EXTENSION_NAME,
+        VK_EXT_MESH_SHADER_EXTENSION_NAME,
+#endif
+#ifdef VK_KHR_buffer_device_address
+        // Buffer addresses, so the scene's vertex shader can pull its
+        // vertices through a pointer instead of vertex input
+        VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+#endif
+    };
+
 #ifdef NDEBUG
     const bool enableValidationLayers = false;
+    const bool enableShaderHotReload = false;
 #else
     const bool enableValidationLayers = true;
+    const bool enableShaderHotReload = true;
 #endif
 
     // Primary objects
@@ -133,18 +246,44 @@ private:
     GLFWwindow* window;
     /** The Vulkan instance */
     vk::Instance instance;
+    /** The version of Vulkan the instance was created for */
+    uint32_t instanceApiVersion = VK_API_VERSION_1_0;
     /** Debug messenger for custom debugging from validation layer messages */
     DebugMessenger debugMessenger;
     /** Surface for interfacing between Vulkan and a window */
     vk::SurfaceKHR surface;
     /** Handle to a graphics card */
     vk::PhysicalDevice physicalDevice;
+    /** The queue families of the physical device, found when it is picked */
+    QueueFamilyIndices queueFamilyIndices;
+    /** The surface's properties on the physical device. The formats and
+     *  present modes don't change, so only the capabilities are queried
+     *  again when the swapchain is recreated */
+    SwapchainProperties surfaceProperties;
     /** Handle to the logical device that interfaces with the physical device */
     vk::Device device;
     /** Handle to the queue used for graphics commands */
     vk::Queue graphicsQueue;
     /** Handle to the queue used for presenting. Often will be graphics queue */
     vk::Queue presentQueue;
+    /** Whether the instance has VK_KHR_get_physical_device_properties2, which
+     *  most optional device extensions depend on */
+    bool instanceSupportsProperties2 = false;
+    /** The optional device extensions that were enabled on the device */
+    std::unordered_set<std::string> enabledOptionalExtensions;
+    /** The features of the optional extensions that are enabled */
+    DeviceFeatures features;
+    /** Runs callbacks when GPU work completes, without blocking this thread */
+    CompletionService completionService;
+    /** Sub-allocates the memory of buffers and images */
+    MemoryAllocator memoryAllocator;
+    /** The host writes of the frame being recorded, flushed together before
+     *  it is submitted */
+    std::vector<vk::MappedMemoryRange> flushRanges;
+    /** Moves buffers and images between frames to keep memory compact */
+    Defragmenter defragmenter;
+    /** The vertices and indices of every mesh, bound once per frame */
+    GeometryArena geometryArena;
 
     // Swapchain objects
     /** The swapchain object for rendering */
@@ -158,20 +297,109 @@ private:
     vk::Format swapchainImageFormat;
     /** The extent (size) of the window */
     vk::Extent2D swapchainExtent;
+    /** The present mode asked for over the control socket, if any */
+    std::optional<vk::PresentModeKHR> requestedPresentMode;
+    /** The scene's resolution relative to the window's, set over the control
+     *  socket */
+    float resolutionScale = 1.f;
+    /** The size the scene is drawn at. The swapchain's extent, unless the
+     *  scene is scaled */
+    vk::Extent2D renderExtent;
+    /** Whether the scene is drawn to the scene color image and blitted to the
+     *  swapchain, rather than drawn to the swapchain directly */
+    bool scaledRendering = false;
+    /** The scene's color, when it is scaled. Shared by the frames like the
+     *  depth buffer */
+    vk::Image sceneColorImage;
+    Allocation sceneColorAllocation;
+    vk::ImageView sceneColorImageView;
+    /** The depth buffer, shared by the swapchain's framebuffers. It is also
+     *  sampled to build the occlusion culler's depth pyramid */
+    vk::Image depthImage;
+    Allocation depthAllocation;
+    vk::ImageView depthImageView;
+    vk::Format depthFormat;
 
     // Graphics objects
-    /** Store details about each render pass */
+    /** Store details about each render pass. This is the first of the
+     *  frame, which clears the attachments and draws the early culling phase */
     vk::RenderPass renderPass;
-    /** The layout which interfaces with shader uniforms */
+    /** The render pass after the depth pyramid is built, which draws the late
+     *  culling phase and the rest of the frame. It is compatible with
+     *  renderPass, so they share pipelines and framebuffers */
+    vk::RenderPass lateRenderPass;
+    /** The layout which interfaces with shader uniforms. Owned by the
+     *  layout cache */
     vk::PipelineLayout pipelineLayout;
-    /** The graphics pipeline itself */
+    /** Shares pipeline and descriptor set layouts between pipelines */
+    LayoutCache layoutCache;
+    /** Builds and owns the graphics pipelines */
+    PipelineLibrary pipelineLibrary;
+    /** The shaders and state of the graphics pipeline */
+    PipelineKey pipelineKey;
+    /** The graphics pipeline itself. Owned by the pipeline library */
     vk::Pipeline graphicsPipeline;
     /** A list of the framebuffers */
     std::vector<vk::Framebuffer> swapchainFramebuffers;
     /** Store the pool of commands used for drawing */
     vk::CommandPool commandPool;
-    /** The command buffers used for drawing */
+    /** The command buffers used for drawing, one for each concurrent frame */
     std::vector<vk::CommandBuffer> commandBuffers;
+    /** Compiles the shader sources, with a cache of the results on disk */
+    ShaderCompiler shaderCompiler;
+    /** The prebuilt shader permutations, if the archive has been built */
+    ShaderArchive shaderArchive;
+    /** Watches the shader sources so they can be reloaded when changed */
+    ShaderWatcher shaderWatcher;
+    /** Records the commands of frames for the replay tool */
+    FrameCapture frameCapture;
+    /** The file to capture to, if capturing */
+    std::string capturePath;
+    /** The number of frames to capture */
+    uint32_t captureFrameCount = 0;
+    /** What the GPU writes during each concurrent frame that a capture
+     *  needs, read back at the end of the frame. Laid out as each culling
+     *  phase's indirect draw, then each phase's instances to draw */
+    std::vector<vk::Buffer> captureReadbackBuffers;
+    std::vector<Allocation> captureReadbackAllocations;
+    /** Loads the code of a shader, for the pipeline library and captures */
+    PipelineLibrary::ShaderLoader shaderLoader;
+    /** Streams the pages of a texture too large for device memory */
+    VirtualTexture virtualTexture;
+    /** Whether the virtual texture is drawn behind the triangle */
+    bool useVirtualTexture = false;
+    /** The pipeline that draws the virtual texture, and its layout. Owned by
+     *  the pipeline library and the layout cache */
+    vk::Pipeline virtualTexturePipeline;
+    vk::PipelineLayout virtualTextureLayout;
+    /** The city drawn behind the triangle */
+    Scene scene;
+    /** Flies through the scene */
+    Camera camera;
+    /** Culls the scene's instances on the GPU, and draws what is left */
+    OcclusionCuller culler;
+    /** The pipeline that draws the scene, and its layout. Owned by the
+     *  pipeline library and the layout cache */
+    vk::Pipeline scenePipeline;
+    vk::PipelineLayout sceneLayout;
+    /** Draws copies of a mesh over the street, culled meshlet by meshlet */
+    MeshletRenderer meshletRenderer;
+    /** Whether the meshlet mesh is drawn */
+    bool useMeshlets = false;
+    /** The pipeline that draws the meshlets, and its layout. Owned by the
+     *  pipeline library and the layout cache */
+    vk::Pipeline meshletPipeline;
+    vk::PipelineLayout meshletLayout;
+    /** Times the frames, and draws the times over them */
+    PerformanceHud hud;
+    /** The pipeline that draws the overlay, and its layout. Owned by the
+     *  pipeline library and the layout cache */
+    vk::Pipeline hudPipeline;
+    vk::PipelineLayout hudLayout;
+    /** Publishes live metrics for other processes to read */
+    MetricsExport metricsExport;
+    /** Serves the metrics and takes commands over a local socket */
+    ControlServer controlServer;
 
     // Drawing objects
     // One semaphore for each possible concurrent frame
@@ -187,10 +415,25 @@ private:
     std::vector<vk::Fence> imagesInFlight;
     /** The current frame, for drawing multiple frames */
     int currentFrame = 0;
+    /** The frames worked on at the same time, at most MAX_CONCURRENT_FRAMES */
+    int framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
 
     /** If a resize has occurred, this flag indicates that the swapchain must
      * be reset, for cases in which an exception is not thrown */
     bool framebufferResized = false;
+    /** When the window was last resized, from glfwGetTime() */
+    double lastResizeTime = 0.0;
+    /** Whether drawing is suspended because the window is hidden, in which
+     *  case the swapchain and what depends on it don't exist */
+    bool suspended = false;
+    /** Whether the swapchain and what depends on it may exist, from the
+     *  start of createSwapchainObjects() until cleanupSwapchain() */
+    bool swapchainObjectsCreated = false;
+    /** Whether vkTrimCommandPool is available, which is core in Vulkan 1.1 */
+    bool canTrimCommandPools = false;
+    /** When the device was last recreated after being lost, from
+     *  glfwGetTime(), or negative if it never has been */
+    double lastRecoveryTime = -1.0;
 
     // Primary functions
 
@@ -215,6 +458,33 @@ private:
      */
     void cleanup();
 
+    /**
+     * Creates the logical device and everything made from it, up to the
+     * objects used to draw each frame. Uploads are made again from the CPU
+     * side copies, and pipelines are warmed from the pipeline cache
+     *
+     * Requires: The instance, surface and physical device exist
+     */
+    void createDeviceObjects();
+
+    /**
+     * Destroys everything createDeviceObjects() created, saving the pipeline
+     * cache first. Doesn't wait on the device, so it works on a lost one
+     *
+     * Requires: No work is pending on the device, or the device is lost
+     */
+    void destroyDeviceObjects();
+
+    /**
+     * Recreates the device in place after it was lost, keeping the window,
+     * instance and everything on the CPU side, so drawing continues where it
+     * stopped
+     *
+     * @throw std::runtime_error if the device is lost again soon after being
+     *        recreated
+     */
+    void recoverDevice();
+
 
     // Helper methods for initVulkan()
 
@@ -253,10 +523,36 @@ private:
     void createImageViews();
 
     /**
-     * Creates the graphics pipeline
+     * Creates the depth buffer, the size the scene is drawn at
+     * 
+     * @throw std::runtime_error if no depth format can be both a depth
+     *        attachment and sampled
+     */
+    void createDepthResources();
+
+    /**
+     * Creates the image the scene is drawn to, if it is scaled
+     */
+    void createSceneColorResources();
+
+    /**
+     * Gets the graphics pipelines and their layouts from the pipeline library
+     * 
+     * Requires: The pipeline library has the current render pass
      */
     void createGraphicsPipeline();
 
+    /**
+     * Sets up the virtual texture, if its page file exists and the device can
+     * write the feedback from fragment shaders
+     */
+    void createVirtualTexture();
+
+    /**
+     * Sets up the meshlet mesh, if its file exists
+     */
+    void createMeshletRenderer();
+
     /**
      * Create framebuffer objects that store the images to be rendered
      */
@@ -268,7 +564,8 @@ private:
     void createCommandPool();
 
     /**
-     * Create the commands which can be executed for rendering
+     * Allocate the command buffers, one for each concurrent frame. They are
+     * recorded each frame by recordCommandBuffer()
      */
     void createCommandBuffers();
 
@@ -279,6 +576,27 @@ private:
 
     // Helper methods for mainLoop()
 
+    /**
+     * Records the commands for drawing a frame into a command buffer
+     * 
+     * Requires: The command buffer is not in use by the GPU
+     * 
+     * @param commandBuffer The command buffer to record into
+     * @param imageIndex The index of the swapchain image to draw to
+     */
+    void recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+
+    /**
+     * Scales the scene color onto a swapchain image, and readies the image to
+     * be presented
+     *
+     * Requires: The scene is scaled, and the late render pass has ended
+     *
+     * @param commandBuffer The command buffer being recorded
+     * @param imageIndex The index of the swapchain image to draw to
+     */
+    void blitToSwapchain(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+
     /**
      * This function first gets an image from the swapchain, then runs the
      * command buffer using that image as the attachment in the framebuffer.
@@ -286,6 +604,62 @@ private:
      */
     void drawFrame();
 
+    /**
+     * Has the pipeline library rebuild its pipelines once the shader watcher
+     * sees changed sources, and swaps in any pipelines the library finished
+     * in the background (rebuilds and optimized links). Never waits on the
+     * library or the GPU, and old pipelines are destroyed once their frames
+     * complete. Should only be called at a frame boundary
+     */
+    void swapReloadedPipeline();
+
+    /**
+     * Applies the commands posted by the control server. Should only be
+     * called at a frame boundary, since some recreate the swapchain
+     */
+    void applyControlCommands();
+
+    /**
+     * Starts a frame capture, with the geometry, the instances and the
+     * culling buffers as they are now. Waits for the queue to read them back
+     *
+     * @param path The file to write the capture to
+     * @param frameCount The number of frames to capture
+     *
+     * @throw std::runtime_error if the capture couldn't be started
+     */
+    void startCapture(const std::string& path, uint32_t frameCount);
+
+    /**
+     * Writes a buffer and its current contents to the capture, reading them
+     * back through a staging buffer
+     *
+     * Requires: The queue is idle
+     */
+    void captureBuffer(vk::Buffer buffer, vk::DeviceSize size, vk::BufferUsageFlags usage);
+
+    /**
+     * Records a culling phase's draw of the scene to the capture, along with
+     * the culling results the frame reads back for it
+     *
+     * @param phase The culling phase
+     * @param viewProjection The view projection matrix, as 16 floats
+     */
+    void captureSceneDraw(uint32_t phase, const float* viewProjection);
+
+    /**
+     * Records the copies of what the frame's GPU work wrote into the frame's
+     * capture read back buffer, if the frame is being captured. Must be
+     * recorded outside a render pass, after the frame's last draw
+     */
+    void recordCaptureReadback(vk::CommandBuffer commandBuffer);
+
+    /**
+     * Writes the captured frames the GPU has finished. Never waits, and
+     * write errors are logged
+     */
+    void finishCapturedFrames();
+
 
     // Swapchain helper methods
 
@@ -297,21 +671,48 @@ private:
     void recreateSwapchain();
 
     /**
-     * Destroy everything that is recreated in recreateSwapchain(). Should only
-     * be called before recreateSwapchain()
+     * Destroy everything that is recreated in recreateSwapchain(), clearing
+     * the handles so nothing is destroyed twice. Whatever was never created,
+     * such as after a failure partway through createSwapchainObjects(), is
+     * skipped
+     *
+     * @param keepSwapchain Whether to keep the swapchain itself, for
+     *                      createSwapchain() to replace and destroy
+     */
+    void cleanupSwapchain(bool keepSwapchain);
+
+    /**
+     * Create the swapchain and all objects that depend on it. Shared by
+     * recreateSwapchain() and resume()
+     */
+    void createSwapchainObjects();
+
+    /**
+     * Stops drawing while the window is hidden, destroying the swapchain and
+     * everything that depends on it and giving back the memory that can be
+     * recreated: the virtual texture's staging buffer, the command pool's
+     * spare memory and the allocator's empty blocks. Does nothing if already
+     * suspended
+     */
+    void suspend();
+
+    /**
+     * Recreates what suspend() released, so drawing can continue
+     *
+     * Requires: Drawing is suspended
      */
-    void cleanupSwapchain();
+    void resume();
 
     /**
-     * Gets the supported swapchain properties from the physical device
+     * Gets the supported swapchain properties from the physical device,
+     * without allocating
      * 
      * Requires: The swapchain extension is supported
      * 
      * @param physicalDevice The physical device
-     * 
-     * @return A SwapchainProperties struct of the supported properties
+     * @param properties Set to the supported properties
      */
-    SwapchainProperties getSwapchainProperties(vk::PhysicalDevice physicalDevice);
+    void getSwapchainProperties(vk::PhysicalDevice physicalDevice, SwapchainProperties* properties);
 
     /**
      * Gets the window extent from the swapchain
@@ -347,6 +748,18 @@ private:
      */
     vk::Extent2D chooseSwapchainExtent(const SwapchainProperties& properties);
 
+    /**
+     * @return Whether the window has been resized within the last
+     *         RESIZE_SETTLE_SECONDS, so its size may still be changing
+     */
+    bool isResizing() const;
+
+    /**
+     * @return Whether nothing drawn would be seen, because the window is
+     *         minimized, invisible or has no size
+     */
+    bool isWindowHidden() const;
+
 
     // Graphics and Shaders helper methods
 
@@ -359,10 +772,31 @@ private:
      */
     vk::ShaderModule createShaderModule(const std::vector<char>& bytes);
 
+    /**
+     * Loads the SPIR-V of a permutation of a shader. It is taken from the
+     * shader archive if it was prebuilt (unless shaders are being hot
+     * reloaded), and otherwise the GLSL source is compiled through the shader
+     * compiler (and its cache). If the source doesn't exist either, the
+     * precompiled SPIR-V is loaded instead. Safe to call from a background
+     * thread
+     * 
+     * @param sourcePath The path to the GLSL source
+     * @param spirvPath The path to the precompiled SPIR-V
+     * @param defines The values of the permutations of the shader
+     * 
+     * @return The SPIR-V code
+     * 
+     * @throw std::runtime_error if the source failed to compile
+     */
+    std::vector<uint32_t> loadShaderCode(const std::string& sourcePath, const std::string& spirvPath,
+                                         const ShaderArchive::Defines& defines = {});
+
     /**
      * Create a render pass object which stores data about how many color and
      * depth buffers to use, or how to proces samples during rendering 
-     * operations
+     * operations. Creates both renderPass and lateRenderPass
+     * 
+     * Requires: The depth format has been chosen
      */
     void createRenderPass();
 
@@ -379,6 +813,20 @@ private:
      */
     bool deviceSupportsExtensions(vk::PhysicalDevice physicalDevice);
 
+    /**
+     * Gets the optional extensions (from optionalDeviceExtensions) that the
+     * given device supports, leaving out the ones that need a newer version of
+     * Vulkan than the instance or device has
+     * 
+     * @return A set of the names of the supported optional extensions
+     */
+    std::unordered_set<std::string> findOptionalExtensions(vk::PhysicalDevice physicalDevice);
+
+    /**
+     * @return Whether the optional device extension was enabled on the device
+     */
+    bool isExtensionEnabled(const char* extensionName);
+
     /**
      * Gets the indices of the required queue families that are available
      * 
@@ -389,7 +837,8 @@ private:
     /**
      * This function gets the required validation layers, which will be the
      * ones required by GLFW, and potentially the debug utils extension if
-     * validation layers are being used.
+     * validation layers are being used. VK_KHR_get_physical_device_properties2
+     * is also added if it is available, which sets instanceSupportsProperties2
      *  
      * @return A vector of c strings containing the extension names
      */
@@ -2,12 +2,32 @@
 
 #include <iostream>
 #include <exception>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
 
 #include "VulkanApp.hpp"
 
-int main() {
+int main(int argc, char** argv) {
     VulkanApp app;
 
+    // "--capture <file> <frames>" records the first frames for the replay
+    // tool. The frame count must be a whole number of at least 1
+    bool validArguments = argc == 1;
+    if (argc == 4 && std::string(argv[1]) == "--capture") {
+        const char* count = argv[3];
+        char* end = nullptr;
+        unsigned long frameCount = std::strtoul(count, &end, 10);
+        if (count[0] >= '0' && count[0] <= '9' && *end == '\0' && frameCount > 0 && frameCount <= UINT32_MAX) {
+            app.setCapture(argv[2], (uint32_t)frameCount);
+            validArguments = true;
+        }
+    }
+    if (!validArguments) {
+        std::cerr << "Usage: " << argv[0] << " [--capture <file> <frames>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     try {
         app.run();
     } catch (const std::exception& e) {
@@ -1,2 +1,30 @@
-/Users/Jake/vulkansdk-macos-1.2.135.0/macOS/bin/glslc shader.vert -o vert.spv
-/Users/Jake/vulkansdk-macos-1.2.135.0/macOS/bin/glslc shader.frag -o frag.spv
+#!/bin/sh
+# Compiles the shaders with glslc, from $VULKAN_SDK/bin or else the PATH
+
+cd "$(dirname "$0")"
+
+GLSLC=glslc
+if [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/glslc" ]; then
+    GLSLC="$VULKAN_SDK/bin/glslc"
+fi
+
+"$GLSLC" shader.vert -o vert.spv
+"$GLSLC" shader.frag -o frag.spv
+"$GLSLC" virtual_texture.vert -o virtual_texture_vert.spv
+"$GLSLC" virtual_texture.frag -o virtual_texture_frag.spv
+"$GLSLC" -DVT_SPARSE=1 virtual_texture.frag -o virtual_texture_sparse_frag.spv
+"$GLSLC" scene.vert -o scene_vert.spv
+"$GLSLC" -DVERTEX_PULLING=1 scene.vert -o scene_pulling_vert.spv
+"$GLSLC" scene.frag -o scene_frag.spv
+"$GLSLC" cull.comp -o cull_comp.spv
+"$GLSLC" depth_pyramid.comp -o depth_pyramid_comp.spv
+# Mesh shaders need SPIR-V 1.4
+"$GLSLC" --target-env=vulkan1.1 --target-spv=spv1.4 meshlet.task -o meshlet_task.spv
+"$GLSLC" --target-env=vulkan1.1 --target-spv=spv1.4 meshlet.mesh -o meshlet_mesh.spv
+"$GLSLC" --target-env=vulkan1.1 --target-spv=spv1.4 -DQUANTIZED_VERTICES=1 meshlet.mesh -o meshlet_quantized_mesh.spv
+"$GLSLC" meshlet_cull.comp -o meshlet_cull_comp.spv
+"$GLSLC" meshlet.vert -o meshlet_vert.spv
+"$GLSLC" -DQUANTIZED_VERTICES=1 meshlet.vert -o meshlet_quantized_vert.spv
+"$GLSLC" meshlet.frag -o meshlet_frag.spv
+"$GLSLC" hud.vert -o hud_vert.spv
+"$GLSLC" hud.frag -o hud_frag.spv
@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Draws a quad of the performance overlay, either solid or a glyph of a 3x5
+// pixel font
+
+layout(location = 0) in vec2 fragUv;
+layout(location = 1) flat in vec4 fragColor;
+layout(location = 2) flat in uint fragGlyph;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // The glyph's bits are its pixels from the top left, the highest first
+    uvec2 pixel = min(uvec2(fragUv * vec2(3.0, 5.0)), uvec2(2, 4));
+    uint bit = 14u - (pixel.y * 3u + pixel.x);
+    if (((fragGlyph >> bit) & 1u) == 0u) {
+        discard;
+    }
+    outColor = fragColor;
+}
@@ -0,0 +1,40 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Draws the quads of the performance overlay, six vertices each, from a
+// buffer of quads rather than vertex buffers
+
+struct Quad {
+    // The corners in pixels, from the top left
+    vec4 rect;
+    uint color;
+    uint glyph;
+};
+
+layout(set = 0, binding = 0) readonly buffer Quads {
+    Quad quads[];
+};
+
+layout(push_constant) uniform PushConstants {
+    vec2 screenSize;
+} pushConstants;
+
+layout(location = 0) out vec2 fragUv;
+layout(location = 1) flat out vec4 fragColor;
+layout(location = 2) flat out uint fragGlyph;
+
+// The corners of the two triangles of a quad
+const vec2 CORNERS[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+                                vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+void main() {
+    Quad quad = quads[gl_VertexIndex / 6];
+    vec2 corner = CORNERS[gl_VertexIndex % 6];
+    vec2 position = mix(quad.rect.xy, quad.rect.zw, corner);
+
+    // y is down in both pixels and Vulkan's clip space
+    gl_Position = vec4(position / pushConstants.screenSize * 2.0 - 1.0, 0.0, 1.0);
+    fragUv = corner;
+    fragColor = unpackUnorm4x8(quad.color);
+    fragGlyph = quad.glyph;
+}
@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Lights the meshlets like scene.frag, and cross-fades between two levels of
+// detail by dithering: each pixel is drawn by only one of the two, and the
+// share the coarser one draws grows with the fade
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+// How far the copy has faded to the coarser level, and 1 if this triangle is
+// from the coarser level
+layout(location = 2) flat in vec2 fragFade;
+
+layout(location = 0) out vec4 outColor;
+
+// The direction towards the sun
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4, 1.0, 0.3));
+
+// A 4x4 ordered dither, so the pixels each level draws are spread evenly
+const float BAYER[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                  3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy) % 4;
+    float dither = (BAYER[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+    bool coarser = fragFade.y > 0.5;
+    if ((dither < fragFade.x) != coarser) {
+        discard;
+    }
+
+    float diffuse = max(dot(normalize(fragNormal), LIGHT_DIRECTION), 0.0);
+    outColor = vec4(fragColor * (0.3 + 0.7 * diffuse), 1.0);
+}
@@ -0,0 +1,126 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Draws the triangles left by meshlet_cull.comp, whose indices hold the copy
+// of the mesh, which of its two levels of detail the triangle is from, and
+// the vertex. The copy's fade is picked again here, the same way
+//
+// Permutations, with the default value first
+// @permutation QUANTIZED_VERTICES 0 1
+
+#ifndef QUANTIZED_VERTICES
+#define QUANTIZED_VERTICES 0
+#endif
+
+#if QUANTIZED_VERTICES
+// 16 bit positions in x, y and z, then the octahedral encoded normal as two
+// 16 bit snorms, then padding
+struct Vertex {
+    uint words[3];
+};
+#else
+struct Vertex {
+    float position[3];
+    float normal[3];
+};
+#endif
+
+layout(set = 0, binding = 1) readonly buffer Instances {
+    vec4 instances[];
+};
+
+layout(set = 0, binding = 2) readonly buffer Vertices {
+    Vertex vertices[];
+};
+
+struct Lod {
+    uint meshletOffset;
+    uint meshletCount;
+    float error;
+    uint triangleCount;
+};
+
+// The levels of detail, finest first
+layout(set = 0, binding = 7) readonly buffer Lods {
+    Lod lods[];
+};
+
+layout(push_constant) uniform PushConstants {
+    mat4 viewProjection;
+    vec4 bounds;
+    vec3 cameraPosition;
+    uint lodCount;
+    uint vertexCount;
+    float lodScale;
+    // The corner and step of quantized positions
+    vec4 quantization;
+} pushConstants;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) flat out vec2 fragFade;
+
+const vec3 COLOR = vec3(0.8, 0.75, 0.7);
+
+// Unfolds a normal from the square it was folded onto, as octahedral
+// encoding does in MeshletMesh
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(normal.xy, vec2(0.0)));
+    return normalize(normal);
+}
+
+// Reads a vertex, decoding it if it is quantized
+void fetchVertex(uint index, out vec3 position, out vec3 normal) {
+    Vertex vertex = vertices[index];
+#if QUANTIZED_VERTICES
+    uvec3 steps = uvec3(vertex.words[0] & 0xffff, vertex.words[0] >> 16, vertex.words[1] & 0xffff);
+    position = pushConstants.quantization.xyz + vec3(steps) * pushConstants.quantization.w;
+    normal = decodeOctahedral(unpackSnorm2x16((vertex.words[1] >> 16) | (vertex.words[2] << 16)));
+#else
+    position = vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+    normal = vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+#endif
+}
+
+// A level of detail is used once its error is at most this many pixels on
+// screen, and fades in from this times LOD_FADE
+const float LOD_THRESHOLD = 1.0;
+const float LOD_FADE = 1.5;
+// The nearest the camera is taken to be, so the pixels stay finite inside
+// the bounds
+const float MIN_DISTANCE = 0.1;
+
+// Picks the coarsest level of detail whose error is small enough for the
+// copy's size on screen, and how far to fade to the next coarser one
+uint selectLod(vec4 instance, out float fade) {
+    vec3 center = instance.xyz + pushConstants.bounds.xyz * instance.w;
+    float distance = length(center - pushConstants.cameraPosition) - pushConstants.bounds.w * instance.w;
+    float pixels = pushConstants.lodScale * instance.w / max(distance, MIN_DISTANCE);
+
+    uint lod = 0;
+    while (lod + 1 < pushConstants.lodCount && lods[lod + 1].error * pixels <= LOD_THRESHOLD) {
+        lod++;
+    }
+    fade = 0.0;
+    if (lod + 1 < pushConstants.lodCount) {
+        float next = lods[lod + 1].error * pixels;
+        fade = clamp((LOD_THRESHOLD * LOD_FADE - next) / (LOD_THRESHOLD * (LOD_FADE - 1.0)), 0.0, 1.0);
+    }
+    return lod;
+}
+
+void main() {
+    uint copy = gl_VertexIndex / pushConstants.vertexCount;
+    vec4 instance = instances[copy / 2];
+    float fade;
+    selectLod(instance, fade);
+    vec3 position;
+    vec3 normal;
+    fetchVertex(gl_VertexIndex % pushConstants.vertexCount, position, normal);
+    gl_Position = pushConstants.viewProjection * vec4(instance.xyz + position * instance.w, 1.0);
+    fragColor = COLOR;
+    fragNormal = normal;
+    fragFade = vec2(fade, copy % 2);
+}
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+// The direction towards the sun
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4, 1.0, 0.3));
+
+void main() {
+    float diffuse = max(dot(normalize(fragNormal), LIGHT_DIRECTION), 0.0);
+    outColor = vec4(fragColor * (0.3 + 0.7 * diffuse), 1.0);
+}
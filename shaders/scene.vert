@@ -0,0 +1,83 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// The buildings of the scene, instanced over the instances left by culling
+//
+// Permutations, with the default value first
+// @permutation VERTEX_PULLING 0 1
+
+#ifndef VERTEX_PULLING
+#define VERTEX_PULLING 0
+#endif
+
+#if VERTEX_PULLING
+#extension GL_EXT_buffer_reference : require
+
+// The vertices, read by index through the buffer's address rather than
+// through vertex input. Only fetchVertex() knows the layout, so packed or
+// custom layouts don't need new vertex input state
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer Vertices {
+    float values[];
+};
+#endif
+
+struct Instance {
+    vec3 center;
+    // RGBA8
+    uint color;
+    // Half the size of the box, which scales the unit cube
+    vec3 extent;
+    float padding;
+};
+
+layout(set = 0, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+// Written by the culling pass, one entry for each instance drawn
+layout(set = 0, binding = 1) readonly buffer VisibleInstances {
+    uint visibleInstances[];
+};
+
+layout(push_constant) uniform PushConstants {
+    mat4 viewProjection;
+#if VERTEX_PULLING
+    Vertices vertices;
+#endif
+} pushConstants;
+
+#if VERTEX_PULLING
+// Must match Scene::Vertex
+const uint VERTEX_FLOATS = 6;
+
+void fetchVertex(out vec3 position, out vec3 normal) {
+    uint base = uint(gl_VertexIndex) * VERTEX_FLOATS;
+    Vertices vertices = pushConstants.vertices;
+    position = vec3(vertices.values[base], vertices.values[base + 1], vertices.values[base + 2]);
+    normal = vec3(vertices.values[base + 3], vertices.values[base + 4], vertices.values[base + 5]);
+}
+#else
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+void fetchVertex(out vec3 position, out vec3 normal) {
+    position = inPosition;
+    normal = inNormal;
+}
+#endif
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+
+void main() {
+    vec3 vertexPosition;
+    vec3 vertexNormal;
+    fetchVertex(vertexPosition, vertexNormal);
+
+    Instance instance = instances[visibleInstances[gl_InstanceIndex]];
+    vec3 position = instance.center + vertexPosition * instance.extent;
+    gl_Position = pushConstants.viewProjection * vec4(position, 1.0);
+    fragColor = unpackUnorm4x8(instance.color).rgb;
+    // Boxes are only scaled along the axes, so the normals stay the same
+    fragNormal = vertexNormal;
+}
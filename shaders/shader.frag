@@ -1,10 +1,23 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Permutations, with the default value first. Only the variants listed in
+// permutations.txt are built into the shader archive
+// @permutation DESATURATE 0 1
+
+#ifndef DESATURATE
+#define DESATURATE 0
+#endif
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
+#if DESATURATE
+    float luminance = dot(fragColor, vec3(0.2126, 0.7152, 0.0722));
+    outColor = vec4(vec3(luminance), 1.0);
+#else
     outColor = vec4(fragColor, 1.0);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Samples the virtual texture, and reports the pages it needs
+//
+// Permutations, with the default value first
+// @permutation VT_SPARSE 0 1
+
+#ifndef VT_SPARSE
+#define VT_SPARSE 0
+#endif
+
+// Must match PageFile::PAGE_SIZE
+const uint PAGE_SIZE = 128;
+
+layout(push_constant) uniform PushConstants {
+    vec4 view;
+    // The size of mip 0 in texels
+    uvec2 size;
+    uint mipCount;
+    // Changes every frame, so each frame reports from different pixels
+    uint frame;
+} pushConstants;
+
+#if VT_SPARSE
+// The partially resident texture itself
+layout(set = 0, binding = 0) uniform sampler2D virtualTexture;
+// The finest resident mip level over each page of mip 0
+layout(set = 0, binding = 1) uniform usampler2D minMipMap;
+#else
+// The resident pages, each in a slot of a grid
+layout(set = 0, binding = 0) uniform sampler2D pageCache;
+// For every page, the slot (high 24 bits) and mip level (low 8 bits) of the
+// finest resident page covering it
+layout(set = 0, binding = 1) readonly buffer Indirection {
+    uint entries[];
+} indirection;
+#endif
+
+// A bit for each page needed this frame
+layout(set = 0, binding = 2) buffer Feedback {
+    uint bits[];
+} feedback;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+uvec2 mipSize(uint mip) {
+    return max(pushConstants.size >> mip, uvec2(1));
+}
+
+uvec2 pageCount(uint mip) {
+    return (mipSize(mip) + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+// The page of a mip level that a texture coordinate is in
+uvec2 pageAt(vec2 uv, uint mip) {
+    uvec2 page = uvec2(uv * vec2(mipSize(mip))) / PAGE_SIZE;
+    return min(page, pageCount(mip) - 1);
+}
+
+// The id of a page, which is its index in the page file
+uint pageId(uint mip, uvec2 page) {
+    uint offset = 0;
+    for (uint level = 0; level < mip; level++) {
+        uvec2 count = pageCount(level);
+        offset += count.x * count.y;
+    }
+    return offset + page.y * pageCount(mip).x + page.x;
+}
+
+void main() {
+    vec2 uv = clamp(fragTexCoord, 0.0, 1.0);
+
+    // The mip level a full texture would sample. Derivatives need every pixel
+    // of the quad, so this comes before any branching
+    vec2 texel = fragTexCoord * vec2(pushConstants.size);
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0, float(pushConstants.mipCount - 1));
+    uint level = uint(lod);
+
+    // Only one pixel in eight reports, in a pattern that moves each frame,
+    // which is plenty to find the pages and keeps the atomics cheap
+    uvec2 pixel = uvec2(gl_FragCoord.xy);
+    if (((pixel.x + pixel.y * 3 + pushConstants.frame) & 7) == 0) {
+        uint id = pageId(level, pageAt(uv, level));
+        atomicOr(feedback.bits[id >> 5], 1u << (id & 31));
+    }
+
+#if VT_SPARSE
+    // Never sample finer than what is resident. The neighbouring pages are
+    // included, since filtering near a page's edge reads from them
+    vec2 pageUv = uv * vec2(pushConstants.size) / (float(PAGE_SIZE) * vec2(pageCount(0)));
+    uvec4 minMips = textureGather(minMipMap, pageUv);
+    float minMip = float(max(max(minMips.x, minMips.y), max(minMips.z, minMips.w)));
+    outColor = textureLod(virtualTexture, uv, max(lod, minMip));
+#else
+    uint entry = indirection.entries[pageId(level, pageAt(uv, level))];
+    uint slot = entry >> 8;
+    uint mip = entry & 0xff;
+
+    // The position within the resident page, kept half a texel from its
+    // edges so filtering doesn't read the neighbouring slot
+    vec2 inPage = uv * vec2(mipSize(mip)) / float(PAGE_SIZE) - vec2(pageAt(uv, mip));
+    inPage = clamp(inPage, 0.5 / float(PAGE_SIZE), 1.0 - 0.5 / float(PAGE_SIZE));
+
+    uvec2 slots = uvec2(textureSize(pageCache, 0)) / PAGE_SIZE;
+    vec2 slotCorner = vec2(slot % slots.x, slot / slots.x);
+    outColor = textureLod(pageCache, (slotCorner + inPage) / vec2(slots), 0.0);
+#endif
+}
@@ -0,0 +1,19 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// A quad over the whole screen, showing part of the virtual texture
+
+layout(push_constant) uniform PushConstants {
+    // The texture coordinates of the top left corner, and the size of the
+    // screen in texture coordinates
+    vec4 view;
+} pushConstants;
+
+layout(location = 0) out vec2 fragTexCoord;
+
+void main() {
+    // A triangle strip of the four corners
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    fragTexCoord = pushConstants.view.xy + corner * pushConstants.view.zw;
+}